@@ -1,5 +1,8 @@
 #include "Algo2d.h"
 
+#include <algorithm>
+#include <cmath>
+
 bool geodb::algo::LineLineIntersection
 (
     double startX1, double startY1, double endX1, double endY1,
@@ -43,3 +46,77 @@ bool geodb::algo::LineRectangleIntersection
 		   geodb::algo::LineLineIntersection(startX, startY, endX, endY, rightX, bottomY, leftX, bottomY) ||
 		   geodb::algo::LineLineIntersection(startX, startY, endX, endY, leftX, bottomY, leftX, topY);
 }
+
+double geodb::algo::PointPointDistance(double x1, double y1, double x2, double y2)
+{
+	return std::hypot(x2 - x1, y2 - y1);
+}
+
+double geodb::algo::PointSegmentDistance
+(
+	double x, double y,
+	double startX, double startY, double endX, double endY
+)
+{
+	const auto dx = endX - startX;
+	const auto dy = endY - startY;
+	const auto lengthSquared = dx * dx + dy * dy;
+
+	if (lengthSquared == 0)
+	{
+		return PointPointDistance(x, y, startX, startY);
+	}
+
+	const auto t = std::clamp(((x - startX) * dx + (y - startY) * dy) / lengthSquared, 0.0, 1.0);
+	return PointPointDistance(x, y, startX + t * dx, startY + t * dy);
+}
+
+double geodb::algo::SegmentSegmentDistance
+(
+	double startX1, double startY1, double endX1, double endY1,
+	double startX2, double startY2, double endX2, double endY2
+)
+{
+	if (LineLineIntersection(startX1, startY1, endX1, endY1, startX2, startY2, endX2, endY2))
+	{
+		return 0.0;
+	}
+
+	return std::min({
+		PointSegmentDistance(startX1, startY1, startX2, startY2, endX2, endY2),
+		PointSegmentDistance(endX1, endY1, startX2, startY2, endX2, endY2),
+		PointSegmentDistance(startX2, startY2, startX1, startY1, endX1, endY1),
+		PointSegmentDistance(endX2, endY2, startX1, startY1, endX1, endY1)
+	});
+}
+
+double geodb::algo::PointBoxDistance(double x, double y, double minX, double minY, double maxX, double maxY)
+{
+	const auto dx = std::max({ minX - x, 0.0, x - maxX });
+	const auto dy = std::max({ minY - y, 0.0, y - maxY });
+	return std::hypot(dx, dy);
+}
+
+double geodb::algo::SegmentBoxDistance
+(
+	double startX, double startY, double endX, double endY,
+	double minX, double minY, double maxX, double maxY
+)
+{
+	const auto startInside = startX >= minX && startX <= maxX && startY >= minY && startY <= maxY;
+	const auto endInside = endX >= minX && endX <= maxX && endY >= minY && endY <= maxY;
+
+	if (startInside || endInside || LineRectangleIntersection(startX, startY, endX, endY, minX, maxY, maxX - minX, maxY - minY))
+	{
+		return 0.0;
+	}
+
+	return std::min({
+		PointBoxDistance(startX, startY, minX, minY, maxX, maxY),
+		PointBoxDistance(endX, endY, minX, minY, maxX, maxY),
+		PointSegmentDistance(minX, minY, startX, startY, endX, endY),
+		PointSegmentDistance(minX, maxY, startX, startY, endX, endY),
+		PointSegmentDistance(maxX, minY, startX, startY, endX, endY),
+		PointSegmentDistance(maxX, maxY, startX, startY, endX, endY)
+	});
+}
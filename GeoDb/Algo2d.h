@@ -15,5 +15,27 @@ namespace geodb
 			double startX, double startY, double endX, double endY,
 			double rectTopLeftX, double rectTopLeftY, double rectWidth, double rectHeight
 		);
+
+		double PointPointDistance(double x1, double y1, double x2, double y2);
+
+		double PointSegmentDistance
+		(
+			double x, double y,
+			double startX, double startY, double endX, double endY
+		);
+
+		double SegmentSegmentDistance
+		(
+			double startX1, double startY1, double endX1, double endY1,
+			double startX2, double startY2, double endX2, double endY2
+		);
+
+		double PointBoxDistance(double x, double y, double minX, double minY, double maxX, double maxY);
+
+		double SegmentBoxDistance
+		(
+			double startX, double startY, double endX, double endY,
+			double minX, double minY, double maxX, double maxY
+		);
 	}
 }
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include "ObjectType.h"
+#include "../Quadtree/Rectangle.h"
+
+namespace geodb
+{
+	// Index entry with float bounds in the index's local frame, rounded outwards so that the stored box
+	// always contains the original one, and the object index packed together with the object type
+	class CompactBoundingBox
+	{
+	public:
+		static constexpr std::size_t MaxObjectIndex = (std::size_t{ 1 } << 31) - 1;
+
+		static CompactBoundingBox Of
+		(
+			std::size_t objectIndex,
+			ObjectType objectType,
+			const quadtree::Rectangle<double>& box,
+			double originX,
+			double originY
+		)
+		{
+			return CompactBoundingBox{
+				objectIndex,
+				objectType,
+				RoundDown(box.GetCenterX() - box.GetHalfWidth() - originX),
+				RoundDown(box.GetCenterY() - box.GetHalfHeight() - originY),
+				RoundUp(box.GetCenterX() + box.GetHalfWidth() - originX),
+				RoundUp(box.GetCenterY() + box.GetHalfHeight() - originY)
+			};
+		}
+
+		CompactBoundingBox(std::size_t objectIndex, ObjectType objectType, float minX, float minY, float maxX, float maxY)
+			: m_minX{ minX }
+			, m_minY{ minY }
+			, m_maxX{ maxX }
+			, m_maxY{ maxY }
+		{
+			if (objectIndex > MaxObjectIndex)
+			{
+				throw std::out_of_range{ "Object index does not fit into a compact index entry" };
+			}
+			m_packedObject = static_cast<std::uint32_t>(objectIndex << 1) | (objectType == ObjectType::Way ? 1u : 0u);
+		}
+
+		CompactBoundingBox() {}
+
+		friend bool operator==(const CompactBoundingBox& b1, const CompactBoundingBox& b2) = default;
+
+		// Center and half sizes are computed in double, so center -/+ half size gives the stored bounds exactly
+		double GetCenterX() const { return (static_cast<double>(m_minX) + m_maxX) / 2.0; }
+
+		double GetCenterY() const { return (static_cast<double>(m_minY) + m_maxY) / 2.0; }
+
+		double GetHalfWidth() const { return (static_cast<double>(m_maxX) - m_minX) / 2.0; }
+
+		double GetHalfHeight() const { return (static_cast<double>(m_maxY) - m_minY) / 2.0; }
+
+		float GetMinX() const { return m_minX; }
+
+		float GetMinY() const { return m_minY; }
+
+		float GetMaxX() const { return m_maxX; }
+
+		float GetMaxY() const { return m_maxY; }
+
+		ObjectType GetObjectType() const { return (m_packedObject & 1u) != 0 ? ObjectType::Way : ObjectType::Node; }
+
+		std::size_t GetObjectIndex() const { return m_packedObject >> 1; }
+
+		static float RoundDown(double value)
+		{
+			auto result = static_cast<float>(value);
+			if (static_cast<double>(result) > value)
+			{
+				result = std::nextafter(result, -std::numeric_limits<float>::infinity());
+			}
+			return result;
+		}
+
+		static float RoundUp(double value)
+		{
+			auto result = static_cast<float>(value);
+			if (static_cast<double>(result) < value)
+			{
+				result = std::nextafter(result, std::numeric_limits<float>::infinity());
+			}
+			return result;
+		}
+
+	private:
+		float m_minX = 0.0f;
+		float m_minY = 0.0f;
+		float m_maxX = 0.0f;
+		float m_maxY = 0.0f;
+		std::uint32_t m_packedObject = 0;
+	};
+}
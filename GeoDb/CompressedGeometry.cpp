@@ -0,0 +1,272 @@
+#include "CompressedGeometry.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::uint32_t FileMagic = 0x47424447;
+	constexpr std::uint32_t FileVersion = 1;
+	constexpr std::uint64_t ContinuationBits = 0x8080808080808080;
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	std::int64_t UnZigZag(std::uint64_t value)
+	{
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+	void AppendVarint(std::uint64_t value, std::vector<std::uint8_t>& bytes)
+	{
+		while (value >= 0x80)
+		{
+			bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	std::uint64_t ReadVarint(const std::uint8_t*& position, const std::uint8_t* end)
+	{
+		auto value = std::uint64_t{ 0 };
+		for (auto shift = 0; position != end && shift < 64; shift += 7)
+		{
+			const auto byte = *position++;
+			value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return value;
+			}
+		}
+		throw std::runtime_error{ "Compressed geometry is corrupted" };
+	}
+
+	template<typename T>
+	void WriteValue(std::ostream& out, T value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	template<typename T>
+	T ReadValue(std::istream& in)
+	{
+		auto value = T{};
+		if (!in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+		{
+			throw std::runtime_error{ "Compressed geometry is truncated" };
+		}
+		return value;
+	}
+}
+
+namespace geodb
+{
+	CompressedGeometry::Decoder::Decoder(const CompressedGeometry& geometry, std::size_t wayId)
+		: m_geometry{ geometry }
+		, m_position{ geometry.m_bytes.data() + geometry.m_ways[wayId].offset }
+		, m_end{ m_position + geometry.m_ways[wayId].bytes }
+		, m_remainingVertices{ geometry.m_ways[wayId].vertices }
+	{ }
+
+	std::size_t CompressedGeometry::Decoder::Next()
+	{
+		const auto limit = std::min(BlockSize, m_remainingVertices);
+		auto count = std::size_t{ 0 };
+		while (count < limit)
+		{
+			// Eight bytes without continuation bits are four vertices with one byte deltas, decoded without branches
+			if constexpr (std::endian::native == std::endian::little)
+			{
+				if (limit - count >= 4 && m_end - m_position >= 8)
+				{
+					auto word = std::uint64_t{};
+					std::memcpy(&word, m_position, sizeof(word));
+					if ((word & ContinuationBits) == 0)
+					{
+						for (auto i = 0; i < 4; ++i)
+						{
+							m_qx += UnZigZag((word >> (16 * i)) & 0x7f);
+							m_qy += UnZigZag((word >> (16 * i + 8)) & 0x7f);
+							m_quantizedX[count] = m_qx;
+							m_quantizedY[count] = m_qy;
+							++count;
+						}
+						m_position += 8;
+						continue;
+					}
+				}
+			}
+
+			m_qx += UnZigZag(ReadVarint(m_position, m_end));
+			m_qy += UnZigZag(ReadVarint(m_position, m_end));
+			m_quantizedX[count] = m_qx;
+			m_quantizedY[count] = m_qy;
+			++count;
+		}
+		m_remainingVertices -= count;
+
+		const auto resolution = m_geometry.m_resolution;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			m_x[i] = m_geometry.m_originX + static_cast<double>(m_quantizedX[i]) * resolution;
+			m_y[i] = m_geometry.m_originY + static_cast<double>(m_quantizedY[i]) * resolution;
+		}
+		return count;
+	}
+
+	CompressedGeometry CompressedGeometry::FromMap(const Map& map, double resolution)
+	{
+		auto minX = 0.0;
+		auto minY = 0.0;
+		auto maxX = 0.0;
+		auto maxY = 0.0;
+		const auto& nodes = map.GetNodes();
+		if (!nodes.empty())
+		{
+			minX = maxX = nodes[0].GetX();
+			minY = maxY = nodes[0].GetY();
+		}
+		for (const auto& node : nodes)
+		{
+			minX = std::min(minX, node.GetX());
+			minY = std::min(minY, node.GetY());
+			maxX = std::max(maxX, node.GetX());
+			maxY = std::max(maxY, node.GetY());
+		}
+
+		auto geometry = CompressedGeometry{ resolution, (minX + maxX) / 2.0, (minY + maxY) / 2.0 };
+		geometry.m_ways.resize(map.GetWays().size());
+		for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+		{
+			geometry.Encode(map.GetWays()[i], map, geometry.m_ways[i]);
+		}
+		return geometry;
+	}
+
+	CompressedGeometry CompressedGeometry::Read(std::istream& in)
+	{
+		if (ReadValue<std::uint32_t>(in) != FileMagic || ReadValue<std::uint32_t>(in) != FileVersion)
+		{
+			throw std::runtime_error{ "Not a compressed geometry file" };
+		}
+		const auto resolution = ReadValue<double>(in);
+		const auto originX = ReadValue<double>(in);
+		const auto originY = ReadValue<double>(in);
+		auto geometry = CompressedGeometry{ resolution, originX, originY };
+
+		geometry.m_ways.resize(ReadValue<std::uint64_t>(in));
+		auto offset = std::uint64_t{ 0 };
+		for (auto& way : geometry.m_ways)
+		{
+			way.offset = offset;
+			way.vertices = ReadValue<std::uint32_t>(in);
+			way.bytes = ReadValue<std::uint32_t>(in);
+			offset += way.bytes;
+		}
+
+		geometry.m_bytes.resize(offset);
+		if (!in.read(reinterpret_cast<char*>(geometry.m_bytes.data()), static_cast<std::streamsize>(offset)))
+		{
+			throw std::runtime_error{ "Compressed geometry is truncated" };
+		}
+		return geometry;
+	}
+
+	CompressedGeometry::CompressedGeometry(double resolution, double originX, double originY)
+		: m_resolution{ resolution }
+		, m_originX{ originX }
+		, m_originY{ originY }
+	{
+		if (!(resolution > 0.0))
+		{
+			throw std::invalid_argument{ "Resolution must be positive" };
+		}
+	}
+
+	void CompressedGeometry::SetWay(std::size_t wayId, const Way& way, const Map& map)
+	{
+		if (wayId >= m_ways.size())
+		{
+			m_ways.resize(wayId + 1);
+		}
+		m_staleBytes += m_ways[wayId].bytes;
+		Encode(way, map, m_ways[wayId]);
+
+		if (m_staleBytes > m_bytes.size() / 2)
+		{
+			Compact();
+		}
+	}
+
+	// Ways are written in order with their encodings back to back, which also drops replaced encodings
+	void CompressedGeometry::Write(std::ostream& out) const
+	{
+		WriteValue(out, FileMagic);
+		WriteValue(out, FileVersion);
+		WriteValue(out, m_resolution);
+		WriteValue(out, m_originX);
+		WriteValue(out, m_originY);
+		WriteValue(out, static_cast<std::uint64_t>(m_ways.size()));
+		for (const auto& way : m_ways)
+		{
+			WriteValue(out, way.vertices);
+			WriteValue(out, way.bytes);
+		}
+		for (const auto& way : m_ways)
+		{
+			out.write(reinterpret_cast<const char*>(m_bytes.data() + way.offset), way.bytes);
+		}
+	}
+
+	void CompressedGeometry::Encode(const Way& way, const Map& map, WayRange& range)
+	{
+		const auto& wayNodes = way.GetNodes();
+		if (wayNodes.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::length_error{ "Too many nodes in a way" };
+		}
+
+		const auto start = m_bytes.size();
+		auto previousX = std::int64_t{ 0 };
+		auto previousY = std::int64_t{ 0 };
+		for (const auto nodeId : wayNodes)
+		{
+			const auto& node = map.GetNodes()[nodeId];
+			const auto x = std::llround((node.GetX() - m_originX) / m_resolution);
+			const auto y = std::llround((node.GetY() - m_originY) / m_resolution);
+			AppendVarint(ZigZag(x - previousX), m_bytes);
+			AppendVarint(ZigZag(y - previousY), m_bytes);
+			previousX = x;
+			previousY = y;
+		}
+
+		if (m_bytes.size() - start > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::length_error{ "Way geometry is too large" };
+		}
+		range.offset = start;
+		range.bytes = static_cast<std::uint32_t>(m_bytes.size() - start);
+		range.vertices = static_cast<std::uint32_t>(wayNodes.size());
+	}
+
+	void CompressedGeometry::Compact()
+	{
+		auto bytes = std::vector<std::uint8_t>{};
+		bytes.reserve(m_bytes.size() - m_staleBytes);
+		for (auto& way : m_ways)
+		{
+			const auto start = bytes.size();
+			bytes.insert(bytes.end(), m_bytes.begin() + way.offset, m_bytes.begin() + way.offset + way.bytes);
+			way.offset = start;
+		}
+		m_bytes = std::move(bytes);
+		m_staleBytes = 0;
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "Map.h"
+
+namespace geodb
+{
+	// Way geometry kept apart from the map as one byte stream: every way stores its vertices as zig-zag varint
+	// deltas of coordinates quantized to a fixed resolution, so a typical vertex takes 2 to 4 bytes instead of an
+	// index plus a node of two doubles
+	class CompressedGeometry
+	{
+	public:
+		// About 6 cm with the default projection
+		static constexpr double DefaultResolution = 1e-4;
+
+		// Decodes the vertices of one way in blocks of plain coordinate arrays that callers can loop over
+		class Decoder
+		{
+		public:
+			static constexpr std::size_t BlockSize = 64;
+
+			Decoder(const CompressedGeometry& geometry, std::size_t wayId);
+
+			// Decodes the next block of vertices and returns their count, zero once the way is exhausted
+			std::size_t Next();
+
+			const double* GetX() const { return m_x.data(); }
+
+			const double* GetY() const { return m_y.data(); }
+
+		private:
+			const CompressedGeometry& m_geometry;
+			const std::uint8_t* m_position;
+			const std::uint8_t* m_end;
+			std::size_t m_remainingVertices;
+			std::int64_t m_qx = 0;
+			std::int64_t m_qy = 0;
+			std::array<std::int64_t, BlockSize> m_quantizedX;
+			std::array<std::int64_t, BlockSize> m_quantizedY;
+			std::array<double, BlockSize> m_x;
+			std::array<double, BlockSize> m_y;
+		};
+
+	public:
+		static CompressedGeometry FromMap(const Map& map, double resolution = DefaultResolution);
+
+		// Restores geometry saved with Write
+		static CompressedGeometry Read(std::istream& in);
+
+		CompressedGeometry(double resolution, double originX, double originY);
+
+		double GetResolution() const { return m_resolution; }
+
+		std::size_t GetWayCount() const { return m_ways.size(); }
+
+		std::size_t GetVertexCount(std::size_t wayId) const { return m_ways[wayId].vertices; }
+
+		std::size_t GetEncodedBytes() const { return m_bytes.size() - m_staleBytes; }
+
+		std::size_t GetAllocatedBytes() const
+		{
+			return m_bytes.capacity() + m_ways.capacity() * sizeof(WayRange);
+		}
+
+		// Encodes the current geometry of a way, replacing an earlier encoding of it
+		void SetWay(std::size_t wayId, const Way& way, const Map& map);
+
+		void Write(std::ostream& out) const;
+
+	private:
+		struct WayRange
+		{
+			std::uint64_t offset = 0;
+			std::uint32_t bytes = 0;
+			std::uint32_t vertices = 0;
+		};
+
+		void Encode(const Way& way, const Map& map, WayRange& range);
+
+		void Compact();
+
+	private:
+		double m_resolution;
+		double m_originX;
+		double m_originY;
+		std::vector<std::uint8_t> m_bytes;
+		std::vector<WayRange> m_ways;
+		// Bytes of encodings replaced by SetWay, reclaimed once they make up half of the stream
+		std::size_t m_staleBytes = 0;
+	};
+}
@@ -0,0 +1,119 @@
+#include "ConcurrentDatabase.h"
+
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace geodb
+{
+	ConcurrentDatabase ConcurrentDatabase::FromFile(std::string_view osmFileName)
+	{
+		return ConcurrentDatabase{ Database::LoadMap(osmFileName) };
+	}
+
+	ConcurrentDatabase::ConcurrentDatabase(Map map)
+		: m_instances{ Database::FromMap(map), Database::FromMap(std::move(map)) }
+	{ }
+
+	std::vector<std::size_t> ConcurrentDatabase::Query(const quadtree::Rectangle<double>& searchWindow)
+	{
+		return Read([&](Database& database) { return database.Query(searchWindow); });
+	}
+
+	std::vector<QueryResult> ConcurrentDatabase::QueryObjects(const quadtree::Rectangle<double>& searchWindow)
+	{
+		return Read([&](Database& database) { return database.QueryObjects(searchWindow); });
+	}
+
+	std::vector<DistanceQueryResult> ConcurrentDatabase::QueryRadius(double centerX, double centerY, double radius)
+	{
+		return Read([&](Database& database) { return database.QueryRadius(centerX, centerY, radius); });
+	}
+
+	ChangeSummary ConcurrentDatabase::ApplyChanges(std::string_view oscFileName)
+	{
+		return ApplyChanges(Database::LoadChanges(oscFileName));
+	}
+
+	ChangeSummary ConcurrentDatabase::ApplyChanges(const MapChanges& changes)
+	{
+		const auto lock = std::lock_guard{ m_writerMutex };
+
+		const auto published = m_published.load();
+		const auto hidden = 1 - published;
+
+		// Applying the same changes to an identical copy fails at the same point, so when the first
+		// copy throws, the second one is still brought to the same state before rethrowing
+		auto summary = ChangeSummary{};
+		auto error = std::exception_ptr{};
+		try
+		{
+			summary = m_instances[hidden].ApplyChanges(changes);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		m_published.store(hidden);
+		AdvanceEpoch();
+
+		try
+		{
+			m_instances[published].ApplyChanges(changes);
+		}
+		catch (...)
+		{
+			if (error == nullptr)
+			{
+				error = std::current_exception();
+			}
+		}
+
+		if (error != nullptr)
+		{
+			std::rethrow_exception(error);
+		}
+		return summary;
+	}
+
+	ConcurrentDatabase::EpochPin::EpochPin(ConcurrentDatabase& database)
+		: m_count{ database.m_readers[database.m_epoch.load()][GetReaderStripe()] }
+	{
+		m_count.value.fetch_add(1);
+	}
+
+	ConcurrentDatabase::EpochPin::~EpochPin()
+	{
+		m_count.value.fetch_sub(1);
+	}
+
+	std::size_t ConcurrentDatabase::GetReaderStripe()
+	{
+		thread_local const auto stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % ReaderStripes;
+		return stripe;
+	}
+
+	void ConcurrentDatabase::WaitForReaders(int epoch) const
+	{
+		for (const auto& count : m_readers[epoch])
+		{
+			while (count.value.load() != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	// Readers that pinned either epoch may still use the copy that was published before, once both
+	// epochs have drained no reader can reach it anymore
+	void ConcurrentDatabase::AdvanceEpoch()
+	{
+		const auto current = m_epoch.load();
+		const auto next = 1 - current;
+
+		WaitForReaders(next);
+		m_epoch.store(next);
+		WaitForReaders(current);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "Database.h"
+
+namespace geodb
+{
+	// Database that serves reads while changes are applied, using the left-right scheme: two copies
+	// of the database are kept, readers pin an epoch and use the copy that is currently published,
+	// while a writer changes the other copy, publishes it and waits for the readers of the old one
+	// to leave before bringing it up to date. Readers never wait, writers are serialized
+	class ConcurrentDatabase
+	{
+	public:
+		static ConcurrentDatabase FromFile(std::string_view osmFileName);
+
+		explicit ConcurrentDatabase(Map map);
+
+		ConcurrentDatabase(const ConcurrentDatabase& other) = delete;
+
+		ConcurrentDatabase& operator=(const ConcurrentDatabase& other) = delete;
+
+		// Calls reader(Database&) on a snapshot that no writer changes until the reader returns,
+		// the reader must only use read operations of the database
+		template<typename Reader>
+		decltype(auto) Read(Reader&& reader)
+		{
+			const auto pin = EpochPin{ *this };
+			return reader(m_instances[m_published.load()]);
+		}
+
+		std::vector<std::size_t> Query(const quadtree::Rectangle<double>& searchWindow);
+
+		std::vector<QueryResult> QueryObjects(const quadtree::Rectangle<double>& searchWindow);
+
+		std::vector<DistanceQueryResult> QueryRadius(double centerX, double centerY, double radius);
+
+		ChangeSummary ApplyChanges(std::string_view oscFileName);
+
+		ChangeSummary ApplyChanges(const MapChanges& changes);
+
+	private:
+		static constexpr std::size_t ReaderStripes = 16;
+
+		// Each counter has its own cache line, so that readers on different threads do not contend
+		struct alignas(64) ReaderCount
+		{
+			std::atomic<std::int64_t> value = 0;
+		};
+
+		using ReaderCounts = std::array<ReaderCount, ReaderStripes>;
+
+		class EpochPin
+		{
+		public:
+			explicit EpochPin(ConcurrentDatabase& database);
+
+			EpochPin(const EpochPin& other) = delete;
+
+			EpochPin& operator=(const EpochPin& other) = delete;
+
+			~EpochPin();
+
+		private:
+			ReaderCount& m_count;
+		};
+
+		static std::size_t GetReaderStripe();
+
+		void WaitForReaders(int epoch) const;
+
+		void AdvanceEpoch();
+
+	private:
+		std::array<Database, 2> m_instances;
+		std::atomic<int> m_published = 0;
+		std::atomic<int> m_epoch = 0;
+		std::array<ReaderCounts, 2> m_readers;
+		std::mutex m_writerMutex;
+	};
+}
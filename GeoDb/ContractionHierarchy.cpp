@@ -0,0 +1,277 @@
+#include "ContractionHierarchy.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "RoadGraph.h"
+
+namespace
+{
+	using Edge = geodb::ContractionHierarchy::Edge;
+
+	constexpr auto NoVertex = geodb::RoadGraph::NoVertex;
+	constexpr auto Infinity = std::numeric_limits<double>::infinity();
+
+	// Witness searches give up after this many vertices and keep the shortcut, which is never wrong, only redundant
+	constexpr std::size_t WitnessSettleLimit = 128;
+
+	// Keeps the shorter of parallel edges
+	void AddEdge(std::vector<Edge>& edges, const Edge& edge)
+	{
+		const auto existing = std::find_if(edges.begin(), edges.end(), [&](const Edge& e) { return e.vertex == edge.vertex; });
+		if (existing == edges.end())
+		{
+			edges.push_back(edge);
+		}
+		else if (edge.length < existing->length)
+		{
+			*existing = edge;
+		}
+	}
+
+	void RemoveEdge(std::vector<Edge>& edges, std::uint32_t vertex)
+	{
+		std::erase_if(edges, [vertex](const Edge& e) { return e.vertex == vertex; });
+	}
+
+	// Remaining graph while vertices are contracted, a contracted vertex keeps its edges and is removed from the
+	// lists of its neighbors, so that it only keeps edges to vertices contracted later
+	class Contractor
+	{
+	public:
+		explicit Contractor(const geodb::RoadGraph& graph)
+			: m_out(graph.GetVertexCount())
+			, m_in(graph.GetVertexCount())
+			, m_removedNeighbors(graph.GetVertexCount(), 0)
+			, m_levels(graph.GetVertexCount(), 0)
+			, m_distances(graph.GetVertexCount(), Infinity)
+			, m_isTarget(graph.GetVertexCount(), false)
+		{
+			for (std::uint32_t v = 0; v < graph.GetVertexCount(); ++v)
+			{
+				for (const auto& edge : graph.GetOutEdges(v))
+				{
+					AddEdge(m_out[v], Edge{ edge.vertex, NoVertex, edge.length });
+					AddEdge(m_in[edge.vertex], Edge{ v, NoVertex, edge.length });
+				}
+			}
+		}
+
+		// Edge difference weighted highest, with removed neighbors and the level in the hierarchy added so that
+		// contractions spread evenly over the graph
+		int GetPriority(std::uint32_t vertex)
+		{
+			auto shortcuts = 0;
+			FindShortcuts(vertex, [&](std::uint32_t, const Edge&) { ++shortcuts; });
+			const auto edgeDifference = shortcuts - static_cast<int>(m_in[vertex].size() + m_out[vertex].size());
+			return 2 * edgeDifference + static_cast<int>(m_removedNeighbors[vertex] + m_levels[vertex]);
+		}
+
+		std::size_t Contract(std::uint32_t vertex)
+		{
+			auto shortcuts = std::vector<std::pair<std::uint32_t, Edge>>{};
+			FindShortcuts(vertex, [&](std::uint32_t source, const Edge& shortcut) { shortcuts.emplace_back(source, shortcut); });
+			for (const auto& [source, shortcut] : shortcuts)
+			{
+				AddEdge(m_out[source], shortcut);
+				AddEdge(m_in[shortcut.vertex], Edge{ source, shortcut.middle, shortcut.length });
+			}
+
+			for (const auto& edge : m_in[vertex])
+			{
+				RemoveEdge(m_out[edge.vertex], vertex);
+				++m_removedNeighbors[edge.vertex];
+				m_levels[edge.vertex] = std::max(m_levels[edge.vertex], m_levels[vertex] + 1);
+			}
+			for (const auto& edge : m_out[vertex])
+			{
+				RemoveEdge(m_in[edge.vertex], vertex);
+				++m_removedNeighbors[edge.vertex];
+				m_levels[edge.vertex] = std::max(m_levels[edge.vertex], m_levels[vertex] + 1);
+			}
+			return shortcuts.size();
+		}
+
+		std::vector<std::vector<Edge>>& GetOutEdges() { return m_out; }
+
+		std::vector<std::vector<Edge>>& GetInEdges() { return m_in; }
+
+	private:
+		// Reports a shortcut for every pair of neighbors whose path through the vertex no witness path beats
+		template<typename OnShortcut>
+		void FindShortcuts(std::uint32_t vertex, OnShortcut onShortcut)
+		{
+			auto maxOut = 0.0;
+			for (const auto& edge : m_out[vertex])
+			{
+				maxOut = std::max(maxOut, edge.length);
+			}
+
+			for (const auto& in : m_in[vertex])
+			{
+				SearchWitnesses(in.vertex, vertex, in.length + maxOut);
+				for (const auto& out : m_out[vertex])
+				{
+					const auto length = in.length + out.length;
+					if (out.vertex != in.vertex && m_distances[out.vertex] > length)
+					{
+						onShortcut(in.vertex, Edge{ out.vertex, vertex, length });
+					}
+				}
+				ResetWitnesses();
+			}
+		}
+
+		// Stops once every out-neighbor of the excluded vertex is settled, or nothing within maxLength is left
+		void SearchWitnesses(std::uint32_t source, std::uint32_t excluded, double maxLength)
+		{
+			auto targets = m_out[excluded].size();
+			for (const auto& edge : m_out[excluded])
+			{
+				m_isTarget[edge.vertex] = true;
+			}
+			m_distances[source] = 0.0;
+			m_touched.push_back(source);
+			m_queue.emplace_back(0.0, source);
+
+			auto settled = std::size_t{ 0 };
+			while (!m_queue.empty() && settled < WitnessSettleLimit && targets > 0)
+			{
+				std::pop_heap(m_queue.begin(), m_queue.end(), std::greater<>{});
+				const auto [distance, vertex] = m_queue.back();
+				m_queue.pop_back();
+				if (distance > m_distances[vertex])
+				{
+					continue;
+				}
+				if (distance > maxLength)
+				{
+					break;
+				}
+				++settled;
+				if (m_isTarget[vertex])
+				{
+					--targets;
+				}
+
+				for (const auto& edge : m_out[vertex])
+				{
+					const auto next = distance + edge.length;
+					if (edge.vertex != excluded && next < m_distances[edge.vertex])
+					{
+						if (m_distances[edge.vertex] == Infinity)
+						{
+							m_touched.push_back(edge.vertex);
+						}
+						m_distances[edge.vertex] = next;
+						m_queue.emplace_back(next, edge.vertex);
+						std::push_heap(m_queue.begin(), m_queue.end(), std::greater<>{});
+					}
+				}
+			}
+
+			m_queue.clear();
+			for (const auto& edge : m_out[excluded])
+			{
+				m_isTarget[edge.vertex] = false;
+			}
+		}
+
+		void ResetWitnesses()
+		{
+			for (const auto vertex : m_touched)
+			{
+				m_distances[vertex] = Infinity;
+			}
+			m_touched.clear();
+		}
+
+	private:
+		std::vector<std::vector<Edge>> m_out;
+		std::vector<std::vector<Edge>> m_in;
+		std::vector<std::uint32_t> m_removedNeighbors;
+		// One more than the highest level among the contracted neighbors
+		std::vector<std::uint32_t> m_levels;
+		std::vector<double> m_distances;
+		std::vector<std::uint32_t> m_touched;
+		std::vector<bool> m_isTarget;
+		std::vector<std::pair<double, std::uint32_t>> m_queue;
+	};
+
+	void ToCompressedRows(std::vector<std::vector<Edge>>& lists, std::vector<std::uint32_t>& first, std::vector<Edge>& edges)
+	{
+		first.reserve(lists.size() + 1);
+		first.push_back(0);
+		for (auto& list : lists)
+		{
+			edges.insert(edges.end(), list.begin(), list.end());
+			first.push_back(static_cast<std::uint32_t>(edges.size()));
+			std::vector<Edge>{}.swap(list);
+		}
+	}
+}
+
+namespace geodb
+{
+	// Priorities are updated lazily: a vertex whose priority grew since it was queued goes back into the queue
+	ContractionHierarchy::ContractionHierarchy(const RoadGraph& graph)
+	{
+		auto contractor = Contractor{ graph };
+
+		using Entry = std::pair<int, std::uint32_t>;
+		auto queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<>>{};
+		for (std::uint32_t v = 0; v < graph.GetVertexCount(); ++v)
+		{
+			queue.emplace(contractor.GetPriority(v), v);
+		}
+
+		while (!queue.empty())
+		{
+			const auto vertex = queue.top().second;
+			queue.pop();
+			const auto priority = contractor.GetPriority(vertex);
+			if (!queue.empty() && priority > queue.top().first)
+			{
+				queue.emplace(priority, vertex);
+				continue;
+			}
+			m_shortcutCount += contractor.Contract(vertex);
+		}
+
+		ToCompressedRows(contractor.GetOutEdges(), m_firstOut, m_outEdges);
+		ToCompressedRows(contractor.GetInEdges(), m_firstIn, m_inEdges);
+	}
+
+	// The bypassed vertex was contracted before both ends, so it keeps the two edges the shortcut replaced
+	void ContractionHierarchy::Unpack(std::uint32_t start, std::uint32_t end, std::uint32_t middle, std::vector<std::uint32_t>& vertices) const
+	{
+		struct Pending
+		{
+			std::uint32_t start;
+			std::uint32_t end;
+			std::uint32_t middle;
+		};
+
+		const auto findMiddle = [](std::span<const Edge> edges, std::uint32_t vertex)
+			{
+				return std::find_if(edges.begin(), edges.end(), [&](const Edge& e) { return e.vertex == vertex; })->middle;
+			};
+
+		auto pending = std::vector<Pending>{ Pending{ start, end, middle } };
+		while (!pending.empty())
+		{
+			const auto edge = pending.back();
+			pending.pop_back();
+			if (edge.middle == NoVertex)
+			{
+				vertices.push_back(edge.end);
+				continue;
+			}
+			pending.push_back(Pending{ edge.middle, edge.end, findMiddle(GetUpwardOutEdges(edge.middle), edge.end) });
+			pending.push_back(Pending{ edge.start, edge.middle, findMiddle(GetUpwardInEdges(edge.middle), edge.start) });
+		}
+	}
+}
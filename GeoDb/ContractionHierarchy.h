@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace geodb
+{
+	class RoadGraph;
+
+	// Vertices of the road graph contracted one after another in the order of how many shortcuts they add, each
+	// contraction connecting its remaining neighbors by shortcuts where no other path is as short. Routes then only
+	// need to search upwards from both ends, towards vertices contracted later
+	class ContractionHierarchy
+	{
+	public:
+		struct Edge
+		{
+			std::uint32_t vertex;
+			// Contracted vertex the shortcut bypasses, NoVertex for edges of the road graph
+			std::uint32_t middle;
+			double length;
+		};
+
+		explicit ContractionHierarchy(const RoadGraph& graph);
+
+		// Edges leaving the vertex towards vertices contracted later
+		std::span<const Edge> GetUpwardOutEdges(std::uint32_t vertex) const
+		{
+			return std::span<const Edge>{ m_outEdges }.subspan(m_firstOut[vertex], m_firstOut[vertex + 1] - m_firstOut[vertex]);
+		}
+
+		// Edges entering the vertex from vertices contracted later
+		std::span<const Edge> GetUpwardInEdges(std::uint32_t vertex) const
+		{
+			return std::span<const Edge>{ m_inEdges }.subspan(m_firstIn[vertex], m_firstIn[vertex + 1] - m_firstIn[vertex]);
+		}
+
+		std::size_t GetShortcutCount() const { return m_shortcutCount; }
+
+		// Appends the road graph vertices the edge from start to end passes, end included and start not
+		void Unpack(std::uint32_t start, std::uint32_t end, std::uint32_t middle, std::vector<std::uint32_t>& vertices) const;
+
+		std::size_t GetAllocatedBytes() const
+		{
+			return (m_firstOut.capacity() + m_firstIn.capacity()) * sizeof(std::uint32_t)
+				+ (m_outEdges.capacity() + m_inEdges.capacity()) * sizeof(Edge);
+		}
+
+	private:
+		std::vector<std::uint32_t> m_firstOut;
+		std::vector<Edge> m_outEdges;
+		std::vector<std::uint32_t> m_firstIn;
+		std::vector<Edge> m_inEdges;
+		std::size_t m_shortcutCount = 0;
+	};
+}
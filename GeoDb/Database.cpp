@@ -12,6 +12,7 @@
 #include "osmium/osm/way.hpp"
 
 #include "Algo2d.h"
+#include "HilbertOrder.h"
 
 namespace
 {
@@ -19,6 +20,7 @@ namespace
 	constexpr auto QuaterPi = Pi / 4.0;
 	constexpr auto DefaultR = 10000.0;
 	constexpr auto L0 = 0.0;
+	constexpr auto EarthRadiusMeters = 6371008.8;
 
 	inline double ProjectLongitude(double longitude, double r = DefaultR)
 	{
@@ -33,22 +35,76 @@ namespace
 			                        ((lattitude * Pi / 180.0) / 2.0)));
 	}
 
-	quadtree::Rectangle<double> GetMapArea(const geodb::Map& map)
+	inline double UnprojectLattitude(double y, double r = DefaultR)
+	{
+		return (2.0 * std::atan(std::exp(y / r)) - Pi / 2.0) * 180.0 / Pi;
+	}
+
+	template<typename DistanceShape>
+	double GetDistance(const DistanceShape& shape, const geodb::Way& way, const geodb::Map& map)
 	{
 		const auto& nodes = map.GetNodes();
+		const auto& wayNodes = way.GetNodes();
 
-		auto maxX = nodes[0].GetX();
-		auto maxY = nodes[0].GetY();
-		auto minX = nodes[0].GetX();
-		auto minY = nodes[0].GetY();
+		if (wayNodes.size() == 1)
+		{
+			return shape.DistanceToPoint(nodes[wayNodes[0]].GetX(), nodes[wayNodes[0]].GetY());
+		}
 
-		for (const auto& node : nodes)
+		auto distance = std::numeric_limits<double>::max();
+		for (std::size_t i = 0; i + 1 < wayNodes.size() && distance > 0.0; ++i)
 		{
-			maxX = std::max(maxX, node.GetX());
-			maxY = std::max(maxY, node.GetY());
-			minX = std::min(minX, node.GetX());
-			minY = std::min(minY, node.GetY());
+			const auto& start = nodes[wayNodes[i]];
+			const auto& end = nodes[wayNodes[i + 1]];
+			distance = std::min(distance, shape.DistanceToSegment(start.GetX(), start.GetY(), end.GetX(), end.GetY()));
 		}
+		return distance;
+	}
+
+	// Shape given in map coordinates, seen from the index's local frame
+	template<typename S>
+	class LocalShape
+	{
+	public:
+		LocalShape(const S& shape, double originX, double originY)
+			: m_shape{ shape }
+			, m_originX{ originX }
+			, m_originY{ originY }
+		{ }
+
+		geodb::CompactBoundingBox GetBoundingBox() const
+		{
+			return geodb::CompactBoundingBox::Of(0, geodb::ObjectType::Node, m_shape.GetBoundingBox(), m_originX, m_originY);
+		}
+
+		bool IntersectsBox(float minX, float minY, float maxX, float maxY) const
+		{
+			return m_shape.IntersectsBox(minX + m_originX, minY + m_originY, maxX + m_originX, maxY + m_originY);
+		}
+
+	private:
+		const S& m_shape;
+		double m_originX;
+		double m_originY;
+	};
+
+	// The index is centered at the origin, so float precision is best where most of the data is
+	// Entries are rounded outwards, so the area gets a little margin to keep them from making the root grow
+	quadtree::Rectangle<float> GetLocalArea(const quadtree::Rectangle<double>& area)
+	{
+		const auto pad = [](double halfSide)
+			{
+				return geodb::CompactBoundingBox::RoundUp(std::max(halfSide * (1.0 + 1e-6), 1.0));
+			};
+		return quadtree::Rectangle<float>{ 0.0f, 0.0f, pad(area.GetHalfWidth()), pad(area.GetHalfHeight()) };
+	}
+
+	quadtree::Rectangle<double> Enclose(const quadtree::Rectangle<double>& area, const quadtree::Rectangle<double>& other)
+	{
+		const auto minX = std::min(area.GetCenterX() - area.GetHalfWidth(), other.GetCenterX() - other.GetHalfWidth());
+		const auto maxX = std::max(area.GetCenterX() + area.GetHalfWidth(), other.GetCenterX() + other.GetHalfWidth());
+		const auto minY = std::min(area.GetCenterY() - area.GetHalfHeight(), other.GetCenterY() - other.GetHalfHeight());
+		const auto maxY = std::max(area.GetCenterY() + area.GetHalfHeight(), other.GetCenterY() + other.GetHalfHeight());
 
 		return quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
 	}
@@ -98,10 +154,14 @@ namespace
 
 		const auto& nodes = map.GetNodes();
 
-		for (std::size_t i = 0; i < way.GetNodes().size() - 1; ++i)
+		const auto& wayNodes = way.GetNodes();
+
+		for (std::size_t i = 0; i + 1 < wayNodes.size(); ++i)
 		{
+			const auto& start = nodes[wayNodes[i]];
+			const auto& end = nodes[wayNodes[i + 1]];
 			const auto lineIntersectsWindow = geodb::algo::LineRectangleIntersection(
-				nodes[i].GetX(), nodes[i].GetY(), nodes[i + 1].GetX(), nodes[i + 1].GetY(),
+				start.GetX(), start.GetY(), end.GetX(), end.GetY(),
 				searchWindow.GetCenterX() - searchWindow.GetHalfWidth(), searchWindow.GetCenterY() + searchWindow.GetHalfHeight(),
 				searchWindow.GetHalfWidth() * 2.0, searchWindow.GetHalfHeight() * 2
 			);
@@ -114,6 +174,48 @@ namespace
 		return false;
 	}
 
+	bool Intersects(
+		const geodb::Way& way,
+		const quadtree::Rectangle<double>& searchWindow,
+		const geodb::CompressedGeometry& geometry,
+		std::size_t wayId
+	)
+	{
+		if (Contains(searchWindow, way.GetBoundingBox()))
+		{
+			return true;
+		}
+
+		const auto windowX = searchWindow.GetCenterX() - searchWindow.GetHalfWidth();
+		const auto windowY = searchWindow.GetCenterY() + searchWindow.GetHalfHeight();
+		const auto windowWidth = searchWindow.GetHalfWidth() * 2.0;
+		const auto windowHeight = searchWindow.GetHalfHeight() * 2.0;
+
+		// The last vertex of a block starts the first segment of the next one
+		auto decoder = geodb::CompressedGeometry::Decoder{ geometry, wayId };
+		auto hasPrevious = false;
+		auto previousX = 0.0;
+		auto previousY = 0.0;
+		for (auto count = decoder.Next(); count != 0; count = decoder.Next())
+		{
+			const auto x = decoder.GetX();
+			const auto y = decoder.GetY();
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (hasPrevious && geodb::algo::LineRectangleIntersection(
+					previousX, previousY, x[i], y[i], windowX, windowY, windowWidth, windowHeight))
+				{
+					return true;
+				}
+				hasPrevious = true;
+				previousX = x[i];
+				previousY = y[i];
+			}
+		}
+
+		return false;
+	}
+
 	class MapImportingHandler : public osmium::handler::Handler
 	{
 	public:
@@ -122,9 +224,17 @@ namespace
 			auto wayNodeIds = std::vector<std::size_t>{};
 			wayNodeIds.reserve(way.nodes().size());
 
+			// References to nodes missing from the extract are dropped
 			for (const auto& nodeReference : way.nodes())
 			{
-				wayNodeIds.push_back(nodeOsmIdToMapId[nodeReference.ref()]);
+				if (const auto nodeId = map.FindObject(nodeReference.ref(), geodb::ObjectType::Node))
+				{
+					wayNodeIds.push_back(*nodeId);
+				}
+			}
+			if (wayNodeIds.empty())
+			{
+				return;
 			}
 
 			map.GetWays().emplace_back(wayNodeIds, GetWayBoundingBox(wayNodeIds, map));
@@ -133,8 +243,10 @@ namespace
 
 			for (const auto& tag : way.tags())
 			{
-				map.AddTagToObject(wayId, tag.key(), tag.value());
+				map.AddTagToObject(wayId, geodb::ObjectType::Way, tag.key(), tag.value());
 			}
+
+			map.SetOsmId(wayId, geodb::ObjectType::Way, way.id());
 		}
 
 		void node(const osmium::Node& node)
@@ -148,10 +260,10 @@ namespace
 
 			for (const auto& tag : node.tags())
 			{
-				map.AddTagToObject(nodeId, tag.key(), tag.value());
+				map.AddTagToObject(nodeId, geodb::ObjectType::Node, tag.key(), tag.value());
 			}
 
-			nodeOsmIdToMapId[node.id()] = nodeId;
+			map.SetOsmId(nodeId, geodb::ObjectType::Node, node.id());
 		}
 
 		geodb::Map GetMap()
@@ -160,70 +272,992 @@ namespace
 		}
 
 	private:
-		using OsmId = osmium::object_id_type;
-		using MapId = std::size_t;
-
 		geodb::Map map;
-		std::unordered_map<OsmId, MapId> nodeOsmIdToMapId;
+	};
+
+	std::vector<geodb::Tag> GetTags(const osmium::TagList& tags)
+	{
+		auto result = std::vector<geodb::Tag>{};
+		for (const auto& tag : tags)
+		{
+			result.push_back(geodb::Tag{ tag.key(), tag.value() });
+		}
+		return result;
+	}
+
+	// Deleted objects come without location, node list or tags in change files
+	class ChangeCollectingHandler : public osmium::handler::Handler
+	{
+	public:
+		void way(const osmium::Way& way)
+		{
+			auto change = geodb::WayChange{ way.id(), way.deleted(), {}, {} };
+			if (!change.deleted)
+			{
+				change.nodes.reserve(way.nodes().size());
+				for (const auto& nodeReference : way.nodes())
+				{
+					change.nodes.push_back(nodeReference.ref());
+				}
+				change.tags = GetTags(way.tags());
+			}
+			changes.ways.push_back(std::move(change));
+		}
+
+		void node(const osmium::Node& node)
+		{
+			auto change = geodb::NodeChange{ node.id(), node.deleted(), 0.0, 0.0, {} };
+			if (!change.deleted)
+			{
+				change.x = ProjectLongitude(node.location().lon());
+				change.y = ProjectLattitude(node.location().lat());
+				change.tags = GetTags(node.tags());
+			}
+			changes.nodes.push_back(std::move(change));
+		}
+
+		geodb::MapChanges GetChanges()
+		{
+			return std::move(changes);
+		}
+
+	private:
+		geodb::MapChanges changes;
 	};
 }
 
 namespace geodb
 {
-	Database Database::FromFile(std::string_view osmFileName)
+	Database Database::FromFile(std::string_view osmFileName, IndexEngine engine, const AllocationPolicy& allocation)
+	{
+		return Database{ LoadMap(osmFileName), engine, allocation };
+	}
+
+	Database Database::FromMap(Map map, IndexEngine engine, const AllocationPolicy& allocation)
+	{
+		return Database{ std::move(map), engine, allocation };
+	}
+
+	Map Database::LoadMap(std::string_view osmFileName)
 	{
 		auto reader = osmium::io::Reader{ osmFileName.data() };
 		auto handler = MapImportingHandler{};
 		osmium::apply(reader, handler);
-		return Database{ handler.GetMap() };
+
+		// Objects are kept in file order until the whole extract is read, the OSM ids follow them afterwards
+		auto map = handler.GetMap();
+		SortAlongHilbertCurve(map);
+		return map;
+	}
+
+	MapChanges Database::LoadChanges(std::string_view oscFileName)
+	{
+		auto reader = osmium::io::Reader{ oscFileName.data() };
+		auto handler = ChangeCollectingHandler{};
+		osmium::apply(reader, handler);
+		return handler.GetChanges();
+	}
+
+	ChangeSummary Database::ApplyChanges(std::string_view oscFileName)
+	{
+		return ApplyChanges(LoadChanges(oscFileName));
+	}
+
+	ChangeSummary Database::ApplyChanges(const MapChanges& changes)
+	{
+		auto summary = ChangeSummary{};
+		auto affectedWays = std::vector<std::size_t>{};
+
+		for (const auto& change : changes.nodes)
+		{
+			ApplyNodeChange(change, summary, affectedWays);
+		}
+		for (const auto& change : changes.ways)
+		{
+			ApplyWayChange(change, summary);
+		}
+
+		// Ways whose bounding box stayed the same, among them the ways the diff rewrote, keep their index entries, but
+		// their geometry changed and so did the answers of the cached cells around them
+		std::sort(affectedWays.begin(), affectedWays.end());
+		affectedWays.erase(std::unique(affectedWays.begin(), affectedWays.end()), affectedWays.end());
+		for (const auto wayIndex : affectedWays)
+		{
+			auto& way = m_map.GetWays()[wayIndex];
+			if (way.IsDeleted())
+			{
+				continue;
+			}
+			const auto boundingBox = GetWayBoundingBox(way.GetNodes(), m_map);
+			if (boundingBox == way.GetBoundingBox())
+			{
+				UpdateWayGeometry(wayIndex);
+				InvalidateCachedArea(way.GetBoundingBox());
+				continue;
+			}
+			UnindexWay(wayIndex);
+			way.SetBoundingBox(boundingBox);
+			IndexWay(wayIndex);
+			++summary.waysReindexed;
+		}
+
+		if (m_roadGraph != nullptr && (!changes.nodes.empty() || !changes.ways.empty()))
+		{
+			m_roadGraphStale = true;
+		}
+		return summary;
+	}
+
+	void Database::ApplyNodeChange(const NodeChange& change, ChangeSummary& summary, std::vector<std::size_t>& affectedWays)
+	{
+		const auto existing = m_map.FindObject(change.osmId, ObjectType::Node);
+
+		if (change.deleted)
+		{
+			if (existing)
+			{
+				UnindexNode(*existing);
+				m_map.SetObjectTags(*existing, ObjectType::Node, {});
+				m_map.RemoveOsmId(change.osmId, ObjectType::Node);
+				++summary.nodesDeleted;
+			}
+			return;
+		}
+
+		if (existing)
+		{
+			const auto nodeIndex = *existing;
+			const auto& node = m_map.GetNodes()[nodeIndex];
+			UnindexNode(nodeIndex);
+			if (node.GetX() != change.x || node.GetY() != change.y)
+			{
+				FindWaysWithNode(nodeIndex, affectedWays);
+			}
+			m_map.GetNodes()[nodeIndex] = Node{ change.x, change.y };
+			m_map.SetObjectTags(nodeIndex, ObjectType::Node, change.tags);
+			IndexNode(nodeIndex);
+			++summary.nodesModified;
+			return;
+		}
+
+		if (m_map.GetNodes().size() > std::numeric_limits<quadtree::PointQuadtree<double>::Id>::max())
+		{
+			throw std::length_error{ "Too many nodes for the node index" };
+		}
+		m_map.GetNodes().emplace_back(change.x, change.y);
+		const auto nodeIndex = m_map.GetNodes().size() - 1;
+		m_map.SetOsmId(nodeIndex, ObjectType::Node, change.osmId);
+		m_map.SetObjectTags(nodeIndex, ObjectType::Node, change.tags);
+		IndexNode(nodeIndex);
+		++summary.nodesCreated;
+	}
+
+	void Database::ApplyWayChange(const WayChange& change, ChangeSummary& summary)
+	{
+		const auto existing = m_map.FindObject(change.osmId, ObjectType::Way);
+
+		if (change.deleted)
+		{
+			if (existing)
+			{
+				UnindexWay(*existing);
+				m_map.GetWays()[*existing].Delete();
+				UpdateWayGeometry(*existing);
+				m_map.SetObjectTags(*existing, ObjectType::Way, {});
+				m_map.RemoveOsmId(change.osmId, ObjectType::Way);
+				++summary.waysDeleted;
+			}
+			return;
+		}
+
+		auto wayNodes = std::vector<std::size_t>{};
+		wayNodes.reserve(change.nodes.size());
+		for (const auto nodeOsmId : change.nodes)
+		{
+			if (const auto nodeIndex = m_map.FindObject(nodeOsmId, ObjectType::Node))
+			{
+				wayNodes.push_back(*nodeIndex);
+			}
+		}
+		// A way without any known node has no geometry to index, the change is skipped
+		if (wayNodes.empty())
+		{
+			return;
+		}
+		const auto boundingBox = GetWayBoundingBox(wayNodes, m_map);
+
+		if (existing)
+		{
+			UnindexWay(*existing);
+			m_map.GetWays()[*existing].SetNodes(std::move(wayNodes), boundingBox);
+			m_map.SetObjectTags(*existing, ObjectType::Way, change.tags);
+			IndexWay(*existing);
+			++summary.waysModified;
+			return;
+		}
+
+		m_map.GetWays().emplace_back(std::move(wayNodes), boundingBox);
+		const auto wayIndex = m_map.GetWays().size() - 1;
+		m_map.SetOsmId(wayIndex, ObjectType::Way, change.osmId);
+		m_map.SetObjectTags(wayIndex, ObjectType::Way, change.tags);
+		IndexWay(wayIndex);
+		++summary.waysCreated;
+	}
+
+	// Ways store their nodes, not the other way around, but a way's bounding box always contains its nodes
+	void Database::FindWaysWithNode(std::size_t nodeIndex, std::vector<std::size_t>& ways)
+	{
+		const auto& node = m_map.GetNodes()[nodeIndex];
+		const auto candidates = std::visit([&](auto& index)
+			{
+				return index.Query(ToLocal(quadtree::Rectangle<double>{ node.GetX(), node.GetY(), 0.0, 0.0 }));
+			}, GetLocalIndex());
+		for (const auto candidate : candidates)
+		{
+			const auto& wayNodes = m_map.GetWays()[candidate->GetObjectIndex()].GetNodes();
+			if (std::find(wayNodes.begin(), wayNodes.end(), nodeIndex) != wayNodes.end())
+			{
+				ways.push_back(candidate->GetObjectIndex());
+			}
+		}
+	}
+
+	void Database::IndexNode(std::size_t nodeIndex)
+	{
+		const auto& node = m_map.GetNodes()[nodeIndex];
+		if (m_map.GetObjectTags(nodeIndex, ObjectType::Node) != nullptr)
+		{
+			m_nodeIndex.Insert(node.GetX(), node.GetY(), static_cast<quadtree::PointQuadtree<double>::Id>(nodeIndex));
+		}
+		m_extent = Enclose(m_extent, quadtree::Rectangle<double>{ node.GetX(), node.GetY(), 0.0, 0.0 });
+		InvalidateCachedArea(quadtree::Rectangle<double>{ node.GetX(), node.GetY(), 0.0, 0.0 });
+	}
+
+	void Database::UnindexNode(std::size_t nodeIndex)
+	{
+		const auto& node = m_map.GetNodes()[nodeIndex];
+		if (m_map.GetObjectTags(nodeIndex, ObjectType::Node) != nullptr)
+		{
+			m_nodeIndex.Remove(node.GetX(), node.GetY(), static_cast<quadtree::PointQuadtree<double>::Id>(nodeIndex));
+		}
+		InvalidateCachedArea(quadtree::Rectangle<double>{ node.GetX(), node.GetY(), 0.0, 0.0 });
+	}
+
+	void Database::IndexWay(std::size_t wayIndex)
+	{
+		UpdateWayGeometry(wayIndex);
+		const auto entry = GetIndexEntry(wayIndex);
+		for (auto& index : m_indexes)
+		{
+			std::visit([&](auto& replica) { replica.Insert(entry); }, index);
+		}
+		m_planner.Add(entry);
+		m_extent = Enclose(m_extent, m_map.GetWays()[wayIndex].GetBoundingBox());
+		InvalidateCachedArea(m_map.GetWays()[wayIndex].GetBoundingBox());
+	}
+
+	void Database::UnindexWay(std::size_t wayIndex)
+	{
+		const auto entry = GetIndexEntry(wayIndex);
+		for (auto& index : m_indexes)
+		{
+			std::visit([&](auto& replica) { replica.Remove(entry); }, index);
+		}
+		m_planner.Remove(entry);
+		InvalidateCachedArea(m_map.GetWays()[wayIndex].GetBoundingBox());
+	}
+
+	void Database::InvalidateCachedArea(const quadtree::Rectangle<double>& area)
+	{
+		if (m_queryCache != nullptr)
+		{
+			m_queryCache->Invalidate(area);
+		}
 	}
 
 	std::vector<std::size_t> Database::Query(const quadtree::Rectangle<double>& searchWindow)
 	{
-		const auto candidates = m_quadtree.Query(searchWindow);
+		if (m_queryCache != nullptr)
+		{
+			return QueryCached(searchWindow);
+		}
+		return QueryUncached(searchWindow);
+	}
+
+	std::vector<std::size_t> Database::QueryUncached(const quadtree::Rectangle<double>& searchWindow)
+	{
+		auto result = QueryWays(searchWindow, nullptr);
+		AppendNodes(searchWindow, result);
+		return result;
+	}
+
+	void Database::AppendNodes(const quadtree::Rectangle<double>& searchWindow, std::vector<std::size_t>& result) const
+	{
+		auto nodes = std::vector<quadtree::PointQuadtree<double>::Point>{};
+		m_nodeIndex.Query(searchWindow, nodes);
+		for (const auto& node : nodes)
+		{
+			result.push_back(node.id);
+		}
+	}
+
+	std::vector<std::size_t> Database::Query(const quadtree::Rectangle<double>& searchWindow, QueryStatistics& statistics)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		auto result = QueryWays(searchWindow, &statistics);
+
+		const auto nodesStart = Clock::now();
+		auto nodes = std::vector<quadtree::PointQuadtree<double>::Point>{};
+		m_nodeIndex.Query(searchWindow, nodes, statistics.traversal);
+		for (const auto& node : nodes)
+		{
+			result.push_back(node.id);
+		}
+
+		++statistics.queries;
+		statistics.traversalTime += Clock::now() - nodesStart;
+
+		return result;
+	}
+
+	IndexEngine Database::GetIndexEngine() const
+	{
+		return std::holds_alternative<RTreeIndex>(m_indexes.front()) ? IndexEngine::RTree : IndexEngine::Quadtree;
+	}
+
+	std::size_t Database::GetIndexSize() const
+	{
+		return std::visit([](const auto& index) { return index.GetSize(); }, m_indexes.front());
+	}
+
+	DatabaseStatistics Database::GetStatistics() const
+	{
+		const auto indexStatistics = std::visit([](const auto& index) { return index.GetStatistics(); }, m_indexes.front());
+		auto hugePageBytes = m_mapHugePageBytes;
+		for (const auto& memory : m_indexMemory)
+		{
+			hugePageBytes += memory->pages.GetHugePageBytes();
+		}
+		return DatabaseStatistics{
+			indexStatistics,
+			m_nodeIndex.GetSize(),
+			m_nodeIndex.GetAllocatedBytes(),
+			m_map.GetMemoryUsage(),
+			m_polygons.GetAllocatedBytes(),
+			m_indexes.size(),
+			hugePageBytes
+		};
+	}
+
+	QueryPlanEstimate Database::ExplainQuery(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		return m_planner.Estimate(searchWindow);
+	}
+
+	quadtree::BatchResult<std::size_t> Database::QueryBatch(std::span<const quadtree::Rectangle<double>> searchWindows)
+	{
+		auto localWindows = std::vector<IndexEntry>{};
+		localWindows.reserve(searchWindows.size());
+		for (const auto& searchWindow : searchWindows)
+		{
+			localWindows.push_back(ToLocal(searchWindow));
+		}
+		const auto candidates = std::visit([&](auto& index)
+			{
+				return index.QueryBatch(std::span<const IndexEntry>{ localWindows });
+			}, GetLocalIndex());
+
+		auto result = quadtree::BatchResult<std::size_t>{};
+		result.offsets.reserve(searchWindows.size() + 1);
+		result.offsets.push_back(0);
+		for (std::size_t i = 0; i < searchWindows.size(); ++i)
+		{
+			for (const auto candidate : candidates[i])
+			{
+				if (Matches(*candidate, searchWindows[i]))
+				{
+					result.values.push_back(candidate->GetObjectIndex());
+				}
+			}
+			AppendNodes(searchWindows[i], result.values);
+			result.offsets.push_back(result.values.size());
+		}
+
+		return result;
+	}
+
+	std::vector<Database::QueryResult> Database::QueryObjects(const quadtree::Rectangle<double>& searchWindow)
+	{
+		auto result = std::vector<QueryResult>{};
+		for (const auto wayIndex : QueryWays(searchWindow, nullptr))
+		{
+			result.push_back(QueryResult{ wayIndex, ObjectType::Way });
+		}
+
+		auto nodes = std::vector<quadtree::PointQuadtree<double>::Point>{};
+		m_nodeIndex.Query(searchWindow, nodes);
+		for (const auto& node : nodes)
+		{
+			result.push_back(QueryResult{ node.id, ObjectType::Node });
+		}
+
+		return result;
+	}
+
+	std::vector<DistanceQueryResult> Database::QueryRadius(double centerX, double centerY, double radius)
+	{
+		return QueryWithinDistance(Circle{ centerX, centerY, radius });
+	}
+
+	std::vector<DistanceQueryResult> Database::QueryCorridor(std::vector<Node> polyline, double radius)
+	{
+		return QueryWithinDistance(Corridor{ std::move(polyline), radius });
+	}
+
+	// Radius queries grow from the radius expected to hold k objects until they hold at least k of them,
+	// the k closest of those are then the nearest overall
+	std::vector<DistanceQueryResult> Database::QueryNearest(double x, double y, std::size_t k)
+	{
+		if (!std::isfinite(x) || !std::isfinite(y))
+		{
+			throw std::invalid_argument{ "Point must be finite" };
+		}
+		if (k == 0)
+		{
+			return {};
+		}
+
+		const auto farthestX = std::abs(x - m_extent.GetCenterX()) + m_extent.GetHalfWidth();
+		const auto farthestY = std::abs(y - m_extent.GetCenterY()) + m_extent.GetHalfHeight();
+		const auto maxRadius = std::sqrt(farthestX * farthestX + farthestY * farthestY);
+
+		const auto objects = static_cast<double>(std::max<std::size_t>(GetIndexSize() + m_nodeIndex.GetSize(), 1));
+		const auto expectedRadius = std::sqrt(m_extent.GetArea() * static_cast<double>(k) / (Pi * objects));
+		auto radius = std::min(std::max(expectedRadius, maxRadius / 1024.0), maxRadius);
+
+		while (true)
+		{
+			auto result = QueryRadius(x, y, radius);
+			if (result.size() >= k || radius >= maxRadius)
+			{
+				const auto nearest = std::min(k, result.size());
+				std::partial_sort(result.begin(), result.begin() + nearest, result.end(), [](const auto& r1, const auto& r2)
+					{
+						return r1.distance < r2.distance;
+					});
+				result.resize(nearest);
+				return result;
+			}
+			radius = std::min(radius * 2.0, maxRadius);
+		}
+	}
+
+	double Database::MetersToProjected(double meters, double projectedY)
+	{
+		const auto lattitude = UnprojectLattitude(projectedY) * Pi / 180.0;
+		return meters * DefaultR / (EarthRadiusMeters * std::cos(lattitude));
+	}
+
+	std::vector<std::size_t> Database::Containing(double x, double y)
+	{
+		const auto point = ToLocal(quadtree::Rectangle<double>{ x, y, 0.0, 0.0 });
+		const auto candidates = std::visit([&](auto& index) { return index.Query(point); }, GetLocalIndex());
 
 		auto result = std::vector<std::size_t>{};
 		for (const auto candidate : candidates)
 		{
-			switch (candidate->GetObjectType())
+			if (m_polygons.Contains(candidate->GetObjectIndex(), x, y))
+			{
+				result.push_back(candidate->GetObjectIndex());
+			}
+		}
+		std::sort(result.begin(), result.end(), [this](std::size_t w1, std::size_t w2)
+			{
+				return m_polygons.GetArea(w1) < m_polygons.GetArea(w2);
+			});
+		return result;
+	}
+
+	template<typename DistanceShape>
+	std::vector<DistanceQueryResult> Database::QueryWithinDistance(const DistanceShape& shape)
+	{
+		const auto localShape = LocalShape<DistanceShape>{ shape, m_indexedArea.GetCenterX(), m_indexedArea.GetCenterY() };
+		const auto candidates = std::visit([&](auto& index) { return index.Query(localShape); }, GetLocalIndex());
+
+		auto result = std::vector<DistanceQueryResult>{};
+		for (const auto candidate : candidates)
+		{
+			const auto index = candidate->GetObjectIndex();
+			const auto distance = candidate->GetObjectType() == ObjectType::Way
+				? GetDistance(shape, m_map.GetWays()[index], m_map)
+				: shape.DistanceToPoint(m_map.GetNodes()[index].GetX(), m_map.GetNodes()[index].GetY());
+
+			if (distance <= shape.GetRadius())
 			{
-			case ObjectType::Way:
+				result.push_back(DistanceQueryResult{ index, candidate->GetObjectType(), distance });
+			}
+		}
+
+		auto nodes = std::vector<quadtree::PointQuadtree<double>::Point>{};
+		m_nodeIndex.Query(shape, nodes);
+		for (const auto& node : nodes)
+		{
+			result.push_back(DistanceQueryResult{ node.id, ObjectType::Node, shape.DistanceToPoint(node.x, node.y) });
+		}
+
+		return result;
+	}
+
+	// Each thread takes blocks of consecutive points along the curve. A thread loads the segments within twice the
+	// distance of a point and keeps them for the following points as long as their search box stays inside that window
+	std::vector<std::optional<WaySnap>> Database::SnapToWays(std::span<const Node> points, double maxDistance, const TagFilter& tagFilter)
+	{
+		if (!(maxDistance >= 0.0) || std::isinf(maxDistance))
+		{
+			throw std::invalid_argument{ "Snapping distance must be finite and not negative" };
+		}
+
+		auto keys = std::vector<std::pair<std::uint64_t, std::size_t>>{};
+		keys.reserve(points.size());
+		for (std::size_t i = 0; i < points.size(); ++i)
+		{
+			keys.emplace_back(GetHilbertIndex(points[i].GetX(), points[i].GetY(), m_extent, 16), i);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		auto result = std::vector<std::optional<WaySnap>>(points.size());
+		auto nextBlock = std::atomic<std::size_t>{ 0 };
+		const auto snapBlocks = [&]()
 			{
-				if (Intersects(m_map.GetWays()[candidate->GetObjectIndex()], searchWindow, m_map))
+				auto candidates = SegmentCandidates{};
+				auto window = std::optional<quadtree::Rectangle<double>>{};
+				for (auto block = nextBlock++; block * SnapBlockSize < keys.size(); block = nextBlock++)
 				{
-					result.push_back(candidate->GetObjectIndex());
+					const auto end = std::min(keys.size(), (block + 1) * SnapBlockSize);
+					for (auto k = block * SnapBlockSize; k < end; ++k)
+					{
+						const auto& point = points[keys[k].second];
+						if (!window || std::abs(point.GetX() - window->GetCenterX()) > maxDistance
+							|| std::abs(point.GetY() - window->GetCenterY()) > maxDistance)
+						{
+							window = quadtree::Rectangle<double>{ point.GetX(), point.GetY(), 2.0 * maxDistance, 2.0 * maxDistance };
+							candidates.Clear();
+							LoadSnapCandidates(*window, tagFilter, candidates);
+						}
+						result[keys[k].second] = candidates.FindNearest(point.GetX(), point.GetY(), maxDistance);
+					}
 				}
-				break;
+			};
+
+		const auto blockCount = (keys.size() + SnapBlockSize - 1) / SnapBlockSize;
+		const auto threadCount = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), blockCount);
+		auto tasks = std::vector<std::future<void>>{};
+		for (std::size_t i = 1; i < threadCount; ++i)
+		{
+			tasks.push_back(std::async(std::launch::async, snapBlocks));
+		}
+		snapBlocks();
+		for (auto& task : tasks)
+		{
+			task.get();
+		}
+
+		return result;
+	}
+
+	void Database::LoadSnapCandidates(const quadtree::Rectangle<double>& window, const TagFilter& tagFilter, SegmentCandidates& candidates)
+	{
+		const auto entries = std::visit([&](auto& index) { return index.Query(ToLocal(window)); }, GetLocalIndex());
+		const auto windowMinX = window.GetCenterX() - window.GetHalfWidth();
+		const auto windowMaxX = window.GetCenterX() + window.GetHalfWidth();
+		const auto windowMinY = window.GetCenterY() - window.GetHalfHeight();
+		const auto windowMaxY = window.GetCenterY() + window.GetHalfHeight();
+		for (const auto entry : entries)
+		{
+			const auto wayIndex = entry->GetObjectIndex();
+			if (!tagFilter.Matches(m_map.GetObjectTags(wayIndex, ObjectType::Way)))
+			{
+				continue;
 			}
-			case ObjectType::Node:
+
+			const auto& nodes = m_map.GetWays()[wayIndex].GetNodes();
+			for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
 			{
-				if (Contains(m_map.GetNodes()[candidate->GetObjectIndex()], searchWindow))
+				const auto& start = m_map.GetNodes()[nodes[i]];
+				const auto& end = m_map.GetNodes()[nodes[i + 1]];
+				if (std::max(start.GetX(), end.GetX()) >= windowMinX && std::min(start.GetX(), end.GetX()) <= windowMaxX
+					&& std::max(start.GetY(), end.GetY()) >= windowMinY && std::min(start.GetY(), end.GetY()) <= windowMaxY)
 				{
-					result.push_back(candidate->GetObjectIndex());
+					candidates.Add(wayIndex, i, start.GetX(), start.GetY(), end.GetX(), end.GetY());
 				}
-				break;
 			}
+		}
+	}
+
+	void Database::SelfJoin(const JoinCallback& callback)
+	{
+		std::visit([&](auto& index)
+			{
+				index.SelfJoin([&callback](const IndexEntry& b1, const IndexEntry& b2)
+					{
+						callback(
+							QueryResult{ b1.GetObjectIndex(), b1.GetObjectType() },
+							QueryResult{ b2.GetObjectIndex(), b2.GetObjectType() }
+						);
+					});
+			}, GetLocalIndex());
+		JoinWaysWithNodes(callback);
+	}
+
+	void Database::ParallelSelfJoin(const JoinCallback& callback)
+	{
+		std::visit([&](auto& index)
+			{
+				index.ParallelJoin(index, [&callback](const IndexEntry& b1, const IndexEntry& b2)
+					{
+						callback(
+							QueryResult{ b1.GetObjectIndex(), b1.GetObjectType() },
+							QueryResult{ b2.GetObjectIndex(), b2.GetObjectType() }
+						);
+					});
+			}, GetLocalIndex());
+		JoinWaysWithNodes(callback);
+	}
+
+	void Database::JoinWaysWithNodes(const JoinCallback& callback) const
+	{
+		auto nodes = std::vector<quadtree::PointQuadtree<double>::Point>{};
+		for (std::size_t i = 0; i < m_map.GetWays().size(); ++i)
+		{
+			if (m_map.GetWays()[i].IsDeleted())
+			{
+				continue;
 			}
+			nodes.clear();
+			m_nodeIndex.Query(m_map.GetWays()[i].GetBoundingBox(), nodes);
+			for (const auto& node : nodes)
+			{
+				callback(QueryResult{ i, ObjectType::Way }, QueryResult{ node.id, ObjectType::Node });
+			}
+		}
+	}
+
+	void Database::EnableQueryCache(double cellSize, std::size_t maxCachedResults)
+	{
+		m_queryCache = std::make_unique<QueryCache>(cellSize, maxCachedResults);
+	}
+
+	void Database::EnableCompressedGeometry(double resolution)
+	{
+		m_compressedGeometry = std::make_unique<CompressedGeometry>(CompressedGeometry::FromMap(m_map, resolution));
+	}
+
+	void Database::EnableRouting(bool contract)
+	{
+		m_roadGraph = std::make_unique<RoadGraph>(RoadGraph::FromMap(m_map));
+		m_roadGraphStale = false;
+		if (contract)
+		{
+			m_roadGraph->Contract();
+		}
+	}
+
+	std::optional<Route> Database::FindRoute(double fromX, double fromY, double toX, double toY, RouteAlgorithm algorithm, double maxSnapDistance)
+	{
+		if (m_roadGraph == nullptr)
+		{
+			throw std::logic_error{ "Routing is not enabled" };
+		}
+		if (m_roadGraphStale)
+		{
+			EnableRouting(m_roadGraph->IsContracted());
+		}
+
+		const auto from = m_roadGraph->Snap(fromX, fromY, maxSnapDistance);
+		const auto to = m_roadGraph->Snap(toX, toY, maxSnapDistance);
+		if (!from || !to)
+		{
+			return std::nullopt;
+		}
+		return m_roadGraph->FindRoute(*from, *to, algorithm);
+	}
+
+	void Database::UpdateWayGeometry(std::size_t wayIndex)
+	{
+		m_polygons.SetWay(wayIndex, m_map.GetWays()[wayIndex], m_map);
+		if (m_compressedGeometry != nullptr)
+		{
+			m_compressedGeometry->SetWay(wayIndex, m_map.GetWays()[wayIndex], m_map);
+		}
+	}
+
+	std::vector<std::size_t> Database::QueryCached(const quadtree::Rectangle<double>& searchWindow)
+	{
+		const auto cells = m_queryCache->GetCoveredCells(searchWindow);
+		if (cells.IsEmpty())
+		{
+			m_queryCache->RecordBypass();
+			return QueryUncached(searchWindow);
+		}
+
+		auto objects = std::vector<QueryResult>{};
+		for (auto y = cells.minY; y <= cells.maxY; ++y)
+		{
+			for (auto x = cells.minX; x <= cells.maxX; ++x)
+			{
+				const auto cell = QueryCache::Cell{ x, y };
+				if (const auto cached = m_queryCache->Find(cell))
+				{
+					objects.insert(objects.end(), cached->begin(), cached->end());
+					continue;
+				}
+				auto cellObjects = QueryObjects(m_queryCache->GetCellArea(cell));
+				objects.insert(objects.end(), cellObjects.begin(), cellObjects.end());
+				m_queryCache->Insert(cell, std::move(cellObjects));
+			}
+		}
+
+		const auto cellSize = m_queryCache->GetCellSize();
+		const auto minX = searchWindow.GetCenterX() - searchWindow.GetHalfWidth();
+		const auto maxX = searchWindow.GetCenterX() + searchWindow.GetHalfWidth();
+		const auto minY = searchWindow.GetCenterY() - searchWindow.GetHalfHeight();
+		const auto maxY = searchWindow.GetCenterY() + searchWindow.GetHalfHeight();
+		const auto coveredMinX = static_cast<double>(cells.minX) * cellSize;
+		const auto coveredMaxX = static_cast<double>(cells.maxX + 1) * cellSize;
+		const auto coveredMinY = static_cast<double>(cells.minY) * cellSize;
+		const auto coveredMaxY = static_cast<double>(cells.maxY + 1) * cellSize;
+
+		const auto queryStrip = [&](double left, double bottom, double right, double top)
+			{
+				if (left < right && bottom < top)
+				{
+					const auto strip = quadtree::Rectangle<double>::Of(left, top, right - left, top - bottom);
+					const auto stripObjects = QueryObjects(strip);
+					objects.insert(objects.end(), stripObjects.begin(), stripObjects.end());
+				}
+			};
+		queryStrip(minX, minY, coveredMinX, maxY);
+		queryStrip(coveredMaxX, minY, maxX, maxY);
+		queryStrip(coveredMinX, minY, coveredMaxX, coveredMinY);
+		queryStrip(coveredMinX, coveredMaxY, coveredMaxX, maxY);
+
+		std::sort(objects.begin(), objects.end());
+		objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+
+		auto result = std::vector<std::size_t>{};
+		result.reserve(objects.size());
+		for (const auto& object : objects)
+		{
+			result.push_back(object.objectId);
 		}
 
 		return result;
 	}
 
-	Database::Database(Map map)
+	Database::IndexEntry Database::ToLocal(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		return IndexEntry::Of(0, ObjectType::Node, searchWindow, m_indexedArea.GetCenterX(), m_indexedArea.GetCenterY());
+	}
+
+	Database::IndexEntry Database::GetIndexEntry(std::size_t wayIndex) const
+	{
+		return IndexEntry::Of(
+			wayIndex, ObjectType::Way, m_map.GetWays()[wayIndex].GetBoundingBox(), m_indexedArea.GetCenterX(), m_indexedArea.GetCenterY()
+		);
+	}
+
+	bool Database::Matches(const IndexEntry& candidate, const quadtree::Rectangle<double>& searchWindow) const
+	{
+		switch (candidate.GetObjectType())
+		{
+		case ObjectType::Way:
+			return MatchesWay(candidate.GetObjectIndex(), searchWindow);
+		case ObjectType::Node:
+			return Contains(m_map.GetNodes()[candidate.GetObjectIndex()], searchWindow);
+		}
+		return false;
+	}
+
+	bool Database::MatchesWay(std::size_t wayIndex, const quadtree::Rectangle<double>& searchWindow) const
+	{
+		if (m_compressedGeometry != nullptr)
+		{
+			return Intersects(m_map.GetWays()[wayIndex], searchWindow, *m_compressedGeometry, wayIndex);
+		}
+		return Intersects(m_map.GetWays()[wayIndex], searchWindow, m_map);
+	}
+
+	// Runs the plan the planner estimates to be the cheapest, ways the plan matches on its own skip refinement
+	std::vector<std::size_t> Database::QueryWays(const quadtree::Rectangle<double>& searchWindow, QueryStatistics* statistics)
+	{
+		using Clock = std::chrono::steady_clock;
+
+		const auto traversalStart = statistics != nullptr ? Clock::now() : Clock::time_point{};
+		const auto plan = m_planner.Estimate(searchWindow).plan;
+		auto result = std::vector<std::size_t>{};
+		auto candidates = std::vector<std::size_t>{};
+		switch (plan)
+		{
+		case QueryPlan::IndexTraversal:
+		{
+			const auto entries = std::visit([&](auto& index)
+				{
+					return statistics != nullptr
+						? index.Query(ToLocal(searchWindow), statistics->traversal)
+						: index.Query(ToLocal(searchWindow));
+				}, GetLocalIndex());
+			candidates.reserve(entries.size());
+			for (const auto entry : entries)
+			{
+				candidates.push_back(entry->GetObjectIndex());
+			}
+			break;
+		}
+		case QueryPlan::LinearScan:
+			m_planner.ScanAll(searchWindow, candidates);
+			break;
+		case QueryPlan::CellScan:
+			m_planner.ScanCells(searchWindow, result, candidates);
+			break;
+		}
+		const auto skippedRefinements = result.size();
+
+		const auto refinementStart = statistics != nullptr ? Clock::now() : Clock::time_point{};
+		for (const auto candidate : candidates)
+		{
+			const auto matches = MatchesWay(candidate, searchWindow);
+			if (matches)
+			{
+				result.push_back(candidate);
+			}
+			if (statistics != nullptr)
+			{
+				++(matches ? statistics->refinementTruePositives : statistics->refinementFalsePositives);
+			}
+		}
+
+		if (statistics != nullptr)
+		{
+			++statistics->plans[static_cast<std::size_t>(plan)];
+			statistics->refinementsSkipped += skippedRefinements;
+			statistics->traversalTime += refinementStart - traversalStart;
+			statistics->refinementTime += Clock::now() - refinementStart;
+		}
+
+		return result;
+	}
+
+	Database::IndexMemory::IndexMemory(PagePolicy pages, std::optional<std::size_t> numaNode)
+		: pages{ pages, numaNode }
+		, pool{ &this->pages }
+	{
+	}
+
+	Database::Index& Database::GetLocalIndex()
+	{
+		return m_indexes.size() == 1 ? m_indexes.front() : m_indexes[std::min(GetCurrentNumaNode(), m_indexes.size() - 1)];
+	}
+
+	const Database::Index& Database::GetLocalIndex() const
+	{
+		return m_indexes.size() == 1 ? m_indexes.front() : m_indexes[std::min(GetCurrentNumaNode(), m_indexes.size() - 1)];
+	}
+
+	Database::Database(Map map, IndexEngine engine, const AllocationPolicy& allocation)
 		: m_map{ std::move(map) }
-		, m_quadtree{ GetMapArea(m_map), QuadtreeMaxDepth}
+		, m_indexedArea{ GetMapArea(m_map) }
+		, m_extent{ m_indexedArea }
+		, m_nodeIndex{ m_indexedArea, NodeIndexMaxDepth }
+		, m_planner{ GetLocalArea(m_indexedArea), m_indexedArea.GetCenterX(), m_indexedArea.GetCenterY(), m_map.GetWays().size() }
 	{
+		if (m_map.GetNodes().size() > std::numeric_limits<quadtree::PointQuadtree<double>::Id>::max())
+		{
+			throw std::length_error{ "Too many nodes for the node index" };
+		}
+
+		const auto replicas = allocation.replicateIndex ? GetNumaNodeCount() : 1;
+		for (std::size_t replica = 0; replica < replicas; ++replica)
+		{
+			auto* resource = std::pmr::new_delete_resource();
+			if (engine == IndexEngine::Quadtree && (allocation.pages != PagePolicy::Default || replicas > 1))
+			{
+				m_indexMemory.push_back(std::make_unique<IndexMemory>(allocation.pages, replicas > 1 ? std::optional{ replica } : std::nullopt));
+				resource = &m_indexMemory.back()->pool;
+			}
+			m_indexes.emplace_back(std::in_place_type<QuadtreeIndex>, GetLocalArea(m_indexedArea), QuadtreeMaxDepth, resource);
+		}
+
+		auto& nodes = m_map.GetNodes();
+		auto& ways = m_map.GetWays();
+		if (allocation.pages != PagePolicy::Default)
+		{
+			m_mapHugePageBytes = AdviseHugePages(nodes.data(), nodes.size() * sizeof(Node)) + AdviseHugePages(ways.data(), ways.size() * sizeof(Way));
+		}
+		// The map is read by the queries of every node, so its pages are spread over all of them rather than left on
+		// the node that loaded it
+		if (replicas > 1)
+		{
+			InterleaveAcrossNumaNodes(nodes.data(), nodes.size() * sizeof(Node));
+			InterleaveAcrossNumaNodes(ways.data(), ways.size() * sizeof(Way));
+		}
+
+		auto entries = std::vector<IndexEntry>{};
+		entries.reserve(m_map.GetWays().size());
 		for (std::size_t i = 0; i < m_map.GetWays().size(); ++i)
 		{
-			m_quadtree.Insert(BoundngBox{ i, ObjectType::Way, m_map.GetWays()[i].GetBoundingBox() });
+			entries.push_back(GetIndexEntry(i));
+		}
+
+		// The node index and the polygons are built on their own thread while the ways are indexed on the others
+		auto nodeIndexing = std::async(std::launch::async, [this]()
+			{
+				m_polygons = PolygonIndex::FromMap(m_map);
+				for (std::size_t i = 0; i < m_map.GetNodes().size(); ++i)
+				{
+					if (m_map.GetObjectTags(i, ObjectType::Node) != nullptr)
+					{
+						const auto& node = m_map.GetNodes()[i];
+						m_nodeIndex.Insert(node.GetX(), node.GetY(), static_cast<quadtree::PointQuadtree<double>::Id>(i));
+					}
+				}
+			});
+		const auto buildIndex = [&](std::size_t replica)
+			{
+				if (m_indexes.size() > 1)
+				{
+					PinThreadToNumaNode(replica);
+				}
+				if (engine == IndexEngine::RTree)
+				{
+					m_indexes[replica].emplace<RTreeIndex>(std::span<const IndexEntry>{ entries });
+				}
+				else
+				{
+					std::get<QuadtreeIndex>(m_indexes[replica]).ParallelInsert(std::span<const IndexEntry>{ entries });
+				}
+			};
+		if (m_indexes.size() == 1)
+		{
+			buildIndex(0);
 		}
-		for (std::size_t i = 0; i < m_map.GetNodes().size(); ++i)
+		else
 		{
-			if (m_map.GetObjectTags(i) != nullptr)
+			// Each copy is built by threads pinned to its node, so that the pages it touches first are placed there
+			auto replicaBuilds = std::vector<std::future<void>>{};
+			for (std::size_t replica = 0; replica < m_indexes.size(); ++replica)
 			{
-				const auto& node = m_map.GetNodes()[i];
-				m_quadtree.Insert(BoundngBox{ i, ObjectType::Node, quadtree::Rectangle{ node.GetX(), node.GetY(), DefaultR / 2.0, DefaultR / 2.0 }});
+				replicaBuilds.push_back(std::async(std::launch::async, buildIndex, replica));
 			}
+			for (auto& replicaBuild : replicaBuilds)
+			{
+				replicaBuild.get();
+			}
+		}
+		for (const auto& entry : entries)
+		{
+			m_planner.Add(entry);
 		}
+		nodeIndexing.get();
 	}
 }
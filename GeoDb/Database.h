@@ -1,26 +1,66 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
 #include <vector>
 #include <string_view>
+#include <variant>
 
 #include "BoundingBox.h"
+#include "CompactBoundingBox.h"
+#include "CompressedGeometry.h"
+#include "DatabaseStatistics.h"
+#include "DistanceShapes.h"
 #include "Map.h"
+#include "MapChanges.h"
+#include "MemoryPlacement.h"
 #include "ObjectType.h"
+#include "PolygonIndex.h"
+#include "QueryCache.h"
+#include "QueryPlanner.h"
+#include "QueryResult.h"
+#include "QueryStatistics.h"
+#include "RoadGraph.h"
+#include "WaySnapping.h"
+#include "../Quadtree/PointQuadtree.h"
 #include "../Quadtree/Quadtree.h"
+#include "../Quadtree/RTree.h"
 
 namespace geodb
 {
+	enum class IndexEngine
+	{
+		// Dynamic, changes are applied in place
+		Quadtree,
+		// Bulk loaded, changes go to an overflow list until the tree is packed again
+		RTree
+	};
+
 	class Database
 	{
 	public:
-		struct QueryResult
-		{
-			std::size_t objectId;
-			ObjectType objectType;
-		};
+		using QueryResult = geodb::QueryResult;
+
+		using JoinCallback = std::function<void(const QueryResult&, const QueryResult&)>;
 
 	public:
-		static Database FromFile(std::string_view osmFileName);
+		static Database FromFile(std::string_view osmFileName, IndexEngine engine = IndexEngine::Quadtree, const AllocationPolicy& allocation = {});
+
+		// Huge pages back the quadtree's nodes and are advised for the map's node and way arrays, the R-tree's arrays
+		// stay with the default allocator
+		static Database FromMap(Map map, IndexEngine engine = IndexEngine::Quadtree, const AllocationPolicy& allocation = {});
+
+		static Map LoadMap(std::string_view osmFileName);
+
+		static MapChanges LoadChanges(std::string_view oscFileName);
+
+		// Applies an OSM change file (.osc) in place, the work done depends on the size of the diff only
+		ChangeSummary ApplyChanges(std::string_view oscFileName);
+
+		ChangeSummary ApplyChanges(const MapChanges& changes);
 
 		Database(const Database& other) = delete;
 
@@ -28,17 +68,161 @@ namespace geodb
 
 		const Map& GetMap() const { return m_map; }
 
-		const quadtree::Rectangle<double>& GetIndexedArea() const { return m_quadtree.GetIndexedArea(); }
+		// Covers every object, including those that changes placed outside of the imported map
+		const quadtree::Rectangle<double>& GetIndexedArea() const { return m_extent; }
+
+		IndexEngine GetIndexEngine() const;
+
+		DatabaseStatistics GetStatistics() const;
 
 		std::vector<std::size_t> Query(const quadtree::Rectangle<double>& searchWindow);
 
+		std::vector<std::size_t> Query(const quadtree::Rectangle<double>& searchWindow, QueryStatistics& statistics);
+
+		// The plan Query picks for the window, with the estimates it is chosen by
+		QueryPlanEstimate ExplainQuery(const quadtree::Rectangle<double>& searchWindow) const;
+
+		quadtree::BatchResult<std::size_t> QueryBatch(std::span<const quadtree::Rectangle<double>> searchWindows);
+
+		std::vector<QueryResult> QueryObjects(const quadtree::Rectangle<double>& searchWindow);
+
+		// Distances are measured and reported in projected units, see MetersToProjected
+		std::vector<DistanceQueryResult> QueryRadius(double centerX, double centerY, double radius);
+
+		std::vector<DistanceQueryResult> QueryCorridor(std::vector<Node> polyline, double radius);
+
+		// The k objects closest to the point, nearest first. Throws std::invalid_argument for points that are not finite
+		std::vector<DistanceQueryResult> QueryNearest(double x, double y, std::size_t k);
+
+		static double MetersToProjected(double meters, double projectedY);
+
+		// Nearest point on a way matching the filter for each of the points, in their order, nothing for points farther
+		// than maxDistance from all such ways. Points are visited along a Hilbert curve on all cores, so that neighbors
+		// share the way segments loaded for them
+		std::vector<std::optional<WaySnap>> SnapToWays(std::span<const Node> points, double maxDistance, const TagFilter& tagFilter = {});
+
+		// Closed ways whose polygon contains the point, smallest first so that the innermost area leads
+		std::vector<std::size_t> Containing(double x, double y);
+
+		void SelfJoin(const JoinCallback& callback);
+
+		void ParallelSelfJoin(const JoinCallback& callback);
+
+		void EnableQueryCache(double cellSize, std::size_t maxCachedResults);
+
+		void DisableQueryCache() { m_queryCache.reset(); }
+
+		const QueryCache* GetQueryCache() const { return m_queryCache.get(); }
+
+		// Way refinement in Query then reads the compressed geometry, which follows changes applied afterwards.
+		// Vertices are rounded to the resolution, so ways within it of the window's border may be reported differently
+		void EnableCompressedGeometry(double resolution = CompressedGeometry::DefaultResolution);
+
+		void DisableCompressedGeometry() { m_compressedGeometry.reset(); }
+
+		const CompressedGeometry* GetCompressedGeometry() const { return m_compressedGeometry.get(); }
+
+		// Builds the road graph from the highway ways, changes applied afterwards make routing rebuild it on next use
+		void EnableRouting(bool contract = false);
+
+		void DisableRouting() { m_roadGraph.reset(); }
+
+		const RoadGraph* GetRoadGraph() const { return m_roadGraph.get(); }
+
+		// Snaps both points to the nearest road within maxSnapDistance, nothing when either is too far or no route exists
+		std::optional<Route> FindRoute(double fromX, double fromY, double toX, double toY, RouteAlgorithm algorithm, double maxSnapDistance);
+
 	private:
-		Database(Map map);
+		using IndexEntry = CompactBoundingBox;
+
+		using QuadtreeIndex = quadtree::Quadtree<float, IndexEntry>;
+
+		using RTreeIndex = quadtree::RTree<float, IndexEntry>;
+
+		using Index = std::variant<QuadtreeIndex, RTreeIndex>;
+
+		// Pages of one copy of the index, pooled so that the nodes freed by changes are reused
+		struct IndexMemory
+		{
+			IndexMemory(PagePolicy pages, std::optional<std::size_t> numaNode);
+
+			PageResource pages;
+			std::pmr::synchronized_pool_resource pool;
+		};
+
+		Database(Map map, IndexEngine engine, const AllocationPolicy& allocation);
+
+		// Copy of the index on the NUMA node the calling thread runs on
+		Index& GetLocalIndex();
+
+		const Index& GetLocalIndex() const;
+
+		std::size_t GetIndexSize() const;
+
+		IndexEntry ToLocal(const quadtree::Rectangle<double>& searchWindow) const;
+
+		IndexEntry GetIndexEntry(std::size_t wayIndex) const;
+
+		void ApplyNodeChange(const NodeChange& change, ChangeSummary& summary, std::vector<std::size_t>& affectedWays);
+
+		void ApplyWayChange(const WayChange& change, ChangeSummary& summary);
+
+		void FindWaysWithNode(std::size_t nodeIndex, std::vector<std::size_t>& ways);
+
+		void IndexNode(std::size_t nodeIndex);
+
+		void UnindexNode(std::size_t nodeIndex);
+
+		void IndexWay(std::size_t wayIndex);
+
+		void UnindexWay(std::size_t wayIndex);
+
+		void InvalidateCachedArea(const quadtree::Rectangle<double>& area);
+
+		// Refreshes the geometry kept apart from the map, the prepared polygon and the compressed encoding
+		void UpdateWayGeometry(std::size_t wayIndex);
+
+		template<typename DistanceShape>
+		std::vector<DistanceQueryResult> QueryWithinDistance(const DistanceShape& shape);
+
+		// Segments of the matching ways that intersect the window
+		void LoadSnapCandidates(const quadtree::Rectangle<double>& window, const TagFilter& tagFilter, SegmentCandidates& candidates);
+
+		void JoinWaysWithNodes(const JoinCallback& callback) const;
+
+		std::vector<std::size_t> QueryUncached(const quadtree::Rectangle<double>& searchWindow);
+
+		void AppendNodes(const quadtree::Rectangle<double>& searchWindow, std::vector<std::size_t>& result) const;
+
+		std::vector<std::size_t> QueryCached(const quadtree::Rectangle<double>& searchWindow);
+
+		bool Matches(const IndexEntry& candidate, const quadtree::Rectangle<double>& searchWindow) const;
+
+		bool MatchesWay(std::size_t wayIndex, const quadtree::Rectangle<double>& searchWindow) const;
+
+		std::vector<std::size_t> QueryWays(const quadtree::Rectangle<double>& searchWindow, QueryStatistics* statistics);
 
 	private:
 		static constexpr int QuadtreeMaxDepth = 10;
+		static constexpr int NodeIndexMaxDepth = 20;
+		static constexpr std::size_t SnapBlockSize = 1024;
 
 		Map m_map;
-		quadtree::Quadtree<double, BoundngBox> m_quadtree;
+		// Area of the imported map, its center is the origin of the index's local coordinates and stays put
+		quadtree::Rectangle<double> m_indexedArea;
+		// Grows with the objects changes create or move outside of the indexed area
+		quadtree::Rectangle<double> m_extent;
+		// Declared before the indexes allocating from it
+		std::vector<std::unique_ptr<IndexMemory>> m_indexMemory;
+		// One per NUMA node when the index is replicated, node 0's first
+		std::vector<Index> m_indexes;
+		std::size_t m_mapHugePageBytes = 0;
+		quadtree::PointQuadtree<double> m_nodeIndex;
+		QueryPlanner m_planner;
+		PolygonIndex m_polygons;
+		std::unique_ptr<QueryCache> m_queryCache;
+		std::unique_ptr<CompressedGeometry> m_compressedGeometry;
+		std::unique_ptr<RoadGraph> m_roadGraph;
+		bool m_roadGraphStale = false;
 	};
 }
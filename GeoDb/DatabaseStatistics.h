@@ -0,0 +1,73 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "Map.h"
+#include "../Quadtree/IndexStatistics.h"
+
+namespace geodb
+{
+	struct DatabaseStatistics
+	{
+		quadtree::IndexStatistics index;
+		std::size_t nodeIndexPoints = 0;
+		std::size_t nodeIndexBytes = 0;
+		MapMemoryUsage map;
+		std::size_t polygonBytes = 0;
+		// Copies of the way index, one per NUMA node when replicated, the index statistics are of one copy
+		std::size_t indexReplicas = 1;
+		// Index and map memory backed or advised to be backed by huge pages
+		std::size_t hugePageBytes = 0;
+
+		std::size_t GetTotalBytes() const
+		{
+			return index.memory.GetTotalBytes() * indexReplicas + nodeIndexBytes + map.GetTotalBytes() + polygonBytes;
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const DatabaseStatistics& statistics)
+		{
+			const auto printArray = [&out](const std::vector<std::size_t>& values)
+				{
+					out << "[";
+					for (std::size_t i = 0; i < values.size(); ++i)
+					{
+						out << (i == 0 ? "" : ",") << values[i];
+					}
+					out << "]";
+				};
+
+			const auto& index = statistics.index;
+			out << "{\"elements\":" << index.elements
+				<< ",\"xAxisElements\":" << index.xAxisElements
+				<< ",\"yAxisElements\":" << index.yAxisElements
+				<< ",\"axisLists\":" << index.axisLists
+				<< ",\"longestAxisList\":" << index.longestAxisList
+				<< ",\"maxDepthReached\":" << index.maxDepthReached
+				<< ",\"nodesPerDepth\":";
+			printArray(index.nodesPerDepth);
+			out << ",\"elementsPerDepth\":";
+			printArray(index.elementsPerDepth);
+			out << ",\"elementsPerNodeHistogram\":";
+			printArray(index.elementsPerNodeHistogram);
+			out << ",\"axisListLengthHistogram\":";
+			printArray(index.axisListLengthHistogram);
+			return out
+				<< ",\"quadtreeNodeBytes\":" << index.memory.quadtreeNodeBytes
+				<< ",\"axisNodeBytes\":" << index.memory.axisNodeBytes
+				<< ",\"listNodeBytes\":" << index.memory.listNodeBytes
+				<< ",\"nodeIndexPoints\":" << statistics.nodeIndexPoints
+				<< ",\"nodeIndexBytes\":" << statistics.nodeIndexBytes
+				<< ",\"mapNodeBytes\":" << statistics.map.nodeBytes
+				<< ",\"mapWayBytes\":" << statistics.map.wayBytes
+				<< ",\"mapWayNodeBytes\":" << statistics.map.wayNodeBytes
+				<< ",\"mapTagBytes\":" << statistics.map.tagBytes
+				<< ",\"mapOsmIdBytes\":" << statistics.map.osmIdBytes
+				<< ",\"polygonBytes\":" << statistics.polygonBytes
+				<< ",\"indexReplicas\":" << statistics.indexReplicas
+				<< ",\"hugePageBytes\":" << statistics.hugePageBytes
+				<< ",\"totalBytes\":" << statistics.GetTotalBytes()
+				<< "}";
+		}
+	};
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Algo2d.h"
+#include "Map.h"
+#include "../Quadtree/Rectangle.h"
+
+namespace geodb
+{
+	class Circle
+	{
+	public:
+		Circle(double centerX, double centerY, double radius)
+			: m_centerX{ centerX }
+			, m_centerY{ centerY }
+			, m_radius{ radius }
+		{ }
+
+		double GetRadius() const { return m_radius; }
+
+		quadtree::Rectangle<double> GetBoundingBox() const
+		{
+			return quadtree::Rectangle<double>{ m_centerX, m_centerY, m_radius, m_radius };
+		}
+
+		bool IntersectsBox(double minX, double minY, double maxX, double maxY) const
+		{
+			return algo::PointBoxDistance(m_centerX, m_centerY, minX, minY, maxX, maxY) <= m_radius;
+		}
+
+		double DistanceToPoint(double x, double y) const
+		{
+			return algo::PointPointDistance(m_centerX, m_centerY, x, y);
+		}
+
+		double DistanceToSegment(double startX, double startY, double endX, double endY) const
+		{
+			return algo::PointSegmentDistance(m_centerX, m_centerY, startX, startY, endX, endY);
+		}
+
+	private:
+		double m_centerX;
+		double m_centerY;
+		double m_radius;
+	};
+
+	// Area within the given distance of a polyline
+	class Corridor
+	{
+	public:
+		Corridor(std::vector<Node> polyline, double radius)
+			: m_polyline{ std::move(polyline) }
+			, m_radius{ radius }
+		{
+			if (m_polyline.empty())
+			{
+				throw std::invalid_argument{ "Corridor polyline must contain at least one point" };
+			}
+
+			auto minX = m_polyline[0].GetX();
+			auto minY = m_polyline[0].GetY();
+			auto maxX = m_polyline[0].GetX();
+			auto maxY = m_polyline[0].GetY();
+			for (const auto& point : m_polyline)
+			{
+				minX = std::min(minX, point.GetX());
+				minY = std::min(minY, point.GetY());
+				maxX = std::max(maxX, point.GetX());
+				maxY = std::max(maxY, point.GetY());
+			}
+
+			m_boundingBox = quadtree::Rectangle<double>::Of(
+				minX - radius, maxY + radius, maxX - minX + radius * 2.0, maxY - minY + radius * 2.0
+			);
+		}
+
+		double GetRadius() const { return m_radius; }
+
+		quadtree::Rectangle<double> GetBoundingBox() const { return m_boundingBox; }
+
+		bool IntersectsBox(double minX, double minY, double maxX, double maxY) const
+		{
+			return MinOverSegments([&](const Node& start, const Node& end)
+				{
+					return algo::SegmentBoxDistance(
+						start.GetX(), start.GetY(), end.GetX(), end.GetY(), minX, minY, maxX, maxY
+					);
+				}) <= m_radius;
+		}
+
+		double DistanceToPoint(double x, double y) const
+		{
+			return MinOverSegments([&](const Node& start, const Node& end)
+				{
+					return algo::PointSegmentDistance(x, y, start.GetX(), start.GetY(), end.GetX(), end.GetY());
+				});
+		}
+
+		double DistanceToSegment(double startX, double startY, double endX, double endY) const
+		{
+			return MinOverSegments([&](const Node& start, const Node& end)
+				{
+					return algo::SegmentSegmentDistance(
+						start.GetX(), start.GetY(), end.GetX(), end.GetY(), startX, startY, endX, endY
+					);
+				});
+		}
+
+	private:
+		template<typename Distance>
+		double MinOverSegments(const Distance& distance) const
+		{
+			if (m_polyline.size() == 1)
+			{
+				return distance(m_polyline[0], m_polyline[0]);
+			}
+
+			auto result = std::numeric_limits<double>::max();
+			for (std::size_t i = 0; i + 1 < m_polyline.size(); ++i)
+			{
+				result = std::min(result, distance(m_polyline[i], m_polyline[i + 1]));
+			}
+			return result;
+		}
+
+	private:
+		std::vector<Node> m_polyline;
+		double m_radius;
+		quadtree::Rectangle<double> m_boundingBox;
+	};
+}
@@ -0,0 +1,379 @@
+#include "FeatureWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// Longest shortest round-trip form of a double, like -2.2250738585072014e-308, with room to spare
+	constexpr std::size_t MaxNumberChars = 32;
+
+	bool IsClosed(const geodb::Way& way)
+	{
+		const auto& nodes = way.GetNodes();
+		return nodes.size() >= 4 && nodes.front() == nodes.back();
+	}
+
+	void WriteToFileDescriptor(int fileDescriptor, const char* data, std::size_t size)
+	{
+		while (size > 0)
+		{
+#if defined(_WIN32)
+			const auto written = _write(fileDescriptor, data, static_cast<unsigned>(std::min<std::size_t>(size, std::numeric_limits<int>::max())));
+#else
+			const auto written = ::write(fileDescriptor, data, size);
+#endif
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				throw std::system_error{ errno, std::generic_category(), "Writing features failed" };
+			}
+			data += written;
+			size -= static_cast<std::size_t>(written);
+		}
+	}
+}
+
+namespace geodb
+{
+	FeatureWriter::FeatureWriter(const Map& map, FeatureFormat format, std::span<char> buffer)
+		: m_map{ map }
+		, m_format{ format }
+		, m_begin{ buffer.data() }
+		, m_end{ buffer.data() + buffer.size() }
+		, m_position{ buffer.data() }
+	{
+	}
+
+	FeatureWriter::FeatureWriter(const Map& map, FeatureFormat format, int fileDescriptor, std::span<char> buffer)
+		: FeatureWriter{ map, format, buffer }
+	{
+		if (buffer.empty())
+		{
+			throw std::invalid_argument{ "Writing to a file descriptor needs a buffer" };
+		}
+		m_fileDescriptor = fileDescriptor;
+	}
+
+	bool FeatureWriter::Begin()
+	{
+		auto* start = m_position;
+		if (m_format == FeatureFormat::GeoJson)
+		{
+			Put("{\"type\":\"FeatureCollection\",\"features\":[");
+		}
+		return Commit(start);
+	}
+
+	bool FeatureWriter::Write(const QueryResult& object)
+	{
+		const auto objectCount = object.objectType == ObjectType::Way ? m_map.GetWays().size() : m_map.GetNodes().size();
+		if (object.objectId >= objectCount)
+		{
+			throw std::out_of_range{ "Object is not in the map" };
+		}
+
+		auto* start = m_position;
+		if (m_format == FeatureFormat::GeoJson)
+		{
+			WriteGeoJson(object);
+		}
+		else
+		{
+			WriteBinary(object);
+		}
+		if (!Commit(start))
+		{
+			return false;
+		}
+		++m_features;
+		return true;
+	}
+
+	std::size_t FeatureWriter::Write(std::span<const QueryResult> objects)
+	{
+		for (std::size_t i = 0; i < objects.size(); ++i)
+		{
+			if (!Write(objects[i]))
+			{
+				return i;
+			}
+		}
+		return objects.size();
+	}
+
+	bool FeatureWriter::End()
+	{
+		auto* start = m_position;
+		if (m_format == FeatureFormat::GeoJson)
+		{
+			Put("]}");
+		}
+		if (!Commit(start))
+		{
+			return false;
+		}
+		Flush();
+		return true;
+	}
+
+	void FeatureWriter::Flush()
+	{
+		if (m_fileDescriptor >= 0)
+		{
+			WriteToFileDescriptor(m_fileDescriptor, m_begin, static_cast<std::size_t>(m_position - m_begin));
+			ClearBuffered();
+		}
+	}
+
+	void FeatureWriter::ClearBuffered()
+	{
+		m_clearedBytes += static_cast<std::size_t>(m_position - m_begin);
+		m_position = m_begin;
+	}
+
+	void FeatureWriter::Put(const char* data, std::size_t size)
+	{
+		while (size > 0)
+		{
+			if (m_position == m_end)
+			{
+				if (m_fileDescriptor < 0)
+				{
+					m_overflowed = true;
+					return;
+				}
+				Flush();
+			}
+			const auto chunk = std::min(size, static_cast<std::size_t>(m_end - m_position));
+			std::memcpy(m_position, data, chunk);
+			m_position += chunk;
+			data += chunk;
+			size -= chunk;
+		}
+	}
+
+	void FeatureWriter::Put(char c)
+	{
+		if (m_position != m_end)
+		{
+			*m_position++ = c;
+			return;
+		}
+		Put(&c, 1);
+	}
+
+	template<typename T>
+	void FeatureWriter::PutBinary(T value)
+	{
+		if (static_cast<std::size_t>(m_end - m_position) >= sizeof(T))
+		{
+			std::memcpy(m_position, &value, sizeof(T));
+			m_position += sizeof(T);
+			return;
+		}
+		Put(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	// Shortest form that reads back to the same double, straight into the buffer when there is room
+	void FeatureWriter::PutNumber(double value)
+	{
+		if (!std::isfinite(value))
+		{
+			Put("null");
+			return;
+		}
+		if (static_cast<std::size_t>(m_end - m_position) >= MaxNumberChars)
+		{
+			m_position = std::to_chars(m_position, m_end, value).ptr;
+			return;
+		}
+		char digits[MaxNumberChars];
+		const auto end = std::to_chars(digits, digits + MaxNumberChars, value).ptr;
+		Put(digits, static_cast<std::size_t>(end - digits));
+	}
+
+	void FeatureWriter::PutNumber(std::size_t value)
+	{
+		if (static_cast<std::size_t>(m_end - m_position) >= MaxNumberChars)
+		{
+			m_position = std::to_chars(m_position, m_end, value).ptr;
+			return;
+		}
+		char digits[MaxNumberChars];
+		const auto end = std::to_chars(digits, digits + MaxNumberChars, value).ptr;
+		Put(digits, static_cast<std::size_t>(end - digits));
+	}
+
+	// Runs of characters that need no escaping are copied at once
+	void FeatureWriter::PutJsonString(std::string_view text)
+	{
+		constexpr char HexDigits[] = "0123456789abcdef";
+
+		Put('"');
+		auto runStart = std::size_t{ 0 };
+		for (std::size_t i = 0; i < text.size(); ++i)
+		{
+			const auto c = static_cast<unsigned char>(text[i]);
+			if (c >= 0x20 && c != '"' && c != '\\')
+			{
+				continue;
+			}
+			Put(text.data() + runStart, i - runStart);
+			runStart = i + 1;
+			switch (c)
+			{
+			case '"':
+				Put("\\\"");
+				break;
+			case '\\':
+				Put("\\\\");
+				break;
+			case '\n':
+				Put("\\n");
+				break;
+			case '\r':
+				Put("\\r");
+				break;
+			case '\t':
+				Put("\\t");
+				break;
+			default:
+				const char escaped[] = { '\\', 'u', '0', '0', HexDigits[c >> 4], HexDigits[c & 0xf] };
+				Put(escaped, sizeof(escaped));
+				break;
+			}
+		}
+		Put(text.data() + runStart, text.size() - runStart);
+		Put('"');
+	}
+
+	void FeatureWriter::WriteGeoJson(const QueryResult& object)
+	{
+		const auto putPoint = [this](const Node& node)
+			{
+				Put('[');
+				PutNumber(node.GetX());
+				Put(',');
+				PutNumber(node.GetY());
+				Put(']');
+			};
+
+		if (m_features > 0)
+		{
+			Put(',');
+		}
+		Put(object.objectType == ObjectType::Way ? "{\"type\":\"Feature\",\"id\":\"way/" : "{\"type\":\"Feature\",\"id\":\"node/");
+		PutNumber(object.objectId);
+		Put("\",\"geometry\":");
+		if (object.objectType == ObjectType::Node)
+		{
+			Put("{\"type\":\"Point\",\"coordinates\":");
+			putPoint(m_map.GetNodes()[object.objectId]);
+			Put('}');
+		}
+		else if (const auto& way = m_map.GetWays()[object.objectId]; way.IsDeleted())
+		{
+			Put("null");
+		}
+		else
+		{
+			const auto closed = IsClosed(way);
+			Put(closed ? "{\"type\":\"Polygon\",\"coordinates\":[[" : "{\"type\":\"LineString\",\"coordinates\":[");
+			const auto& nodes = way.GetNodes();
+			for (std::size_t i = 0; i < nodes.size(); ++i)
+			{
+				if (i > 0)
+				{
+					Put(',');
+				}
+				putPoint(m_map.GetNodes()[nodes[i]]);
+			}
+			Put(closed ? "]]}" : "]}");
+		}
+
+		Put(",\"properties\":{");
+		if (const auto* tags = m_map.GetObjectTags(object.objectId, object.objectType))
+		{
+			for (std::size_t i = 0; i < tags->size(); ++i)
+			{
+				if (i > 0)
+				{
+					Put(',');
+				}
+				PutJsonString((*tags)[i].GetKey());
+				Put(':');
+				PutJsonString((*tags)[i].GetValue());
+			}
+		}
+		Put("}}");
+	}
+
+	void FeatureWriter::WriteBinary(const QueryResult& object)
+	{
+		const auto* tags = m_map.GetObjectTags(object.objectId, object.objectType);
+		const auto* wayNodes = object.objectType == ObjectType::Way ? &m_map.GetWays()[object.objectId].GetNodes() : nullptr;
+		const auto pointCount = wayNodes != nullptr ? wayNodes->size() : 1;
+
+		auto recordBytes = sizeof(std::uint8_t) + sizeof(std::uint64_t) + sizeof(std::uint32_t) + pointCount * 2 * sizeof(double) + sizeof(std::uint32_t);
+		if (tags != nullptr)
+		{
+			for (const auto& tag : *tags)
+			{
+				recordBytes += 2 * sizeof(std::uint32_t) + tag.GetKey().size() + tag.GetValue().size();
+			}
+		}
+		if (recordBytes > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::length_error{ "Feature is too large for the binary format" };
+		}
+
+		PutBinary(static_cast<std::uint32_t>(recordBytes));
+		PutBinary(static_cast<std::uint8_t>(object.objectType == ObjectType::Way ? 1 : 0));
+		PutBinary(static_cast<std::uint64_t>(object.objectId));
+		PutBinary(static_cast<std::uint32_t>(pointCount));
+		for (std::size_t i = 0; i < pointCount; ++i)
+		{
+			const auto& node = m_map.GetNodes()[wayNodes != nullptr ? (*wayNodes)[i] : object.objectId];
+			PutBinary(node.GetX());
+			PutBinary(node.GetY());
+		}
+		PutBinary(static_cast<std::uint32_t>(tags != nullptr ? tags->size() : 0));
+		if (tags != nullptr)
+		{
+			for (const auto& tag : *tags)
+			{
+				PutBinary(static_cast<std::uint32_t>(tag.GetKey().size()));
+				Put(tag.GetKey());
+				PutBinary(static_cast<std::uint32_t>(tag.GetValue().size()));
+				Put(tag.GetValue());
+			}
+		}
+	}
+
+	bool FeatureWriter::Commit(char* featureStart)
+	{
+		if (!m_overflowed)
+		{
+			return true;
+		}
+		m_position = featureStart;
+		m_overflowed = false;
+		return false;
+	}
+}
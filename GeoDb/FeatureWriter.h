@@ -0,0 +1,97 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "Map.h"
+#include "QueryResult.h"
+
+// GeoJSON is written as one FeatureCollection, ids are "node/<index>" and "way/<index>", closed ways are polygons,
+// the tags are the properties and coordinates are the map's projected ones.
+// Binary features are records of a u32 length of the rest of the record, the object type u8 (0 node, 1 way), the
+// object index u64, a u32 point count with x y f64 per point, and a u32 tag count with per tag a u32 length and the
+// bytes of the key, then of the value. Deleted ways have no points, numbers are little-endian.
+namespace geodb
+{
+	static_assert(std::endian::native == std::endian::little, "Binary features are written straight from memory");
+
+	enum class FeatureFormat
+	{
+		GeoJson,
+		Binary
+	};
+
+	// Streams objects of a map into a buffer owned by the caller, without allocating. Not thread-safe
+	class FeatureWriter
+	{
+	public:
+		// The buffer is the whole output, features that do not fit are refused whole so that the caller can send
+		// what is buffered, clear it and write them again
+		FeatureWriter(const Map& map, FeatureFormat format, std::span<char> buffer);
+
+		// The buffer gathers writes to the descriptor, which is neither closed nor flushed to disk. Throws
+		// std::system_error when writing fails
+		FeatureWriter(const Map& map, FeatureFormat format, int fileDescriptor, std::span<char> buffer);
+
+		FeatureWriter(const FeatureWriter& other) = delete;
+
+		FeatureWriter& operator=(const FeatureWriter& other) = delete;
+
+		// Opens the GeoJSON collection, binary output has no header
+		bool Begin();
+
+		// Throws std::out_of_range for objects not in the map
+		bool Write(const QueryResult& object);
+
+		// Number of objects written, the rest did not fit
+		std::size_t Write(std::span<const QueryResult> objects);
+
+		// Closes the GeoJSON collection and flushes the buffer to the descriptor
+		bool End();
+
+		void Flush();
+
+		// Bytes in the buffer, all that was written since the last clear when writing to a buffer only
+		std::span<const char> GetBuffered() const { return { m_begin, m_position }; }
+
+		void ClearBuffered();
+
+		std::size_t GetWrittenBytes() const { return m_clearedBytes + static_cast<std::size_t>(m_position - m_begin); }
+
+	private:
+		void Put(const char* data, std::size_t size);
+
+		void Put(std::string_view text) { Put(text.data(), text.size()); }
+
+		void Put(char c);
+
+		template<typename T>
+		void PutBinary(T value);
+
+		void PutNumber(double value);
+
+		void PutNumber(std::size_t value);
+
+		void PutJsonString(std::string_view text);
+
+		void WriteGeoJson(const QueryResult& object);
+
+		void WriteBinary(const QueryResult& object);
+
+		// Undoes the feature being written when it overflowed the buffer
+		bool Commit(char* featureStart);
+
+		const Map& m_map;
+		FeatureFormat m_format;
+		int m_fileDescriptor = -1;
+		char* m_begin;
+		char* m_end;
+		char* m_position;
+		bool m_overflowed = false;
+		std::size_t m_features = 0;
+		std::size_t m_clearedBytes = 0;
+	};
+}
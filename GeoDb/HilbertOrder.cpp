@@ -0,0 +1,111 @@
+#include "HilbertOrder.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+	constexpr unsigned CurveOrder = 20;
+
+	// Values outside the range fall into the border cells, and a range of no length is a single cell
+	std::uint32_t ToCell(double value, double min, double max, unsigned order)
+	{
+		const auto lastCell = (std::uint32_t{ 1 } << order) - 1;
+		if (!(max > min))
+		{
+			return 0;
+		}
+		const auto cell = (value - min) / (max - min) * lastCell;
+		return static_cast<std::uint32_t>(std::clamp(cell, 0.0, static_cast<double>(lastCell)));
+	}
+
+	class HilbertGrid
+	{
+	public:
+		explicit HilbertGrid(const geodb::Map& map)
+		{
+			for (const auto& node : map.GetNodes())
+			{
+				m_minX = std::min(m_minX, node.GetX());
+				m_minY = std::min(m_minY, node.GetY());
+				m_maxX = std::max(m_maxX, node.GetX());
+				m_maxY = std::max(m_maxY, node.GetY());
+			}
+		}
+
+		std::uint64_t GetIndex(double x, double y) const
+		{
+			return geodb::GetHilbertIndex(ToCell(x, m_minX, m_maxX, CurveOrder), ToCell(y, m_minY, m_maxY, CurveOrder), CurveOrder);
+		}
+
+	private:
+		double m_minX = std::numeric_limits<double>::max();
+		double m_minY = std::numeric_limits<double>::max();
+		double m_maxX = std::numeric_limits<double>::lowest();
+		double m_maxY = std::numeric_limits<double>::lowest();
+	};
+
+	std::vector<std::size_t> SortByKeys(const std::vector<std::uint64_t>& keys)
+	{
+		auto order = std::vector<std::size_t>(keys.size());
+		std::iota(order.begin(), order.end(), std::size_t{ 0 });
+		std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return keys[a] < keys[b]; });
+		return order;
+	}
+}
+
+namespace geodb
+{
+	std::uint64_t GetHilbertIndex(std::uint32_t x, std::uint32_t y, unsigned order)
+	{
+		auto index = std::uint64_t{ 0 };
+		for (auto side = std::uint32_t{ 1 } << (order - 1); side > 0; side >>= 1)
+		{
+			const auto rx = (x & side) != 0 ? 1u : 0u;
+			const auto ry = (y & side) != 0 ? 1u : 0u;
+			index += static_cast<std::uint64_t>(side) * side * ((3 * rx) ^ ry);
+
+			// Rotate the quadrant so that the curve inside it starts and ends next to its neighbours
+			if (ry == 0)
+			{
+				if (rx == 1)
+				{
+					x = side - 1 - (x & (side - 1));
+					y = side - 1 - (y & (side - 1));
+				}
+				std::swap(x, y);
+			}
+		}
+		return index;
+	}
+
+	std::uint64_t GetHilbertIndex(double x, double y, const quadtree::Rectangle<double>& area, unsigned order)
+	{
+		const auto cellX = ToCell(x, area.GetCenterX() - area.GetHalfWidth(), area.GetCenterX() + area.GetHalfWidth(), order);
+		const auto cellY = ToCell(y, area.GetCenterY() - area.GetHalfHeight(), area.GetCenterY() + area.GetHalfHeight(), order);
+		return GetHilbertIndex(cellX, cellY, order);
+	}
+
+	MapPermutation SortAlongHilbertCurve(Map& map)
+	{
+		const auto grid = HilbertGrid{ map };
+
+		auto nodeKeys = std::vector<std::uint64_t>{};
+		nodeKeys.reserve(map.GetNodes().size());
+		for (const auto& node : map.GetNodes())
+		{
+			nodeKeys.push_back(grid.GetIndex(node.GetX(), node.GetY()));
+		}
+
+		auto wayKeys = std::vector<std::uint64_t>{};
+		wayKeys.reserve(map.GetWays().size());
+		for (const auto& way : map.GetWays())
+		{
+			const auto& box = way.GetBoundingBox();
+			wayKeys.push_back(grid.GetIndex(box.GetCenterX(), box.GetCenterY()));
+		}
+
+		return map.Reorder(SortByKeys(nodeKeys), SortByKeys(wayKeys));
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Map.h"
+
+namespace geodb
+{
+	// Position of cell (x, y) along the Hilbert curve filling a grid of 2^order cells per side
+	std::uint64_t GetHilbertIndex(std::uint32_t x, std::uint32_t y, unsigned order);
+
+	// Position of the cell holding the point when the area is split into 2^order cells per side. Points outside the
+	// area fall into its border cells, and a side of no length, as for points all on one line, has a single cell
+	std::uint64_t GetHilbertIndex(double x, double y, const quadtree::Rectangle<double>& area, unsigned order);
+
+	// Reorders nodes by position and ways by the center of their bounding box along a Hilbert curve over the
+	// extent of the map, so that objects close on the map are close in memory and in the index
+	MapPermutation SortAlongHilbertCurve(Map& map);
+}
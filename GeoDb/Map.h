@@ -1,15 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <optional>
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <string_view>
 #include <stdexcept>
 
+#include "ObjectType.h"
 #include "../Quadtree/Rectangle.h"
 
 namespace geodb
 {
+	using OsmId = std::int64_t;
+
 	class Node
 	{
 	public:
@@ -39,6 +45,21 @@ namespace geodb
 
 		const quadtree::Rectangle<double>& GetBoundingBox() const { return m_boundingBox; };
 
+		std::size_t GetAllocatedBytes() const { return m_nodes.capacity() * sizeof(std::size_t); }
+
+		void SetNodes(std::vector<std::size_t> nodes, const quadtree::Rectangle<double>& boundingBox)
+		{
+			m_nodes = std::move(nodes);
+			m_boundingBox = boundingBox;
+		}
+
+		void SetBoundingBox(const quadtree::Rectangle<double>& boundingBox) { m_boundingBox = boundingBox; }
+
+		// Deleted ways keep their slot so that the ids of other ways stay valid, a way always has nodes otherwise
+		void Delete() { m_nodes = {}; }
+
+		bool IsDeleted() const { return m_nodes.empty(); }
+
 	private:
 		quadtree::Rectangle<double> m_boundingBox;
 		std::vector<std::size_t> m_nodes;
@@ -56,11 +77,44 @@ namespace geodb
 
 		std::string_view GetValue() const { return m_value; }
 
+		std::size_t GetAllocatedBytes() const
+		{
+			return GetAllocatedBytes(m_key) + GetAllocatedBytes(m_value);
+		}
+
+	private:
+		static std::size_t GetAllocatedBytes(const std::string& string)
+		{
+			static const auto inplaceCapacity = std::string{}.capacity();
+			return string.capacity() > inplaceCapacity ? string.capacity() + 1 : 0;
+		}
+
 	private:
 		std::string m_key;
 		std::string m_value;
 	};
 
+	struct MapMemoryUsage
+	{
+		std::size_t nodeBytes = 0;
+		std::size_t wayBytes = 0;
+		std::size_t wayNodeBytes = 0;
+		std::size_t tagBytes = 0;
+		std::size_t osmIdBytes = 0;
+
+		std::size_t GetTotalBytes() const
+		{
+			return nodeBytes + wayBytes + wayNodeBytes + tagBytes + osmIdBytes;
+		}
+	};
+
+	// Old object ids to new ones, after the objects of a map were reordered
+	struct MapPermutation
+	{
+		std::vector<std::size_t> nodes;
+		std::vector<std::size_t> ways;
+	};
+
 	class Map
 	{
 	public:
@@ -72,31 +126,209 @@ namespace geodb
 
 		const std::vector<Way>& GetWays() const { return m_ways; }
 
-		const std::vector<Tag>* GetObjectTags(std::size_t objectId) const
+		const std::vector<Tag>* GetObjectTags(std::size_t objectId, ObjectType objectType) const
+		{
+			return const_cast<Map*>(this)->DoGetObjectTags(objectId, objectType);
+		}
+
+		std::vector<Tag>* GetObjectTags(std::size_t objectId, ObjectType objectType)
+		{
+			return DoGetObjectTags(objectId, objectType);
+		}
+
+		void AddTagToObject(std::size_t objectId, ObjectType objectType, std::string_view key, std::string_view value)
+		{
+			GetTags(objectType)[objectId].push_back(Tag{ std::string{ key }, std::string{ value } });
+		}
+
+		// Replaces all tags of the object, an empty list removes them
+		void SetObjectTags(std::size_t objectId, ObjectType objectType, std::vector<Tag> tags)
+		{
+			if (tags.empty())
+			{
+				GetTags(objectType).erase(objectId);
+				return;
+			}
+			GetTags(objectType)[objectId] = std::move(tags);
+		}
+
+		void SetOsmId(std::size_t objectId, ObjectType objectType, OsmId osmId)
 		{
-			return const_cast<Map*>(this)->DoGetObjectTags(objectId);
+			GetOsmIds(objectType)[osmId] = objectId;
 		}
 
-		std::vector<Tag>* GetObjectTags(std::size_t objectId)
+		void RemoveOsmId(OsmId osmId, ObjectType objectType)
 		{
-			return DoGetObjectTags(objectId);
+			GetOsmIds(objectType).erase(osmId);
 		}
 
-		void AddTagToObject(std::size_t objectId, std::string_view key, std::string_view value)
+		std::optional<std::size_t> FindObject(OsmId osmId, ObjectType objectType) const
 		{
-			m_tags[objectId].push_back(Tag{ std::string{ key }, std::string{ value } });
+			const auto& osmIds = const_cast<Map*>(this)->GetOsmIds(objectType);
+			const auto it = osmIds.find(osmId);
+			return it == osmIds.end() ? std::nullopt : std::optional<std::size_t>{ it->second };
+		}
+
+		// Moves the objects so that new id i holds old object order[i], references from ways,
+		// tags and OSM ids follow their objects
+		MapPermutation Reorder(const std::vector<std::size_t>& nodeOrder, const std::vector<std::size_t>& wayOrder)
+		{
+			if (nodeOrder.size() != m_nodes.size() || wayOrder.size() != m_ways.size())
+			{
+				throw std::invalid_argument{ "Orders must list every object once" };
+			}
+
+			auto permutation = MapPermutation{
+				std::vector<std::size_t>(m_nodes.size(), m_nodes.size()),
+				std::vector<std::size_t>(m_ways.size(), m_ways.size())
+			};
+			for (std::size_t i = 0; i < nodeOrder.size(); ++i)
+			{
+				if (nodeOrder[i] >= m_nodes.size() || permutation.nodes[nodeOrder[i]] != m_nodes.size())
+				{
+					throw std::invalid_argument{ "Orders must list every object once" };
+				}
+				permutation.nodes[nodeOrder[i]] = i;
+			}
+			for (std::size_t i = 0; i < wayOrder.size(); ++i)
+			{
+				if (wayOrder[i] >= m_ways.size() || permutation.ways[wayOrder[i]] != m_ways.size())
+				{
+					throw std::invalid_argument{ "Orders must list every object once" };
+				}
+				permutation.ways[wayOrder[i]] = i;
+			}
+
+			auto nodes = std::vector<Node>{};
+			nodes.reserve(m_nodes.size());
+			for (const auto node : nodeOrder)
+			{
+				nodes.push_back(m_nodes[node]);
+			}
+			m_nodes = std::move(nodes);
+
+			auto ways = std::vector<Way>{};
+			ways.reserve(m_ways.size());
+			for (const auto way : wayOrder)
+			{
+				ways.push_back(std::move(m_ways[way]));
+				auto wayNodes = ways.back().GetNodes();
+				for (auto& node : wayNodes)
+				{
+					node = permutation.nodes[node];
+				}
+				ways.back().SetNodes(std::move(wayNodes), ways.back().GetBoundingBox());
+			}
+			m_ways = std::move(ways);
+
+			RemapIds(m_nodeTags, m_nodeOsmIds, permutation.nodes);
+			RemapIds(m_wayTags, m_wayOsmIds, permutation.ways);
+
+			return permutation;
+		}
+
+		MapMemoryUsage GetMemoryUsage() const
+		{
+			auto usage = MapMemoryUsage{};
+
+			usage.nodeBytes = m_nodes.capacity() * sizeof(Node);
+			usage.wayBytes = m_ways.capacity() * sizeof(Way);
+			for (const auto& way : m_ways)
+			{
+				usage.wayNodeBytes += way.GetAllocatedBytes();
+			}
+
+			using TagMapEntry = std::pair<const std::size_t, std::vector<Tag>>;
+			for (const auto* tagMap : { &m_nodeTags, &m_wayTags })
+			{
+				usage.tagBytes += tagMap->bucket_count() * sizeof(void*);
+				for (const auto& [objectId, tags] : *tagMap)
+				{
+					usage.tagBytes += sizeof(TagMapEntry) + sizeof(void*) + tags.capacity() * sizeof(Tag);
+					for (const auto& tag : tags)
+					{
+						usage.tagBytes += tag.GetAllocatedBytes();
+					}
+				}
+			}
+
+			using OsmIdMapEntry = std::pair<const OsmId, std::size_t>;
+			for (const auto* osmIds : { &m_nodeOsmIds, &m_wayOsmIds })
+			{
+				usage.osmIdBytes += osmIds->bucket_count() * sizeof(void*) + osmIds->size() * (sizeof(OsmIdMapEntry) + sizeof(void*));
+			}
+
+			return usage;
 		}
 
 	private:
-		std::vector<Tag>* DoGetObjectTags(std::size_t objectId)
+		using TagMap = std::unordered_map<std::size_t, std::vector<Tag>>;
+		using OsmIdMap = std::unordered_map<OsmId, std::size_t>;
+
+		std::vector<Tag>* DoGetObjectTags(std::size_t objectId, ObjectType objectType)
 		{
-			const auto it = m_tags.find(objectId);
-			return it == m_tags.end() ? nullptr : &it->second;
+			auto& tags = GetTags(objectType);
+			const auto it = tags.find(objectId);
+			return it == tags.end() ? nullptr : &it->second;
+		}
+
+		static void RemapIds(TagMap& tags, OsmIdMap& osmIds, const std::vector<std::size_t>& newIds)
+		{
+			auto remappedTags = TagMap{};
+			remappedTags.reserve(tags.size());
+			for (auto& [objectId, objectTags] : tags)
+			{
+				remappedTags.emplace(newIds[objectId], std::move(objectTags));
+			}
+			tags = std::move(remappedTags);
+
+			for (auto& [osmId, objectId] : osmIds)
+			{
+				objectId = newIds[objectId];
+			}
+		}
+
+		TagMap& GetTags(ObjectType objectType)
+		{
+			return objectType == ObjectType::Node ? m_nodeTags : m_wayTags;
+		}
+
+		OsmIdMap& GetOsmIds(ObjectType objectType)
+		{
+			return objectType == ObjectType::Node ? m_nodeOsmIds : m_wayOsmIds;
 		}
 
 	private:
 		std::vector<Node> m_nodes;
 		std::vector<Way> m_ways;
-		std::unordered_map<std::size_t, std::vector<Tag>> m_tags;
+		TagMap m_nodeTags;
+		TagMap m_wayTags;
+		OsmIdMap m_nodeOsmIds;
+		OsmIdMap m_wayOsmIds;
 	};
+
+	// Smallest rectangle holding every node of the map, empty at the origin for a map without nodes
+	inline quadtree::Rectangle<double> GetMapArea(const Map& map)
+	{
+		const auto& nodes = map.GetNodes();
+		if (nodes.empty())
+		{
+			return quadtree::Rectangle<double>{ 0.0, 0.0, 0.0, 0.0 };
+		}
+
+		auto maxX = nodes[0].GetX();
+		auto maxY = nodes[0].GetY();
+		auto minX = nodes[0].GetX();
+		auto minY = nodes[0].GetY();
+
+		for (const auto& node : nodes)
+		{
+			maxX = std::max(maxX, node.GetX());
+			maxY = std::max(maxY, node.GetY());
+			minX = std::min(minX, node.GetX());
+			minY = std::min(minY, node.GetY());
+		}
+
+		return quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
+	}
 }
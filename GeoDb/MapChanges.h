@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Map.h"
+
+namespace geodb
+{
+	// Objects that are not known yet are created, known ones are replaced
+	struct NodeChange
+	{
+		OsmId osmId = 0;
+		bool deleted = false;
+		double x = 0.0;
+		double y = 0.0;
+		std::vector<Tag> tags;
+	};
+
+	struct WayChange
+	{
+		OsmId osmId = 0;
+		bool deleted = false;
+		std::vector<OsmId> nodes;
+		std::vector<Tag> tags;
+	};
+
+	// Node changes are applied before way changes, each in the given order
+	struct MapChanges
+	{
+		std::vector<NodeChange> nodes;
+		std::vector<WayChange> ways;
+	};
+
+	struct ChangeSummary
+	{
+		std::size_t nodesCreated = 0;
+		std::size_t nodesModified = 0;
+		std::size_t nodesDeleted = 0;
+		std::size_t waysCreated = 0;
+		std::size_t waysModified = 0;
+		std::size_t waysDeleted = 0;
+		// Ways whose bounding box changed because some of their nodes moved
+		std::size_t waysReindexed = 0;
+	};
+}
@@ -0,0 +1,460 @@
+#include "MemoryPlacement.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace geodb
+{
+	namespace
+	{
+		// Requests above this get a region of their own, which is returned to the system when they are freed
+		constexpr std::size_t SharedRegionLimit = HugePageBytes / 4;
+
+		std::size_t RoundUp(std::size_t value, std::size_t multiple)
+		{
+			return (value + multiple - 1) / multiple * multiple;
+		}
+
+		struct MappedMemory
+		{
+			void* data;
+			bool hugePages;
+		};
+	}
+
+#if defined(_WIN32)
+	namespace
+	{
+		// Nodes with processors, in the order of their numbers
+		const std::vector<USHORT>& GetNodeNumbers()
+		{
+			static const auto nodes = []()
+				{
+					auto result = std::vector<USHORT>{};
+					auto highest = ULONG{ 0 };
+					if (GetNumaHighestNodeNumber(&highest))
+					{
+						for (ULONG node = 0; node <= highest; ++node)
+						{
+							auto affinity = GROUP_AFFINITY{};
+							if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) && affinity.Mask != 0)
+							{
+								result.push_back(static_cast<USHORT>(node));
+							}
+						}
+					}
+					return result;
+				}();
+			return nodes;
+		}
+
+		MappedMemory MapMemory(std::size_t bytes, PagePolicy pages, std::optional<std::size_t> numaNode)
+		{
+			const auto preferredNode = numaNode && *numaNode < GetNodeNumbers().size()
+				? static_cast<DWORD>(GetNodeNumbers()[*numaNode])
+				: NUMA_NO_PREFERRED_NODE;
+			if (pages == PagePolicy::ExplicitHugePages && GetLargePageMinimum() != 0 && bytes % GetLargePageMinimum() == 0)
+			{
+				// Fails without the lock pages in memory privilege or when no contiguous physical memory is left
+				auto* data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, preferredNode);
+				if (data != nullptr)
+				{
+					return MappedMemory{ data, true };
+				}
+			}
+			auto* data = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, preferredNode);
+			if (data == nullptr)
+			{
+				throw std::bad_alloc{};
+			}
+			return MappedMemory{ data, false };
+		}
+
+		void UnmapMemory(void* data, std::size_t)
+		{
+			VirtualFree(data, 0, MEM_RELEASE);
+		}
+	}
+
+	std::size_t GetNumaNodeCount()
+	{
+		return std::max<std::size_t>(GetNodeNumbers().size(), 1);
+	}
+
+	std::size_t GetCurrentNumaNode()
+	{
+		auto processor = PROCESSOR_NUMBER{};
+		GetCurrentProcessorNumberEx(&processor);
+		auto node = USHORT{ 0 };
+		if (!GetNumaProcessorNodeEx(&processor, &node))
+		{
+			return 0;
+		}
+		const auto& nodes = GetNodeNumbers();
+		const auto found = std::find(nodes.begin(), nodes.end(), node);
+		return found != nodes.end() ? static_cast<std::size_t>(found - nodes.begin()) : 0;
+	}
+
+	bool PinThreadToNumaNode(std::size_t node)
+	{
+		if (node >= GetNodeNumbers().size())
+		{
+			return false;
+		}
+		auto affinity = GROUP_AFFINITY{};
+		return GetNumaNodeProcessorMaskEx(GetNodeNumbers()[node], &affinity) && SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+	}
+
+	// Windows has no transparent huge pages and places pages on the node of the thread touching them first
+	std::size_t AdviseHugePages(void*, std::size_t)
+	{
+		return 0;
+	}
+
+	bool InterleaveAcrossNumaNodes(void*, std::size_t)
+	{
+		return false;
+	}
+#elif defined(__linux__)
+	namespace
+	{
+		// Not in glibc's headers, the values are those of linux/mempolicy.h
+		constexpr int MpolPreferred = 1;
+		constexpr int MpolInterleave = 3;
+		constexpr unsigned MpolMoveFlag = 1u << 1;
+
+		struct Topology
+		{
+			// Nodes with processors, in the order of their numbers
+			std::vector<int> nodeNumbers;
+			std::vector<std::vector<int>> nodeCpus;
+			// Index into nodeNumbers of each processor's node
+			std::vector<std::size_t> cpuNodes;
+		};
+
+		// A cpulist is like "0-3,8-11"
+		std::vector<int> ParseCpuList(const std::string& cpuList)
+		{
+			auto cpus = std::vector<int>{};
+			auto position = std::size_t{ 0 };
+			while (position < cpuList.size())
+			{
+				auto end = cpuList.find(',', position);
+				end = end == std::string::npos ? cpuList.size() : end;
+				const auto range = cpuList.substr(position, end - position);
+				const auto dash = range.find('-');
+				if (!range.empty() && range.find_first_not_of(" \n") != std::string::npos)
+				{
+					const auto first = std::stoi(range.substr(0, dash));
+					const auto last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+					for (auto cpu = first; cpu <= last; ++cpu)
+					{
+						cpus.push_back(cpu);
+					}
+				}
+				position = end + 1;
+			}
+			return cpus;
+		}
+
+		const Topology& GetTopology()
+		{
+			static const auto topology = []()
+				{
+					auto result = Topology{};
+					auto error = std::error_code{};
+					auto nodes = std::vector<std::pair<int, std::vector<int>>>{};
+					for (const auto& entry : std::filesystem::directory_iterator{ "/sys/devices/system/node", error })
+					{
+						const auto name = entry.path().filename().string();
+						if (!name.starts_with("node") || name.size() == 4 || name.find_first_not_of("0123456789", 4) != std::string::npos)
+						{
+							continue;
+						}
+						auto file = std::ifstream{ entry.path() / "cpulist" };
+						auto cpuList = std::string{};
+						std::getline(file, cpuList);
+						auto cpus = ParseCpuList(cpuList);
+						if (!cpus.empty())
+						{
+							nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+						}
+					}
+					std::sort(nodes.begin(), nodes.end());
+					for (auto& [number, cpus] : nodes)
+					{
+						for (const auto cpu : cpus)
+						{
+							if (static_cast<std::size_t>(cpu) >= result.cpuNodes.size())
+							{
+								result.cpuNodes.resize(cpu + 1, 0);
+							}
+							result.cpuNodes[cpu] = result.nodeNumbers.size();
+						}
+						result.nodeNumbers.push_back(number);
+						result.nodeCpus.push_back(std::move(cpus));
+					}
+					return result;
+				}();
+			return topology;
+		}
+
+		// Node mask with the given nodes, sized for the highest, as mbind takes it
+		std::vector<unsigned long> GetNodeMask(const std::vector<int>& nodeNumbers)
+		{
+			constexpr auto Bits = sizeof(unsigned long) * 8;
+			auto mask = std::vector<unsigned long>(*std::max_element(nodeNumbers.begin(), nodeNumbers.end()) / Bits + 1, 0);
+			for (const auto node : nodeNumbers)
+			{
+				mask[node / Bits] |= 1ul << (node % Bits);
+			}
+			return mask;
+		}
+
+		bool Bind(void* data, std::size_t bytes, int mode, const std::vector<int>& nodeNumbers, unsigned flags)
+		{
+			const auto mask = GetNodeMask(nodeNumbers);
+			// The kernel reads one bit less than the count it is given
+			const auto maxNode = mask.size() * sizeof(unsigned long) * 8 + 1;
+			return syscall(SYS_mbind, data, bytes, mode, mask.data(), maxNode, flags) == 0;
+		}
+
+		MappedMemory MapMemory(std::size_t bytes, PagePolicy pages, std::optional<std::size_t> numaNode)
+		{
+			auto mapped = MappedMemory{ MAP_FAILED, false };
+			if (pages == PagePolicy::ExplicitHugePages)
+			{
+				// Fails when the reserved pool, see /proc/sys/vm/nr_hugepages, has too few pages left
+				mapped = MappedMemory{ mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0), true };
+			}
+			if (mapped.data == MAP_FAILED)
+			{
+				// Mapped with room to spare and trimmed, so that the region starts on a huge page boundary
+				auto* data = static_cast<char*>(mmap(nullptr, bytes + HugePageBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+				if (data == MAP_FAILED)
+				{
+					throw std::bad_alloc{};
+				}
+				const auto offset = RoundUp(reinterpret_cast<std::uintptr_t>(data), HugePageBytes) - reinterpret_cast<std::uintptr_t>(data);
+				if (offset != 0)
+				{
+					munmap(data, offset);
+				}
+				munmap(data + offset + bytes, HugePageBytes - offset);
+				mapped = MappedMemory{ data + offset, pages != PagePolicy::Default && madvise(data + offset, bytes, MADV_HUGEPAGE) == 0 };
+			}
+
+			// Before the first touch, pages are placed when they are faulted in
+			const auto& topology = GetTopology();
+			if (numaNode && *numaNode < topology.nodeNumbers.size() && topology.nodeNumbers.size() > 1)
+			{
+				Bind(mapped.data, bytes, MpolPreferred, { topology.nodeNumbers[*numaNode] }, 0);
+			}
+			return mapped;
+		}
+
+		void UnmapMemory(void* data, std::size_t bytes)
+		{
+			munmap(data, bytes);
+		}
+	}
+
+	std::size_t GetNumaNodeCount()
+	{
+		return std::max<std::size_t>(GetTopology().nodeNumbers.size(), 1);
+	}
+
+	std::size_t GetCurrentNumaNode()
+	{
+		const auto& cpuNodes = GetTopology().cpuNodes;
+		const auto cpu = sched_getcpu();
+		return cpu >= 0 && static_cast<std::size_t>(cpu) < cpuNodes.size() ? cpuNodes[cpu] : 0;
+	}
+
+	bool PinThreadToNumaNode(std::size_t node)
+	{
+		const auto& topology = GetTopology();
+		if (node >= topology.nodeCpus.size())
+		{
+			return false;
+		}
+		auto cpus = cpu_set_t{};
+		CPU_ZERO(&cpus);
+		for (const auto cpu : topology.nodeCpus[node])
+		{
+			if (cpu < CPU_SETSIZE)
+			{
+				CPU_SET(cpu, &cpus);
+			}
+		}
+		return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+	}
+
+	std::size_t AdviseHugePages(void* data, std::size_t bytes)
+	{
+		const auto start = RoundUp(reinterpret_cast<std::uintptr_t>(data), HugePageBytes);
+		const auto end = (reinterpret_cast<std::uintptr_t>(data) + bytes) / HugePageBytes * HugePageBytes;
+		if (end <= start || madvise(reinterpret_cast<void*>(start), end - start, MADV_HUGEPAGE) != 0)
+		{
+			return 0;
+		}
+#if defined(MADV_COLLAPSE)
+		// Pages faulted in before the advice stay small until khugepaged gets to them, unless collapsed now
+		madvise(reinterpret_cast<void*>(start), end - start, MADV_COLLAPSE);
+#endif
+		return end - start;
+	}
+
+	bool InterleaveAcrossNumaNodes(void* data, std::size_t bytes)
+	{
+		const auto& topology = GetTopology();
+		if (topology.nodeNumbers.size() < 2)
+		{
+			return false;
+		}
+		const auto pageBytes = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+		const auto start = reinterpret_cast<std::uintptr_t>(data) / pageBytes * pageBytes;
+		const auto end = RoundUp(reinterpret_cast<std::uintptr_t>(data) + bytes, pageBytes);
+		return Bind(reinterpret_cast<void*>(start), end - start, MpolInterleave, topology.nodeNumbers, MpolMoveFlag);
+	}
+#else
+	namespace
+	{
+		MappedMemory MapMemory(std::size_t bytes, PagePolicy, std::optional<std::size_t>)
+		{
+			return MappedMemory{ ::operator new(bytes, std::align_val_t{ HugePageBytes }), false };
+		}
+
+		void UnmapMemory(void* data, std::size_t)
+		{
+			::operator delete(data, std::align_val_t{ HugePageBytes });
+		}
+	}
+
+	std::size_t GetNumaNodeCount()
+	{
+		return 1;
+	}
+
+	std::size_t GetCurrentNumaNode()
+	{
+		return 0;
+	}
+
+	bool PinThreadToNumaNode(std::size_t)
+	{
+		return false;
+	}
+
+	std::size_t AdviseHugePages(void*, std::size_t)
+	{
+		return 0;
+	}
+
+	bool InterleaveAcrossNumaNodes(void*, std::size_t)
+	{
+		return false;
+	}
+#endif
+
+	PageResource::PageResource(PagePolicy pages, std::optional<std::size_t> numaNode)
+		: m_pages{ pages }
+		, m_numaNode{ numaNode }
+	{
+	}
+
+	PageResource::~PageResource()
+	{
+		for (const auto& region : m_regions)
+		{
+			UnmapMemory(region.data, region.bytes);
+		}
+	}
+
+	std::size_t PageResource::GetMappedBytes() const
+	{
+		const auto lock = std::lock_guard{ m_mutex };
+		return m_mappedBytes;
+	}
+
+	std::size_t PageResource::GetHugePageBytes() const
+	{
+		const auto lock = std::lock_guard{ m_mutex };
+		return m_hugePageBytes;
+	}
+
+	void* PageResource::do_allocate(std::size_t bytes, std::size_t alignment)
+	{
+		if (alignment > HugePageBytes)
+		{
+			throw std::bad_alloc{};
+		}
+
+		const auto lock = std::lock_guard{ m_mutex };
+		if (bytes > SharedRegionLimit)
+		{
+			return Map(RoundUp(bytes, HugePageBytes)).data;
+		}
+
+		auto offset = RoundUp(reinterpret_cast<std::uintptr_t>(m_current), alignment) - reinterpret_cast<std::uintptr_t>(m_current);
+		if (m_current == nullptr || offset + bytes > m_currentBytes)
+		{
+			const auto region = Map(HugePageBytes);
+			m_current = static_cast<char*>(region.data);
+			m_currentBytes = region.bytes;
+			offset = 0;
+		}
+		auto* data = m_current + offset;
+		m_current += offset + bytes;
+		m_currentBytes -= offset + bytes;
+		return data;
+	}
+
+	void PageResource::do_deallocate(void* p, std::size_t bytes, std::size_t)
+	{
+		if (bytes <= SharedRegionLimit)
+		{
+			return;
+		}
+
+		const auto lock = std::lock_guard{ m_mutex };
+		const auto region = std::find_if(m_regions.begin(), m_regions.end(), [p](const Region& r) { return r.data == p; });
+		if (region == m_regions.end())
+		{
+			return;
+		}
+		m_mappedBytes -= region->bytes;
+		m_hugePageBytes -= region->hugePages ? region->bytes : 0;
+		UnmapMemory(region->data, region->bytes);
+		m_regions.erase(region);
+	}
+
+	bool PageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return this == &other;
+	}
+
+	PageResource::Region PageResource::Map(std::size_t bytes)
+	{
+		const auto mapped = MapMemory(bytes, m_pages, m_numaNode);
+		const auto region = Region{ mapped.data, bytes, mapped.hugePages };
+		m_regions.push_back(region);
+		m_mappedBytes += bytes;
+		m_hugePageBytes += mapped.hugePages ? bytes : 0;
+		return region;
+	}
+}
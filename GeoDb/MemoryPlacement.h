@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace geodb
+{
+	enum class PagePolicy
+	{
+		// Whatever the allocator and the operating system choose
+		Default,
+		// Memory is aligned to huge pages and the kernel asked to back it with them, Linux only
+		TransparentHugePages,
+		// Memory comes from the reserved huge pages, falling back to transparent ones when none are left
+		ExplicitHugePages
+	};
+
+	struct AllocationPolicy
+	{
+		PagePolicy pages = PagePolicy::Default;
+		// Keeps a copy of the way index on every NUMA node, queries read the copy of the node they run on. Changes
+		// are applied to every copy. Has no effect on machines with a single node
+		bool replicateIndex = false;
+	};
+
+	constexpr std::size_t HugePageBytes = std::size_t{ 2 } << 20;
+
+	// Number of NUMA nodes with processors, 1 where the topology is unknown
+	std::size_t GetNumaNodeCount();
+
+	// Node of the processor the calling thread runs on, as an index below GetNumaNodeCount
+	std::size_t GetCurrentNumaNode();
+
+	// Restricts the calling thread to the processors of the node, false when that is not possible
+	bool PinThreadToNumaNode(std::size_t node);
+
+	// Asks for huge pages behind the part of the range that covers whole huge pages, and for the pages already
+	// there to be collapsed into huge ones where the kernel supports it. Returns the bytes covered
+	std::size_t AdviseHugePages(void* data, std::size_t bytes);
+
+	// Spreads the pages of the range round-robin over all nodes, moving those already placed. Returns whether the
+	// placement was applied, which it is not on single-node machines
+	bool InterleaveAcrossNumaNodes(void* data, std::size_t bytes);
+
+	// Memory mapped from the operating system in huge-page sized regions on the given node, for the pools of index
+	// nodes. Small requests are carved from shared regions that are only returned when the resource is destroyed,
+	// so it is meant to sit under a pool resource that recycles blocks itself
+	class PageResource final : public std::pmr::memory_resource
+	{
+	public:
+		PageResource(PagePolicy pages, std::optional<std::size_t> numaNode);
+
+		PageResource(const PageResource& other) = delete;
+
+		PageResource& operator=(const PageResource& other) = delete;
+
+		~PageResource() override;
+
+		std::size_t GetMappedBytes() const;
+
+		// Part of the mapped bytes that is backed or advised to be backed by huge pages
+		std::size_t GetHugePageBytes() const;
+
+	private:
+		struct Region
+		{
+			void* data;
+			std::size_t bytes;
+			bool hugePages;
+		};
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		Region Map(std::size_t bytes);
+
+		PagePolicy m_pages;
+		std::optional<std::size_t> m_numaNode;
+		mutable std::mutex m_mutex;
+		std::vector<Region> m_regions;
+		// Free part of the region small requests are carved from
+		char* m_current = nullptr;
+		std::size_t m_currentBytes = 0;
+		std::size_t m_mappedBytes = 0;
+		std::size_t m_hugePageBytes = 0;
+	};
+}
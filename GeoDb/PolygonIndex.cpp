@@ -0,0 +1,257 @@
+#include "PolygonIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	constexpr std::size_t SlabThreshold = 32;
+	constexpr std::size_t EdgesPerSlab = 4;
+	constexpr std::size_t MaxSlabs = 4096;
+	constexpr std::size_t MaxEntriesPerEdge = 4;
+
+	bool IsClosed(const geodb::Way& way)
+	{
+		const auto& nodes = way.GetNodes();
+		return nodes.size() >= 4 && nodes.front() == nodes.back();
+	}
+
+	// Whether the ray from the point towards +x crosses the edge, a vertex at the height of the point counts
+	// for the edge going above it only, so that rays through vertices cross once
+	template<typename Vertex>
+	bool Crosses(double x, double y, const Vertex& start, const Vertex& end)
+	{
+		return ((start.y > y) != (end.y > y)) && x < (end.x - start.x) * (y - start.y) / (end.y - start.y) + start.x;
+	}
+}
+
+namespace geodb
+{
+	PolygonIndex PolygonIndex::FromMap(const Map& map)
+	{
+		auto index = PolygonIndex{};
+		index.m_slots.resize(map.GetWays().size(), NoPolygon);
+		for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+		{
+			if (IsClosed(map.GetWays()[i]))
+			{
+				index.m_slots[i] = static_cast<std::uint32_t>(index.m_polygons.size());
+				index.Prepare(map.GetWays()[i], map, index.m_polygons.emplace_back());
+			}
+		}
+		index.m_vertices.shrink_to_fit();
+		index.m_slabOffsets.shrink_to_fit();
+		index.m_slabEdges.shrink_to_fit();
+		index.m_polygons.shrink_to_fit();
+		return index;
+	}
+
+	void PolygonIndex::SetWay(std::size_t wayId, const Way& way, const Map& map)
+	{
+		if (wayId >= m_slots.size())
+		{
+			m_slots.resize(wayId + 1, NoPolygon);
+		}
+
+		auto& slot = m_slots[wayId];
+		if (slot != NoPolygon)
+		{
+			Release(slot);
+			slot = NoPolygon;
+		}
+		if (IsClosed(way))
+		{
+			if (m_freeSlots.empty())
+			{
+				if (m_polygons.size() == NoPolygon)
+				{
+					throw std::length_error{ "Too many polygons" };
+				}
+				m_freeSlots.push_back(static_cast<std::uint32_t>(m_polygons.size()));
+				m_polygons.emplace_back();
+			}
+			slot = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			Prepare(way, map, m_polygons[slot]);
+		}
+
+		if (GetStaleEntries() > (m_vertices.size() + m_slabOffsets.size() + m_slabEdges.size()) / 2)
+		{
+			Compact();
+		}
+	}
+
+	bool PolygonIndex::Contains(std::size_t wayId, double x, double y) const
+	{
+		if (!IsPolygon(wayId))
+		{
+			return false;
+		}
+
+		const auto& polygon = m_polygons[m_slots[wayId]];
+		const auto vertices = m_vertices.data() + polygon.firstVertex;
+		auto inside = false;
+		if (polygon.slabCount == 0)
+		{
+			for (std::uint32_t i = 0; i + 1 < polygon.vertexCount; ++i)
+			{
+				inside ^= Crosses(x, y, vertices[i], vertices[i + 1]);
+			}
+			return inside;
+		}
+
+		// No edge crosses the ray of a point below the bottom or above the top, clamping them to a slab is safe
+		if (!(y >= polygon.minY))
+		{
+			return false;
+		}
+		const auto slab = std::min(std::floor((y - polygon.minY) * polygon.slabScale), static_cast<double>(polygon.slabCount - 1));
+		const auto offsets = m_slabOffsets.data() + polygon.firstSlabOffset + static_cast<std::size_t>(slab);
+		const auto edges = m_slabEdges.data() + polygon.firstSlabEdge;
+		for (auto i = offsets[0]; i < offsets[1]; ++i)
+		{
+			const auto edge = edges[i];
+			inside ^= Crosses(x, y, vertices[edge], vertices[edge + 1]);
+		}
+		return inside;
+	}
+
+	void PolygonIndex::Prepare(const Way& way, const Map& map, PolygonRange& polygon)
+	{
+		const auto& wayNodes = way.GetNodes();
+		if (wayNodes.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::length_error{ "Too many nodes in a way" };
+		}
+
+		polygon = PolygonRange{};
+		polygon.firstVertex = m_vertices.size();
+		polygon.vertexCount = static_cast<std::uint32_t>(wayNodes.size());
+		auto minY = std::numeric_limits<double>::infinity();
+		auto maxY = -std::numeric_limits<double>::infinity();
+		for (const auto nodeId : wayNodes)
+		{
+			const auto& node = map.GetNodes()[nodeId];
+			m_vertices.push_back(Vertex{ node.GetX(), node.GetY() });
+			minY = std::min(minY, node.GetY());
+			maxY = std::max(maxY, node.GetY());
+		}
+
+		const auto vertices = m_vertices.data() + polygon.firstVertex;
+		const auto edgeCount = std::size_t{ polygon.vertexCount } - 1;
+		auto doubleArea = 0.0;
+		for (std::size_t i = 0; i < edgeCount; ++i)
+		{
+			doubleArea += vertices[i].x * vertices[i + 1].y - vertices[i + 1].x * vertices[i].y;
+		}
+		polygon.area = std::abs(doubleArea) / 2.0;
+
+		if (edgeCount <= SlabThreshold || maxY <= minY)
+		{
+			return;
+		}
+
+		// Edges are listed in every slab their height range overlaps, counted first and then filled in. Rings with
+		// long steep edges get fewer slabs until the copies stay bounded
+		polygon.minY = minY;
+		const auto toSlab = [&](double y)
+			{
+				const auto slab = std::floor((y - polygon.minY) * polygon.slabScale);
+				return static_cast<std::size_t>(std::clamp(slab, 0.0, static_cast<double>(polygon.slabCount - 1)));
+			};
+
+		auto offsets = std::vector<std::uint32_t>{};
+		for (auto slabCount = std::min(edgeCount / EdgesPerSlab, MaxSlabs); ; slabCount /= 2)
+		{
+			polygon.slabCount = static_cast<std::uint32_t>(slabCount);
+			polygon.slabScale = slabCount / (maxY - minY);
+			offsets.assign(slabCount + 1, 0);
+			auto entries = std::size_t{ 0 };
+			for (std::size_t i = 0; i < edgeCount; ++i)
+			{
+				const auto first = toSlab(std::min(vertices[i].y, vertices[i + 1].y));
+				const auto last = toSlab(std::max(vertices[i].y, vertices[i + 1].y));
+				for (auto slab = first; slab <= last; ++slab)
+				{
+					++offsets[slab + 1];
+				}
+				entries += last - first + 1;
+			}
+			if (entries <= MaxEntriesPerEdge * edgeCount)
+			{
+				break;
+			}
+			if (slabCount < 4)
+			{
+				polygon.slabCount = 0;
+				return;
+			}
+		}
+		for (std::size_t slab = 0; slab < polygon.slabCount; ++slab)
+		{
+			offsets[slab + 1] += offsets[slab];
+		}
+
+		polygon.firstSlabOffset = m_slabOffsets.size();
+		polygon.firstSlabEdge = m_slabEdges.size();
+		m_slabOffsets.insert(m_slabOffsets.end(), offsets.begin(), offsets.end());
+		m_slabEdges.resize(m_slabEdges.size() + offsets.back());
+		const auto edges = m_slabEdges.data() + polygon.firstSlabEdge;
+		for (std::size_t i = 0; i < edgeCount; ++i)
+		{
+			const auto last = toSlab(std::max(vertices[i].y, vertices[i + 1].y));
+			for (auto slab = toSlab(std::min(vertices[i].y, vertices[i + 1].y)); slab <= last; ++slab)
+			{
+				edges[offsets[slab]++] = static_cast<std::uint32_t>(i);
+			}
+		}
+	}
+
+	void PolygonIndex::Release(std::uint32_t slot)
+	{
+		const auto& polygon = m_polygons[slot];
+		m_staleVertices += polygon.vertexCount;
+		if (polygon.slabCount != 0)
+		{
+			const auto offsets = m_slabOffsets.data() + polygon.firstSlabOffset;
+			m_staleSlabEntries += polygon.slabCount + 1 + offsets[polygon.slabCount];
+		}
+		m_polygons[slot] = PolygonRange{};
+		m_freeSlots.push_back(slot);
+	}
+
+	// Free slots keep an empty range, so only polygons in use are copied
+	void PolygonIndex::Compact()
+	{
+		auto vertices = std::vector<Vertex>{};
+		auto slabOffsets = std::vector<std::uint32_t>{};
+		auto slabEdges = std::vector<std::uint32_t>{};
+		vertices.reserve(m_vertices.size() - m_staleVertices);
+		for (auto& polygon : m_polygons)
+		{
+			const auto firstVertex = vertices.size();
+			vertices.insert(vertices.end(), m_vertices.begin() + polygon.firstVertex,
+				m_vertices.begin() + polygon.firstVertex + polygon.vertexCount);
+			polygon.firstVertex = firstVertex;
+			if (polygon.slabCount == 0)
+			{
+				continue;
+			}
+
+			const auto offsets = m_slabOffsets.begin() + polygon.firstSlabOffset;
+			const auto edges = m_slabEdges.begin() + polygon.firstSlabEdge;
+			const auto firstSlabOffset = slabOffsets.size();
+			const auto firstSlabEdge = slabEdges.size();
+			slabEdges.insert(slabEdges.end(), edges, edges + offsets[polygon.slabCount]);
+			slabOffsets.insert(slabOffsets.end(), offsets, offsets + polygon.slabCount + 1);
+			polygon.firstSlabOffset = firstSlabOffset;
+			polygon.firstSlabEdge = firstSlabEdge;
+		}
+		m_vertices = std::move(vertices);
+		m_slabOffsets = std::move(slabOffsets);
+		m_slabEdges = std::move(slabEdges);
+		m_staleVertices = 0;
+		m_staleSlabEntries = 0;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Map.h"
+
+namespace geodb
+{
+	// Closed ways prepared for point-in-polygon tests. The vertices of every ring lie back to back in one array, and
+	// rings with many edges get horizontal slabs listing the edges that cross them, so a test only looks at the edges
+	// at the height of the point instead of all of them
+	class PolygonIndex
+	{
+	public:
+		static PolygonIndex FromMap(const Map& map);
+
+		// Prepares the current geometry of a way, deleted ways and ways that are not closed are dropped
+		void SetWay(std::size_t wayId, const Way& way, const Map& map);
+
+		bool IsPolygon(std::size_t wayId) const { return wayId < m_slots.size() && m_slots[wayId] != NoPolygon; }
+
+		// Even-odd rule, points on the boundary may fall either way
+		bool Contains(std::size_t wayId, double x, double y) const;
+
+		double GetArea(std::size_t wayId) const { return m_polygons[m_slots[wayId]].area; }
+
+		std::size_t GetPolygonCount() const { return m_polygons.size() - m_freeSlots.size(); }
+
+		std::size_t GetAllocatedBytes() const
+		{
+			return m_vertices.capacity() * sizeof(Vertex)
+				+ m_slabOffsets.capacity() * sizeof(std::uint32_t)
+				+ m_slabEdges.capacity() * sizeof(std::uint32_t)
+				+ m_polygons.capacity() * sizeof(PolygonRange)
+				+ m_slots.capacity() * sizeof(std::uint32_t)
+				+ m_freeSlots.capacity() * sizeof(std::uint32_t);
+		}
+
+	private:
+		static constexpr std::uint32_t NoPolygon = std::numeric_limits<std::uint32_t>::max();
+
+		struct Vertex
+		{
+			double x;
+			double y;
+		};
+
+		// Rings up to SlabThreshold edges are tested edge by edge and have no slabs
+		struct PolygonRange
+		{
+			std::uint64_t firstVertex = 0;
+			std::uint64_t firstSlabOffset = 0;
+			std::uint64_t firstSlabEdge = 0;
+			std::uint32_t vertexCount = 0;
+			std::uint32_t slabCount = 0;
+			double minY = 0.0;
+			// Slabs per unit of height
+			double slabScale = 0.0;
+			double area = 0.0;
+		};
+
+		void Prepare(const Way& way, const Map& map, PolygonRange& polygon);
+
+		void Release(std::uint32_t slot);
+
+		void Compact();
+
+		std::size_t GetStaleEntries() const { return m_staleVertices + m_staleSlabEntries; }
+
+	private:
+		std::vector<Vertex> m_vertices;
+		// Per slab the start of its edges relative to firstSlabEdge, followed by the end of the last slab
+		std::vector<std::uint32_t> m_slabOffsets;
+		// Index of the first vertex of each edge relative to firstVertex
+		std::vector<std::uint32_t> m_slabEdges;
+		std::vector<PolygonRange> m_polygons;
+		// Polygon of each way, NoPolygon for ways that are not closed
+		std::vector<std::uint32_t> m_slots;
+		std::vector<std::uint32_t> m_freeSlots;
+		// Entries of replaced or dropped polygons, reclaimed once they make up half of the arrays
+		std::size_t m_staleVertices = 0;
+		std::size_t m_staleSlabEntries = 0;
+	};
+}
@@ -0,0 +1,136 @@
+#include "QueryCache.h"
+
+#include <cmath>
+
+namespace geodb
+{
+	QueryCache::QueryCache(double cellSize, std::size_t maxCachedResults)
+		: m_cellSize{ cellSize }
+		, m_maxCachedResults{ maxCachedResults }
+	{ }
+
+	QueryCache::CellRange QueryCache::GetCoveredCells(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		const auto minX = searchWindow.GetCenterX() - searchWindow.GetHalfWidth();
+		const auto maxX = searchWindow.GetCenterX() + searchWindow.GetHalfWidth();
+		const auto minY = searchWindow.GetCenterY() - searchWindow.GetHalfHeight();
+		const auto maxY = searchWindow.GetCenterY() + searchWindow.GetHalfHeight();
+
+		return CellRange{
+			static_cast<std::int64_t>(std::ceil(minX / m_cellSize)),
+			static_cast<std::int64_t>(std::ceil(minY / m_cellSize)),
+			static_cast<std::int64_t>(std::floor(maxX / m_cellSize)) - 1,
+			static_cast<std::int64_t>(std::floor(maxY / m_cellSize)) - 1
+		};
+	}
+
+	quadtree::Rectangle<double> QueryCache::GetCellArea(Cell cell) const
+	{
+		const auto halfSize = m_cellSize / 2.0;
+		return quadtree::Rectangle<double>{
+			static_cast<double>(cell.x) * m_cellSize + halfSize,
+			static_cast<double>(cell.y) * m_cellSize + halfSize,
+			halfSize,
+			halfSize
+		};
+	}
+
+	const std::vector<QueryResult>* QueryCache::Find(Cell cell)
+	{
+		const auto it = m_entries.find(cell);
+		if (it == m_entries.end())
+		{
+			++m_statistics.cellMisses;
+			return nullptr;
+		}
+
+		++m_statistics.cellHits;
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+		return &it->second->results;
+	}
+
+	void QueryCache::Insert(Cell cell, std::vector<QueryResult> results)
+	{
+		if (results.size() > m_maxCachedResults)
+		{
+			return;
+		}
+
+		const auto existing = m_entries.find(cell);
+		if (existing != m_entries.end())
+		{
+			Erase(existing->second);
+		}
+
+		while (!m_lru.empty() && m_statistics.cachedResults + results.size() > m_maxCachedResults)
+		{
+			++m_statistics.evictions;
+			Erase(std::prev(m_lru.end()));
+		}
+
+		m_statistics.cachedResults += results.size();
+		++m_statistics.cachedCells;
+		m_lru.push_front(Entry{ cell, std::move(results) });
+		m_entries[cell] = m_lru.begin();
+	}
+
+	void QueryCache::Invalidate(const quadtree::Rectangle<double>& changedArea)
+	{
+		const auto minX = static_cast<std::int64_t>(std::floor((changedArea.GetCenterX() - changedArea.GetHalfWidth()) / m_cellSize));
+		const auto maxX = static_cast<std::int64_t>(std::floor((changedArea.GetCenterX() + changedArea.GetHalfWidth()) / m_cellSize));
+		const auto minY = static_cast<std::int64_t>(std::floor((changedArea.GetCenterY() - changedArea.GetHalfHeight()) / m_cellSize));
+		const auto maxY = static_cast<std::int64_t>(std::floor((changedArea.GetCenterY() + changedArea.GetHalfHeight()) / m_cellSize));
+
+		// Cells share their borders, so the neighbours touching the changed area are dropped too
+		const auto isAffected = [&](const Cell& cell)
+			{
+				return minX - 1 <= cell.x && cell.x <= maxX && minY - 1 <= cell.y && cell.y <= maxY;
+			};
+
+		// Small areas look their cells up, so that invalidating a change does not scan the whole cache
+		const auto affectedCells = static_cast<double>(maxX - minX + 2) * static_cast<double>(maxY - minY + 2);
+		if (affectedCells <= static_cast<double>(m_entries.size()))
+		{
+			for (auto y = minY - 1; y <= maxY; ++y)
+			{
+				for (auto x = minX - 1; x <= maxX; ++x)
+				{
+					const auto it = m_entries.find(Cell{ x, y });
+					if (it != m_entries.end())
+					{
+						++m_statistics.invalidations;
+						Erase(it->second);
+					}
+				}
+			}
+			return;
+		}
+
+		for (auto it = m_lru.begin(); it != m_lru.end();)
+		{
+			const auto current = it++;
+			if (isAffected(current->cell))
+			{
+				++m_statistics.invalidations;
+				Erase(current);
+			}
+		}
+	}
+
+	void QueryCache::Clear()
+	{
+		m_statistics.invalidations += m_entries.size();
+		m_statistics.cachedCells = 0;
+		m_statistics.cachedResults = 0;
+		m_entries.clear();
+		m_lru.clear();
+	}
+
+	void QueryCache::Erase(LruList::iterator entry)
+	{
+		m_statistics.cachedResults -= entry->results.size();
+		--m_statistics.cachedCells;
+		m_entries.erase(entry->cell);
+		m_lru.erase(entry);
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "QueryResult.h"
+#include "../Quadtree/Rectangle.h"
+
+namespace geodb
+{
+	struct QueryCacheStatistics
+	{
+		std::size_t cellHits = 0;
+		std::size_t cellMisses = 0;
+		std::size_t evictions = 0;
+		std::size_t invalidations = 0;
+		std::size_t bypassedQueries = 0;
+		std::size_t cachedCells = 0;
+		std::size_t cachedResults = 0;
+	};
+
+	// Stores results of queries over the cells of a regular grid, a window is answered
+	// from the cells it fully covers plus direct queries over the remaining border strips
+	class QueryCache
+	{
+	public:
+		struct Cell
+		{
+			std::int64_t x;
+			std::int64_t y;
+
+			friend bool operator==(const Cell& c1, const Cell& c2) = default;
+		};
+
+		struct CellRange
+		{
+			std::int64_t minX;
+			std::int64_t minY;
+			std::int64_t maxX;
+			std::int64_t maxY;
+
+			bool IsEmpty() const { return minX > maxX || minY > maxY; }
+		};
+
+	public:
+		QueryCache(double cellSize, std::size_t maxCachedResults);
+
+		double GetCellSize() const { return m_cellSize; }
+
+		const QueryCacheStatistics& GetStatistics() const { return m_statistics; }
+
+		CellRange GetCoveredCells(const quadtree::Rectangle<double>& searchWindow) const;
+
+		quadtree::Rectangle<double> GetCellArea(Cell cell) const;
+
+		const std::vector<QueryResult>* Find(Cell cell);
+
+		void Insert(Cell cell, std::vector<QueryResult> results);
+
+		void Invalidate(const quadtree::Rectangle<double>& changedArea);
+
+		void Clear();
+
+		void RecordBypass() { ++m_statistics.bypassedQueries; }
+
+	private:
+		struct CellHash
+		{
+			std::size_t operator()(const Cell& cell) const
+			{
+				return std::hash<std::int64_t>{}(cell.x * 73856093 ^ cell.y * 19349663);
+			}
+		};
+
+		struct Entry
+		{
+			Cell cell;
+			std::vector<QueryResult> results;
+		};
+
+		using LruList = std::list<Entry>;
+
+		void Erase(LruList::iterator entry);
+
+	private:
+		double m_cellSize;
+		std::size_t m_maxCachedResults;
+		LruList m_lru;
+		std::unordered_map<Cell, LruList::iterator, CellHash> m_entries;
+		QueryCacheStatistics m_statistics;
+	};
+}
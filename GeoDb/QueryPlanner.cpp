@@ -0,0 +1,280 @@
+#include "QueryPlanner.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace
+{
+	constexpr std::size_t WaysPerCell = 16;
+	constexpr std::size_t MaxCellsPerSide = 512;
+	constexpr std::size_t ScanBlockSize = 256;
+
+	// Relative costs per unit of work, fitted to query times on generated maps
+	constexpr double IndexBaseCost = 150.0;
+	constexpr double IndexCandidateCost = 5.0;
+	constexpr double RefinementCost = 4.0;
+	constexpr double ScanWayCost = 0.25;
+	constexpr double CellVisitCost = 2.0;
+	constexpr double CellWayCost = 0.5;
+	constexpr double MatchEmitCost = 0.1;
+
+	bool Overlaps(const geodb::CompactBoundingBox& a, const geodb::CompactBoundingBox& b)
+	{
+		return a.GetMinX() <= b.GetMaxX() && b.GetMinX() <= a.GetMaxX() && a.GetMinY() <= b.GetMaxY() && b.GetMinY() <= a.GetMaxY();
+	}
+
+	double GetOverlapFraction(const geodb::CompactBoundingBox& box, const geodb::CompactBoundingBox& window)
+	{
+		const auto width = std::min(box.GetMaxX(), window.GetMaxX()) - std::max(box.GetMinX(), window.GetMinX());
+		const auto height = std::min(box.GetMaxY(), window.GetMaxY()) - std::max(box.GetMinY(), window.GetMinY());
+		const auto boxWidth = box.GetMaxX() - box.GetMinX();
+		const auto boxHeight = box.GetMaxY() - box.GetMinY();
+		const auto fractionX = boxWidth > 0.0f ? std::clamp(width / boxWidth, 0.0f, 1.0f) : 1.0f;
+		const auto fractionY = boxHeight > 0.0f ? std::clamp(height / boxHeight, 0.0f, 1.0f) : 1.0f;
+		return static_cast<double>(fractionX) * fractionY;
+	}
+
+	geodb::CompactBoundingBox Union(const geodb::CompactBoundingBox& a, const geodb::CompactBoundingBox& b)
+	{
+		return geodb::CompactBoundingBox{
+			0,
+			geodb::ObjectType::Way,
+			std::min(a.GetMinX(), b.GetMinX()),
+			std::min(a.GetMinY(), b.GetMinY()),
+			std::max(a.GetMaxX(), b.GetMaxX()),
+			std::max(a.GetMaxY(), b.GetMaxY())
+		};
+	}
+}
+
+namespace geodb
+{
+	const char* ToString(QueryPlan plan)
+	{
+		switch (plan)
+		{
+		case QueryPlan::IndexTraversal:
+			return "index";
+		case QueryPlan::LinearScan:
+			return "scan";
+		case QueryPlan::CellScan:
+			return "cells";
+		}
+		return "unknown";
+	}
+
+	QueryPlanner::QueryPlanner(const quadtree::Rectangle<float>& localArea, double originX, double originY, std::size_t expectedWays)
+		: m_originX{ originX }
+		, m_originY{ originY }
+		, m_minX{ localArea.GetCenterX() - localArea.GetHalfWidth() }
+		, m_minY{ localArea.GetCenterY() - localArea.GetHalfHeight() }
+		, m_cellsPerSide{ std::clamp<std::size_t>(
+			static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(expectedWays) / WaysPerCell))), 1, MaxCellsPerSide) }
+	{
+		m_cellWidth = std::max(localArea.GetHalfWidth() * 2.0f / static_cast<float>(m_cellsPerSide), std::numeric_limits<float>::min());
+		m_cellHeight = std::max(localArea.GetHalfHeight() * 2.0f / static_cast<float>(m_cellsPerSide), std::numeric_limits<float>::min());
+		m_cells.resize(m_cellsPerSide * m_cellsPerSide);
+	}
+
+	void QueryPlanner::Add(const CompactBoundingBox& way)
+	{
+		auto& cell = GetCell(way);
+		cell.bounds = cell.ways.empty() ? way : Union(cell.bounds, way);
+		cell.ways.push_back(way);
+		m_maxHalfWidth = std::max(m_maxHalfWidth, static_cast<float>(way.GetHalfWidth()));
+		m_maxHalfHeight = std::max(m_maxHalfHeight, static_cast<float>(way.GetHalfHeight()));
+
+		const auto wayId = way.GetObjectIndex();
+		if (wayId >= m_boxMinX.size())
+		{
+			const auto size = wayId + 1;
+			m_boxMinX.resize(size, std::numeric_limits<float>::infinity());
+			m_boxMinY.resize(size, std::numeric_limits<float>::infinity());
+			m_boxMaxX.resize(size, -std::numeric_limits<float>::infinity());
+			m_boxMaxY.resize(size, -std::numeric_limits<float>::infinity());
+		}
+		m_boxMinX[wayId] = way.GetMinX();
+		m_boxMinY[wayId] = way.GetMinY();
+		m_boxMaxX[wayId] = way.GetMaxX();
+		m_boxMaxY[wayId] = way.GetMaxY();
+	}
+
+	// Cell bounds do not shrink, they only need to contain the boxes of the cell
+	void QueryPlanner::Remove(const CompactBoundingBox& way)
+	{
+		auto& ways = GetCell(way).ways;
+		const auto found = std::find(ways.begin(), ways.end(), way);
+		if (found == ways.end())
+		{
+			return;
+		}
+		*found = ways.back();
+		ways.pop_back();
+
+		const auto wayId = way.GetObjectIndex();
+		m_boxMinX[wayId] = std::numeric_limits<float>::infinity();
+		m_boxMinY[wayId] = std::numeric_limits<float>::infinity();
+		m_boxMaxX[wayId] = -std::numeric_limits<float>::infinity();
+		m_boxMaxY[wayId] = -std::numeric_limits<float>::infinity();
+	}
+
+	QueryPlanEstimate QueryPlanner::Estimate(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		const auto window = ToLocal(searchWindow);
+
+		auto cellsVisited = 0.0;
+		auto containedWays = 0.0;
+		auto partialWays = 0.0;
+		auto partialCandidates = 0.0;
+		ForEachCell(window, [&](const Cell& cell, bool contained)
+			{
+				cellsVisited += 1.0;
+				const auto ways = static_cast<double>(cell.ways.size());
+				if (contained)
+				{
+					containedWays += ways;
+				}
+				else
+				{
+					partialWays += ways;
+					partialCandidates += ways * GetOverlapFraction(cell.bounds, window.outer);
+				}
+			});
+
+		auto estimate = QueryPlanEstimate{};
+		estimate.candidates = containedWays + partialCandidates;
+		estimate.indexCost = IndexBaseCost + estimate.candidates * (IndexCandidateCost + RefinementCost);
+		estimate.scanCost = static_cast<double>(m_boxMinX.size()) * ScanWayCost + estimate.candidates * RefinementCost;
+		estimate.cellCost = cellsVisited * CellVisitCost + containedWays * MatchEmitCost
+			+ partialWays * CellWayCost + partialCandidates * RefinementCost;
+
+		if (estimate.scanCost < estimate.indexCost && estimate.scanCost < estimate.cellCost)
+		{
+			estimate.plan = QueryPlan::LinearScan;
+		}
+		else if (estimate.cellCost < estimate.indexCost)
+		{
+			estimate.plan = QueryPlan::CellScan;
+		}
+		return estimate;
+	}
+
+	// Overlap flags are computed for a block of boxes at a time in a loop without branches, which compilers vectorize
+	void QueryPlanner::ScanAll(const quadtree::Rectangle<double>& searchWindow, std::vector<std::size_t>& candidates) const
+	{
+		const auto window = ToLocal(searchWindow).outer;
+		const auto minX = window.GetMinX();
+		const auto minY = window.GetMinY();
+		const auto maxX = window.GetMaxX();
+		const auto maxY = window.GetMaxY();
+
+		auto overlaps = std::array<std::uint8_t, ScanBlockSize>{};
+		for (std::size_t start = 0; start < m_boxMinX.size(); start += ScanBlockSize)
+		{
+			const auto count = std::min(ScanBlockSize, m_boxMinX.size() - start);
+			const auto boxMinX = m_boxMinX.data() + start;
+			const auto boxMinY = m_boxMinY.data() + start;
+			const auto boxMaxX = m_boxMaxX.data() + start;
+			const auto boxMaxY = m_boxMaxY.data() + start;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				overlaps[i] = static_cast<std::uint8_t>(
+					(boxMinX[i] <= maxX) & (boxMaxX[i] >= minX) & (boxMinY[i] <= maxY) & (boxMaxY[i] >= minY));
+			}
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (overlaps[i] != 0)
+				{
+					candidates.push_back(start + i);
+				}
+			}
+		}
+	}
+
+	void QueryPlanner::ScanCells(
+		const quadtree::Rectangle<double>& searchWindow,
+		std::vector<std::size_t>& matches,
+		std::vector<std::size_t>& candidates
+	) const
+	{
+		const auto window = ToLocal(searchWindow);
+		ForEachCell(window, [&](const Cell& cell, bool contained)
+			{
+				for (const auto& way : cell.ways)
+				{
+					if (contained)
+					{
+						matches.push_back(way.GetObjectIndex());
+					}
+					else if (Overlaps(way, window.outer))
+					{
+						candidates.push_back(way.GetObjectIndex());
+					}
+				}
+			});
+	}
+
+	QueryPlanner::LocalWindow QueryPlanner::ToLocal(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		return LocalWindow{
+			CompactBoundingBox::Of(0, ObjectType::Node, searchWindow, m_originX, m_originY),
+			searchWindow.GetCenterX() - searchWindow.GetHalfWidth() - m_originX,
+			searchWindow.GetCenterY() - searchWindow.GetHalfHeight() - m_originY,
+			searchWindow.GetCenterX() + searchWindow.GetHalfWidth() - m_originX,
+			searchWindow.GetCenterY() + searchWindow.GetHalfHeight() - m_originY
+		};
+	}
+
+	std::size_t QueryPlanner::ToCellX(double x) const
+	{
+		const auto cell = std::floor((x - m_minX) / m_cellWidth);
+		return static_cast<std::size_t>(std::clamp(cell, 0.0, static_cast<double>(m_cellsPerSide - 1)));
+	}
+
+	std::size_t QueryPlanner::ToCellY(double y) const
+	{
+		const auto cell = std::floor((y - m_minY) / m_cellHeight);
+		return static_cast<std::size_t>(std::clamp(cell, 0.0, static_cast<double>(m_cellsPerSide - 1)));
+	}
+
+	QueryPlanner::Cell& QueryPlanner::GetCell(const CompactBoundingBox& way)
+	{
+		return m_cells[ToCellY(way.GetCenterY()) * m_cellsPerSide + ToCellX(way.GetCenterX())];
+	}
+
+	QueryPlanner::CellRange QueryPlanner::GetCellRange(const LocalWindow& window) const
+	{
+		return CellRange{
+			ToCellX(static_cast<double>(window.outer.GetMinX()) - m_maxHalfWidth),
+			ToCellY(static_cast<double>(window.outer.GetMinY()) - m_maxHalfHeight),
+			ToCellX(static_cast<double>(window.outer.GetMaxX()) + m_maxHalfWidth),
+			ToCellY(static_cast<double>(window.outer.GetMaxY()) + m_maxHalfHeight)
+		};
+	}
+
+	// Cell bounds contain the rounded boxes of the cell, so bounds strictly inside the exact window mean
+	// that every way of the cell lies inside the window even before rounding
+	template<typename Visitor>
+	void QueryPlanner::ForEachCell(const LocalWindow& window, Visitor visitor) const
+	{
+		const auto range = GetCellRange(window);
+		for (auto y = range.minY; y <= range.maxY; ++y)
+		{
+			for (auto x = range.minX; x <= range.maxX; ++x)
+			{
+				const auto& cell = m_cells[y * m_cellsPerSide + x];
+				if (cell.ways.empty() || !Overlaps(cell.bounds, window.outer))
+				{
+					continue;
+				}
+				const auto contained =
+					cell.bounds.GetMinX() > window.minX && cell.bounds.GetMaxX() < window.maxX &&
+					cell.bounds.GetMinY() > window.minY && cell.bounds.GetMaxY() < window.maxY;
+				visitor(cell, contained);
+			}
+		}
+	}
+}
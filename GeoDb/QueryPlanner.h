@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "CompactBoundingBox.h"
+#include "../Quadtree/Rectangle.h"
+
+namespace geodb
+{
+	enum class QueryPlan
+	{
+		// Traverses the quadtree and refines every candidate
+		IndexTraversal,
+		// Filters the boxes of all ways in one sequential pass
+		LinearScan,
+		// Visits the cells of the histogram grid, ways of cells lying inside the window match without refinement
+		CellScan
+	};
+
+	const char* ToString(QueryPlan plan);
+
+	struct QueryPlanEstimate
+	{
+		QueryPlan plan = QueryPlan::IndexTraversal;
+		double candidates = 0.0;
+		double indexCost = 0.0;
+		double scanCost = 0.0;
+		double cellCost = 0.0;
+	};
+
+	// Keeps a grid histogram of the ways, each way counted in the cell holding the center of its box, together with the
+	// union of the boxes per cell. Window selectivity estimated from it picks the cheapest plan, and the grid and a flat
+	// array of all boxes serve as the access paths of the scan plans. Boxes are index entries in the local frame
+	class QueryPlanner
+	{
+	public:
+		QueryPlanner(const quadtree::Rectangle<float>& localArea, double originX, double originY, std::size_t expectedWays);
+
+		void Add(const CompactBoundingBox& way);
+
+		void Remove(const CompactBoundingBox& way);
+
+		QueryPlanEstimate Estimate(const quadtree::Rectangle<double>& searchWindow) const;
+
+		// Ways whose boxes overlap the window become candidates for refinement
+		void ScanAll(const quadtree::Rectangle<double>& searchWindow, std::vector<std::size_t>& candidates) const;
+
+		// Ways of cells inside the window go to matches, the overlapping ways of the other cells to candidates
+		void ScanCells(
+			const quadtree::Rectangle<double>& searchWindow,
+			std::vector<std::size_t>& matches,
+			std::vector<std::size_t>& candidates
+		) const;
+
+	private:
+		struct Cell
+		{
+			std::vector<CompactBoundingBox> ways;
+			CompactBoundingBox bounds;
+		};
+
+		// Window in the local frame, bounds rounded outwards for overlap tests and exact ones for containment tests
+		struct LocalWindow
+		{
+			CompactBoundingBox outer;
+			double minX;
+			double minY;
+			double maxX;
+			double maxY;
+		};
+
+		struct CellRange
+		{
+			std::size_t minX;
+			std::size_t minY;
+			std::size_t maxX;
+			std::size_t maxY;
+		};
+
+		LocalWindow ToLocal(const quadtree::Rectangle<double>& searchWindow) const;
+
+		std::size_t ToCellX(double x) const;
+
+		std::size_t ToCellY(double y) const;
+
+		Cell& GetCell(const CompactBoundingBox& way);
+
+		// Cells whose ways may reach into the window
+		CellRange GetCellRange(const LocalWindow& window) const;
+
+		template<typename Visitor>
+		void ForEachCell(const LocalWindow& window, Visitor visitor) const;
+
+	private:
+		double m_originX;
+		double m_originY;
+		float m_minX;
+		float m_minY;
+		float m_cellWidth;
+		float m_cellHeight;
+		std::size_t m_cellsPerSide;
+		std::vector<Cell> m_cells;
+		// Ways reach at most this far from the cell holding their center
+		float m_maxHalfWidth = 0.0f;
+		float m_maxHalfHeight = 0.0f;
+
+		// Boxes of all ways indexed by way id, removed ways keep an empty box
+		std::vector<float> m_boxMinX;
+		std::vector<float> m_boxMinY;
+		std::vector<float> m_boxMaxX;
+		std::vector<float> m_boxMaxY;
+	};
+}
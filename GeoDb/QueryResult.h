@@ -0,0 +1,24 @@
+#pragma once
+
+#include <compare>
+#include <cstddef>
+
+#include "ObjectType.h"
+
+namespace geodb
+{
+	struct QueryResult
+	{
+		std::size_t objectId;
+		ObjectType objectType;
+
+		friend auto operator<=>(const QueryResult& r1, const QueryResult& r2) = default;
+	};
+
+	struct DistanceQueryResult
+	{
+		std::size_t objectId;
+		ObjectType objectType;
+		double distance;
+	};
+}
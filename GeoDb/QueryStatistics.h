@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+#include "QueryPlanner.h"
+#include "../Quadtree/QueryStatistics.h"
+
+namespace geodb
+{
+	struct QueryStatistics
+	{
+		std::size_t queries = 0;
+		quadtree::QueryStatistics traversal;
+		std::size_t refinementTruePositives = 0;
+		std::size_t refinementFalsePositives = 0;
+		// Ways matched by the plan itself, without refinement
+		std::size_t refinementsSkipped = 0;
+		// Queries run with each plan, indexed by QueryPlan
+		std::array<std::size_t, 3> plans = {};
+		std::chrono::nanoseconds traversalTime{ 0 };
+		std::chrono::nanoseconds refinementTime{ 0 };
+
+		double GetFalsePositiveRate() const
+		{
+			const auto refined = refinementTruePositives + refinementFalsePositives;
+			return refined == 0 ? 0.0 : static_cast<double>(refinementFalsePositives) / static_cast<double>(refined);
+		}
+
+		QueryStatistics& operator+=(const QueryStatistics& other)
+		{
+			queries += other.queries;
+			traversal += other.traversal;
+			refinementTruePositives += other.refinementTruePositives;
+			refinementFalsePositives += other.refinementFalsePositives;
+			refinementsSkipped += other.refinementsSkipped;
+			for (std::size_t i = 0; i < plans.size(); ++i)
+			{
+				plans[i] += other.plans[i];
+			}
+			traversalTime += other.traversalTime;
+			refinementTime += other.refinementTime;
+			return *this;
+		}
+
+		friend std::ostream& operator<<(std::ostream& out, const QueryStatistics& statistics)
+		{
+			return out
+				<< "{\"queries\":" << statistics.queries
+				<< ",\"quadtreeNodesVisited\":" << statistics.traversal.quadtreeNodesVisited
+				<< ",\"axisNodesVisited\":" << statistics.traversal.axisNodesVisited
+				<< ",\"listElementsTested\":" << statistics.traversal.listElementsTested
+				<< ",\"candidatesReturned\":" << statistics.traversal.candidatesReturned
+				<< ",\"refinementTruePositives\":" << statistics.refinementTruePositives
+				<< ",\"refinementFalsePositives\":" << statistics.refinementFalsePositives
+				<< ",\"falsePositiveRate\":" << statistics.GetFalsePositiveRate()
+				<< ",\"refinementsSkipped\":" << statistics.refinementsSkipped
+				<< ",\"indexPlans\":" << statistics.plans[static_cast<std::size_t>(QueryPlan::IndexTraversal)]
+				<< ",\"scanPlans\":" << statistics.plans[static_cast<std::size_t>(QueryPlan::LinearScan)]
+				<< ",\"cellPlans\":" << statistics.plans[static_cast<std::size_t>(QueryPlan::CellScan)]
+				<< ",\"traversalTimeNs\":" << statistics.traversalTime.count()
+				<< ",\"refinementTimeNs\":" << statistics.refinementTime.count()
+				<< "}";
+		}
+	};
+}
@@ -0,0 +1,581 @@
+#include "RoadGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+
+#include "Algo2d.h"
+#include "ContractionHierarchy.h"
+
+namespace
+{
+	constexpr auto Infinity = std::numeric_limits<double>::infinity();
+	constexpr int SegmentIndexMaxDepth = 16;
+
+	enum class Direction
+	{
+		Both,
+		Forward,
+		Backward
+	};
+
+	struct Arc
+	{
+		std::uint32_t from;
+		std::uint32_t to;
+		double length;
+	};
+
+	const geodb::Tag* FindTag(const std::vector<geodb::Tag>* tags, std::string_view key)
+	{
+		if (tags == nullptr)
+		{
+			return nullptr;
+		}
+		const auto found = std::find_if(tags->begin(), tags->end(), [&](const geodb::Tag& tag) { return tag.GetKey() == key; });
+		return found == tags->end() ? nullptr : &*found;
+	}
+
+	// Roundabouts are one way unless tagged otherwise
+	Direction GetDirection(const std::vector<geodb::Tag>* tags)
+	{
+		const auto oneway = FindTag(tags, "oneway");
+		if (oneway != nullptr)
+		{
+			const auto value = oneway->GetValue();
+			if (value == "yes" || value == "true" || value == "1")
+			{
+				return Direction::Forward;
+			}
+			if (value == "-1" || value == "reverse")
+			{
+				return Direction::Backward;
+			}
+			if (value == "no")
+			{
+				return Direction::Both;
+			}
+		}
+		const auto junction = FindTag(tags, "junction");
+		return junction != nullptr && junction->GetValue() == "roundabout" ? Direction::Forward : Direction::Both;
+	}
+
+	template<typename Edge>
+	std::uint32_t MiddleOf(const Edge& edge)
+	{
+		if constexpr (requires { edge.middle; })
+		{
+			return edge.middle;
+		}
+		else
+		{
+			return geodb::RoadGraph::NoVertex;
+		}
+	}
+
+	void ToCompressedRows(std::size_t vertexCount, const std::vector<Arc>& arcs, bool bySource,
+		std::vector<std::uint32_t>& first, std::vector<geodb::RoadEdge>& edges)
+	{
+		first.assign(vertexCount + 1, 0);
+		for (const auto& arc : arcs)
+		{
+			++first[(bySource ? arc.from : arc.to) + 1];
+		}
+		for (std::size_t v = 0; v < vertexCount; ++v)
+		{
+			first[v + 1] += first[v];
+		}
+
+		edges.resize(arcs.size());
+		auto next = std::vector<std::uint32_t>(first.begin(), first.end() - 1);
+		for (const auto& arc : arcs)
+		{
+			const auto vertex = bySource ? arc.from : arc.to;
+			edges[next[vertex]++] = geodb::RoadEdge{ bySource ? arc.to : arc.from, arc.length };
+		}
+	}
+}
+
+namespace geodb
+{
+	const char* ToString(RouteAlgorithm algorithm)
+	{
+		switch (algorithm)
+		{
+		case RouteAlgorithm::BidirectionalDijkstra:
+			return "bidirectional-dijkstra";
+		case RouteAlgorithm::AStar:
+			return "a-star";
+		case RouteAlgorithm::ContractionHierarchy:
+			return "contraction-hierarchy";
+		}
+		return "unknown";
+	}
+
+	RoadGraph RoadGraph::FromMap(const Map& map)
+	{
+		const auto& nodes = map.GetNodes();
+		auto vertexOf = std::vector<std::uint32_t>(nodes.size(), NoVertex);
+		auto mapNodes = std::vector<std::size_t>{};
+		const auto getVertex = [&](std::size_t node)
+			{
+				if (vertexOf[node] == NoVertex)
+				{
+					if (mapNodes.size() == NoVertex)
+					{
+						throw std::length_error{ "Too many road vertices" };
+					}
+					vertexOf[node] = static_cast<std::uint32_t>(mapNodes.size());
+					mapNodes.push_back(node);
+				}
+				return vertexOf[node];
+			};
+
+		auto arcs = std::vector<Arc>{};
+		auto segments = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+		for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+		{
+			const auto& way = map.GetWays()[i];
+			const auto tags = map.GetObjectTags(i, ObjectType::Way);
+			if (way.IsDeleted() || FindTag(tags, "highway") == nullptr)
+			{
+				continue;
+			}
+
+			const auto direction = GetDirection(tags);
+			const auto& wayNodes = way.GetNodes();
+			for (std::size_t k = 0; k + 1 < wayNodes.size(); ++k)
+			{
+				if (wayNodes[k] == wayNodes[k + 1])
+				{
+					continue;
+				}
+				const auto start = getVertex(wayNodes[k]);
+				const auto end = getVertex(wayNodes[k + 1]);
+				const auto length = algo::PointPointDistance(nodes[wayNodes[k]].GetX(), nodes[wayNodes[k]].GetY(),
+					nodes[wayNodes[k + 1]].GetX(), nodes[wayNodes[k + 1]].GetY());
+				if (direction != Direction::Backward)
+				{
+					arcs.push_back(Arc{ start, end, length });
+				}
+				if (direction != Direction::Forward)
+				{
+					arcs.push_back(Arc{ end, start, length });
+				}
+				segments.emplace_back(start, end);
+			}
+		}
+
+		auto minX = Infinity;
+		auto minY = Infinity;
+		auto maxX = -Infinity;
+		auto maxY = -Infinity;
+		for (const auto node : mapNodes)
+		{
+			minX = std::min(minX, nodes[node].GetX());
+			minY = std::min(minY, nodes[node].GetY());
+			maxX = std::max(maxX, nodes[node].GetX());
+			maxY = std::max(maxY, nodes[node].GetY());
+		}
+		const auto area = mapNodes.empty()
+			? quadtree::Rectangle<double>{ 0.0, 0.0, 1.0, 1.0 }
+			: quadtree::Rectangle<double>::Of(minX, maxY, std::max(maxX - minX, 1.0), std::max(maxY - minY, 1.0));
+
+		auto graph = RoadGraph{ area };
+		graph.m_mapNodes = std::move(mapNodes);
+		for (const auto node : graph.m_mapNodes)
+		{
+			graph.m_x.push_back(nodes[node].GetX());
+			graph.m_y.push_back(nodes[node].GetY());
+		}
+		ToCompressedRows(graph.GetVertexCount(), arcs, true, graph.m_firstOut, graph.m_outEdges);
+		ToCompressedRows(graph.GetVertexCount(), arcs, false, graph.m_firstIn, graph.m_inEdges);
+
+		for (const auto& [start, end] : segments)
+		{
+			const auto x1 = graph.m_x[start];
+			const auto y1 = graph.m_y[start];
+			const auto x2 = graph.m_x[end];
+			const auto y2 = graph.m_y[end];
+			graph.m_segments.Insert(RoadSegment{
+				start, end, (x1 + x2) / 2.0, (y1 + y2) / 2.0, std::abs(x2 - x1) / 2.0, std::abs(y2 - y1) / 2.0 });
+		}
+		graph.m_snapRadius = std::sqrt(area.GetArea() / static_cast<double>(std::max<std::size_t>(segments.size(), 1)));
+
+		for (auto direction = 0; direction < 2; ++direction)
+		{
+			graph.m_search.distances[direction].assign(graph.GetVertexCount(), Infinity);
+			graph.m_search.parents[direction].assign(graph.GetVertexCount(), NoVertex);
+			graph.m_search.middles[direction].assign(graph.GetVertexCount(), NoVertex);
+		}
+		return graph;
+	}
+
+	RoadGraph::RoadGraph(const quadtree::Rectangle<double>& area)
+		: m_segments{ area, SegmentIndexMaxDepth }
+	{ }
+
+	RoadGraph::RoadGraph(RoadGraph&& other) noexcept = default;
+
+	RoadGraph::~RoadGraph() = default;
+
+	// Windows double until the nearest segment found lies inside the window, which means no closer one lies outside
+	std::optional<RoadPosition> RoadGraph::Snap(double x, double y, double maxDistance)
+	{
+		auto best = std::optional<RoadPosition>{};
+		for (auto radius = std::min(m_snapRadius, maxDistance); ; radius = std::min(radius * 2.0, maxDistance))
+		{
+			for (const auto segment : m_segments.Query(quadtree::Rectangle<double>{ x, y, radius, radius }))
+			{
+				const auto startX = m_x[segment->start];
+				const auto startY = m_y[segment->start];
+				const auto dx = m_x[segment->end] - startX;
+				const auto dy = m_y[segment->end] - startY;
+				const auto lengthSquared = dx * dx + dy * dy;
+				const auto fraction = lengthSquared > 0.0 ? std::clamp(((x - startX) * dx + (y - startY) * dy) / lengthSquared, 0.0, 1.0) : 0.0;
+				const auto snappedX = startX + fraction * dx;
+				const auto snappedY = startY + fraction * dy;
+				const auto distance = algo::PointPointDistance(x, y, snappedX, snappedY);
+				if (!best || distance < best->distance)
+				{
+					best = RoadPosition{ segment->start, segment->end, fraction, snappedX, snappedY, distance };
+				}
+			}
+
+			if (best && best->distance <= radius)
+			{
+				return best;
+			}
+			if (radius >= maxDistance || m_segments.GetSize() == 0)
+			{
+				return best && best->distance <= maxDistance ? best : std::nullopt;
+			}
+		}
+	}
+
+	std::optional<Route> RoadGraph::FindRoute(const RoadPosition& from, const RoadPosition& to, RouteAlgorithm algorithm)
+	{
+		if (algorithm == RouteAlgorithm::ContractionHierarchy && m_hierarchy == nullptr)
+		{
+			throw std::logic_error{ "Contraction hierarchy routes need a contracted road graph" };
+		}
+
+		auto sources = std::vector<Terminal>{};
+		auto targets = std::vector<Terminal>{};
+		GetTerminals(from, to, sources, targets);
+
+		auto route = Route{ Infinity, from, to, {}, 0 };
+		auto meeting = NoVertex;
+		switch (algorithm)
+		{
+		case RouteAlgorithm::BidirectionalDijkstra:
+			meeting = SearchBidirectional(sources, targets, [this](int direction, std::uint32_t vertex)
+				{
+					return direction == 0 ? GetOutEdges(vertex) : GetInEdges(vertex);
+				}, false, route.length, route.settledVertices);
+			break;
+		case RouteAlgorithm::AStar:
+			meeting = SearchAStar(sources, targets, route.length, route.settledVertices);
+			break;
+		case RouteAlgorithm::ContractionHierarchy:
+			meeting = SearchBidirectional(sources, targets, [this](int direction, std::uint32_t vertex)
+				{
+					return direction == 0 ? m_hierarchy->GetUpwardOutEdges(vertex) : m_hierarchy->GetUpwardInEdges(vertex);
+				}, true, route.length, route.settledVertices);
+			break;
+		}
+
+		const auto direct = GetDirectLength(from, to);
+		if (direct && *direct <= route.length)
+		{
+			route.length = *direct;
+		}
+		else if (meeting != NoVertex)
+		{
+			AppendPath(meeting, algorithm == RouteAlgorithm::ContractionHierarchy, route.nodes);
+		}
+		ResetSearch();
+
+		if (route.length == Infinity)
+		{
+			return std::nullopt;
+		}
+		return route;
+	}
+
+	void RoadGraph::Contract()
+	{
+		m_hierarchy = std::make_unique<ContractionHierarchy>(*this);
+	}
+
+	std::size_t RoadGraph::GetShortcutCount() const
+	{
+		return m_hierarchy != nullptr ? m_hierarchy->GetShortcutCount() : 0;
+	}
+
+	std::size_t RoadGraph::GetAllocatedBytes() const
+	{
+		auto bytes = m_mapNodes.capacity() * sizeof(std::size_t)
+			+ (m_x.capacity() + m_y.capacity()) * sizeof(double)
+			+ (m_firstOut.capacity() + m_firstIn.capacity()) * sizeof(std::uint32_t)
+			+ (m_outEdges.capacity() + m_inEdges.capacity()) * sizeof(RoadEdge)
+			+ m_segments.GetStatistics().memory.GetTotalBytes();
+		for (auto direction = 0; direction < 2; ++direction)
+		{
+			bytes += m_search.distances[direction].capacity() * sizeof(double)
+				+ (m_search.parents[direction].capacity() + m_search.middles[direction].capacity()) * sizeof(std::uint32_t);
+		}
+		return bytes + (m_hierarchy != nullptr ? m_hierarchy->GetAllocatedBytes() : 0);
+	}
+
+	double RoadGraph::GetEdgeLength(std::uint32_t start, std::uint32_t end) const
+	{
+		auto length = Infinity;
+		for (const auto& edge : GetOutEdges(start))
+		{
+			if (edge.vertex == end)
+			{
+				length = std::min(length, edge.length);
+			}
+		}
+		return length;
+	}
+
+	// Routes leave a position towards either end of its segment that an edge leads to, and arrive from either end
+	// that has an edge leading to the position
+	void RoadGraph::GetTerminals(const RoadPosition& from, const RoadPosition& to, std::vector<Terminal>& sources, std::vector<Terminal>& targets) const
+	{
+		if (const auto length = GetEdgeLength(from.start, from.end); length != Infinity)
+		{
+			sources.push_back(Terminal{ from.end, (1.0 - from.fraction) * length });
+		}
+		if (const auto length = GetEdgeLength(from.end, from.start); length != Infinity)
+		{
+			sources.push_back(Terminal{ from.start, from.fraction * length });
+		}
+		if (const auto length = GetEdgeLength(to.start, to.end); length != Infinity)
+		{
+			targets.push_back(Terminal{ to.start, to.fraction * length });
+		}
+		if (const auto length = GetEdgeLength(to.end, to.start); length != Infinity)
+		{
+			targets.push_back(Terminal{ to.end, (1.0 - to.fraction) * length });
+		}
+	}
+
+	std::optional<double> RoadGraph::GetDirectLength(const RoadPosition& from, const RoadPosition& to) const
+	{
+		auto toFraction = to.fraction;
+		if (from.start == to.end && from.end == to.start)
+		{
+			toFraction = 1.0 - to.fraction;
+		}
+		else if (from.start != to.start || from.end != to.end)
+		{
+			return std::nullopt;
+		}
+
+		const auto forward = GetEdgeLength(from.start, from.end);
+		const auto backward = GetEdgeLength(from.end, from.start);
+		auto length = Infinity;
+		if (toFraction >= from.fraction && forward != Infinity)
+		{
+			length = (toFraction - from.fraction) * forward;
+		}
+		if (toFraction <= from.fraction && backward != Infinity)
+		{
+			length = std::min(length, (from.fraction - toFraction) * backward);
+		}
+		return length == Infinity ? std::nullopt : std::optional<double>{ length };
+	}
+
+	void RoadGraph::Visit(int direction, std::uint32_t vertex, double distance, std::uint32_t parent, std::uint32_t middle)
+	{
+		if (m_search.distances[direction][vertex] == Infinity)
+		{
+			m_search.touched[direction].push_back(vertex);
+		}
+		m_search.distances[direction][vertex] = distance;
+		m_search.parents[direction][vertex] = parent;
+		m_search.middles[direction][vertex] = middle;
+	}
+
+	void RoadGraph::ResetSearch()
+	{
+		for (auto direction = 0; direction < 2; ++direction)
+		{
+			for (const auto vertex : m_search.touched[direction])
+			{
+				m_search.distances[direction][vertex] = Infinity;
+				m_search.parents[direction][vertex] = NoVertex;
+				m_search.middles[direction][vertex] = NoVertex;
+			}
+			m_search.touched[direction].clear();
+		}
+	}
+
+	// Direction 0 searches forwards from the sources and direction 1 backwards from the targets, the frontier
+	// that is closer to its start goes next
+	template<typename Edges>
+	std::uint32_t RoadGraph::SearchBidirectional(const std::vector<Terminal>& sources, const std::vector<Terminal>& targets,
+		Edges edges, bool upward, double& length, std::size_t& settled)
+	{
+		using Entry = std::pair<double, std::uint32_t>;
+		using Queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<>>;
+		Queue queues[2];
+
+		auto meeting = NoVertex;
+		const auto reach = [&](int direction, std::uint32_t vertex, double distance, std::uint32_t parent, std::uint32_t middle)
+			{
+				if (distance >= m_search.distances[direction][vertex])
+				{
+					return;
+				}
+				Visit(direction, vertex, distance, parent, middle);
+				queues[direction].emplace(distance, vertex);
+				const auto total = distance + m_search.distances[1 - direction][vertex];
+				if (total < length)
+				{
+					length = total;
+					meeting = vertex;
+				}
+			};
+		for (const auto& source : sources)
+		{
+			reach(0, source.vertex, source.distance, NoVertex, NoVertex);
+		}
+		for (const auto& target : targets)
+		{
+			reach(1, target.vertex, target.distance, NoVertex, NoVertex);
+		}
+
+		while (true)
+		{
+			const auto top0 = queues[0].empty() ? Infinity : queues[0].top().first;
+			const auto top1 = queues[1].empty() ? Infinity : queues[1].top().first;
+			const auto done = upward ? std::min(top0, top1) >= length : top0 + top1 >= length;
+			if (done || (queues[0].empty() && queues[1].empty()))
+			{
+				return meeting;
+			}
+
+			const auto direction = top0 <= top1 ? 0 : 1;
+			const auto [distance, vertex] = queues[direction].top();
+			queues[direction].pop();
+			if (distance > m_search.distances[direction][vertex])
+			{
+				continue;
+			}
+			++settled;
+
+			for (const auto& edge : edges(direction, vertex))
+			{
+				reach(direction, edge.vertex, distance + edge.length, vertex, MiddleOf(edge));
+			}
+		}
+	}
+
+	// The heuristic is the straight-line distance to the nearer target plus what remains from there, which never
+	// overestimates since edges are at least as long as the straight line between their ends
+	std::uint32_t RoadGraph::SearchAStar(const std::vector<Terminal>& sources, const std::vector<Terminal>& targets,
+		double& length, std::size_t& settled)
+	{
+		const auto heuristic = [&](std::uint32_t vertex)
+			{
+				auto estimate = Infinity;
+				for (const auto& target : targets)
+				{
+					estimate = std::min(estimate, target.distance
+						+ algo::PointPointDistance(m_x[vertex], m_y[vertex], m_x[target.vertex], m_y[target.vertex]));
+				}
+				return estimate;
+			};
+
+		using Entry = std::tuple<double, double, std::uint32_t>;
+		auto queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<>>{};
+		for (const auto& source : sources)
+		{
+			if (source.distance < m_search.distances[0][source.vertex])
+			{
+				Visit(0, source.vertex, source.distance, NoVertex, NoVertex);
+				queue.emplace(source.distance + heuristic(source.vertex), source.distance, source.vertex);
+			}
+		}
+
+		auto meeting = NoVertex;
+		while (!queue.empty() && std::get<0>(queue.top()) < length)
+		{
+			const auto [estimate, distance, vertex] = queue.top();
+			queue.pop();
+			if (distance > m_search.distances[0][vertex])
+			{
+				continue;
+			}
+			++settled;
+
+			for (const auto& target : targets)
+			{
+				if (target.vertex == vertex && distance + target.distance < length)
+				{
+					length = distance + target.distance;
+					meeting = vertex;
+				}
+			}
+			for (const auto& edge : GetOutEdges(vertex))
+			{
+				const auto next = distance + edge.length;
+				if (next < m_search.distances[0][edge.vertex])
+				{
+					Visit(0, edge.vertex, next, vertex, NoVertex);
+					queue.emplace(next + heuristic(edge.vertex), next, edge.vertex);
+				}
+			}
+		}
+		return meeting;
+	}
+
+	void RoadGraph::AppendPath(std::uint32_t meeting, bool unpack, std::vector<std::size_t>& nodes) const
+	{
+		auto vertices = std::vector<std::uint32_t>{};
+		auto forward = std::vector<std::uint32_t>{ meeting };
+		while (m_search.parents[0][forward.back()] != NoVertex)
+		{
+			forward.push_back(m_search.parents[0][forward.back()]);
+		}
+		vertices.push_back(forward.back());
+		for (auto i = forward.size() - 1; i > 0; --i)
+		{
+			const auto vertex = forward[i - 1];
+			if (unpack)
+			{
+				m_hierarchy->Unpack(forward[i], vertex, m_search.middles[0][vertex], vertices);
+			}
+			else
+			{
+				vertices.push_back(vertex);
+			}
+		}
+
+		for (auto vertex = meeting; m_search.parents[1][vertex] != NoVertex; vertex = m_search.parents[1][vertex])
+		{
+			const auto next = m_search.parents[1][vertex];
+			if (unpack)
+			{
+				m_hierarchy->Unpack(vertex, next, m_search.middles[1][vertex], vertices);
+			}
+			else
+			{
+				vertices.push_back(next);
+			}
+		}
+
+		for (const auto vertex : vertices)
+		{
+			nodes.push_back(m_mapNodes[vertex]);
+		}
+	}
+}
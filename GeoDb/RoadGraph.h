@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Map.h"
+#include "../Quadtree/Quadtree.h"
+
+namespace geodb
+{
+	class ContractionHierarchy;
+
+	enum class RouteAlgorithm
+	{
+		// Searches from both ends at once until the searches meet
+		BidirectionalDijkstra,
+		// Searches from the start only, guided towards the end by the straight-line distance
+		AStar,
+		// Bidirectional search over the upward edges of the contracted graph, needs RoadGraph::Contract first
+		ContractionHierarchy
+	};
+
+	const char* ToString(RouteAlgorithm algorithm);
+
+	// Point on the segment between two consecutive vertices of a road, at the fraction of the way from start to end
+	struct RoadPosition
+	{
+		std::uint32_t start = 0;
+		std::uint32_t end = 0;
+		double fraction = 0.0;
+		double x = 0.0;
+		double y = 0.0;
+		// From the point that was snapped
+		double distance = 0.0;
+	};
+
+	struct Route
+	{
+		// Along the roads in projected units, between the two positions
+		double length = 0.0;
+		RoadPosition from;
+		RoadPosition to;
+		// Map nodes passed from the start position to the end position
+		std::vector<std::size_t> nodes;
+		std::size_t settledVertices = 0;
+	};
+
+	struct RoadEdge
+	{
+		std::uint32_t vertex;
+		double length;
+	};
+
+	// Directed graph of the highway ways in compressed sparse row form, every map node on a highway is one vertex and
+	// every pair of consecutive way nodes one edge per allowed direction. Edges are indexed both by their source and
+	// by their target for searches in either direction, and road segments are indexed in a quadtree for snapping
+	class RoadGraph
+	{
+	public:
+		static constexpr std::uint32_t NoVertex = std::numeric_limits<std::uint32_t>::max();
+
+		static RoadGraph FromMap(const Map& map);
+
+		RoadGraph(RoadGraph&& other) noexcept;
+
+		~RoadGraph();
+
+		std::size_t GetVertexCount() const { return m_mapNodes.size(); }
+
+		std::size_t GetEdgeCount() const { return m_outEdges.size(); }
+
+		std::size_t GetMapNode(std::uint32_t vertex) const { return m_mapNodes[vertex]; }
+
+		std::span<const RoadEdge> GetOutEdges(std::uint32_t vertex) const
+		{
+			return std::span<const RoadEdge>{ m_outEdges }.subspan(m_firstOut[vertex], m_firstOut[vertex + 1] - m_firstOut[vertex]);
+		}
+
+		std::span<const RoadEdge> GetInEdges(std::uint32_t vertex) const
+		{
+			return std::span<const RoadEdge>{ m_inEdges }.subspan(m_firstIn[vertex], m_firstIn[vertex + 1] - m_firstIn[vertex]);
+		}
+
+		// Nearest point on any road segment no farther than maxDistance
+		std::optional<RoadPosition> Snap(double x, double y, double maxDistance);
+
+		std::optional<Route> FindRoute(const RoadPosition& from, const RoadPosition& to, RouteAlgorithm algorithm);
+
+		// Preprocesses the graph for RouteAlgorithm::ContractionHierarchy
+		void Contract();
+
+		bool IsContracted() const { return m_hierarchy != nullptr; }
+
+		std::size_t GetShortcutCount() const;
+
+		std::size_t GetAllocatedBytes() const;
+
+	private:
+		struct RoadSegment
+		{
+			std::uint32_t start;
+			std::uint32_t end;
+			double centerX;
+			double centerY;
+			double halfWidth;
+			double halfHeight;
+
+			double GetCenterX() const { return centerX; }
+
+			double GetCenterY() const { return centerY; }
+
+			double GetHalfWidth() const { return halfWidth; }
+
+			double GetHalfHeight() const { return halfHeight; }
+
+			friend bool operator==(const RoadSegment& s1, const RoadSegment& s2) = default;
+		};
+
+		// Vertex where a search starts or ends, at a distance from the snapped position
+		struct Terminal
+		{
+			std::uint32_t vertex;
+			double distance;
+		};
+
+		// Distances and parents of both search directions, reset through the touched lists between queries
+		struct SearchSpace
+		{
+			std::vector<double> distances[2];
+			std::vector<std::uint32_t> parents[2];
+			// Vertex a shortcut to the parent stands for, NoVertex for original edges
+			std::vector<std::uint32_t> middles[2];
+			std::vector<std::uint32_t> touched[2];
+		};
+
+		RoadGraph(const quadtree::Rectangle<double>& area);
+
+		double GetEdgeLength(std::uint32_t start, std::uint32_t end) const;
+
+		void GetTerminals(const RoadPosition& from, const RoadPosition& to, std::vector<Terminal>& sources, std::vector<Terminal>& targets) const;
+
+		// Length of the route along the shared segment when both positions lie on it
+		std::optional<double> GetDirectLength(const RoadPosition& from, const RoadPosition& to) const;
+
+		void Visit(int direction, std::uint32_t vertex, double distance, std::uint32_t parent, std::uint32_t middle);
+
+		void ResetSearch();
+
+		// Returns the vertex where the shortest route found passes from one search to the other. Searches over upward
+		// edges stop each on their own, as the route may climb higher than both frontiers
+		template<typename Edges>
+		std::uint32_t SearchBidirectional(const std::vector<Terminal>& sources, const std::vector<Terminal>& targets,
+			Edges edges, bool upward, double& length, std::size_t& settled);
+
+		std::uint32_t SearchAStar(const std::vector<Terminal>& sources, const std::vector<Terminal>& targets,
+			double& length, std::size_t& settled);
+
+		// Appends the map nodes from the search's start to the meeting vertex and on to the search's end
+		void AppendPath(std::uint32_t meeting, bool unpack, std::vector<std::size_t>& nodes) const;
+
+	private:
+		std::vector<std::size_t> m_mapNodes;
+		std::vector<double> m_x;
+		std::vector<double> m_y;
+		std::vector<std::uint32_t> m_firstOut;
+		std::vector<RoadEdge> m_outEdges;
+		std::vector<std::uint32_t> m_firstIn;
+		std::vector<RoadEdge> m_inEdges;
+		quadtree::Quadtree<double, RoadSegment> m_segments;
+		// Side of the area holding one segment on average, where snapping starts to look
+		double m_snapRadius = 1.0;
+		std::unique_ptr<ContractionHierarchy> m_hierarchy;
+		SearchSpace m_search;
+	};
+}
@@ -0,0 +1,214 @@
+#include "ShardedDatabase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	// Collects the objects owned by one shard, together with the nodes of its ways
+	struct ShardContents
+	{
+		geodb::Map map;
+		std::vector<std::size_t> nodeIds;
+		std::vector<std::size_t> wayIds;
+		std::unordered_map<std::size_t, std::size_t> localNodes;
+
+		std::size_t AddNode(const geodb::Map& source, std::size_t nodeId)
+		{
+			const auto [it, inserted] = localNodes.try_emplace(nodeId, map.GetNodes().size());
+			if (inserted)
+			{
+				map.GetNodes().push_back(source.GetNodes()[nodeId]);
+				nodeIds.push_back(nodeId);
+			}
+			return it->second;
+		}
+
+		void AddTaggedNode(const geodb::Map& source, std::size_t nodeId)
+		{
+			const auto localId = AddNode(source, nodeId);
+			map.SetObjectTags(localId, geodb::ObjectType::Node, *source.GetObjectTags(nodeId, geodb::ObjectType::Node));
+		}
+
+		void AddWay(const geodb::Map& source, std::size_t wayId)
+		{
+			const auto& way = source.GetWays()[wayId];
+
+			auto wayNodes = std::vector<std::size_t>{};
+			wayNodes.reserve(way.GetNodes().size());
+			for (const auto node : way.GetNodes())
+			{
+				wayNodes.push_back(AddNode(source, node));
+			}
+
+			map.GetWays().emplace_back(std::move(wayNodes), way.GetBoundingBox());
+			wayIds.push_back(wayId);
+			if (const auto tags = source.GetObjectTags(wayId, geodb::ObjectType::Way))
+			{
+				map.SetObjectTags(map.GetWays().size() - 1, geodb::ObjectType::Way, *tags);
+			}
+		}
+
+		bool IsEmpty() const
+		{
+			return map.GetWays().empty() && localNodes.empty();
+		}
+	};
+
+	bool Intersect(const quadtree::Rectangle<double>& r1, const quadtree::Rectangle<double>& r2)
+	{
+		return std::abs(r1.GetCenterX() - r2.GetCenterX()) <= r1.GetHalfWidth() + r2.GetHalfWidth()
+			&& std::abs(r1.GetCenterY() - r2.GetCenterY()) <= r1.GetHalfHeight() + r2.GetHalfHeight();
+	}
+}
+
+namespace geodb
+{
+	ShardedDatabase ShardedDatabase::FromFile(std::string_view osmFileName, int shardsPerSide)
+	{
+		return ShardedDatabase{ Database::LoadMap(osmFileName), shardsPerSide };
+	}
+
+	ShardedDatabase::ShardedDatabase(const Map& map, int shardsPerSide)
+	{
+		if (shardsPerSide < 1)
+		{
+			throw std::invalid_argument{ "There must be at least one shard per side" };
+		}
+
+		const auto area = GetMapArea(map);
+		const auto minX = area.GetCenterX() - area.GetHalfWidth();
+		const auto minY = area.GetCenterY() - area.GetHalfHeight();
+		const auto cellWidth = area.GetHalfWidth() * 2.0 / shardsPerSide;
+		const auto cellHeight = area.GetHalfHeight() * 2.0 / shardsPerSide;
+		const auto getCell = [&](double offset, double cellSize)
+			{
+				return cellSize > 0.0 ? std::clamp(static_cast<int>(offset / cellSize), 0, shardsPerSide - 1) : 0;
+			};
+
+		auto contents = std::vector<ShardContents>(static_cast<std::size_t>(shardsPerSide) * shardsPerSide);
+		const auto getContents = [&](double x, double y) -> ShardContents&
+			{
+				return contents[getCell(y - minY, cellHeight) * shardsPerSide + getCell(x - minX, cellWidth)];
+			};
+
+		for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+		{
+			const auto& way = map.GetWays()[i];
+			if (!way.IsDeleted())
+			{
+				getContents(way.GetBoundingBox().GetCenterX(), way.GetBoundingBox().GetCenterY()).AddWay(map, i);
+			}
+		}
+		for (std::size_t i = 0; i < map.GetNodes().size(); ++i)
+		{
+			if (map.GetObjectTags(i, ObjectType::Node) != nullptr)
+			{
+				const auto& node = map.GetNodes()[i];
+				getContents(node.GetX(), node.GetY()).AddTaggedNode(map, i);
+			}
+		}
+
+		for (auto& shardContents : contents)
+		{
+			if (shardContents.IsEmpty())
+			{
+				continue;
+			}
+			auto shard = std::make_unique<Shard>(std::move(shardContents.map));
+			shard->nodeIds = std::move(shardContents.nodeIds);
+			shard->wayIds = std::move(shardContents.wayIds);
+			m_shards.push_back(std::move(shard));
+		}
+	}
+
+	std::vector<QueryResult> ShardedDatabase::QueryObjects(const quadtree::Rectangle<double>& searchWindow)
+	{
+		return ScatterGather<QueryResult>(searchWindow, [searchWindow](Shard& shard)
+			{
+				auto results = shard.database.QueryObjects(searchWindow);
+				for (auto& result : results)
+				{
+					result.objectId = shard.GetGlobalId(result.objectId, result.objectType);
+				}
+				return results;
+			});
+	}
+
+	std::vector<DistanceQueryResult> ShardedDatabase::QueryRadius(double centerX, double centerY, double radius)
+	{
+		return ScatterGather<DistanceQueryResult>(quadtree::Rectangle<double>{ centerX, centerY, radius, radius }, [=](Shard& shard)
+			{
+				auto results = shard.database.QueryRadius(centerX, centerY, radius);
+				for (auto& result : results)
+				{
+					result.objectId = shard.GetGlobalId(result.objectId, result.objectType);
+				}
+				return results;
+			});
+	}
+
+	std::size_t ShardedDatabase::CountShardsOverlapping(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		return FindShards(searchWindow).size();
+	}
+
+	// A shard's indexed area covers its nodes, and with them every object it owns
+	std::vector<ShardedDatabase::Shard*> ShardedDatabase::FindShards(const quadtree::Rectangle<double>& searchWindow) const
+	{
+		auto shards = std::vector<Shard*>{};
+		for (const auto& shard : m_shards)
+		{
+			if (Intersect(shard->database.GetIndexedArea(), searchWindow))
+			{
+				shards.push_back(shard.get());
+			}
+		}
+		return shards;
+	}
+
+	ShardedDatabase::Worker::Worker()
+		: m_thread{ [this]() { Run(); } }
+	{ }
+
+	ShardedDatabase::Worker::~Worker()
+	{
+		{
+			const auto lock = std::lock_guard{ m_mutex };
+			m_stopping = true;
+		}
+		m_wakeUp.notify_one();
+		m_thread.join();
+	}
+
+	void ShardedDatabase::Worker::Post(std::function<void()> task)
+	{
+		{
+			const auto lock = std::lock_guard{ m_mutex };
+			m_tasks.push_back(std::move(task));
+		}
+		m_wakeUp.notify_one();
+	}
+
+	// Tasks still queued when the worker stops are run first
+	void ShardedDatabase::Worker::Run()
+	{
+		while (true)
+		{
+			auto task = std::function<void()>{};
+			{
+				auto lock = std::unique_lock{ m_mutex };
+				m_wakeUp.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+				if (m_tasks.empty())
+				{
+					return;
+				}
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+}
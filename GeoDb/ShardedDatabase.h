@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Database.h"
+
+namespace geodb
+{
+	// Splits a map into a grid of spatial shards, each with its own Database served by its own worker thread.
+	// Every object belongs to the shard that holds the center of its bounding box, so objects crossing shard
+	// borders are reported once. Queries are sent only to the shards whose contents overlap the window, and
+	// object ids in the merged results refer to the map the database was built from
+	class ShardedDatabase
+	{
+	public:
+		static ShardedDatabase FromFile(std::string_view osmFileName, int shardsPerSide);
+
+		ShardedDatabase(const Map& map, int shardsPerSide);
+
+		ShardedDatabase(ShardedDatabase&& other) = default;
+
+		std::vector<QueryResult> QueryObjects(const quadtree::Rectangle<double>& searchWindow);
+
+		std::vector<DistanceQueryResult> QueryRadius(double centerX, double centerY, double radius);
+
+		// Shards without any objects are not created
+		std::size_t GetShardCount() const { return m_shards.size(); }
+
+		std::size_t CountShardsOverlapping(const quadtree::Rectangle<double>& searchWindow) const;
+
+	private:
+		class Worker
+		{
+		public:
+			Worker();
+
+			Worker(const Worker& other) = delete;
+
+			Worker& operator=(const Worker& other) = delete;
+
+			~Worker();
+
+			void Post(std::function<void()> task);
+
+		private:
+			void Run();
+
+		private:
+			std::mutex m_mutex;
+			std::condition_variable m_wakeUp;
+			std::deque<std::function<void()>> m_tasks;
+			bool m_stopping = false;
+			std::thread m_thread;
+		};
+
+		struct Shard
+		{
+			explicit Shard(Map map)
+				: database{ Database::FromMap(std::move(map)) }
+			{ }
+
+			std::size_t GetGlobalId(std::size_t objectId, ObjectType objectType) const
+			{
+				return objectType == ObjectType::Node ? nodeIds[objectId] : wayIds[objectId];
+			}
+
+			Database database;
+			// Shard-local object ids to ids in the original map
+			std::vector<std::size_t> nodeIds;
+			std::vector<std::size_t> wayIds;
+			// Declared last, so that the worker has stopped before the database is destroyed
+			Worker worker;
+		};
+
+		std::vector<Shard*> FindShards(const quadtree::Rectangle<double>& searchWindow) const;
+
+		// Runs query(Shard&) on the worker of every overlapping shard and concatenates the results
+		template<typename Result, typename Query>
+		std::vector<Result> ScatterGather(const quadtree::Rectangle<double>& searchWindow, const Query& query)
+		{
+			auto pending = std::vector<std::future<std::vector<Result>>>{};
+			for (const auto shard : FindShards(searchWindow))
+			{
+				auto task = std::make_shared<std::packaged_task<std::vector<Result>()>>([shard, query]() { return query(*shard); });
+				pending.push_back(task->get_future());
+				shard->worker.Post([task]() { (*task)(); });
+			}
+
+			auto result = std::vector<Result>{};
+			for (auto& shardResult : pending)
+			{
+				const auto values = shardResult.get();
+				result.insert(result.end(), values.begin(), values.end());
+			}
+			return result;
+		}
+
+	private:
+		std::vector<std::unique_ptr<Shard>> m_shards;
+	};
+}
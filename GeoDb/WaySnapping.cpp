@@ -0,0 +1,128 @@
+#include "WaySnapping.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace geodb
+{
+	bool TagFilter::Matches(const std::vector<Tag>* tags) const
+	{
+		if (key.empty())
+		{
+			return true;
+		}
+		if (tags == nullptr)
+		{
+			return false;
+		}
+		return std::any_of(tags->begin(), tags->end(), [this](const Tag& tag)
+			{
+				return tag.GetKey() == key && (value.empty() || tag.GetValue() == value);
+			});
+	}
+
+	void SegmentCandidates::Clear()
+	{
+		m_startX.clear();
+		m_startY.clear();
+		m_deltaX.clear();
+		m_deltaY.clear();
+		m_inverseLengthSquared.clear();
+		m_wayIndices.clear();
+		m_segments.clear();
+	}
+
+	void SegmentCandidates::Add(std::size_t wayIndex, std::size_t segment, double startX, double startY, double endX, double endY)
+	{
+		const auto deltaX = endX - startX;
+		const auto deltaY = endY - startY;
+		const auto lengthSquared = deltaX * deltaX + deltaY * deltaY;
+		m_startX.push_back(startX);
+		m_startY.push_back(startY);
+		m_deltaX.push_back(deltaX);
+		m_deltaY.push_back(deltaY);
+		m_inverseLengthSquared.push_back(lengthSquared > 0.0 ? 1.0 / lengthSquared : 0.0);
+		m_wayIndices.push_back(wayIndex);
+		m_segments.push_back(segment);
+	}
+
+	// Distances are computed for all candidates first, two at a time where SSE2 is available, and the minimum
+	// picked afterwards
+	std::optional<WaySnap> SegmentCandidates::FindNearest(double x, double y, double maxDistance)
+	{
+		const auto count = m_startX.size();
+		m_fractions.resize(count);
+		m_distancesSquared.resize(count);
+
+		const auto* startX = m_startX.data();
+		const auto* startY = m_startY.data();
+		const auto* deltaX = m_deltaX.data();
+		const auto* deltaY = m_deltaY.data();
+		const auto* inverseLengthSquared = m_inverseLengthSquared.data();
+		auto* fractions = m_fractions.data();
+		auto* distancesSquared = m_distancesSquared.data();
+		auto i = std::size_t{ 0 };
+#if defined(_M_X64) || defined(__SSE2__)
+		const auto pointX = _mm_set1_pd(x);
+		const auto pointY = _mm_set1_pd(y);
+		const auto zero = _mm_setzero_pd();
+		const auto one = _mm_set1_pd(1.0);
+		for (; i + 2 <= count; i += 2)
+		{
+			const auto segmentStartX = _mm_loadu_pd(startX + i);
+			const auto segmentStartY = _mm_loadu_pd(startY + i);
+			const auto segmentDeltaX = _mm_loadu_pd(deltaX + i);
+			const auto segmentDeltaY = _mm_loadu_pd(deltaY + i);
+			const auto projection = _mm_mul_pd(
+				_mm_add_pd(
+					_mm_mul_pd(_mm_sub_pd(pointX, segmentStartX), segmentDeltaX),
+					_mm_mul_pd(_mm_sub_pd(pointY, segmentStartY), segmentDeltaY)),
+				_mm_loadu_pd(inverseLengthSquared + i));
+			const auto fraction = _mm_min_pd(_mm_max_pd(projection, zero), one);
+			const auto offsetX = _mm_sub_pd(_mm_add_pd(segmentStartX, _mm_mul_pd(fraction, segmentDeltaX)), pointX);
+			const auto offsetY = _mm_sub_pd(_mm_add_pd(segmentStartY, _mm_mul_pd(fraction, segmentDeltaY)), pointY);
+			_mm_storeu_pd(fractions + i, fraction);
+			_mm_storeu_pd(distancesSquared + i, _mm_add_pd(_mm_mul_pd(offsetX, offsetX), _mm_mul_pd(offsetY, offsetY)));
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const auto projection = ((x - startX[i]) * deltaX[i] + (y - startY[i]) * deltaY[i]) * inverseLengthSquared[i];
+			const auto fraction = std::min(std::max(projection, 0.0), 1.0);
+			const auto offsetX = startX[i] + fraction * deltaX[i] - x;
+			const auto offsetY = startY[i] + fraction * deltaY[i] - y;
+			fractions[i] = fraction;
+			distancesSquared[i] = offsetX * offsetX + offsetY * offsetY;
+		}
+
+		auto best = count;
+		auto bestDistanceSquared = maxDistance * maxDistance;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			if (distancesSquared[i] < bestDistanceSquared
+				|| (distancesSquared[i] == bestDistanceSquared
+					&& (best == count || std::make_pair(m_wayIndices[i], m_segments[i]) < std::make_pair(m_wayIndices[best], m_segments[best]))))
+			{
+				best = i;
+				bestDistanceSquared = distancesSquared[i];
+			}
+		}
+
+		if (best == count)
+		{
+			return std::nullopt;
+		}
+		return WaySnap{
+			m_wayIndices[best],
+			m_segments[best],
+			fractions[best],
+			startX[best] + fractions[best] * deltaX[best],
+			startY[best] + fractions[best] * deltaY[best],
+			std::sqrt(bestDistanceSquared)
+		};
+	}
+}
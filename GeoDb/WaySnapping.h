@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Map.h"
+
+namespace geodb
+{
+	// Ways carrying the key, with the given value unless it is empty. An empty key matches every way
+	struct TagFilter
+	{
+		std::string key;
+		std::string value;
+
+		bool Matches(const std::vector<Tag>* tags) const;
+	};
+
+	// Nearest point on a way to a snapped point
+	struct WaySnap
+	{
+		std::size_t wayIndex = 0;
+		// Position in the way's nodes where the segment starts
+		std::size_t segment = 0;
+		// Along the segment from its start
+		double fraction = 0.0;
+		double x = 0.0;
+		double y = 0.0;
+		double distance = 0.0;
+	};
+
+	// Way segments around a group of nearby points, kept as separate arrays so that distances to several segments
+	// load and compute as one vector
+	class SegmentCandidates
+	{
+	public:
+		void Clear();
+
+		void Add(std::size_t wayIndex, std::size_t segment, double startX, double startY, double endX, double endY);
+
+		std::size_t GetSize() const { return m_startX.size(); }
+
+		// Nearest candidate no farther than maxDistance, ties going to the lowest way and segment
+		std::optional<WaySnap> FindNearest(double x, double y, double maxDistance);
+
+	private:
+		std::vector<double> m_startX;
+		std::vector<double> m_startY;
+		std::vector<double> m_deltaX;
+		std::vector<double> m_deltaY;
+		// Zero for segments of zero length, which then snap to their start
+		std::vector<double> m_inverseLengthSquared;
+		std::vector<std::size_t> m_wayIndices;
+		std::vector<std::size_t> m_segments;
+		std::vector<double> m_fractions;
+		std::vector<double> m_distancesSquared;
+	};
+}
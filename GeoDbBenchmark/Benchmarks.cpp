@@ -0,0 +1,96 @@
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+	quadtree::Rectangle<double> BoundingBoxOf(const geodb::Map& map, const std::vector<std::size_t>& nodes)
+	{
+		auto minX = map.GetNodes()[nodes.front()].GetX();
+		auto maxX = minX;
+		auto minY = map.GetNodes()[nodes.front()].GetY();
+		auto maxY = minY;
+		for (const auto node : nodes)
+		{
+			minX = std::min(minX, map.GetNodes()[node].GetX());
+			maxX = std::max(maxX, map.GetNodes()[node].GetX());
+			minY = std::min(minY, map.GetNodes()[node].GetY());
+			maxY = std::max(maxY, map.GetNodes()[node].GetY());
+		}
+		return quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
+	}
+}
+
+namespace benchmark
+{
+	geodb::Map GenerateMap(std::mt19937& random)
+	{
+		using geodb::ObjectType;
+
+		auto coordinate = std::uniform_real_distribution<double>{ 0.0, MapSize };
+		auto offset = std::uniform_real_distribution<double>{ -20.0, 20.0 };
+
+		auto map = geodb::Map{};
+		for (auto i = 0; i < NodeCount; ++i)
+		{
+			map.GetNodes().emplace_back(coordinate(random), coordinate(random));
+			map.SetOsmId(i, ObjectType::Node, i);
+			if (i % 10 == 0)
+			{
+				map.AddTagToObject(i, ObjectType::Node, "amenity", "cafe");
+			}
+		}
+
+		auto pickNode = std::uniform_int_distribution<std::size_t>{ 0, NodeCount - 1 };
+		for (auto i = 0; i < WayCount; ++i)
+		{
+			const auto& first = map.GetNodes()[pickNode(random)];
+			auto nodes = std::vector<std::size_t>{};
+			for (auto j = 0; j < NodesPerWay; ++j)
+			{
+				map.GetNodes().emplace_back(first.GetX() + offset(random), first.GetY() + offset(random));
+				nodes.push_back(map.GetNodes().size() - 1);
+				map.SetOsmId(nodes.back(), ObjectType::Node, static_cast<geodb::OsmId>(nodes.back()));
+			}
+			const auto boundingBox = BoundingBoxOf(map, nodes);
+			map.GetWays().emplace_back(std::move(nodes), boundingBox);
+			map.SetOsmId(i, ObjectType::Way, i);
+			if (i % 4 == 0)
+			{
+				map.AddTagToObject(i, ObjectType::Way, "highway", "residential");
+			}
+		}
+		return map;
+	}
+
+	quadtree::Rectangle<double> RandomWindow(std::mt19937& random)
+	{
+		auto position = std::uniform_real_distribution<double>{ 0.0, MapSize };
+		auto side = std::uniform_real_distribution<double>{ 1.0, MaxWindowSide };
+		return quadtree::Rectangle<double>{ position(random), position(random), side(random), side(random) };
+	}
+
+	void PrintLatencies(std::string_view name, std::vector<double>& latencies, double seconds)
+	{
+		std::cout << "  " << name << ": " << latencies.size() << " ops, " << latencies.size() / seconds << " ops/s";
+		if (latencies.empty())
+		{
+			std::cout << "\n";
+			return;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+		const auto percentile = [&](double p)
+			{
+				const auto rank = static_cast<std::size_t>(p / 100.0 * static_cast<double>(latencies.size() - 1));
+				return latencies[rank];
+			};
+		std::cout
+			<< ", p50 " << percentile(50.0) << " us"
+			<< ", p90 " << percentile(90.0) << " us"
+			<< ", p99 " << percentile(99.0) << " us"
+			<< ", p99.9 " << percentile(99.9) << " us"
+			<< ", max " << latencies.back() << " us\n";
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../GeoDb/Map.h"
+
+namespace benchmark
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr auto MapSize = 10000.0;
+	constexpr auto NodeCount = 200000;
+	constexpr auto WayCount = 50000;
+	constexpr auto NodesPerWay = 5;
+	constexpr auto MaxWindowSide = 200.0;
+
+	struct Options
+	{
+		int threads = 0;
+		double seconds = 0.0;
+	};
+
+	template<typename Duration>
+	double ToMicroseconds(Duration duration)
+	{
+		return std::chrono::duration<double, std::micro>(duration).count();
+	}
+
+	// Random short ways over random nodes, every object gets its index as its OSM id
+	geodb::Map GenerateMap(std::mt19937& random);
+
+	quadtree::Rectangle<double> RandomWindow(std::mt19937& random);
+
+	// Prints the throughput and latency percentiles of the operations, which are sorted in place
+	void PrintLatencies(std::string_view name, std::vector<double>& latencies, double seconds);
+
+	// Readers querying while one writer applies diffs, compared with a database behind a shared_mutex
+	void RunConcurrencyBenchmark(const Options& options);
+
+	// Clients querying databases split into more and more shards
+	void RunShardingBenchmark(const Options& options);
+
+	// Build time, index memory and query latency of the quadtree and R-tree engines on each OSM file, or on a generated map
+	void RunEngineBenchmark(const Options& options, const std::vector<std::string>& osmFileNames);
+
+	// A million point-in-polygon lookups over the closed ways of each OSM file, or of a generated map
+	void RunPolygonBenchmark(const std::vector<std::string>& osmFileNames);
+
+	// Road graph build and contraction time, and the latency of a thousand random routes with each algorithm, on the
+	// highways of each OSM file or of a generated grid city
+	void RunRoutingBenchmark(const std::vector<std::string>& osmFileNames);
+
+	// A million fixes along random traces snapped to the ways of a generated map, one radius query per fix
+	// against the batch API
+	void RunSnappingBenchmark();
+
+	// Query throughput of clients pinned round-robin to the NUMA nodes, with the index and map on default or huge
+	// pages and the index shared or copied to every node, on each OSM file or on a generated map
+	void RunPlacementBenchmark(const Options& options, const std::vector<std::string>& osmFileNames);
+
+	// Results of random window queries serialized to GeoJSON with an ostringstream, against the feature writer's
+	// GeoJSON and binary output into a fixed buffer
+	void RunExportBenchmark();
+}
@@ -0,0 +1,166 @@
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/ConcurrentDatabase.h"
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+
+namespace
+{
+	constexpr auto MovedNodesPerDiff = 100;
+	constexpr auto CreatedWaysPerDiff = 10;
+
+	// Moves random nodes a little, creates a few ways and deletes the ways created by an earlier diff
+	class DiffGenerator
+	{
+	public:
+		DiffGenerator(std::size_t nodeCount, unsigned seed)
+			: m_random{ seed }
+			, m_nodeCount{ nodeCount }
+		{ }
+
+		MapChanges Next()
+		{
+			auto coordinate = std::uniform_real_distribution<double>{ 0.0, benchmark::MapSize };
+			auto pickNode = std::uniform_int_distribution<OsmId>{ 0, static_cast<OsmId>(m_nodeCount) - 1 };
+
+			auto changes = MapChanges{};
+			for (auto i = 0; i < MovedNodesPerDiff; ++i)
+			{
+				changes.nodes.push_back(NodeChange{ pickNode(m_random), false, coordinate(m_random), coordinate(m_random), {} });
+			}
+
+			for (const auto way : m_createdWays)
+			{
+				changes.ways.push_back(WayChange{ way, true, {}, {} });
+			}
+			m_createdWays.clear();
+
+			for (auto i = 0; i < CreatedWaysPerDiff; ++i)
+			{
+				auto nodes = std::vector<OsmId>{};
+				for (auto j = 0; j < benchmark::NodesPerWay; ++j)
+				{
+					nodes.push_back(pickNode(m_random));
+				}
+				changes.ways.push_back(WayChange{ m_nextWayId, false, std::move(nodes), { Tag{ "highway", "service" } } });
+				m_createdWays.push_back(m_nextWayId++);
+			}
+			return changes;
+		}
+
+	private:
+		std::mt19937 m_random;
+		std::size_t m_nodeCount;
+		OsmId m_nextWayId = benchmark::WayCount;
+		std::vector<OsmId> m_createdWays;
+	};
+
+	struct LatencyReport
+	{
+		std::vector<double> readMicroseconds;
+		std::vector<double> writeMicroseconds;
+		std::size_t results = 0;
+	};
+
+	// Runs reader threads that query random windows through `read` while the calling thread
+	// applies diffs through `write` back to back, until the time is up
+	template<typename Read, typename Write>
+	LatencyReport RunMixedWorkload(const benchmark::Options& options, std::size_t nodeCount, Read&& read, Write&& write)
+	{
+		auto stop = std::atomic<bool>{ false };
+		auto readLatencies = std::vector<std::vector<double>>(options.threads);
+		auto results = std::vector<std::size_t>(options.threads);
+
+		auto threads = std::vector<std::thread>{};
+		for (auto i = 0; i < options.threads; ++i)
+		{
+			threads.emplace_back([&, i]
+			{
+				auto random = std::mt19937{ static_cast<unsigned>(i + 1) };
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const auto window = benchmark::RandomWindow(random);
+					const auto start = benchmark::Clock::now();
+					results[i] += read(window);
+					readLatencies[i].push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - start));
+				}
+			});
+		}
+
+		auto report = LatencyReport{};
+		auto diffs = DiffGenerator{ nodeCount, 42 };
+		const auto end = benchmark::Clock::now() + std::chrono::duration<double>(options.seconds);
+		while (benchmark::Clock::now() < end)
+		{
+			const auto changes = diffs.Next();
+			const auto start = benchmark::Clock::now();
+			write(changes);
+			report.writeMicroseconds.push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - start));
+		}
+
+		stop.store(true);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		for (auto i = 0; i < options.threads; ++i)
+		{
+			report.readMicroseconds.insert(report.readMicroseconds.end(), readLatencies[i].begin(), readLatencies[i].end());
+			report.results += results[i];
+		}
+		return report;
+	}
+
+	void PrintReport(std::string_view name, LatencyReport& report, double seconds)
+	{
+		std::cout << name << " (" << report.results << " results)\n";
+		benchmark::PrintLatencies("reads", report.readMicroseconds, seconds);
+		benchmark::PrintLatencies("writes", report.writeMicroseconds, seconds);
+	}
+}
+
+namespace benchmark
+{
+	void RunConcurrencyBenchmark(const Options& options)
+	{
+		std::cout << "Generating map...\n";
+		auto random = std::mt19937{ 7 };
+		const auto map = GenerateMap(random);
+		const auto nodeCount = map.GetNodes().size();
+
+		std::cout << "Running " << options.threads << " readers and 1 writer for " << options.seconds << " s each\n";
+
+		{
+			auto database = Database::FromMap(map);
+			auto mutex = std::shared_mutex{};
+			auto report = RunMixedWorkload(options, nodeCount,
+				[&](const quadtree::Rectangle<double>& window)
+				{
+					const auto lock = std::shared_lock{ mutex };
+					return database.Query(window).size();
+				},
+				[&](const MapChanges& changes)
+				{
+					const auto lock = std::unique_lock{ mutex };
+					database.ApplyChanges(changes);
+				});
+			PrintReport("Database with shared_mutex", report, options.seconds);
+		}
+
+		{
+			auto database = ConcurrentDatabase{ map };
+			auto report = RunMixedWorkload(options, nodeCount,
+				[&](const quadtree::Rectangle<double>& window) { return database.Query(window).size(); },
+				[&](const MapChanges& changes) { database.ApplyChanges(changes); });
+			PrintReport("ConcurrentDatabase", report, options.seconds);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <string>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+
+namespace
+{
+	const char* ToString(IndexEngine engine)
+	{
+		return engine == IndexEngine::RTree ? "R-tree" : "Quadtree";
+	}
+
+	// Windows are spread over the indexed area and sized relative to it, so files of any extent get comparable queries
+	std::vector<quadtree::Rectangle<double>> GenerateWindows(const quadtree::Rectangle<double>& area, std::size_t count)
+	{
+		auto random = std::mt19937{ 1 };
+		auto x = std::uniform_real_distribution<double>{ area.GetCenterX() - area.GetHalfWidth(), area.GetCenterX() + area.GetHalfWidth() };
+		auto y = std::uniform_real_distribution<double>{ area.GetCenterY() - area.GetHalfHeight(), area.GetCenterY() + area.GetHalfHeight() };
+		auto side = std::uniform_real_distribution<double>{ 0.001, 0.02 };
+		auto windows = std::vector<quadtree::Rectangle<double>>{};
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			windows.push_back(quadtree::Rectangle<double>{ x(random), y(random), area.GetHalfWidth() * 2.0 * side(random),
+				area.GetHalfHeight() * 2.0 * side(random) });
+		}
+		return windows;
+	}
+
+	void RunEngine(const Map& map, IndexEngine engine, const benchmark::Options& options)
+	{
+		const auto buildStart = benchmark::Clock::now();
+		auto database = Database::FromMap(map, engine);
+		const auto buildMicroseconds = benchmark::ToMicroseconds(benchmark::Clock::now() - buildStart);
+		const auto statistics = database.GetStatistics();
+		std::cout << ToString(engine) << ": build " << buildMicroseconds / 1000.0 << " ms, index "
+			<< statistics.index.memory.GetTotalBytes() / 1024 << " KiB, depth " << statistics.index.maxDepthReached << "\n";
+
+		const auto windows = GenerateWindows(database.GetIndexedArea(), 10000);
+		auto latencies = std::vector<double>{};
+		auto results = std::size_t{ 0 };
+		const auto start = benchmark::Clock::now();
+		while (benchmark::ToMicroseconds(benchmark::Clock::now() - start) < options.seconds * 1e6)
+		{
+			const auto& window = windows[latencies.size() % windows.size()];
+			const auto queryStart = benchmark::Clock::now();
+			results += database.Query(window).size();
+			latencies.push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - queryStart));
+		}
+		benchmark::PrintLatencies("queries", latencies, options.seconds);
+
+		const auto joinStart = benchmark::Clock::now();
+		auto pairs = std::size_t{ 0 };
+		database.SelfJoin([&pairs](const QueryResult&, const QueryResult&) { ++pairs; });
+		std::cout << "  self join: " << pairs << " pairs in " << benchmark::ToMicroseconds(benchmark::Clock::now() - joinStart) / 1000.0
+			<< " ms (" << results << " query results)\n";
+	}
+
+	void CompareEngines(const Map& map, const benchmark::Options& options)
+	{
+		for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+		{
+			RunEngine(map, engine, options);
+		}
+	}
+}
+
+namespace benchmark
+{
+	void RunEngineBenchmark(const Options& options, const std::vector<std::string>& osmFileNames)
+	{
+		if (osmFileNames.empty())
+		{
+			std::cout << "Generating map...\n";
+			auto random = std::mt19937{ 7 };
+			CompareEngines(GenerateMap(random), options);
+			return;
+		}
+
+		for (const auto& osmFileName : osmFileNames)
+		{
+			std::cout << "Loading " << osmFileName << "...\n";
+			CompareEngines(Database::LoadMap(osmFileName), options);
+		}
+	}
+}
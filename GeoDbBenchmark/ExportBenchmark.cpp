@@ -0,0 +1,124 @@
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+#include "../GeoDb/FeatureWriter.h"
+
+using namespace geodb;
+
+namespace
+{
+	constexpr auto QueryCount = 2000;
+	constexpr std::size_t BufferBytes = 64 * 1024;
+
+	// What serializing results costs without the writer: an ostream walking the map for every feature
+	std::size_t WriteWithStream(const Map& map, const std::vector<Database::QueryResult>& objects)
+	{
+		auto out = std::ostringstream{};
+		out << std::setprecision(std::numeric_limits<double>::max_digits10);
+		out << "{\"type\":\"FeatureCollection\",\"features\":[";
+		for (std::size_t i = 0; i < objects.size(); ++i)
+		{
+			const auto& object = objects[i];
+			out << (i == 0 ? "" : ",") << "{\"type\":\"Feature\",\"id\":\"" << (object.objectType == ObjectType::Way ? "way/" : "node/")
+				<< object.objectId << "\",\"geometry\":";
+			if (object.objectType == ObjectType::Node)
+			{
+				const auto& node = map.GetNodes()[object.objectId];
+				out << "{\"type\":\"Point\",\"coordinates\":[" << node.GetX() << "," << node.GetY() << "]}";
+			}
+			else
+			{
+				out << "{\"type\":\"LineString\",\"coordinates\":[";
+				const auto& nodes = map.GetWays()[object.objectId].GetNodes();
+				for (std::size_t j = 0; j < nodes.size(); ++j)
+				{
+					const auto& node = map.GetNodes()[nodes[j]];
+					out << (j == 0 ? "" : ",") << "[" << node.GetX() << "," << node.GetY() << "]";
+				}
+				out << "]}";
+			}
+			out << ",\"properties\":{";
+			if (const auto* tags = map.GetObjectTags(object.objectId, object.objectType))
+			{
+				for (std::size_t j = 0; j < tags->size(); ++j)
+				{
+					out << (j == 0 ? "" : ",") << "\"" << (*tags)[j].GetKey() << "\":\"" << (*tags)[j].GetValue() << "\"";
+				}
+			}
+			out << "}}";
+		}
+		out << "]}";
+		return out.str().size();
+	}
+
+	// Writes into a fixed buffer that is handed off, as to a socket, whenever it fills up
+	std::size_t WriteWithWriter(const Map& map, const std::vector<Database::QueryResult>& objects, FeatureFormat format, std::span<char> buffer)
+	{
+		auto writer = FeatureWriter{ map, format, buffer };
+		writer.Begin();
+		auto written = std::size_t{ 0 };
+		while (written < objects.size())
+		{
+			written += writer.Write(std::span<const Database::QueryResult>{ objects }.subspan(written));
+			if (written < objects.size())
+			{
+				writer.ClearBuffered();
+			}
+		}
+		while (!writer.End())
+		{
+			writer.ClearBuffered();
+		}
+		return writer.GetWrittenBytes();
+	}
+}
+
+namespace benchmark
+{
+	void RunExportBenchmark()
+	{
+		auto random = std::mt19937{ 5 };
+		std::cout << "Generating map...\n";
+		auto database = Database::FromMap(GenerateMap(random));
+
+		auto results = std::vector<std::vector<Database::QueryResult>>{};
+		auto features = std::size_t{ 0 };
+		for (auto i = 0; i < QueryCount; ++i)
+		{
+			results.push_back(database.QueryObjects(RandomWindow(random)));
+			features += results.back().size();
+		}
+		std::cout << QueryCount << " query results, " << features << " features\n";
+
+		auto buffer = std::vector<char>(BufferBytes);
+		const auto measure = [&](const char* name, const auto& write)
+			{
+				auto latencies = std::vector<double>{};
+				auto bytes = std::size_t{ 0 };
+				const auto start = Clock::now();
+				for (const auto& objects : results)
+				{
+					const auto queryStart = Clock::now();
+					bytes += write(objects);
+					latencies.push_back(ToMicroseconds(Clock::now() - queryStart));
+				}
+				const auto seconds = ToMicroseconds(Clock::now() - start) / 1e6;
+				std::cout << name << ", " << features / seconds << " features/s, " << bytes / seconds / (1024 * 1024) << " MiB/s\n";
+				PrintLatencies("results", latencies, seconds);
+			};
+		measure("GeoJSON with ostringstream", [&](const auto& objects) { return WriteWithStream(database.GetMap(), objects); });
+		measure("GeoJSON with FeatureWriter", [&](const auto& objects)
+			{
+				return WriteWithWriter(database.GetMap(), objects, FeatureFormat::GeoJson, buffer);
+			});
+		measure("Binary with FeatureWriter", [&](const auto& objects)
+			{
+				return WriteWithWriter(database.GetMap(), objects, FeatureFormat::Binary, buffer);
+			});
+	}
+}
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+#include "../GeoDb/MemoryPlacement.h"
+
+using namespace geodb;
+
+namespace
+{
+	struct Placement
+	{
+		const char* name;
+		AllocationPolicy allocation;
+	};
+
+	constexpr Placement Placements[] = {
+		{ "default pages", { PagePolicy::Default, false } },
+		{ "transparent huge pages", { PagePolicy::TransparentHugePages, false } },
+		{ "explicit huge pages", { PagePolicy::ExplicitHugePages, false } },
+		{ "index per NUMA node", { PagePolicy::Default, true } },
+		{ "index per NUMA node, transparent huge pages", { PagePolicy::TransparentHugePages, true } }
+	};
+
+	// Client threads spread round-robin over the NUMA nodes and pinned there, querying random windows until the time is up
+	void RunPinnedClients(const benchmark::Options& options, Database& database)
+	{
+		auto stop = std::atomic<bool>{ false };
+		auto latencies = std::vector<std::vector<double>>(options.threads);
+		auto pinned = std::atomic<int>{ 0 };
+
+		auto threads = std::vector<std::thread>{};
+		for (auto i = 0; i < options.threads; ++i)
+		{
+			threads.emplace_back([&, i]
+			{
+				pinned += PinThreadToNumaNode(i % GetNumaNodeCount()) ? 1 : 0;
+				auto random = std::mt19937{ static_cast<unsigned>(i + 1) };
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const auto window = benchmark::RandomWindow(random);
+					const auto start = benchmark::Clock::now();
+					database.Query(window);
+					latencies[i].push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - start));
+				}
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+		stop.store(true);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		auto queryMicroseconds = std::vector<double>{};
+		for (const auto& threadLatencies : latencies)
+		{
+			queryMicroseconds.insert(queryMicroseconds.end(), threadLatencies.begin(), threadLatencies.end());
+		}
+		std::cout << "  " << pinned.load() << " of " << options.threads << " clients pinned\n";
+		benchmark::PrintLatencies("queries", queryMicroseconds, options.seconds);
+	}
+
+	void RunPlacements(const benchmark::Options& options, const Map& map)
+	{
+		for (const auto& placement : Placements)
+		{
+			const auto start = benchmark::Clock::now();
+			auto database = Database::FromMap(map, IndexEngine::Quadtree, placement.allocation);
+			const auto buildSeconds = benchmark::ToMicroseconds(benchmark::Clock::now() - start) / 1e6;
+			const auto statistics = database.GetStatistics();
+			std::cout << placement.name << ", built in " << buildSeconds << " s, " << statistics.indexReplicas
+				<< " index copies, " << statistics.hugePageBytes / (1024 * 1024) << " of "
+				<< statistics.GetTotalBytes() / (1024 * 1024) << " MiB on huge pages\n";
+			RunPinnedClients(options, database);
+		}
+	}
+}
+
+namespace benchmark
+{
+	void RunPlacementBenchmark(const Options& options, const std::vector<std::string>& osmFileNames)
+	{
+		std::cout << GetNumaNodeCount() << " NUMA nodes, running " << options.threads << " clients for " << options.seconds
+			<< " s each\n";
+		if (osmFileNames.empty())
+		{
+			std::cout << "Generating map...\n";
+			auto random = std::mt19937{ 7 };
+			RunPlacements(options, GenerateMap(random));
+			return;
+		}
+
+		for (const auto& osmFileName : osmFileNames)
+		{
+			std::cout << "Loading " << osmFileName << "...\n";
+			RunPlacements(options, Database::LoadMap(osmFileName));
+		}
+	}
+}
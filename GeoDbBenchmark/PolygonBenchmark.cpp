@@ -0,0 +1,127 @@
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <string>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+
+namespace
+{
+	constexpr std::size_t LookupCount = 1000000;
+	constexpr auto BuildingCount = 200000;
+	constexpr auto LanduseCount = 5000;
+	constexpr auto AdminAreasPerSide = 4;
+
+	// Closed ring of vertices around the center, the radius varying by up to the given fraction
+	void AddRing(Map& map, double centerX, double centerY, double radius, int vertices, double roughness, std::mt19937& random)
+	{
+		auto variation = std::uniform_real_distribution<double>{ 1.0 - roughness, 1.0 };
+		auto nodes = std::vector<std::size_t>{};
+		auto minX = centerX;
+		auto maxX = centerX;
+		auto minY = centerY;
+		auto maxY = centerY;
+		for (auto i = 0; i < vertices; ++i)
+		{
+			const auto angle = 2.0 * std::numbers::pi * i / vertices;
+			const auto distance = radius * variation(random);
+			map.GetNodes().emplace_back(centerX + distance * std::cos(angle), centerY + distance * std::sin(angle));
+			nodes.push_back(map.GetNodes().size() - 1);
+			minX = std::min(minX, map.GetNodes().back().GetX());
+			maxX = std::max(maxX, map.GetNodes().back().GetX());
+			minY = std::min(minY, map.GetNodes().back().GetY());
+			maxY = std::max(maxY, map.GetNodes().back().GetY());
+		}
+		nodes.push_back(nodes.front());
+		map.GetWays().emplace_back(std::move(nodes), quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY));
+	}
+
+	// Small buildings, landuse areas of up to a few hundred vertices and administrative areas of thousands
+	Map GeneratePolygonMap(std::mt19937& random)
+	{
+		auto coordinate = std::uniform_real_distribution<double>{ 0.0, benchmark::MapSize };
+		auto landuseVertices = std::uniform_int_distribution<int>{ 30, 300 };
+		auto landuseRadius = std::uniform_real_distribution<double>{ 20.0, 150.0 };
+
+		auto map = Map{};
+		const auto adminRadius = benchmark::MapSize / AdminAreasPerSide * 0.7;
+		for (auto i = 0; i < AdminAreasPerSide * AdminAreasPerSide; ++i)
+		{
+			const auto step = benchmark::MapSize / AdminAreasPerSide;
+			AddRing(map, (i % AdminAreasPerSide + 0.5) * step, (i / AdminAreasPerSide + 0.5) * step, adminRadius, 5000, 0.05, random);
+		}
+		for (auto i = 0; i < LanduseCount; ++i)
+		{
+			AddRing(map, coordinate(random), coordinate(random), landuseRadius(random), landuseVertices(random), 0.2, random);
+		}
+		for (auto i = 0; i < BuildingCount; ++i)
+		{
+			AddRing(map, coordinate(random), coordinate(random), 8.0, 5, 0.3, random);
+		}
+		return map;
+	}
+
+	void RunLookups(const Map& map, IndexEngine engine)
+	{
+		auto database = Database::FromMap(map, engine);
+		const auto& area = database.GetIndexedArea();
+
+		auto random = std::mt19937{ 1 };
+		auto x = std::uniform_real_distribution<double>{ area.GetCenterX() - area.GetHalfWidth(), area.GetCenterX() + area.GetHalfWidth() };
+		auto y = std::uniform_real_distribution<double>{ area.GetCenterY() - area.GetHalfHeight(), area.GetCenterY() + area.GetHalfHeight() };
+		auto points = std::vector<std::pair<double, double>>{};
+		points.reserve(LookupCount);
+		for (std::size_t i = 0; i < LookupCount; ++i)
+		{
+			points.emplace_back(x(random), y(random));
+		}
+
+		auto latencies = std::vector<double>{};
+		latencies.reserve(LookupCount);
+		auto matches = std::size_t{ 0 };
+		const auto start = benchmark::Clock::now();
+		for (const auto& [pointX, pointY] : points)
+		{
+			const auto lookupStart = benchmark::Clock::now();
+			matches += database.Containing(pointX, pointY).size();
+			latencies.push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - lookupStart));
+		}
+		const auto seconds = benchmark::ToMicroseconds(benchmark::Clock::now() - start) / 1e6;
+		std::cout << (engine == IndexEngine::RTree ? "R-tree" : "Quadtree") << " candidates, "
+			<< database.GetStatistics().polygonBytes / (1024 * 1024) << " MiB of prepared polygons, "
+			<< static_cast<double>(matches) / LookupCount << " polygons per point\n";
+		benchmark::PrintLatencies("lookups", latencies, seconds);
+	}
+}
+
+namespace benchmark
+{
+	void RunPolygonBenchmark(const std::vector<std::string>& osmFileNames)
+	{
+		const auto runEngines = [](const Map& map)
+			{
+				for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+				{
+					RunLookups(map, engine);
+				}
+			};
+
+		if (osmFileNames.empty())
+		{
+			std::cout << "Generating map...\n";
+			auto random = std::mt19937{ 7 };
+			runEngines(GeneratePolygonMap(random));
+			return;
+		}
+
+		for (const auto& osmFileName : osmFileNames)
+		{
+			std::cout << "Loading " << osmFileName << "...\n";
+			runEngines(Database::LoadMap(osmFileName));
+		}
+	}
+}
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+#include "../GeoDb/RoadGraph.h"
+
+using namespace geodb;
+
+namespace
+{
+	constexpr std::size_t RouteCount = 1000;
+	constexpr auto StreetsPerSide = 150;
+	constexpr auto ShapeNodesPerBlock = 2;
+	constexpr auto OneWayEvery = 4;
+	constexpr auto MaxSnapDistance = 500.0;
+	constexpr RouteAlgorithm Algorithms[] = { RouteAlgorithm::BidirectionalDijkstra, RouteAlgorithm::AStar, RouteAlgorithm::ContractionHierarchy };
+
+	// Jittered grid of streets across the whole map with shape nodes between the intersections, every few streets
+	// one way in alternating directions
+	Map GenerateCityMap(std::mt19937& random)
+	{
+		const auto spacing = benchmark::MapSize / StreetsPerSide;
+		auto jitter = std::uniform_real_distribution<double>{ -0.3 * spacing, 0.3 * spacing };
+		auto shapeJitter = std::uniform_real_distribution<double>{ -0.05 * spacing, 0.05 * spacing };
+
+		auto map = Map{};
+		for (auto row = 0; row < StreetsPerSide; ++row)
+		{
+			for (auto column = 0; column < StreetsPerSide; ++column)
+			{
+				map.GetNodes().emplace_back((column + 0.5) * spacing + jitter(random), (row + 0.5) * spacing + jitter(random));
+			}
+		}
+
+		const auto addStreet = [&](const std::vector<std::size_t>& intersections, int street)
+			{
+				auto nodes = std::vector<std::size_t>{ intersections.front() };
+				for (std::size_t i = 1; i < intersections.size(); ++i)
+				{
+					const auto from = map.GetNodes()[intersections[i - 1]];
+					const auto to = map.GetNodes()[intersections[i]];
+					for (auto k = 1; k <= ShapeNodesPerBlock; ++k)
+					{
+						const auto t = static_cast<double>(k) / (ShapeNodesPerBlock + 1);
+						const auto x = from.GetX() + t * (to.GetX() - from.GetX()) + shapeJitter(random);
+						const auto y = from.GetY() + t * (to.GetY() - from.GetY()) + shapeJitter(random);
+						map.GetNodes().emplace_back(x, y);
+						nodes.push_back(map.GetNodes().size() - 1);
+					}
+					nodes.push_back(intersections[i]);
+				}
+
+				auto tags = std::vector<Tag>{ Tag{ "highway", street % 10 == 0 ? "primary" : "residential" } };
+				if (street % OneWayEvery == 1)
+				{
+					tags.emplace_back("oneway", street % (2 * OneWayEvery) == 1 ? "yes" : "-1");
+				}
+				auto minX = std::numeric_limits<double>::infinity();
+				auto minY = minX;
+				auto maxX = -minX;
+				auto maxY = -minX;
+				for (const auto node : nodes)
+				{
+					minX = std::min(minX, map.GetNodes()[node].GetX());
+					minY = std::min(minY, map.GetNodes()[node].GetY());
+					maxX = std::max(maxX, map.GetNodes()[node].GetX());
+					maxY = std::max(maxY, map.GetNodes()[node].GetY());
+				}
+				map.GetWays().emplace_back(std::move(nodes), quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY));
+				map.SetObjectTags(map.GetWays().size() - 1, ObjectType::Way, std::move(tags));
+			};
+		for (auto street = 0; street < StreetsPerSide; ++street)
+		{
+			auto horizontal = std::vector<std::size_t>{};
+			auto vertical = std::vector<std::size_t>{};
+			for (auto i = 0; i < StreetsPerSide; ++i)
+			{
+				horizontal.push_back(static_cast<std::size_t>(street * StreetsPerSide + i));
+				vertical.push_back(static_cast<std::size_t>(i * StreetsPerSide + street));
+			}
+			addStreet(horizontal, street);
+			addStreet(vertical, street);
+		}
+		return map;
+	}
+
+	void RunRoutes(const Map& map)
+	{
+		auto start = benchmark::Clock::now();
+		auto graph = RoadGraph::FromMap(map);
+		const auto buildSeconds = benchmark::ToMicroseconds(benchmark::Clock::now() - start) / 1e6;
+		start = benchmark::Clock::now();
+		graph.Contract();
+		const auto contractSeconds = benchmark::ToMicroseconds(benchmark::Clock::now() - start) / 1e6;
+		std::cout << graph.GetVertexCount() << " vertices, " << graph.GetEdgeCount() << " edges, built in " << buildSeconds
+			<< " s, contracted in " << contractSeconds << " s with " << graph.GetShortcutCount() << " shortcuts, "
+			<< graph.GetAllocatedBytes() / (1024 * 1024) << " MiB\n";
+
+		auto minX = std::numeric_limits<double>::infinity();
+		auto minY = minX;
+		auto maxX = -minX;
+		auto maxY = -minX;
+		for (const auto& node : map.GetNodes())
+		{
+			minX = std::min(minX, node.GetX());
+			minY = std::min(minY, node.GetY());
+			maxX = std::max(maxX, node.GetX());
+			maxY = std::max(maxY, node.GetY());
+		}
+		auto random = std::mt19937{ 1 };
+		auto x = std::uniform_real_distribution<double>{ minX, maxX };
+		auto y = std::uniform_real_distribution<double>{ minY, maxY };
+		auto positions = std::vector<std::pair<RoadPosition, RoadPosition>>{};
+		while (positions.size() < RouteCount)
+		{
+			const auto from = graph.Snap(x(random), y(random), MaxSnapDistance);
+			const auto to = graph.Snap(x(random), y(random), MaxSnapDistance);
+			if (from && to)
+			{
+				positions.emplace_back(*from, *to);
+			}
+		}
+
+		auto lengths = std::vector<std::optional<double>>{};
+		for (const auto algorithm : Algorithms)
+		{
+			auto latencies = std::vector<double>{};
+			auto settled = std::size_t{ 0 };
+			auto mismatches = std::size_t{ 0 };
+			const auto routesStart = benchmark::Clock::now();
+			for (std::size_t i = 0; i < positions.size(); ++i)
+			{
+				const auto routeStart = benchmark::Clock::now();
+				const auto route = graph.FindRoute(positions[i].first, positions[i].second, algorithm);
+				latencies.push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - routeStart));
+
+				const auto length = route ? std::optional<double>{ route->length } : std::nullopt;
+				settled += route ? route->settledVertices : 0;
+				if (lengths.size() < positions.size())
+				{
+					lengths.push_back(length);
+				}
+				else if (length.has_value() != lengths[i].has_value() || (length && std::abs(*length - *lengths[i]) > 1e-6 * *length))
+				{
+					++mismatches;
+				}
+			}
+			const auto seconds = benchmark::ToMicroseconds(benchmark::Clock::now() - routesStart) / 1e6;
+			std::cout << ToString(algorithm) << ", " << settled / positions.size() << " vertices settled per route, "
+				<< mismatches << " lengths differing from " << ToString(Algorithms[0]) << "\n";
+			benchmark::PrintLatencies("routes", latencies, seconds);
+		}
+	}
+}
+
+namespace benchmark
+{
+	void RunRoutingBenchmark(const std::vector<std::string>& osmFileNames)
+	{
+		if (osmFileNames.empty())
+		{
+			std::cout << "Generating map...\n";
+			auto random = std::mt19937{ 7 };
+			RunRoutes(GenerateCityMap(random));
+			return;
+		}
+
+		for (const auto& osmFileName : osmFileNames)
+		{
+			std::cout << "Loading " << osmFileName << "...\n";
+			RunRoutes(Database::LoadMap(osmFileName));
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Database.h"
+#include "../GeoDb/ShardedDatabase.h"
+
+using namespace geodb;
+
+namespace
+{
+	struct ThroughputReport
+	{
+		std::vector<double> queryMicroseconds;
+		std::size_t results = 0;
+	};
+
+	// Runs client threads that send random window queries through `query` until the time is up
+	template<typename Query>
+	ThroughputReport RunClients(const benchmark::Options& options, Query&& query)
+	{
+		auto stop = std::atomic<bool>{ false };
+		auto latencies = std::vector<std::vector<double>>(options.threads);
+		auto results = std::vector<std::size_t>(options.threads);
+
+		auto threads = std::vector<std::thread>{};
+		for (auto i = 0; i < options.threads; ++i)
+		{
+			threads.emplace_back([&, i]
+			{
+				auto random = std::mt19937{ static_cast<unsigned>(i + 1) };
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					const auto window = benchmark::RandomWindow(random);
+					const auto start = benchmark::Clock::now();
+					results[i] += query(window);
+					latencies[i].push_back(benchmark::ToMicroseconds(benchmark::Clock::now() - start));
+				}
+			});
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(options.seconds));
+		stop.store(true);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		auto report = ThroughputReport{};
+		for (auto i = 0; i < options.threads; ++i)
+		{
+			report.queryMicroseconds.insert(report.queryMicroseconds.end(), latencies[i].begin(), latencies[i].end());
+			report.results += results[i];
+		}
+		return report;
+	}
+}
+
+namespace benchmark
+{
+	void RunShardingBenchmark(const Options& options)
+	{
+		std::cout << "Generating map...\n";
+		auto random = std::mt19937{ 7 };
+		const auto map = GenerateMap(random);
+
+		std::cout << "Running " << options.threads << " clients for " << options.seconds << " s each\n";
+
+		{
+			auto database = Database::FromMap(map);
+			auto report = RunClients(options, [&](const quadtree::Rectangle<double>& window)
+				{
+					return database.QueryObjects(window).size();
+				});
+			std::cout << "Unsharded Database (" << report.results << " results)\n";
+			PrintLatencies("queries", report.queryMicroseconds, options.seconds);
+		}
+
+		for (const auto shardsPerSide : { 1, 2, 4, 8 })
+		{
+			auto database = ShardedDatabase{ map, shardsPerSide };
+
+			auto windows = std::mt19937{ 1 };
+			auto shardsQueried = std::size_t{ 0 };
+			for (auto i = 0; i < 1000; ++i)
+			{
+				shardsQueried += database.CountShardsOverlapping(RandomWindow(windows));
+			}
+
+			auto report = RunClients(options, [&](const quadtree::Rectangle<double>& window)
+				{
+					return database.QueryObjects(window).size();
+				});
+			std::cout << database.GetShardCount() << " shards, " << shardsQueried / 1000.0 << " shards per query ("
+				<< report.results << " results)\n";
+			PrintLatencies("queries", report.queryMicroseconds, options.seconds);
+		}
+	}
+}
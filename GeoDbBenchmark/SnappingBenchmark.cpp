@@ -0,0 +1,108 @@
+#include <cmath>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "Benchmarks.h"
+
+#include "../GeoDb/Algo2d.h"
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+
+namespace
+{
+	constexpr auto TraceCount = 2000;
+	constexpr auto FixesPerTrace = 500;
+	constexpr auto FixSpacing = 15.0;
+	constexpr auto MaxSnapDistance = 50.0;
+
+	// Random walks over the map with a fix every few units, like GPS traces of vehicles
+	std::vector<Node> GenerateTraces(const quadtree::Rectangle<double>& area, std::mt19937& random)
+	{
+		auto x = std::uniform_real_distribution<double>{ area.GetCenterX() - area.GetHalfWidth(), area.GetCenterX() + area.GetHalfWidth() };
+		auto y = std::uniform_real_distribution<double>{ area.GetCenterY() - area.GetHalfHeight(), area.GetCenterY() + area.GetHalfHeight() };
+		auto turn = std::normal_distribution<double>{ 0.0, 0.3 };
+		auto fixes = std::vector<Node>{};
+		fixes.reserve(static_cast<std::size_t>(TraceCount) * FixesPerTrace);
+		for (auto trace = 0; trace < TraceCount; ++trace)
+		{
+			auto fixX = x(random);
+			auto fixY = y(random);
+			auto heading = turn(random) * 10.0;
+			for (auto i = 0; i < FixesPerTrace; ++i)
+			{
+				heading += turn(random);
+				fixX += FixSpacing * std::cos(heading);
+				fixY += FixSpacing * std::sin(heading);
+				fixes.emplace_back(fixX, fixY);
+			}
+		}
+		return fixes;
+	}
+
+	// What snapping costs without the batch API: a radius query per fix, then the nearest segment of the ways found
+	std::optional<double> SnapOne(Database& database, const Node& fix)
+	{
+		auto best = std::optional<double>{};
+		for (const auto& result : database.QueryRadius(fix.GetX(), fix.GetY(), MaxSnapDistance))
+		{
+			if (result.objectType != ObjectType::Way)
+			{
+				continue;
+			}
+			const auto& nodes = database.GetMap().GetWays()[result.objectId].GetNodes();
+			for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+			{
+				const auto& start = database.GetMap().GetNodes()[nodes[i]];
+				const auto& end = database.GetMap().GetNodes()[nodes[i + 1]];
+				const auto distance = algo::PointSegmentDistance(fix.GetX(), fix.GetY(), start.GetX(), start.GetY(), end.GetX(), end.GetY());
+				if (distance <= MaxSnapDistance && (!best || distance < *best))
+				{
+					best = distance;
+				}
+			}
+		}
+		return best;
+	}
+}
+
+namespace benchmark
+{
+	void RunSnappingBenchmark()
+	{
+		auto random = std::mt19937{ 3 };
+		std::cout << "Generating map...\n";
+		auto database = Database::FromMap(GenerateMap(random));
+		const auto fixes = GenerateTraces(database.GetIndexedArea(), random);
+
+		auto start = Clock::now();
+		auto expected = std::vector<std::optional<double>>{};
+		expected.reserve(fixes.size());
+		for (const auto& fix : fixes)
+		{
+			expected.push_back(SnapOne(database, fix));
+		}
+		const auto oneByOneSeconds = ToMicroseconds(Clock::now() - start) / 1e6;
+
+		start = Clock::now();
+		const auto snaps = database.SnapToWays(fixes, MaxSnapDistance);
+		const auto batchSeconds = ToMicroseconds(Clock::now() - start) / 1e6;
+
+		auto snapped = std::size_t{ 0 };
+		auto mismatches = std::size_t{ 0 };
+		for (std::size_t i = 0; i < fixes.size(); ++i)
+		{
+			snapped += snaps[i].has_value() ? 1 : 0;
+			if (snaps[i].has_value() != expected[i].has_value() || (snaps[i] && std::abs(snaps[i]->distance - *expected[i]) > 1e-9))
+			{
+				++mismatches;
+			}
+		}
+
+		std::cout << fixes.size() << " fixes, " << snapped << " within " << MaxSnapDistance << " of a way, "
+			<< mismatches << " snapped differently\n";
+		std::cout << "  one by one: " << fixes.size() / oneByOneSeconds << " fixes/s\n";
+		std::cout << "  batch: " << fixes.size() / batchSeconds << " fixes/s\n";
+	}
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.h"
+
+// Usage: GeoDbBenchmark concurrency|sharding|engines|polygons|routing|snapping|placement|export [threads] [seconds] [osm files...]
+int main(int argc, char** argv)
+{
+	auto options = benchmark::Options{ static_cast<int>(std::max(2u, std::thread::hardware_concurrency()) - 1), 10.0 };
+	if (argc > 2)
+	{
+		options.threads = std::atoi(argv[2]);
+	}
+	if (argc > 3)
+	{
+		options.seconds = std::atof(argv[3]);
+	}
+
+	const auto name = std::string_view{ argc > 1 ? argv[1] : "" };
+	if (name == "concurrency")
+	{
+		benchmark::RunConcurrencyBenchmark(options);
+	}
+	else if (name == "sharding")
+	{
+		benchmark::RunShardingBenchmark(options);
+	}
+	else if (name == "engines")
+	{
+		benchmark::RunEngineBenchmark(options, std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+	}
+	else if (name == "polygons")
+	{
+		benchmark::RunPolygonBenchmark(std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+	}
+	else if (name == "routing")
+	{
+		benchmark::RunRoutingBenchmark(std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+	}
+	else if (name == "snapping")
+	{
+		benchmark::RunSnappingBenchmark();
+	}
+	else if (name == "placement")
+	{
+		benchmark::RunPlacementBenchmark(options, std::vector<std::string>(argv + std::min(argc, 4), argv + argc));
+	}
+	else if (name == "export")
+	{
+		benchmark::RunExportBenchmark();
+	}
+	else
+	{
+		std::cout << "Usage: GeoDbBenchmark concurrency|sharding|engines|polygons|routing|snapping|placement|export [threads] [seconds] [osm files...]\n";
+		return 1;
+	}
+
+	return 0;
+}
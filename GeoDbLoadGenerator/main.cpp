@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../GeoDbServer/Protocol.h"
+
+using namespace geodb;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr std::size_t ReadChunkSize = 64 * 1024;
+	constexpr std::uint32_t NearestCount = 10;
+
+	struct Options
+	{
+		std::string host = "127.0.0.1";
+		std::string port = "7878";
+		int connections = 4;
+		int pipelineDepth = 16;
+		double seconds = 10.0;
+		// Side of the query windows relative to the side of the indexed area
+		double windowSize = 0.01;
+	};
+
+	struct Area
+	{
+		double minX = 0.0;
+		double minY = 0.0;
+		double maxX = 0.0;
+		double maxY = 0.0;
+	};
+
+	class Connection
+	{
+	public:
+		explicit Connection(const Options& options)
+		{
+			auto hints = addrinfo{};
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo* addresses = nullptr;
+			if (::getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &addresses) != 0)
+			{
+				throw std::runtime_error{ "Cannot resolve " + options.host };
+			}
+
+			for (auto address = addresses; address != nullptr && m_socket < 0; address = address->ai_next)
+			{
+				m_socket = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+				if (m_socket >= 0 && ::connect(m_socket, address->ai_addr, address->ai_addrlen) < 0)
+				{
+					::close(m_socket);
+					m_socket = -1;
+				}
+			}
+			::freeaddrinfo(addresses);
+			if (m_socket < 0)
+			{
+				throw std::system_error{ errno, std::generic_category(), "Cannot connect to the server" };
+			}
+
+			const auto noDelay = 1;
+			::setsockopt(m_socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		}
+
+		Connection(const Connection& other) = delete;
+
+		Connection& operator=(const Connection& other) = delete;
+
+		~Connection()
+		{
+			::close(m_socket);
+		}
+
+		void Send(const std::vector<std::byte>& buffer)
+		{
+			for (auto offset = std::size_t{ 0 }; offset < buffer.size(); )
+			{
+				const auto sent = ::send(m_socket, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+				if (sent < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw std::system_error{ errno, std::generic_category(), "Cannot send requests" };
+				}
+				offset += static_cast<std::size_t>(sent);
+			}
+		}
+
+		bool HasFrame() const
+		{
+			const auto available = std::span<const std::byte>{ m_input }.subspan(m_consumed);
+			const auto frameSize = protocol::GetFrameSize(available);
+			return frameSize != 0 && available.size() >= frameSize;
+		}
+
+		// Blocks until a whole response has arrived
+		std::span<const std::byte> ReceiveFrame()
+		{
+			while (!HasFrame())
+			{
+				m_input.erase(m_input.begin(), m_input.begin() + m_consumed);
+				m_consumed = 0;
+
+				const auto previousSize = m_input.size();
+				m_input.resize(previousSize + ReadChunkSize);
+				const auto received = ::recv(m_socket, m_input.data() + previousSize, ReadChunkSize, 0);
+				m_input.resize(previousSize + static_cast<std::size_t>(std::max<ssize_t>(received, 0)));
+				if (received == 0 || (received < 0 && errno != EINTR))
+				{
+					throw std::runtime_error{ "Connection closed by the server" };
+				}
+			}
+
+			const auto available = std::span<const std::byte>{ m_input }.subspan(m_consumed);
+			const auto frame = available.first(protocol::GetFrameSize(available));
+			m_consumed += frame.size();
+			return frame;
+		}
+
+	private:
+		int m_socket = -1;
+		std::vector<std::byte> m_input;
+		std::size_t m_consumed = 0;
+	};
+
+	Area QueryArea(const Options& options)
+	{
+		auto connection = Connection{ options };
+		auto buffer = std::vector<std::byte>{};
+		protocol::AppendRequest(protocol::Request{ 0, protocol::RequestType::Bounds }, buffer);
+		connection.Send(buffer);
+
+		const auto frame = connection.ReceiveFrame();
+		const auto header = protocol::ParseResponseHeader(frame);
+		if (header.status != protocol::Status::Ok || header.values != 4)
+		{
+			throw std::runtime_error{ "Server did not report its area" };
+		}
+
+		auto values = std::array<double, 4>{};
+		std::copy_n(frame.begin() + protocol::ResponseHeaderSize, sizeof(values), reinterpret_cast<std::byte*>(values.data()));
+		return Area{ values[0], values[1], values[2], values[3] };
+	}
+
+	// Mostly window queries, with some nearest neighbour and count queries
+	protocol::Request NextRequest(std::mt19937& random, const Area& area, double windowSize, std::uint32_t id)
+	{
+		auto x = std::uniform_real_distribution<double>{ area.minX, area.maxX };
+		auto y = std::uniform_real_distribution<double>{ area.minY, area.maxY };
+		auto kind = std::uniform_int_distribution<int>{ 0, 9 };
+
+		auto request = protocol::Request{ id };
+		const auto roll = kind(random);
+		if (roll == 0)
+		{
+			request.type = protocol::RequestType::Nearest;
+			request.x = x(random);
+			request.y = y(random);
+			request.k = NearestCount;
+			return request;
+		}
+
+		request.type = roll == 1 ? protocol::RequestType::Count : protocol::RequestType::Window;
+		request.window = quadtree::Rectangle<double>{
+			x(random),
+			y(random),
+			(area.maxX - area.minX) * windowSize / 2,
+			(area.maxY - area.minY) * windowSize / 2
+		};
+		return request;
+	}
+
+	struct Report
+	{
+		std::vector<double> latencies;
+		std::size_t results = 0;
+		std::size_t errors = 0;
+	};
+
+	// Keeps pipelineDepth requests in flight, requests issued while responses are still buffered go out together
+	Report RunConnection(const Options& options, const Area& area, unsigned seed)
+	{
+		auto connection = Connection{ options };
+		auto random = std::mt19937{ seed };
+		auto sendTimes = std::unordered_map<std::uint32_t, Clock::time_point>{};
+		auto outgoing = std::vector<std::byte>{};
+		auto nextId = std::uint32_t{ 0 };
+
+		const auto issue = [&]()
+			{
+				const auto request = NextRequest(random, area, options.windowSize, nextId++);
+				protocol::AppendRequest(request, outgoing);
+				sendTimes.emplace(request.id, Clock::now());
+			};
+
+		for (auto i = 0; i < options.pipelineDepth; ++i)
+		{
+			issue();
+		}
+		connection.Send(outgoing);
+		outgoing.clear();
+
+		auto report = Report{};
+		const auto end = Clock::now() + std::chrono::duration<double>(options.seconds);
+		while (!sendTimes.empty())
+		{
+			const auto header = protocol::ParseResponseHeader(connection.ReceiveFrame());
+			const auto sent = sendTimes.find(header.requestId);
+			if (sent == sendTimes.end())
+			{
+				throw std::runtime_error{ "Response to an unknown request" };
+			}
+			report.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent->second).count());
+			sendTimes.erase(sent);
+
+			if (header.status == protocol::Status::Ok)
+			{
+				report.results += header.count;
+			}
+			else
+			{
+				++report.errors;
+			}
+
+			if (Clock::now() < end)
+			{
+				issue();
+			}
+			if (!connection.HasFrame() && !outgoing.empty())
+			{
+				connection.Send(outgoing);
+				outgoing.clear();
+			}
+		}
+		return report;
+	}
+}
+
+// Usage: GeoDbLoadGenerator [host] [port] [connections] [pipeline depth] [seconds] [window size]
+int main(int argc, char** argv)
+{
+	auto options = Options{};
+	const auto argument = [&](int index) { return index < argc ? argv[index] : nullptr; };
+	if (argument(1) != nullptr)
+	{
+		options.host = argument(1);
+	}
+	if (argument(2) != nullptr)
+	{
+		options.port = argument(2);
+	}
+	if (argument(3) != nullptr)
+	{
+		options.connections = std::max(1, std::atoi(argument(3)));
+	}
+	if (argument(4) != nullptr)
+	{
+		options.pipelineDepth = std::max(1, std::atoi(argument(4)));
+	}
+	if (argument(5) != nullptr)
+	{
+		options.seconds = std::atof(argument(5));
+	}
+	if (argument(6) != nullptr)
+	{
+		options.windowSize = std::atof(argument(6));
+	}
+
+	try
+	{
+		const auto area = QueryArea(options);
+		std::cout << "Area [" << area.minX << ", " << area.minY << "] - [" << area.maxX << ", " << area.maxY << "]\n";
+		std::cout << "Running " << options.connections << " connections with " << options.pipelineDepth
+			<< " requests in flight each for " << options.seconds << " s\n";
+
+		auto reports = std::vector<Report>(options.connections);
+		auto failures = std::vector<std::string>(options.connections);
+		auto threads = std::vector<std::thread>{};
+		const auto start = Clock::now();
+		for (auto i = 0; i < options.connections; ++i)
+		{
+			threads.emplace_back([&, i]()
+			{
+				try
+				{
+					reports[i] = RunConnection(options, area, static_cast<unsigned>(i + 1));
+				}
+				catch (const std::exception& e)
+				{
+					failures[i] = e.what();
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		auto total = Report{};
+		for (auto i = 0; i < options.connections; ++i)
+		{
+			if (!failures[i].empty())
+			{
+				std::cout << "Connection " << i << " failed: " << failures[i] << "\n";
+			}
+			total.latencies.insert(total.latencies.end(), reports[i].latencies.begin(), reports[i].latencies.end());
+			total.results += reports[i].results;
+			total.errors += reports[i].errors;
+		}
+
+		auto& latencies = total.latencies;
+		std::cout << latencies.size() << " requests, " << latencies.size() / elapsed << " requests/s, "
+			<< total.results / elapsed << " results/s, " << total.errors << " errors\n";
+		if (!latencies.empty())
+		{
+			std::sort(latencies.begin(), latencies.end());
+			const auto percentile = [&](double p)
+				{
+					return latencies[static_cast<std::size_t>(p / 100.0 * static_cast<double>(latencies.size() - 1))];
+				};
+			std::cout
+				<< "Latency p50 " << percentile(50.0) << " us"
+				<< ", p90 " << percentile(90.0) << " us"
+				<< ", p99 " << percentile(99.0) << " us"
+				<< ", p99.9 " << percentile(99.9) << " us"
+				<< ", max " << latencies.back() << " us\n";
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "Error: " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
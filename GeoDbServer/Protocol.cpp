@@ -0,0 +1,163 @@
+#include "Protocol.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	template<typename T>
+	void Append(std::vector<std::byte>& buffer, T value)
+	{
+		const auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+		buffer.insert(buffer.end(), bytes.begin(), bytes.end());
+	}
+
+	template<typename T>
+	void Write(std::byte* destination, T value)
+	{
+		const auto bytes = std::bit_cast<std::array<std::byte, sizeof(T)>>(value);
+		std::copy(bytes.begin(), bytes.end(), destination);
+	}
+
+	template<typename T>
+	T Read(std::span<const std::byte> buffer, std::size_t& offset)
+	{
+		if (buffer.size() < offset + sizeof(T))
+		{
+			throw std::invalid_argument{ "Frame is too short" };
+		}
+		auto bytes = std::array<std::byte, sizeof(T)>{};
+		std::copy_n(buffer.begin() + offset, sizeof(T), bytes.begin());
+		offset += sizeof(T);
+		return std::bit_cast<T>(bytes);
+	}
+}
+
+namespace geodb::protocol
+{
+	ObjectKey ToObjectKey(const QueryResult& object)
+	{
+		return static_cast<ObjectKey>(object.objectId) << 1 | (object.objectType == ObjectType::Way ? 1 : 0);
+	}
+
+	QueryResult FromObjectKey(ObjectKey key)
+	{
+		return QueryResult{ static_cast<std::size_t>(key >> 1), (key & 1) != 0 ? ObjectType::Way : ObjectType::Node };
+	}
+
+	void AppendRequest(const Request& request, std::vector<std::byte>& buffer)
+	{
+		const auto start = buffer.size();
+		Append(buffer, std::uint32_t{ 0 });
+		Append(buffer, request.id);
+		Append(buffer, static_cast<std::uint8_t>(request.type));
+
+		switch (request.type)
+		{
+		case RequestType::Window:
+		case RequestType::Count:
+			Append(buffer, request.window.GetCenterX() - request.window.GetHalfWidth());
+			Append(buffer, request.window.GetCenterY() - request.window.GetHalfHeight());
+			Append(buffer, request.window.GetCenterX() + request.window.GetHalfWidth());
+			Append(buffer, request.window.GetCenterY() + request.window.GetHalfHeight());
+			break;
+		case RequestType::Nearest:
+			Append(buffer, request.x);
+			Append(buffer, request.y);
+			Append(buffer, request.k);
+			break;
+		case RequestType::Bounds:
+			break;
+		}
+
+		Write(buffer.data() + start, static_cast<std::uint32_t>(buffer.size() - start - LengthSize));
+	}
+
+	std::size_t GetFrameSize(std::span<const std::byte> buffer)
+	{
+		if (buffer.size() < LengthSize)
+		{
+			return 0;
+		}
+		auto offset = std::size_t{ 0 };
+		return LengthSize + Read<std::uint32_t>(buffer, offset);
+	}
+
+	Request ParseRequest(std::span<const std::byte> frame)
+	{
+		auto offset = LengthSize;
+		auto request = Request{};
+		request.id = Read<std::uint32_t>(frame, offset);
+		request.type = static_cast<RequestType>(Read<std::uint8_t>(frame, offset));
+
+		switch (request.type)
+		{
+		case RequestType::Window:
+		case RequestType::Count:
+		{
+			const auto minX = Read<double>(frame, offset);
+			const auto minY = Read<double>(frame, offset);
+			const auto maxX = Read<double>(frame, offset);
+			const auto maxY = Read<double>(frame, offset);
+			if (!std::isfinite(minX) || !std::isfinite(minY) || !std::isfinite(maxX) || !std::isfinite(maxY))
+			{
+				throw std::invalid_argument{ "Window corners must be finite" };
+			}
+			if (!(minX <= maxX && minY <= maxY))
+			{
+				throw std::invalid_argument{ "Window is empty" };
+			}
+			request.window = quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
+			break;
+		}
+		case RequestType::Nearest:
+			request.x = Read<double>(frame, offset);
+			request.y = Read<double>(frame, offset);
+			request.k = Read<std::uint32_t>(frame, offset);
+			if (!std::isfinite(request.x) || !std::isfinite(request.y))
+			{
+				throw std::invalid_argument{ "Point must be finite" };
+			}
+			break;
+		case RequestType::Bounds:
+			break;
+		default:
+			throw std::invalid_argument{ "Unknown request type" };
+		}
+
+		if (offset != frame.size())
+		{
+			throw std::invalid_argument{ "Frame is too long" };
+		}
+		return request;
+	}
+
+	std::uint32_t GetRequestId(std::span<const std::byte> frame)
+	{
+		auto offset = LengthSize;
+		return Read<std::uint32_t>(frame, offset);
+	}
+
+	std::array<std::byte, ResponseHeaderSize> MakeResponseHeader(const ResponseHeader& header)
+	{
+		const auto payloadBytes = static_cast<std::size_t>(header.values) * sizeof(std::uint64_t);
+		auto bytes = std::array<std::byte, ResponseHeaderSize>{};
+		Write(bytes.data(), static_cast<std::uint32_t>(ResponseHeaderSize - LengthSize + payloadBytes));
+		Write(bytes.data() + 4, header.requestId);
+		Write(bytes.data() + 8, static_cast<std::uint8_t>(header.status));
+		Write(bytes.data() + 9, header.count);
+		return bytes;
+	}
+
+	ResponseHeader ParseResponseHeader(std::span<const std::byte> frame)
+	{
+		auto offset = LengthSize;
+		auto header = ResponseHeader{};
+		header.requestId = Read<std::uint32_t>(frame, offset);
+		header.status = static_cast<Status>(Read<std::uint8_t>(frame, offset));
+		header.count = Read<std::uint32_t>(frame, offset);
+		header.values = static_cast<std::uint32_t>((frame.size() - ResponseHeaderSize) / sizeof(std::uint64_t));
+		return header;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "../GeoDb/QueryResult.h"
+#include "../Quadtree/Rectangle.h"
+
+// Every frame starts with a 32-bit length of the rest of the frame, all numbers are little-endian.
+// Request:  length, requestId u32, type u8, then minX minY maxX maxY f64 for Window and Count,
+//           or x y f64 and k u32 for Nearest, nothing for Bounds.
+// Response: length, requestId u32, status u8, count u32, then u64 values up to the frame length:
+//           count object keys for Window and Nearest, none for Count, whose count is the number of
+//           objects in the window, and the bits of minX minY maxX maxY f64 for Bounds.
+// Requests on one connection may be pipelined, their responses can arrive in any order
+namespace geodb::protocol
+{
+	static_assert(std::endian::native == std::endian::little, "Responses are written straight from memory");
+
+	enum struct RequestType : std::uint8_t
+	{
+		Window = 1,
+		Nearest = 2,
+		Count = 3,
+		Bounds = 4
+	};
+
+	enum struct Status : std::uint8_t
+	{
+		Ok = 0,
+		BadRequest = 1,
+		ServerError = 2
+	};
+
+	struct Request
+	{
+		std::uint32_t id = 0;
+		RequestType type = RequestType::Window;
+		quadtree::Rectangle<double> window = {};
+		double x = 0.0;
+		double y = 0.0;
+		std::uint32_t k = 0;
+	};
+
+	struct ResponseHeader
+	{
+		std::uint32_t requestId = 0;
+		Status status = Status::Ok;
+		std::uint32_t count = 0;
+		// Number of u64 values after the header, implied by the frame length
+		std::uint32_t values = 0;
+	};
+
+	constexpr std::size_t LengthSize = 4;
+	constexpr std::size_t RequestHeaderSize = LengthSize + 5;
+	constexpr std::size_t ResponseHeaderSize = LengthSize + 9;
+	constexpr std::size_t MaxRequestSize = RequestHeaderSize + 4 * sizeof(double);
+
+	// Objects travel as their id shifted left by one, with the low bit set for ways
+	using ObjectKey = std::uint64_t;
+
+	ObjectKey ToObjectKey(const QueryResult& object);
+
+	QueryResult FromObjectKey(ObjectKey key);
+
+	void AppendRequest(const Request& request, std::vector<std::byte>& buffer);
+
+	// Size of the frame at the start of the buffer, or zero if its length has not arrived yet
+	std::size_t GetFrameSize(std::span<const std::byte> buffer);
+
+	// Throws std::invalid_argument for frames that are not a valid request
+	Request ParseRequest(std::span<const std::byte> frame);
+
+	// The id of a frame of at least RequestHeaderSize bytes, so that invalid requests can be answered
+	std::uint32_t GetRequestId(std::span<const std::byte> frame);
+
+	std::array<std::byte, ResponseHeaderSize> MakeResponseHeader(const ResponseHeader& header);
+
+	ResponseHeader ParseResponseHeader(std::span<const std::byte> frame);
+}
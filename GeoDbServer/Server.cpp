@@ -0,0 +1,447 @@
+#include "Server.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace
+{
+	constexpr std::size_t ReadChunkSize = 64 * 1024;
+	constexpr std::size_t MaxEvents = 64;
+	constexpr std::size_t MaxIoVectors = 64;
+
+	[[noreturn]] void ThrowSystemError(const char* what)
+	{
+		throw std::system_error{ errno, std::generic_category(), what };
+	}
+}
+
+namespace geodb
+{
+	Server::Descriptor::Descriptor(Descriptor&& other) noexcept
+		: m_descriptor{ other.m_descriptor }
+	{
+		other.m_descriptor = -1;
+	}
+
+	Server::Descriptor& Server::Descriptor::operator=(Descriptor&& other) noexcept
+	{
+		std::swap(m_descriptor, other.m_descriptor);
+		return *this;
+	}
+
+	Server::Descriptor::~Descriptor()
+	{
+		if (m_descriptor >= 0)
+		{
+			::close(m_descriptor);
+		}
+	}
+
+	Server::Server(Database& database, std::uint16_t port, unsigned workerCount)
+		: m_database{ database }
+		, m_listener{ ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0) }
+		, m_epoll{ ::epoll_create1(EPOLL_CLOEXEC) }
+		, m_wakeUp{ ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) }
+	{
+		if (m_listener.Get() < 0 || m_epoll.Get() < 0 || m_wakeUp.Get() < 0)
+		{
+			ThrowSystemError("Cannot create the server descriptors");
+		}
+
+		const auto reuse = 1;
+		::setsockopt(m_listener.Get(), SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+		auto address = sockaddr_in{};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port = htons(port);
+		if (::bind(m_listener.Get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+			|| ::listen(m_listener.Get(), SOMAXCONN) < 0)
+		{
+			ThrowSystemError("Cannot listen on the port");
+		}
+
+		auto addressSize = static_cast<socklen_t>(sizeof(address));
+		::getsockname(m_listener.Get(), reinterpret_cast<sockaddr*>(&address), &addressSize);
+		m_port = ntohs(address.sin_port);
+
+		Watch(m_listener.Get(), ListenerId, false, true);
+		Watch(m_wakeUp.Get(), WakeUpId, false, true);
+
+		for (auto i = 0u; i < std::max(workerCount, 1u); ++i)
+		{
+			m_workers.emplace_back([this]() { RunWorker(); });
+		}
+	}
+
+	Server::~Server()
+	{
+		{
+			const auto lock = std::lock_guard{ m_jobsMutex };
+			m_stopping = true;
+		}
+		m_jobsAvailable.notify_all();
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	void Server::Run()
+	{
+		auto events = std::array<epoll_event, MaxEvents>{};
+		while (!m_stopRequested.load())
+		{
+			const auto count = ::epoll_wait(m_epoll.Get(), events.data(), static_cast<int>(events.size()), -1);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				ThrowSystemError("Cannot wait for events");
+			}
+
+			for (auto i = 0; i < count; ++i)
+			{
+				const auto id = events[i].data.u64;
+				if (id == ListenerId)
+				{
+					AcceptConnections();
+					continue;
+				}
+				if (id == WakeUpId)
+				{
+					auto signals = std::uint64_t{ 0 };
+					while (::read(m_wakeUp.Get(), &signals, sizeof(signals)) > 0)
+					{ }
+					DeliverResponses();
+					continue;
+				}
+
+				const auto connection = m_connections.find(id);
+				if (connection == m_connections.end())
+				{
+					continue;
+				}
+
+				auto open = true;
+				if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+				{
+					open = ReadRequests(id, connection->second);
+				}
+				if (open && (events[i].events & EPOLLOUT) != 0)
+				{
+					open = WriteResponses(id, connection->second);
+				}
+				if (!open)
+				{
+					m_connections.erase(connection);
+				}
+			}
+		}
+	}
+
+	void Server::Stop()
+	{
+		m_stopRequested.store(true);
+		WakeUp();
+	}
+
+	void Server::AcceptConnections()
+	{
+		while (true)
+		{
+			auto socket = Descriptor{ ::accept4(m_listener.Get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+			if (socket.Get() < 0)
+			{
+				return;
+			}
+
+			const auto noDelay = 1;
+			::setsockopt(socket.Get(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+			const auto id = m_nextConnectionId++;
+			Watch(socket.Get(), id, false, true);
+			m_connections.emplace(id, Connection{ std::move(socket) });
+		}
+	}
+
+	// Reads once per readiness event, so that a busy connection cannot starve the others
+	bool Server::ReadRequests(std::uint64_t connectionId, Connection& connection)
+	{
+		auto& input = connection.input;
+		const auto previousSize = input.size();
+		input.resize(previousSize + ReadChunkSize);
+		const auto received = ::recv(connection.socket.Get(), input.data() + previousSize, ReadChunkSize, 0);
+		if (received <= 0)
+		{
+			input.resize(previousSize);
+			return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+		}
+		input.resize(previousSize + static_cast<std::size_t>(received));
+
+		auto jobs = std::vector<Job>{};
+		auto consumed = std::size_t{ 0 };
+		while (true)
+		{
+			const auto available = std::span<const std::byte>{ input }.subspan(consumed);
+			const auto frameSize = protocol::GetFrameSize(available);
+			if (frameSize == 0)
+			{
+				break;
+			}
+			// A length this far off means the stream cannot be followed anymore
+			if (frameSize < protocol::RequestHeaderSize || frameSize > protocol::MaxRequestSize)
+			{
+				return false;
+			}
+			if (available.size() < frameSize)
+			{
+				break;
+			}
+
+			const auto frame = available.first(frameSize);
+			try
+			{
+				jobs.push_back(Job{ connectionId, protocol::ParseRequest(frame) });
+			}
+			catch (const std::invalid_argument&)
+			{
+				auto response = Response{ connectionId };
+				response.header = protocol::MakeResponseHeader(protocol::ResponseHeader{ protocol::GetRequestId(frame), protocol::Status::BadRequest });
+				connection.output.push_back(std::move(response));
+			}
+			consumed += frameSize;
+		}
+		input.erase(input.begin(), input.begin() + consumed);
+
+		if (!jobs.empty())
+		{
+			{
+				const auto lock = std::lock_guard{ m_jobsMutex };
+				m_jobs.insert(m_jobs.end(), jobs.begin(), jobs.end());
+			}
+			m_jobsAvailable.notify_all();
+		}
+		return connection.output.empty() || WriteResponses(connectionId, connection);
+	}
+
+	// Sends as many queued responses as the socket takes, headers and result arrays go out without copying
+	bool Server::WriteResponses(std::uint64_t connectionId, Connection& connection)
+	{
+		auto& output = connection.output;
+		while (!output.empty())
+		{
+			auto vectors = std::array<iovec, MaxIoVectors>{};
+			auto vectorCount = std::size_t{ 0 };
+			for (auto& response : output)
+			{
+				if (vectorCount + 2 > vectors.size())
+				{
+					break;
+				}
+
+				const auto payload = std::as_bytes(std::span{ response.values });
+				if (response.written < response.header.size())
+				{
+					vectors[vectorCount++] = iovec{ response.header.data() + response.written, response.header.size() - response.written };
+					if (!payload.empty())
+					{
+						vectors[vectorCount++] = iovec{ const_cast<std::byte*>(payload.data()), payload.size() };
+					}
+				}
+				else
+				{
+					const auto payloadWritten = response.written - response.header.size();
+					vectors[vectorCount++] = iovec{ const_cast<std::byte*>(payload.data()) + payloadWritten, payload.size() - payloadWritten };
+				}
+			}
+
+			auto message = msghdr{};
+			message.msg_iov = vectors.data();
+			message.msg_iovlen = vectorCount;
+			const auto sent = ::sendmsg(connection.socket.Get(), &message, MSG_NOSIGNAL);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					return false;
+				}
+				break;
+			}
+
+			auto remaining = static_cast<std::size_t>(sent);
+			while (remaining > 0)
+			{
+				auto& response = output.front();
+				const auto left = response.GetSize() - response.written;
+				if (remaining < left)
+				{
+					response.written += remaining;
+					break;
+				}
+				remaining -= left;
+				output.pop_front();
+			}
+		}
+
+		const auto waitToWrite = !output.empty();
+		if (waitToWrite != connection.waitingToWrite)
+		{
+			Watch(connection.socket.Get(), connectionId, waitToWrite, false);
+			connection.waitingToWrite = waitToWrite;
+		}
+		return true;
+	}
+
+	// Responses for connections that were closed in the meantime are dropped
+	void Server::DeliverResponses()
+	{
+		auto responses = std::vector<Response>{};
+		{
+			const auto lock = std::lock_guard{ m_responsesMutex };
+			responses.swap(m_responses);
+		}
+
+		auto connectionIds = std::vector<std::uint64_t>{};
+		for (auto& response : responses)
+		{
+			const auto connection = m_connections.find(response.connectionId);
+			if (connection != m_connections.end())
+			{
+				connectionIds.push_back(response.connectionId);
+				connection->second.output.push_back(std::move(response));
+			}
+		}
+
+		std::sort(connectionIds.begin(), connectionIds.end());
+		connectionIds.erase(std::unique(connectionIds.begin(), connectionIds.end()), connectionIds.end());
+		for (const auto id : connectionIds)
+		{
+			const auto connection = m_connections.find(id);
+			if (!connection->second.waitingToWrite && !WriteResponses(id, connection->second))
+			{
+				m_connections.erase(connection);
+			}
+		}
+	}
+
+	void Server::RunWorker()
+	{
+		while (true)
+		{
+			auto job = Job{};
+			{
+				auto lock = std::unique_lock{ m_jobsMutex };
+				m_jobsAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if (m_stopping)
+				{
+					return;
+				}
+				job = m_jobs.front();
+				m_jobs.pop_front();
+			}
+
+			auto response = Execute(job);
+
+			// The event loop takes all queued responses at once, so only the first one needs to wake it up
+			auto wasEmpty = false;
+			{
+				const auto lock = std::lock_guard{ m_responsesMutex };
+				wasEmpty = m_responses.empty();
+				m_responses.push_back(std::move(response));
+			}
+			if (wasEmpty)
+			{
+				WakeUp();
+			}
+		}
+	}
+
+	Server::Response Server::Execute(const Job& job)
+	{
+		using protocol::RequestType;
+
+		const auto& request = job.request;
+		auto response = Response{ job.connectionId };
+		auto header = protocol::ResponseHeader{ request.id };
+		try
+		{
+			switch (request.type)
+			{
+			case RequestType::Window:
+				for (const auto& object : m_database.QueryObjects(request.window))
+				{
+					response.values.push_back(protocol::ToObjectKey(object));
+				}
+				header.count = static_cast<std::uint32_t>(response.values.size());
+				break;
+			case RequestType::Nearest:
+				for (const auto& object : m_database.QueryNearest(request.x, request.y, request.k))
+				{
+					response.values.push_back(protocol::ToObjectKey(QueryResult{ object.objectId, object.objectType }));
+				}
+				header.count = static_cast<std::uint32_t>(response.values.size());
+				break;
+			case RequestType::Count:
+				header.count = static_cast<std::uint32_t>(m_database.QueryObjects(request.window).size());
+				break;
+			case RequestType::Bounds:
+			{
+				const auto& area = m_database.GetIndexedArea();
+				for (const auto value : {
+					area.GetCenterX() - area.GetHalfWidth(),
+					area.GetCenterY() - area.GetHalfHeight(),
+					area.GetCenterX() + area.GetHalfWidth(),
+					area.GetCenterY() + area.GetHalfHeight() })
+				{
+					response.values.push_back(std::bit_cast<std::uint64_t>(value));
+				}
+				break;
+			}
+			}
+		}
+		catch (const std::exception&)
+		{
+			response.values.clear();
+			header = protocol::ResponseHeader{ request.id, protocol::Status::ServerError };
+		}
+
+		header.values = static_cast<std::uint32_t>(response.values.size());
+		response.header = protocol::MakeResponseHeader(header);
+		return response;
+	}
+
+	void Server::WakeUp()
+	{
+		const auto signal = std::uint64_t{ 1 };
+		[[maybe_unused]] const auto written = ::write(m_wakeUp.Get(), &signal, sizeof(signal));
+	}
+
+	void Server::Watch(int descriptor, std::uint64_t id, bool writable, bool added)
+	{
+		auto event = epoll_event{};
+		event.events = EPOLLIN | (writable ? EPOLLOUT : 0u);
+		event.data.u64 = id;
+		if (::epoll_ctl(m_epoll.Get(), added ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, descriptor, &event) < 0)
+		{
+			ThrowSystemError("Cannot watch the descriptor");
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Protocol.h"
+#include "../GeoDb/Database.h"
+
+namespace geodb
+{
+	// Serves queries on a database over TCP using epoll, so it runs on Linux only. One thread runs the event loop
+	// over all connections and parses pipelined requests, a pool of workers runs the queries, and responses are
+	// written with scatter-gather sends straight from the result arrays. The database must not change meanwhile
+	class Server
+	{
+	public:
+		// Port 0 picks a free port, see GetPort
+		Server(Database& database, std::uint16_t port, unsigned workerCount);
+
+		Server(const Server& other) = delete;
+
+		Server& operator=(const Server& other) = delete;
+
+		~Server();
+
+		std::uint16_t GetPort() const { return m_port; }
+
+		// Serves connections until Stop is called
+		void Run();
+
+		// Can be called from any thread
+		void Stop();
+
+	private:
+		class Descriptor
+		{
+		public:
+			explicit Descriptor(int descriptor = -1)
+				: m_descriptor{ descriptor }
+			{ }
+
+			Descriptor(Descriptor&& other) noexcept;
+
+			Descriptor& operator=(Descriptor&& other) noexcept;
+
+			~Descriptor();
+
+			int Get() const { return m_descriptor; }
+
+		private:
+			int m_descriptor;
+		};
+
+		struct Job
+		{
+			std::uint64_t connectionId;
+			protocol::Request request;
+		};
+
+		struct Response
+		{
+			std::uint64_t connectionId = 0;
+			std::array<std::byte, protocol::ResponseHeaderSize> header = {};
+			std::vector<std::uint64_t> values = {};
+			std::size_t written = 0;
+
+			std::size_t GetSize() const { return header.size() + values.size() * sizeof(std::uint64_t); }
+		};
+
+		struct Connection
+		{
+			Descriptor socket;
+			std::vector<std::byte> input = {};
+			std::deque<Response> output = {};
+			bool waitingToWrite = false;
+		};
+
+		static constexpr std::uint64_t ListenerId = 0;
+		static constexpr std::uint64_t WakeUpId = 1;
+
+		void AcceptConnections();
+
+		bool ReadRequests(std::uint64_t connectionId, Connection& connection);
+
+		bool WriteResponses(std::uint64_t connectionId, Connection& connection);
+
+		void DeliverResponses();
+
+		void RunWorker();
+
+		Response Execute(const Job& job);
+
+		void WakeUp();
+
+		void Watch(int descriptor, std::uint64_t id, bool writable, bool added);
+
+	private:
+		Database& m_database;
+		Descriptor m_listener;
+		Descriptor m_epoll;
+		Descriptor m_wakeUp;
+		std::uint16_t m_port = 0;
+		std::atomic<bool> m_stopRequested = false;
+
+		// Only used by the event loop
+		std::unordered_map<std::uint64_t, Connection> m_connections;
+		std::uint64_t m_nextConnectionId = WakeUpId + 1;
+
+		std::mutex m_jobsMutex;
+		std::condition_variable m_jobsAvailable;
+		std::deque<Job> m_jobs;
+		bool m_stopping = false;
+
+		std::mutex m_responsesMutex;
+		std::vector<Response> m_responses;
+
+		std::vector<std::thread> m_workers;
+	};
+}
@@ -0,0 +1,27 @@
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "Server.h"
+
+// Usage: GeoDbServer <map.osm> [port] [workers]
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: GeoDbServer <map.osm> [port] [workers]\n";
+		return 1;
+	}
+
+	const auto port = static_cast<std::uint16_t>(argc > 2 ? std::atoi(argv[2]) : 7878);
+	const auto workers = argc > 3 ? static_cast<unsigned>(std::atoi(argv[3])) : std::thread::hardware_concurrency();
+
+	std::cout << "Loading " << argv[1] << "...\n";
+	auto database = geodb::Database::FromFile(argv[1]);
+
+	auto server = geodb::Server{ database, port, workers };
+	std::cout << "Listening on port " << server.GetPort() << " with " << workers << " workers\n";
+	server.Run();
+
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "../GeoDb/CompactBoundingBox.h"
+
+using namespace geodb;
+
+namespace
+{
+    // Distance from the value to the next float away from zero, the most rounding outwards may add
+    double FloatSpacing(double value)
+    {
+        const auto rounded = std::abs(static_cast<float>(value));
+        return static_cast<double>(std::nextafter(rounded, std::numeric_limits<float>::infinity())) - rounded;
+    }
+}
+
+TEST(CompactBoundingBoxTest, RoundsOutwardsByAtMostOneFloatStep)
+{
+    auto random = std::mt19937{ 3 };
+    auto position = std::uniform_real_distribution<double>{ -20000.0, 20000.0 };
+    auto side = std::uniform_real_distribution<double>{ 0.0, 50.0 };
+    const auto originX = 1234.5678;
+    const auto originY = -8765.4321;
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        const auto box = quadtree::Rectangle<double>{ position(random), position(random), side(random), side(random) };
+        const auto compact = CompactBoundingBox::Of(7, ObjectType::Way, box, originX, originY);
+
+        const auto minX = box.GetCenterX() - box.GetHalfWidth() - originX;
+        const auto minY = box.GetCenterY() - box.GetHalfHeight() - originY;
+        const auto maxX = box.GetCenterX() + box.GetHalfWidth() - originX;
+        const auto maxY = box.GetCenterY() + box.GetHalfHeight() - originY;
+        ASSERT_LE(compact.GetMinX(), minX);
+        ASSERT_LE(compact.GetMinY(), minY);
+        ASSERT_GE(compact.GetMaxX(), maxX);
+        ASSERT_GE(compact.GetMaxY(), maxY);
+        ASSERT_LE(minX - compact.GetMinX(), FloatSpacing(minX));
+        ASSERT_LE(minY - compact.GetMinY(), FloatSpacing(minY));
+        ASSERT_LE(compact.GetMaxX() - maxX, FloatSpacing(maxX));
+        ASSERT_LE(compact.GetMaxY() - maxY, FloatSpacing(maxY));
+    }
+}
+
+TEST(CompactBoundingBoxTest, KeepsValuesExactInFloat)
+{
+    EXPECT_EQ(CompactBoundingBox::RoundDown(0.5), 0.5f);
+    EXPECT_EQ(CompactBoundingBox::RoundUp(-1024.0), -1024.0f);
+    EXPECT_LT(CompactBoundingBox::RoundDown(0.1), 0.1);
+    EXPECT_GT(CompactBoundingBox::RoundUp(0.1), 0.1);
+}
+
+TEST(CompactBoundingBoxTest, ReportsTheStoredBoundsExactly)
+{
+    const auto compact = CompactBoundingBox{ 3, ObjectType::Node, -1.1f, 2.2f, 3.3f, 4.4f };
+
+    EXPECT_EQ(compact.GetCenterX() - compact.GetHalfWidth(), static_cast<double>(-1.1f));
+    EXPECT_EQ(compact.GetCenterX() + compact.GetHalfWidth(), static_cast<double>(3.3f));
+    EXPECT_EQ(compact.GetCenterY() - compact.GetHalfHeight(), static_cast<double>(2.2f));
+    EXPECT_EQ(compact.GetCenterY() + compact.GetHalfHeight(), static_cast<double>(4.4f));
+}
+
+TEST(CompactBoundingBoxTest, PacksObjectIndexAndType)
+{
+    const auto way = CompactBoundingBox{ CompactBoundingBox::MaxObjectIndex, ObjectType::Way, 0.0f, 0.0f, 1.0f, 1.0f };
+    EXPECT_EQ(way.GetObjectIndex(), CompactBoundingBox::MaxObjectIndex);
+    EXPECT_EQ(way.GetObjectType(), ObjectType::Way);
+
+    const auto node = CompactBoundingBox{ 12345, ObjectType::Node, 0.0f, 0.0f, 1.0f, 1.0f };
+    EXPECT_EQ(node.GetObjectIndex(), 12345u);
+    EXPECT_EQ(node.GetObjectType(), ObjectType::Node);
+
+    EXPECT_THROW((CompactBoundingBox{ CompactBoundingBox::MaxObjectIndex + 1, ObjectType::Way, 0.0f, 0.0f, 1.0f, 1.0f }), std::out_of_range);
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/CompressedGeometry.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    using Vertices = std::vector<std::pair<double, double>>;
+
+    Vertices Decode(const CompressedGeometry& geometry, std::size_t wayId)
+    {
+        auto vertices = Vertices{};
+        auto decoder = CompressedGeometry::Decoder{ geometry, wayId };
+        for (auto count = decoder.Next(); count != 0; count = decoder.Next())
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                vertices.emplace_back(decoder.GetX()[i], decoder.GetY()[i]);
+            }
+        }
+        return vertices;
+    }
+
+    void ExpectWithinResolution(const CompressedGeometry& geometry, const Map& map)
+    {
+        const auto tolerance = geometry.GetResolution() / 2.0 * (1.0 + 1e-6);
+        for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+        {
+            const auto& nodes = map.GetWays()[way].GetNodes();
+            const auto vertices = Decode(geometry, way);
+            ASSERT_EQ(vertices.size(), nodes.size());
+            EXPECT_EQ(geometry.GetVertexCount(way), nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+            {
+                EXPECT_LE(std::abs(vertices[i].first - map.GetNodes()[nodes[i]].GetX()), tolerance) << way << ":" << i;
+                EXPECT_LE(std::abs(vertices[i].second - map.GetNodes()[nodes[i]].GetY()), tolerance) << way << ":" << i;
+            }
+        }
+    }
+
+    // Ways longer than a decoder block, one creeping by single steps of the resolution so that whole words of one
+    // byte deltas come up, one jumping far between vertices, and the short random ones
+    Map WayMap()
+    {
+        auto random = std::mt19937{ 6 };
+        auto map = RandomMap(random, 0, 100);
+
+        auto creeping = std::vector<std::size_t>{};
+        auto jumping = std::vector<std::size_t>{};
+        auto jump = std::uniform_real_distribution<double>{ -1e5, 1e5 };
+        for (auto i = 0; i < 150; ++i)
+        {
+            creeping.push_back(AddNode(map, 500.0 + i * 1e-4, 500.0 - (i % 7) * 1e-4));
+            jumping.push_back(AddNode(map, jump(random), jump(random)));
+        }
+        AddWay(map, std::move(creeping));
+        AddWay(map, std::move(jumping));
+        AddWay(map, { AddNode(map, 1.0, 2.0) });
+        return map;
+    }
+}
+
+TEST(CompressedGeometryTest, DecodesWithinHalfTheResolution)
+{
+    const auto map = WayMap();
+    for (const auto resolution : { CompressedGeometry::DefaultResolution, 0.5 })
+    {
+        const auto geometry = CompressedGeometry::FromMap(map, resolution);
+        EXPECT_EQ(geometry.GetWayCount(), map.GetWays().size());
+        ExpectWithinResolution(geometry, map);
+    }
+}
+
+// Steps of one resolution unit take a byte per coordinate, past the first vertex which is relative to the origin
+TEST(CompressedGeometryTest, EncodesSmallStepsInTwoBytes)
+{
+    auto map = Map{};
+    auto nodes = std::vector<std::size_t>{};
+    for (auto i = 0; i < 150; ++i)
+    {
+        nodes.push_back(AddNode(map, 500.0 + i * 0.5, 500.0 - (i % 7) * 0.5));
+    }
+    AddWay(map, std::move(nodes));
+
+    const auto geometry = CompressedGeometry::FromMap(map, 0.5);
+    EXPECT_LE(geometry.GetEncodedBytes(), 2 * 149 + 2 * 10u);
+    ExpectWithinResolution(geometry, map);
+}
+
+TEST(CompressedGeometryTest, ReplacesWaysAndReclaimsTheirBytes)
+{
+    auto map = WayMap();
+    auto geometry = CompressedGeometry::FromMap(map);
+    const auto encodedBytes = geometry.GetEncodedBytes();
+
+    for (auto round = 0; round < 5; ++round)
+    {
+        for (std::size_t way = 0; way < map.GetWays().size(); way += 2)
+        {
+            for (const auto node : map.GetWays()[way].GetNodes())
+            {
+                auto& position = map.GetNodes()[node];
+                position = Node{ position.GetX() + 1.0, position.GetY() - 1.0 };
+            }
+            geometry.SetWay(way, map.GetWays()[way], map);
+        }
+    }
+    AddWay(map, { AddNode(map, 3.0, 4.0), AddNode(map, 5.0, 6.0) });
+    geometry.SetWay(map.GetWays().size() - 1, map.GetWays().back(), map);
+
+    ExpectWithinResolution(geometry, map);
+    EXPECT_LT(geometry.GetEncodedBytes(), encodedBytes + 100);
+    EXPECT_LE(geometry.GetAllocatedBytes(), 4 * encodedBytes + geometry.GetWayCount() * 16 + 1024);
+}
+
+TEST(CompressedGeometryTest, RoundTripsThroughWriteAndRead)
+{
+    auto map = WayMap();
+    auto geometry = CompressedGeometry::FromMap(map, 0.01);
+    map.GetNodes()[map.GetWays()[0].GetNodes()[0]] = Node{ -20.0, 30.0 };
+    geometry.SetWay(0, map.GetWays()[0], map);
+
+    auto stream = std::stringstream{};
+    geometry.Write(stream);
+    const auto restored = CompressedGeometry::Read(stream);
+
+    EXPECT_EQ(restored.GetResolution(), geometry.GetResolution());
+    EXPECT_EQ(restored.GetWayCount(), geometry.GetWayCount());
+    EXPECT_EQ(restored.GetEncodedBytes(), geometry.GetEncodedBytes());
+    for (std::size_t way = 0; way < geometry.GetWayCount(); ++way)
+    {
+        EXPECT_EQ(Decode(restored, way), Decode(geometry, way));
+    }
+}
+
+TEST(CompressedGeometryTest, RejectsDamagedFiles)
+{
+    const auto geometry = CompressedGeometry::FromMap(WayMap());
+    auto stream = std::stringstream{};
+    geometry.Write(stream);
+    const auto bytes = stream.str();
+
+    auto truncated = std::stringstream{ bytes.substr(0, bytes.size() - 1) };
+    EXPECT_THROW(CompressedGeometry::Read(truncated), std::runtime_error);
+    auto header = std::stringstream{ bytes.substr(0, 10) };
+    EXPECT_THROW(CompressedGeometry::Read(header), std::runtime_error);
+    auto foreign = std::stringstream{ std::string{ "not geometry" } + bytes };
+    EXPECT_THROW(CompressedGeometry::Read(foreign), std::runtime_error);
+
+    EXPECT_THROW((CompressedGeometry{ 0.0, 0.0, 0.0 }), std::invalid_argument);
+}
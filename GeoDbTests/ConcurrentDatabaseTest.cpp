@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/ConcurrentDatabase.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    const auto Left = quadtree::Rectangle<double>{ 100.0, 500.0, 10.0, 10.0 };
+    const auto Right = quadtree::Rectangle<double>{ 900.0, 500.0, 10.0, 10.0 };
+
+    // Moves the two nodes of the map together into the window
+    MapChanges MoveBothInto(const quadtree::Rectangle<double>& window)
+    {
+        const auto tags = std::vector<Tag>{ Tag{ "amenity", "cafe" } };
+        auto changes = MapChanges{};
+        changes.nodes.push_back(NodeChange{ 1, false, window.GetCenterX() - 1.0, window.GetCenterY(), tags });
+        changes.nodes.push_back(NodeChange{ 2, false, window.GetCenterX() + 1.0, window.GetCenterY(), tags });
+        return changes;
+    }
+
+    Map PairMap()
+    {
+        auto map = Map{};
+        map.AddTagToObject(AddNode(map, 0.0, 0.0), ObjectType::Node, "amenity", "cafe");
+        map.AddTagToObject(AddNode(map, 1000.0, 1000.0), ObjectType::Node, "amenity", "cafe");
+        return map;
+    }
+}
+
+TEST(ConcurrentDatabaseTest, BringsBothCopiesUpToDate)
+{
+    auto random = std::mt19937{ 2 };
+    const auto map = RandomMap(random, 500, 100);
+    auto database = ConcurrentDatabase{ map };
+    auto reference = Database::FromMap(map);
+
+    // Each change is applied to the copy serving reads first, so the second one is served by the other copy
+    for (auto i = 0; i < 2; ++i)
+    {
+        auto changes = MapChanges{};
+        for (std::size_t node = i; node < map.GetNodes().size(); node += 5)
+        {
+            const auto* tags = map.GetObjectTags(node, ObjectType::Node);
+            changes.nodes.push_back(NodeChange{
+                static_cast<OsmId>(node + 1), false, 1000.0 - map.GetNodes()[node].GetX(), map.GetNodes()[node].GetY(),
+                tags != nullptr ? *tags : std::vector<Tag>{}
+            });
+        }
+        changes.ways.push_back(WayChange{ static_cast<OsmId>(i + 1), true, {}, {} });
+        EXPECT_EQ(database.ApplyChanges(changes).nodesModified, reference.ApplyChanges(changes).nodesModified);
+
+        for (auto j = 0; j < 50; ++j)
+        {
+            const auto window = RandomWindow(random);
+            EXPECT_EQ(Sorted(database.Query(window)), Sorted(reference.Query(window)));
+        }
+    }
+}
+
+TEST(ConcurrentDatabaseTest, ReadersSeeChangesWhole)
+{
+    auto database = ConcurrentDatabase{ PairMap() };
+    database.ApplyChanges(MoveBothInto(Left));
+
+    auto stop = std::atomic<bool>{ false };
+    auto torn = std::atomic<int>{ 0 };
+    auto readers = std::vector<std::thread>{};
+    for (auto i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]
+        {
+            while (!stop.load())
+            {
+                const auto left = database.Query(Left).size();
+                const auto snapshot = database.Read([](Database& copy)
+                {
+                    return copy.Query(Left).size() + copy.Query(Right).size();
+                });
+                torn += (left == 0 || left == 2) && snapshot == 2 ? 0 : 1;
+            }
+        });
+    }
+
+    for (auto i = 0; i < 500; ++i)
+    {
+        database.ApplyChanges(MoveBothInto(i % 2 == 0 ? Right : Left));
+    }
+    stop.store(true);
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(database.Query(Left).size(), 2u);
+}
+
+TEST(ConcurrentDatabaseTest, WritersWaitForReadersOfTheOldCopy)
+{
+    auto database = ConcurrentDatabase{ PairMap() };
+    database.ApplyChanges(MoveBothInto(Left));
+
+    auto written = std::atomic<bool>{ false };
+    auto writer = std::thread{};
+    database.Read([&](Database& copy)
+    {
+        writer = std::thread{ [&]
+        {
+            database.ApplyChanges(MoveBothInto(Right));
+            written.store(true);
+        } };
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+
+        EXPECT_FALSE(written.load());
+        EXPECT_EQ(copy.Query(Left).size(), 2u);
+        EXPECT_TRUE(copy.Query(Right).empty());
+    });
+    writer.join();
+
+    EXPECT_TRUE(written.load());
+    EXPECT_TRUE(database.Query(Left).empty());
+    EXPECT_EQ(database.Query(Right).size(), 2u);
+}
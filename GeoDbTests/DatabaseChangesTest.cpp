@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    std::vector<Tag> TagsOf(const Map& map, std::size_t objectId, ObjectType objectType)
+    {
+        const auto* tags = map.GetObjectTags(objectId, objectType);
+        return tags != nullptr ? *tags : std::vector<Tag>{};
+    }
+
+    // Moves nodes, some of them by a little only, rewrites and deletes ways and deletes and creates nodes and ways
+    MapChanges RandomChanges(const Map& map, std::mt19937& random)
+    {
+        auto pickNode = std::uniform_int_distribution<std::size_t>{ 0, map.GetNodes().size() - 1 };
+        auto pickWay = std::uniform_int_distribution<std::size_t>{ 0, map.GetWays().size() - 1 };
+        auto coordinate = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+        auto nudge = std::uniform_real_distribution<double>{ -1.0, 1.0 };
+
+        auto changes = MapChanges{};
+        for (auto i = 0; i < 200; ++i)
+        {
+            const auto node = pickNode(random);
+            const auto& position = map.GetNodes()[node];
+            const auto x = i % 2 == 0 ? coordinate(random) : position.GetX() + nudge(random);
+            const auto y = i % 2 == 0 ? coordinate(random) : position.GetY() + nudge(random);
+            changes.nodes.push_back(NodeChange{ static_cast<OsmId>(node + 1), false, x, y, TagsOf(map, node, ObjectType::Node) });
+        }
+        for (auto i = 0; i < 20; ++i)
+        {
+            const auto node = pickNode(random);
+            changes.nodes.push_back(NodeChange{ static_cast<OsmId>(node + 1), true, 0.0, 0.0, {} });
+        }
+        const auto firstNewNode = static_cast<OsmId>(map.GetNodes().size() + 1);
+        for (auto i = 0; i < 20; ++i)
+        {
+            changes.nodes.push_back(NodeChange{
+                firstNewNode + i, false, coordinate(random), coordinate(random), { Tag{ "amenity", "bench" } }
+            });
+        }
+
+        for (auto i = 0; i < 30; ++i)
+        {
+            const auto way = pickWay(random);
+            auto nodes = std::vector<OsmId>{};
+            for (auto j = 0; j < 3; ++j)
+            {
+                nodes.push_back(static_cast<OsmId>(pickNode(random) + 1));
+            }
+            changes.ways.push_back(WayChange{ static_cast<OsmId>(way + 1), false, std::move(nodes), TagsOf(map, way, ObjectType::Way) });
+        }
+        for (auto i = 0; i < 30; ++i)
+        {
+            changes.ways.push_back(WayChange{ static_cast<OsmId>(pickWay(random) + 1), true, {}, {} });
+        }
+        const auto firstNewWay = static_cast<OsmId>(map.GetWays().size() + 1);
+        for (auto i = 0; i < 10; ++i)
+        {
+            changes.ways.push_back(WayChange{ firstNewWay + i, false, { firstNewNode + i, firstNewNode + i + 1 }, {} });
+        }
+        return changes;
+    }
+}
+
+TEST(DatabaseChangesTest, MatchesBruteForceAfterChanges)
+{
+    auto random = std::mt19937{ 1 };
+    const auto map = RandomMap(random, 2000, 500);
+    auto windows = std::vector<quadtree::Rectangle<double>>{};
+    for (auto i = 0; i < 300; ++i)
+    {
+        windows.push_back(RandomWindow(random));
+    }
+
+    for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+    {
+        auto uncached = Database::FromMap(map, engine);
+        auto cached = Database::FromMap(map, engine);
+        cached.EnableQueryCache(25.0, 1000000);
+        for (const auto& window : windows)
+        {
+            cached.Query(window);
+        }
+
+        const auto changes = RandomChanges(map, random);
+        const auto summary = uncached.ApplyChanges(changes);
+        cached.ApplyChanges(changes);
+        EXPECT_GT(summary.waysReindexed, 0u);
+        EXPECT_GT(summary.waysDeleted, 0u);
+        EXPECT_EQ(summary.nodesCreated, 20u);
+        EXPECT_EQ(summary.waysCreated, 10u);
+
+        for (const auto& window : windows)
+        {
+            const auto expected = Sorted(BruteForceQuery(uncached.GetMap(), window));
+            EXPECT_EQ(Sorted(uncached.Query(window)), expected);
+            EXPECT_EQ(Sorted(cached.Query(window)), expected);
+        }
+    }
+}
+
+// Moving the corner of a U onto its other end turns it around without changing its bounding box
+TEST(DatabaseChangesTest, InvalidatesCachedWaysWhoseBoundingBoxStayed)
+{
+    auto map = Map{};
+    AddWay(map, { AddNode(map, 0.0, 10.0), AddNode(map, 0.0, 0.0), AddNode(map, 10.0, 0.0), AddNode(map, 10.0, 10.0) });
+    auto database = Database::FromMap(std::move(map));
+    database.EnableQueryCache(1.0, 1000);
+
+    const auto window = quadtree::Rectangle<double>::Of(-2.0, 7.0, 5.0, 4.0);
+    ASSERT_EQ(database.Query(window), std::vector<std::size_t>{ 0 });
+
+    auto changes = MapChanges{};
+    changes.nodes.push_back(NodeChange{ 2, false, 10.0, 10.0, {} });
+    const auto summary = database.ApplyChanges(changes);
+
+    EXPECT_EQ(summary.waysReindexed, 0u);
+    EXPECT_TRUE(database.Query(window).empty());
+    database.DisableQueryCache();
+    EXPECT_TRUE(database.Query(window).empty());
+}
+
+TEST(DatabaseChangesTest, GrowsTheAreaWithObjectsCreatedOutsideIt)
+{
+    auto map = Map{};
+    for (auto i = 0; i < 100; ++i)
+    {
+        map.AddTagToObject(AddNode(map, i, i % 10), ObjectType::Node, "amenity", "cafe");
+    }
+    auto database = Database::FromMap(std::move(map));
+    database.EnableQueryCache(10.0, 1000);
+    const auto far = quadtree::Rectangle<double>::Of(4000.0, 6000.0, 2000.0, 2000.0);
+    ASSERT_TRUE(database.Query(far).empty());
+
+    auto changes = MapChanges{};
+    changes.nodes.push_back(NodeChange{ 101, false, 5000.0, 5000.0, { Tag{ "amenity", "bench" } } });
+    changes.nodes.push_back(NodeChange{ 102, false, -300.0, 20.0, {} });
+    changes.nodes.push_back(NodeChange{ 103, false, -300.0, -40.0, {} });
+    changes.ways.push_back(WayChange{ 1, false, { 102, 103 }, {} });
+    database.ApplyChanges(changes);
+
+    const auto& area = database.GetIndexedArea();
+    EXPECT_EQ(area.GetCenterX() - area.GetHalfWidth(), -300.0);
+    EXPECT_EQ(area.GetCenterX() + area.GetHalfWidth(), 5000.0);
+    EXPECT_EQ(area.GetCenterY() - area.GetHalfHeight(), -40.0);
+    EXPECT_EQ(area.GetCenterY() + area.GetHalfHeight(), 5000.0);
+
+    EXPECT_EQ(database.QueryNearest(50.0, 5.0, 1000).size(), 102u);
+    EXPECT_EQ(database.Query(far), std::vector<std::size_t>{ 100 });
+    EXPECT_EQ(database.Query(quadtree::Rectangle<double>{ -300.0, 0.0, 1.0, 1.0 }), std::vector<std::size_t>{ 0 });
+}
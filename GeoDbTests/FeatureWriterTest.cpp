@@ -0,0 +1,465 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/FeatureWriter.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    // Reads one JSON value without whitespace, as the writer has none, keeping the numbers and decoded strings met
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(std::string_view text)
+            : m_text{ text }
+        { }
+
+        bool Parse() { return Value() && m_position == m_text.size(); }
+
+        const std::vector<double>& GetNumbers() const { return m_numbers; }
+
+        const std::vector<std::string>& GetStrings() const { return m_strings; }
+
+    private:
+        bool Value()
+        {
+            if (m_position == m_text.size())
+            {
+                return false;
+            }
+            switch (m_text[m_position])
+            {
+            case '{':
+                return Members('}', true);
+            case '[':
+                return Members(']', false);
+            case '"':
+                return String();
+            case 'n':
+                return Literal("null");
+            case 't':
+                return Literal("true");
+            case 'f':
+                return Literal("false");
+            default:
+                return Number();
+            }
+        }
+
+        bool Members(char close, bool named)
+        {
+            ++m_position;
+            if (Skip(close))
+            {
+                return true;
+            }
+            do
+            {
+                if (named && !(String() && Skip(':')))
+                {
+                    return false;
+                }
+                if (!Value())
+                {
+                    return false;
+                }
+            } while (Skip(','));
+            return Skip(close);
+        }
+
+        bool String()
+        {
+            if (!Skip('"'))
+            {
+                return false;
+            }
+            auto text = std::string{};
+            while (m_position < m_text.size() && m_text[m_position] != '"')
+            {
+                const auto c = m_text[m_position++];
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    return false;
+                }
+                if (c != '\\')
+                {
+                    text.push_back(c);
+                    continue;
+                }
+                if (m_position == m_text.size())
+                {
+                    return false;
+                }
+                switch (const auto escaped = m_text[m_position++])
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    text.push_back(escaped);
+                    break;
+                case 'n':
+                    text.push_back('\n');
+                    break;
+                case 'r':
+                    text.push_back('\r');
+                    break;
+                case 't':
+                    text.push_back('\t');
+                    break;
+                case 'u':
+                {
+                    auto code = 0u;
+                    const auto digits = m_text.substr(m_position, 4);
+                    if (digits.size() != 4 || std::from_chars(digits.data(), digits.data() + 4, code, 16).ptr != digits.data() + 4 || code > 0xff)
+                    {
+                        return false;
+                    }
+                    text.push_back(static_cast<char>(code));
+                    m_position += 4;
+                    break;
+                }
+                default:
+                    return false;
+                }
+            }
+            m_strings.push_back(std::move(text));
+            return Skip('"');
+        }
+
+        bool Number()
+        {
+            const auto c = m_text[m_position];
+            if (c != '-' && (c < '0' || c > '9'))
+            {
+                return false;
+            }
+            auto value = 0.0;
+            const auto result = std::from_chars(m_text.data() + m_position, m_text.data() + m_text.size(), value);
+            if (result.ec != std::errc{})
+            {
+                return false;
+            }
+            m_position = static_cast<std::size_t>(result.ptr - m_text.data());
+            m_numbers.push_back(value);
+            return true;
+        }
+
+        bool Literal(std::string_view literal)
+        {
+            if (m_text.substr(m_position, literal.size()) != literal)
+            {
+                return false;
+            }
+            m_position += literal.size();
+            return true;
+        }
+
+        bool Skip(char c)
+        {
+            if (m_position < m_text.size() && m_text[m_position] == c)
+            {
+                ++m_position;
+                return true;
+            }
+            return false;
+        }
+
+        std::string_view m_text;
+        std::size_t m_position = 0;
+        std::vector<double> m_numbers;
+        std::vector<std::string> m_strings;
+    };
+
+    class BinaryReader
+    {
+    public:
+        explicit BinaryReader(std::string_view bytes)
+            : m_bytes{ bytes }
+        { }
+
+        bool IsAtEnd() const { return m_position == m_bytes.size(); }
+
+        std::size_t GetPosition() const { return m_position; }
+
+        template<typename T>
+        T Read()
+        {
+            auto value = T{};
+            if (m_position + sizeof(T) > m_bytes.size())
+            {
+                throw std::out_of_range{ "Record ends early" };
+            }
+            std::memcpy(&value, m_bytes.data() + m_position, sizeof(T));
+            m_position += sizeof(T);
+            return value;
+        }
+
+        std::string_view ReadText()
+        {
+            const auto size = Read<std::uint32_t>();
+            if (m_position + size > m_bytes.size())
+            {
+                throw std::out_of_range{ "Record ends early" };
+            }
+            const auto text = m_bytes.substr(m_position, size);
+            m_position += size;
+            return text;
+        }
+
+    private:
+        std::string_view m_bytes;
+        std::size_t m_position = 0;
+    };
+
+    // A random map with a closed way, a deleted one, and tags that need escaping in JSON
+    Map FeatureMap()
+    {
+        auto random = std::mt19937{ 20 };
+        auto map = RandomMap(random, 300, 100);
+        map.AddTagToObject(0, ObjectType::Node, "name", "\"Quoted\" \\ back\nslash\t\x01");
+        map.AddTagToObject(0, ObjectType::Node, "", "");
+
+        const auto square = std::vector<std::size_t>{
+            AddNode(map, 0.1, 0.2), AddNode(map, 1.0 / 3.0, -1e-300), AddNode(map, 12345.678, 9.0)
+        };
+        const auto closed = AddWay(map, { square[0], square[1], square[2], square[0] });
+        map.AddTagToObject(closed, ObjectType::Way, "building", "yes");
+        const auto deleted = AddWay(map, { square[0], square[1] });
+        map.GetWays()[deleted].Delete();
+        return map;
+    }
+
+    std::vector<QueryResult> AllObjects(const Map& map)
+    {
+        auto objects = std::vector<QueryResult>{};
+        for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+        {
+            objects.push_back(QueryResult{ i, ObjectType::Way });
+        }
+        for (std::size_t i = 0; i < map.GetNodes().size(); ++i)
+        {
+            objects.push_back(QueryResult{ i, ObjectType::Node });
+        }
+        return objects;
+    }
+
+    std::string WriteAtOnce(const Map& map, FeatureFormat format, std::span<const QueryResult> objects)
+    {
+        auto buffer = std::vector<char>(1 << 22);
+        auto writer = FeatureWriter{ map, format, buffer };
+        EXPECT_TRUE(writer.Begin());
+        EXPECT_EQ(writer.Write(objects), objects.size());
+        EXPECT_TRUE(writer.End());
+        return std::string{ writer.GetBuffered().data(), writer.GetBuffered().size() };
+    }
+
+    std::vector<std::size_t> PointsOf(const Map& map, const QueryResult& object)
+    {
+        return object.objectType == ObjectType::Node ? std::vector<std::size_t>{ object.objectId } : map.GetWays()[object.objectId].GetNodes();
+    }
+}
+
+TEST(FeatureWriterTest, WritesGeoJsonThatParsesBack)
+{
+    const auto map = FeatureMap();
+    const auto objects = AllObjects(map);
+    const auto json = WriteAtOnce(map, FeatureFormat::GeoJson, objects);
+
+    auto reader = JsonReader{ json };
+    ASSERT_TRUE(reader.Parse()) << json;
+
+    // Coordinates are the only numbers, and read back to the same doubles
+    auto coordinates = std::vector<double>{};
+    for (const auto& object : objects)
+    {
+        for (const auto node : PointsOf(map, object))
+        {
+            coordinates.push_back(map.GetNodes()[node].GetX());
+            coordinates.push_back(map.GetNodes()[node].GetY());
+        }
+    }
+    EXPECT_EQ(reader.GetNumbers(), coordinates);
+
+    const auto& strings = reader.GetStrings();
+    EXPECT_NE(std::find(strings.begin(), strings.end(), "\"Quoted\" \\ back\nslash\t\x01"), strings.end());
+    EXPECT_NE(std::find(strings.begin(), strings.end(), "way/100"), strings.end());
+    EXPECT_NE(std::find(strings.begin(), strings.end(), "node/0"), strings.end());
+    EXPECT_NE(json.find("{\"type\":\"Feature\",\"id\":\"way/100\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[[0.1,0.2],"), std::string::npos);
+    EXPECT_NE(json.find("\"id\":\"way/101\",\"geometry\":null,\"properties\":{}}"), std::string::npos);
+    EXPECT_EQ(json.substr(0, 41), "{\"type\":\"FeatureCollection\",\"features\":[{");
+
+    auto empty = std::vector<char>(64);
+    auto writer = FeatureWriter{ map, FeatureFormat::GeoJson, empty };
+    EXPECT_TRUE(writer.Begin());
+    EXPECT_TRUE(writer.End());
+    EXPECT_EQ(std::string_view(writer.GetBuffered().data(), writer.GetBuffered().size()), "{\"type\":\"FeatureCollection\",\"features\":[]}");
+}
+
+TEST(FeatureWriterTest, WritesNonFiniteCoordinatesAsNull)
+{
+    auto map = Map{};
+    AddNode(map, std::numeric_limits<double>::infinity(), -2.5);
+    const auto object = QueryResult{ 0, ObjectType::Node };
+    const auto json = WriteAtOnce(map, FeatureFormat::GeoJson, { &object, 1 });
+
+    EXPECT_TRUE(JsonReader{ json }.Parse()) << json;
+    EXPECT_NE(json.find("\"coordinates\":[null,-2.5]"), std::string::npos) << json;
+}
+
+TEST(FeatureWriterTest, WritesBinaryRecordsOfTheMap)
+{
+    const auto map = FeatureMap();
+    const auto objects = AllObjects(map);
+    const auto bytes = WriteAtOnce(map, FeatureFormat::Binary, objects);
+
+    auto reader = BinaryReader{ bytes };
+    for (const auto& object : objects)
+    {
+        const auto recordBytes = reader.Read<std::uint32_t>();
+        const auto recordStart = reader.GetPosition();
+        EXPECT_EQ(reader.Read<std::uint8_t>(), object.objectType == ObjectType::Way ? 1 : 0);
+        EXPECT_EQ(reader.Read<std::uint64_t>(), object.objectId);
+
+        const auto points = PointsOf(map, object);
+        ASSERT_EQ(reader.Read<std::uint32_t>(), points.size());
+        for (const auto node : points)
+        {
+            EXPECT_EQ(reader.Read<double>(), map.GetNodes()[node].GetX());
+            EXPECT_EQ(reader.Read<double>(), map.GetNodes()[node].GetY());
+        }
+
+        const auto* tags = map.GetObjectTags(object.objectId, object.objectType);
+        ASSERT_EQ(reader.Read<std::uint32_t>(), tags != nullptr ? tags->size() : 0);
+        for (std::size_t i = 0; tags != nullptr && i < tags->size(); ++i)
+        {
+            EXPECT_EQ(reader.ReadText(), (*tags)[i].GetKey());
+            EXPECT_EQ(reader.ReadText(), (*tags)[i].GetValue());
+        }
+        EXPECT_EQ(reader.GetPosition() - recordStart, recordBytes);
+    }
+    EXPECT_TRUE(reader.IsAtEnd());
+}
+
+TEST(FeatureWriterTest, RefusesFeaturesThatDoNotFitWhole)
+{
+    const auto map = FeatureMap();
+    const auto objects = AllObjects(map);
+
+    auto tiny = std::vector<char>(10);
+    auto refused = FeatureWriter{ map, FeatureFormat::GeoJson, tiny };
+    EXPECT_FALSE(refused.Begin());
+    EXPECT_TRUE(refused.GetBuffered().empty());
+
+    for (const auto format : { FeatureFormat::GeoJson, FeatureFormat::Binary })
+    {
+        const auto expected = WriteAtOnce(map, format, objects);
+        for (const auto bufferSize : { 512, 1000, 4096 })
+        {
+            auto buffer = std::vector<char>(bufferSize);
+            auto writer = FeatureWriter{ map, format, buffer };
+            auto output = std::string{};
+            const auto drain = [&]
+                {
+                    output.append(writer.GetBuffered().data(), writer.GetBuffered().size());
+                    writer.ClearBuffered();
+                };
+
+            ASSERT_TRUE(writer.Begin());
+            for (auto remaining = std::span<const QueryResult>{ objects }; !remaining.empty(); )
+            {
+                const auto written = writer.Write(remaining);
+                if (written < remaining.size())
+                {
+                    // The refused feature leaves nothing behind, and fits once the buffer is empty
+                    const auto before = writer.GetBuffered().size();
+                    EXPECT_FALSE(writer.Write(remaining[written]));
+                    EXPECT_EQ(writer.GetBuffered().size(), before);
+                    drain();
+                    ASSERT_TRUE(writer.Write(remaining[written]));
+                    remaining = remaining.subspan(written + 1);
+                }
+                else
+                {
+                    remaining = {};
+                }
+            }
+            if (!writer.End())
+            {
+                drain();
+                ASSERT_TRUE(writer.End());
+            }
+            drain();
+
+            EXPECT_EQ(output, expected) << bufferSize;
+            EXPECT_EQ(writer.GetWrittenBytes(), expected.size());
+        }
+    }
+}
+
+TEST(FeatureWriterTest, StreamsToFileDescriptors)
+{
+    const auto map = FeatureMap();
+    const auto objects = AllObjects(map);
+
+    for (const auto format : { FeatureFormat::GeoJson, FeatureFormat::Binary })
+    {
+        auto* file = std::tmpfile();
+        ASSERT_NE(file, nullptr);
+#if defined(_WIN32)
+        const auto fileDescriptor = _fileno(file);
+#else
+        const auto fileDescriptor = fileno(file);
+#endif
+
+        // Smaller than most features, which are then flushed in pieces
+        auto buffer = std::vector<char>(16);
+        auto writer = FeatureWriter{ map, format, fileDescriptor, buffer };
+        EXPECT_TRUE(writer.Begin());
+        EXPECT_EQ(writer.Write(objects), objects.size());
+        EXPECT_TRUE(writer.End());
+        EXPECT_TRUE(writer.GetBuffered().empty());
+
+        const auto expected = WriteAtOnce(map, format, objects);
+        EXPECT_EQ(writer.GetWrittenBytes(), expected.size());
+        auto output = std::string(expected.size() + 1, '\0');
+        std::rewind(file);
+        output.resize(std::fread(output.data(), 1, output.size(), file));
+        std::fclose(file);
+        EXPECT_EQ(output, expected);
+    }
+
+    EXPECT_THROW((FeatureWriter{ map, FeatureFormat::Binary, 1, std::span<char>{} }), std::invalid_argument);
+}
+
+TEST(FeatureWriterTest, RejectsObjectsNotInTheMap)
+{
+    const auto map = FeatureMap();
+    auto buffer = std::vector<char>(1024);
+    auto writer = FeatureWriter{ map, FeatureFormat::GeoJson, buffer };
+    ASSERT_TRUE(writer.Begin());
+    const auto header = writer.GetBuffered().size();
+
+    EXPECT_THROW(writer.Write(QueryResult{ map.GetWays().size(), ObjectType::Way }), std::out_of_range);
+    EXPECT_THROW(writer.Write(QueryResult{ map.GetNodes().size(), ObjectType::Node }), std::out_of_range);
+    EXPECT_EQ(writer.GetBuffered().size(), header);
+
+    // The next feature is still the first of the collection
+    ASSERT_TRUE(writer.Write(QueryResult{ 1, ObjectType::Node }));
+    ASSERT_TRUE(writer.End());
+    EXPECT_TRUE(JsonReader(std::string_view(writer.GetBuffered().data(), writer.GetBuffered().size())).Parse());
+}
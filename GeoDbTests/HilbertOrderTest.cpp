@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/HilbertOrder.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    void ExpectSameTags(const std::vector<Tag>* actual, const std::vector<Tag>* expected)
+    {
+        ASSERT_EQ(actual == nullptr, expected == nullptr);
+        if (expected == nullptr)
+        {
+            return;
+        }
+        ASSERT_EQ(actual->size(), expected->size());
+        for (std::size_t i = 0; i < expected->size(); ++i)
+        {
+            EXPECT_EQ((*actual)[i].GetKey(), (*expected)[i].GetKey());
+            EXPECT_EQ((*actual)[i].GetValue(), (*expected)[i].GetValue());
+        }
+    }
+}
+
+TEST(HilbertOrderTest, VisitsNeighbouringCellsInTurn)
+{
+    constexpr auto order = 4u;
+    constexpr auto side = 1u << order;
+
+    auto cells = std::vector<std::pair<std::uint32_t, std::uint32_t>>(side * side, { side, side });
+    for (std::uint32_t x = 0; x < side; ++x)
+    {
+        for (std::uint32_t y = 0; y < side; ++y)
+        {
+            const auto index = GetHilbertIndex(x, y, order);
+            ASSERT_LT(index, cells.size());
+            ASSERT_EQ(cells[index].first, side) << "cell " << index << " visited twice";
+            cells[index] = { x, y };
+        }
+    }
+    for (std::size_t i = 1; i < cells.size(); ++i)
+    {
+        const auto dx = std::abs(static_cast<int>(cells[i].first) - static_cast<int>(cells[i - 1].first));
+        const auto dy = std::abs(static_cast<int>(cells[i].second) - static_cast<int>(cells[i - 1].second));
+        EXPECT_EQ(dx + dy, 1) << "step " << i;
+    }
+}
+
+TEST(HilbertOrderTest, KeepsOsmIdsAndTagsWithTheirObjects)
+{
+    auto random = std::mt19937{ 5 };
+    const auto original = RandomMap(random, 1000, 300);
+    auto map = original;
+
+    const auto permutation = SortAlongHilbertCurve(map);
+    ASSERT_EQ(permutation.nodes.size(), original.GetNodes().size());
+    ASSERT_EQ(permutation.ways.size(), original.GetWays().size());
+
+    auto moved = std::size_t{ 0 };
+    for (std::size_t node = 0; node < original.GetNodes().size(); ++node)
+    {
+        const auto newNode = map.FindObject(static_cast<OsmId>(node + 1), ObjectType::Node);
+        ASSERT_TRUE(newNode.has_value());
+        EXPECT_EQ(*newNode, permutation.nodes[node]);
+        EXPECT_EQ(map.GetNodes()[*newNode].GetX(), original.GetNodes()[node].GetX());
+        EXPECT_EQ(map.GetNodes()[*newNode].GetY(), original.GetNodes()[node].GetY());
+        ExpectSameTags(map.GetObjectTags(*newNode, ObjectType::Node), original.GetObjectTags(node, ObjectType::Node));
+        moved += *newNode != node ? 1 : 0;
+    }
+    EXPECT_GT(moved, 0u);
+
+    for (std::size_t way = 0; way < original.GetWays().size(); ++way)
+    {
+        const auto newWay = map.FindObject(static_cast<OsmId>(way + 1), ObjectType::Way);
+        ASSERT_TRUE(newWay.has_value());
+        EXPECT_EQ(*newWay, permutation.ways[way]);
+        ExpectSameTags(map.GetObjectTags(*newWay, ObjectType::Way), original.GetObjectTags(way, ObjectType::Way));
+
+        const auto& nodes = map.GetWays()[*newWay].GetNodes();
+        const auto& originalNodes = original.GetWays()[way].GetNodes();
+        ASSERT_EQ(nodes.size(), originalNodes.size());
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            EXPECT_EQ(nodes[i], permutation.nodes[originalNodes[i]]);
+        }
+        EXPECT_EQ(map.GetWays()[*newWay].GetBoundingBox(), original.GetWays()[way].GetBoundingBox());
+    }
+}
+
+TEST(HilbertOrderTest, RejectsOrdersThatAreNotPermutations)
+{
+    auto map = Map{};
+    AddNode(map, 0.0, 0.0);
+    AddNode(map, 1.0, 1.0);
+    AddWay(map, { 0, 1 });
+
+    EXPECT_THROW(map.Reorder({ 0 }, { 0 }), std::invalid_argument);
+    EXPECT_THROW(map.Reorder({ 1, 1 }, { 0 }), std::invalid_argument);
+    EXPECT_THROW(map.Reorder({ 0, 2 }, { 0 }), std::invalid_argument);
+
+    const auto permutation = map.Reorder({ 1, 0 }, { 0 });
+    EXPECT_EQ(permutation.nodes, (std::vector<std::size_t>{ 1, 0 }));
+    EXPECT_EQ(map.GetWays()[0].GetNodes(), (std::vector<std::size_t>{ 1, 0 }));
+    EXPECT_EQ(map.GetNodes()[0].GetX(), 1.0);
+    EXPECT_EQ(map.FindObject(1, ObjectType::Node), std::optional<std::size_t>{ 1 });
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/Database.h"
+#include "../GeoDb/PolygonIndex.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    // Even-odd rule over every edge of the way, without slabs
+    bool BruteForceContains(const Map& map, const Way& way, double x, double y)
+    {
+        const auto& nodes = way.GetNodes();
+        if (nodes.size() < 4 || nodes.front() != nodes.back())
+        {
+            return false;
+        }
+        auto inside = false;
+        for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+        {
+            const auto& start = map.GetNodes()[nodes[i]];
+            const auto& end = map.GetNodes()[nodes[i + 1]];
+            if ((start.GetY() > y) != (end.GetY() > y)
+                && x < (end.GetX() - start.GetX()) * (y - start.GetY()) / (end.GetY() - start.GetY()) + start.GetX())
+            {
+                inside = !inside;
+            }
+        }
+        return inside;
+    }
+
+    double BruteForceArea(const Map& map, const Way& way)
+    {
+        const auto& nodes = way.GetNodes();
+        auto doubleArea = 0.0;
+        for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+        {
+            const auto& start = map.GetNodes()[nodes[i]];
+            const auto& end = map.GetNodes()[nodes[i + 1]];
+            doubleArea += start.GetX() * end.GetY() - end.GetX() * start.GetY();
+        }
+        return std::abs(doubleArea) / 2.0;
+    }
+
+    // A concave ring around the center, its vertices at sorted angles and random radii
+    std::size_t AddStar(Map& map, std::mt19937& random, double centerX, double centerY, double radius, std::size_t vertexCount)
+    {
+        auto angles = std::vector<double>(vertexCount);
+        auto angle = std::uniform_real_distribution<double>{ 0.0, 2.0 * std::numbers::pi };
+        std::generate(angles.begin(), angles.end(), [&] { return angle(random); });
+        std::sort(angles.begin(), angles.end());
+
+        auto scale = std::uniform_real_distribution<double>{ 0.3, 1.0 };
+        auto nodes = std::vector<std::size_t>{};
+        for (const auto a : angles)
+        {
+            const auto r = radius * scale(random);
+            nodes.push_back(AddNode(map, centerX + r * std::cos(a), centerY + r * std::sin(a)));
+        }
+        nodes.push_back(nodes.front());
+        return AddWay(map, std::move(nodes));
+    }
+
+    // A ring with teeth hanging from its top, every tooth edge spans most of the height so the slabs have to thin out
+    std::size_t AddComb(Map& map, double left, double bottom, std::size_t teeth)
+    {
+        const auto width = 2.0 * static_cast<double>(teeth) + 1.0;
+        auto nodes = std::vector<std::size_t>{
+            AddNode(map, left, bottom), AddNode(map, left + width, bottom), AddNode(map, left + width, bottom + 100.0)
+        };
+        for (auto tooth = teeth; tooth > 0; --tooth)
+        {
+            const auto x = left + 2.0 * static_cast<double>(tooth);
+            nodes.push_back(AddNode(map, x, bottom + 100.0));
+            nodes.push_back(AddNode(map, x, bottom + 5.0));
+            nodes.push_back(AddNode(map, x - 1.0, bottom + 5.0));
+            nodes.push_back(AddNode(map, x - 1.0, bottom + 100.0));
+        }
+        nodes.push_back(AddNode(map, left, bottom + 100.0));
+        nodes.push_back(nodes.front());
+        return AddWay(map, std::move(nodes));
+    }
+
+    // Overlapping and nested rings of few and of many vertices, a comb, and the open ways of a random map
+    Map PolygonMap(std::mt19937& random)
+    {
+        auto map = RandomMap(random, 0, 200);
+        auto position = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+        auto radius = std::uniform_real_distribution<double>{ 10.0, 200.0 };
+        for (auto i = 0; i < 60; ++i)
+        {
+            AddStar(map, random, position(random), position(random), radius(random), i % 3 == 0 ? 500 : 3 + i % 20);
+        }
+        AddStar(map, random, 500.0, 500.0, 700.0, 5000);
+        AddComb(map, 300.0, 300.0, 200);
+        return map;
+    }
+
+    void ExpectMatchesBruteForce(const PolygonIndex& index, const Map& map, std::mt19937& random)
+    {
+        auto position = std::uniform_real_distribution<double>{ -100.0, 1100.0 };
+        auto inside = 0;
+        for (auto i = 0; i < 2000; ++i)
+        {
+            const auto x = position(random);
+            const auto y = position(random);
+            for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+            {
+                const auto expected = BruteForceContains(map, map.GetWays()[way], x, y);
+                ASSERT_EQ(index.Contains(way, x, y), expected) << "way " << way << " at " << x << ", " << y;
+                inside += expected ? 1 : 0;
+            }
+        }
+        EXPECT_GT(inside, 0);
+    }
+}
+
+TEST(PolygonIndexTest, MatchesBruteForce)
+{
+    auto random = std::mt19937{ 12 };
+    const auto map = PolygonMap(random);
+    const auto index = PolygonIndex::FromMap(map);
+
+    EXPECT_EQ(index.GetPolygonCount(), 62u);
+    for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+    {
+        EXPECT_EQ(index.IsPolygon(way), way >= 200) << way;
+        if (index.IsPolygon(way))
+        {
+            EXPECT_NEAR(index.GetArea(way), BruteForceArea(map, map.GetWays()[way]), 1e-6 * BruteForceArea(map, map.GetWays()[way]));
+        }
+    }
+    ExpectMatchesBruteForce(index, map, random);
+}
+
+TEST(PolygonIndexTest, FollowsReplacedWays)
+{
+    auto random = std::mt19937{ 13 };
+    auto map = PolygonMap(random);
+    auto index = PolygonIndex::FromMap(map);
+
+    auto shift = std::uniform_real_distribution<double>{ -50.0, 50.0 };
+    for (auto round = 0; round < 5; ++round)
+    {
+        for (std::size_t way = 200 + round % 2; way < map.GetWays().size(); way += 2)
+        {
+            const auto dx = shift(random);
+            const auto dy = shift(random);
+            const auto& nodes = map.GetWays()[way].GetNodes();
+            for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+            {
+                auto& node = map.GetNodes()[nodes[i]];
+                node = Node{ node.GetX() + dx, node.GetY() + dy };
+            }
+            index.SetWay(way, map.GetWays()[way], map);
+        }
+    }
+
+    // Opening a ring drops it, closing an open way adds it
+    auto opened = map.GetWays()[201].GetNodes();
+    opened.pop_back();
+    map.GetWays()[201].SetNodes(opened, BoundingBoxOf(map, opened));
+    index.SetWay(201, map.GetWays()[201], map);
+    auto closed = map.GetWays()[0].GetNodes();
+    closed.push_back(AddNode(map, map.GetNodes()[closed.back()].GetX() + 30.0, map.GetNodes()[closed.back()].GetY() + 40.0));
+    closed.push_back(closed.front());
+    map.GetWays()[0].SetNodes(closed, BoundingBoxOf(map, closed));
+    index.SetWay(0, map.GetWays()[0], map);
+    const auto added = AddStar(map, random, 100.0, 100.0, 90.0, 40);
+    index.SetWay(added, map.GetWays()[added], map);
+
+    EXPECT_FALSE(index.IsPolygon(201));
+    EXPECT_TRUE(index.IsPolygon(0));
+    EXPECT_TRUE(index.IsPolygon(added));
+    ExpectMatchesBruteForce(index, map, random);
+}
+
+TEST(PolygonIndexTest, DatabaseFindsContainingWaysSmallestFirst)
+{
+    auto random = std::mt19937{ 14 };
+    const auto map = PolygonMap(random);
+    auto position = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+
+    for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+    {
+        auto database = Database::FromMap(map, engine);
+        for (auto i = 0; i < 500; ++i)
+        {
+            const auto x = position(random);
+            const auto y = position(random);
+            auto expected = std::vector<std::size_t>{};
+            for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+            {
+                if (BruteForceContains(map, map.GetWays()[way], x, y))
+                {
+                    expected.push_back(way);
+                }
+            }
+
+            const auto actual = database.Containing(x, y);
+            EXPECT_EQ(Sorted(actual), expected) << x << ", " << y;
+            for (std::size_t j = 1; j < actual.size(); ++j)
+            {
+                EXPECT_LE(BruteForceArea(map, map.GetWays()[actual[j - 1]]), BruteForceArea(map, map.GetWays()[actual[j]]));
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "../GeoDbServer/Protocol.h"
+
+using namespace geodb;
+using namespace geodb::protocol;
+
+namespace
+{
+    std::vector<std::byte> Frame(const Request& request)
+    {
+        auto buffer = std::vector<std::byte>{};
+        AppendRequest(request, buffer);
+        return buffer;
+    }
+
+    Request WindowRequest(std::uint32_t id, double minX, double minY, double maxX, double maxY)
+    {
+        auto request = Request{};
+        request.id = id;
+        request.window = quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
+        return request;
+    }
+}
+
+TEST(ProtocolTest, RoundTripsRequests)
+{
+    auto nearest = Request{};
+    nearest.id = 7;
+    nearest.type = RequestType::Nearest;
+    nearest.x = -3.25;
+    nearest.y = 1e9;
+    nearest.k = 42;
+    auto count = WindowRequest(8, -1.0, 2.0, 3.0, 4.0);
+    count.type = RequestType::Count;
+    auto bounds = Request{};
+    bounds.id = std::numeric_limits<std::uint32_t>::max();
+    bounds.type = RequestType::Bounds;
+
+    for (const auto& request : { WindowRequest(6, 0.5, -10.0, 100.25, 20.0), nearest, count, bounds })
+    {
+        const auto frame = Frame(request);
+        EXPECT_EQ(GetFrameSize(frame), frame.size());
+        EXPECT_EQ(GetRequestId(frame), request.id);
+
+        const auto parsed = ParseRequest(frame);
+        EXPECT_EQ(parsed.id, request.id);
+        EXPECT_EQ(parsed.type, request.type);
+        EXPECT_EQ(parsed.window, request.window);
+        EXPECT_EQ(parsed.x, request.x);
+        EXPECT_EQ(parsed.y, request.y);
+        EXPECT_EQ(parsed.k, request.k);
+    }
+    EXPECT_EQ(Frame(bounds).size(), RequestHeaderSize);
+    EXPECT_EQ(Frame(count).size(), MaxRequestSize);
+}
+
+TEST(ProtocolTest, SplitsPipelinedFrames)
+{
+    auto buffer = std::vector<std::byte>{};
+    AppendRequest(WindowRequest(1, 0.0, 0.0, 1.0, 1.0), buffer);
+    const auto first = buffer.size();
+    auto bounds = Request{};
+    bounds.id = 2;
+    bounds.type = RequestType::Bounds;
+    AppendRequest(bounds, buffer);
+
+    EXPECT_EQ(GetFrameSize(std::span<const std::byte>{ buffer }.first(3)), 0u);
+    EXPECT_EQ(GetFrameSize(buffer), first);
+    EXPECT_EQ(GetFrameSize(std::span<const std::byte>{ buffer }.subspan(first)), buffer.size() - first);
+    EXPECT_EQ(ParseRequest(std::span<const std::byte>{ buffer }.subspan(first)).id, 2u);
+}
+
+TEST(ProtocolTest, RejectsMalformedFrames)
+{
+    const auto frame = Frame(WindowRequest(3, 0.0, 0.0, 1.0, 1.0));
+    EXPECT_THROW(ParseRequest(std::span<const std::byte>{ frame }.first(frame.size() - 1)), std::invalid_argument);
+    EXPECT_THROW(ParseRequest(std::span<const std::byte>{ frame }.first(RequestHeaderSize - 1)), std::invalid_argument);
+
+    auto tooLong = frame;
+    tooLong.push_back(std::byte{ 0 });
+    EXPECT_THROW(ParseRequest(tooLong), std::invalid_argument);
+
+    auto unknownType = frame;
+    unknownType[RequestHeaderSize - 1] = std::byte{ 9 };
+    EXPECT_THROW(ParseRequest(unknownType), std::invalid_argument);
+    EXPECT_EQ(GetRequestId(unknownType), 3u);
+
+    // A window shrunk to a point is still valid, one with minX and maxX swapped is not
+    EXPECT_NO_THROW(ParseRequest(Frame(WindowRequest(4, 1.0, 1.0, 1.0, 1.0))));
+    auto empty = Frame(WindowRequest(4, 1.0, 0.0, 2.0, 1.0));
+    std::swap_ranges(empty.begin() + RequestHeaderSize, empty.begin() + RequestHeaderSize + 8, empty.begin() + RequestHeaderSize + 16);
+    EXPECT_THROW(ParseRequest(empty), std::invalid_argument);
+
+    auto notANumber = Frame(WindowRequest(5, 0.0, 0.0, std::numeric_limits<double>::quiet_NaN(), 1.0));
+    EXPECT_THROW(ParseRequest(notANumber), std::invalid_argument);
+    auto unbounded = Frame(WindowRequest(5, -std::numeric_limits<double>::infinity(), 0.0, 1.0, 1.0));
+    EXPECT_THROW(ParseRequest(unbounded), std::invalid_argument);
+
+    // Nearest points that are not finite would have the database search forever
+    for (const auto value : { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity() })
+    {
+        auto nearest = Request{};
+        nearest.type = RequestType::Nearest;
+        nearest.x = value;
+        nearest.k = 3;
+        EXPECT_THROW(ParseRequest(Frame(nearest)), std::invalid_argument);
+        nearest.x = 0.0;
+        nearest.y = -value;
+        EXPECT_THROW(ParseRequest(Frame(nearest)), std::invalid_argument);
+    }
+}
+
+TEST(ProtocolTest, RoundTripsResponseHeadersAndObjectKeys)
+{
+    const auto header = ResponseHeader{ 11, Status::BadRequest, 3, 2 };
+    auto frame = std::vector<std::byte>{};
+    const auto bytes = MakeResponseHeader(header);
+    frame.insert(frame.end(), bytes.begin(), bytes.end());
+    frame.resize(frame.size() + 2 * sizeof(ObjectKey));
+
+    EXPECT_EQ(GetFrameSize(frame), frame.size());
+    const auto parsed = ParseResponseHeader(frame);
+    EXPECT_EQ(parsed.requestId, 11u);
+    EXPECT_EQ(parsed.status, Status::BadRequest);
+    EXPECT_EQ(parsed.count, 3u);
+    EXPECT_EQ(parsed.values, 2u);
+
+    for (const auto object : { QueryResult{ 0, ObjectType::Node }, QueryResult{ 0, ObjectType::Way }, QueryResult{ 123456789, ObjectType::Way } })
+    {
+        EXPECT_EQ(FromObjectKey(ToObjectKey(object)), object);
+    }
+    EXPECT_EQ(ToObjectKey(QueryResult{ 5, ObjectType::Way }), 11u);
+}
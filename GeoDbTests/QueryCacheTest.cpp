@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "../GeoDb/QueryCache.h"
+
+using namespace geodb;
+
+namespace
+{
+    std::vector<QueryResult> Results(std::size_t count)
+    {
+        auto results = std::vector<QueryResult>{};
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            results.push_back(QueryResult{ i, ObjectType::Way });
+        }
+        return results;
+    }
+}
+
+TEST(QueryCacheTest, CoversOnlyWholeCells)
+{
+    const auto cache = QueryCache{ 10.0, 100 };
+
+    const auto cells = cache.GetCoveredCells(quadtree::Rectangle<double>::Of(-5.0, 35.0, 40.0, 30.0));
+    EXPECT_EQ(cells.minX, 0);
+    EXPECT_EQ(cells.maxX, 2);
+    EXPECT_EQ(cells.minY, 1);
+    EXPECT_EQ(cells.maxY, 2);
+
+    EXPECT_TRUE(cache.GetCoveredCells(quadtree::Rectangle<double>::Of(1.0, 9.0, 8.0, 8.0)).IsEmpty());
+    EXPECT_EQ(cache.GetCellArea(QueryCache::Cell{ -1, 2 }), (quadtree::Rectangle<double>{ -5.0, 25.0, 5.0, 5.0 }));
+}
+
+TEST(QueryCacheTest, EvictsLeastRecentlyUsedCells)
+{
+    auto cache = QueryCache{ 10.0, 4 };
+    const auto a = QueryCache::Cell{ 0, 0 };
+    const auto b = QueryCache::Cell{ 1, 0 };
+    const auto c = QueryCache::Cell{ 2, 0 };
+
+    cache.Insert(a, Results(2));
+    cache.Insert(b, Results(2));
+    ASSERT_NE(cache.Find(a), nullptr);
+    cache.Insert(c, Results(2));
+
+    EXPECT_EQ(cache.Find(b), nullptr);
+    ASSERT_NE(cache.Find(a), nullptr);
+    ASSERT_NE(cache.Find(c), nullptr);
+    EXPECT_EQ(cache.Find(c)->size(), 2u);
+
+    const auto& statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.evictions, 1u);
+    EXPECT_EQ(statistics.cachedCells, 2u);
+    EXPECT_EQ(statistics.cachedResults, 4u);
+    EXPECT_EQ(statistics.cellMisses, 1u);
+    EXPECT_EQ(statistics.cellHits, 4u);
+}
+
+TEST(QueryCacheTest, SkipsResultsLargerThanTheCache)
+{
+    auto cache = QueryCache{ 10.0, 4 };
+    cache.Insert(QueryCache::Cell{ 0, 0 }, Results(1));
+    cache.Insert(QueryCache::Cell{ 1, 0 }, Results(5));
+
+    EXPECT_EQ(cache.Find(QueryCache::Cell{ 1, 0 }), nullptr);
+    EXPECT_NE(cache.Find(QueryCache::Cell{ 0, 0 }), nullptr);
+    EXPECT_EQ(cache.GetStatistics().evictions, 0u);
+}
+
+TEST(QueryCacheTest, ReplacesCellsInsertedAgain)
+{
+    auto cache = QueryCache{ 10.0, 10 };
+    cache.Insert(QueryCache::Cell{ 0, 0 }, Results(3));
+    cache.Insert(QueryCache::Cell{ 0, 0 }, Results(1));
+
+    ASSERT_NE(cache.Find(QueryCache::Cell{ 0, 0 }), nullptr);
+    EXPECT_EQ(cache.Find(QueryCache::Cell{ 0, 0 })->size(), 1u);
+    EXPECT_EQ(cache.GetStatistics().cachedResults, 1u);
+    EXPECT_EQ(cache.GetStatistics().cachedCells, 1u);
+}
+
+TEST(QueryCacheTest, InvalidatesCellsTouchingTheChangedArea)
+{
+    auto cache = QueryCache{ 10.0, 100 };
+    for (std::int64_t y = -1; y <= 2; ++y)
+    {
+        for (std::int64_t x = -1; x <= 3; ++x)
+        {
+            cache.Insert(QueryCache::Cell{ x, y }, Results(1));
+        }
+    }
+
+    cache.Invalidate(quadtree::Rectangle<double>::Of(12.0, 8.0, 1.0, 1.0));
+
+    for (std::int64_t y = -1; y <= 2; ++y)
+    {
+        for (std::int64_t x = -1; x <= 3; ++x)
+        {
+            const auto dropped = (x == 0 || x == 1) && (y == -1 || y == 0);
+            EXPECT_EQ(cache.Find(QueryCache::Cell{ x, y }) == nullptr, dropped) << x << "," << y;
+        }
+    }
+    EXPECT_EQ(cache.GetStatistics().invalidations, 4u);
+}
+
+// Areas spanning more cells than are cached scan the cache instead of looking every cell up
+TEST(QueryCacheTest, InvalidatesLargeAreasByScanning)
+{
+    auto cache = QueryCache{ 10.0, 100 };
+    cache.Insert(QueryCache::Cell{ 3, 4 }, Results(1));
+    cache.Insert(QueryCache::Cell{ 50, 50 }, Results(1));
+
+    cache.Invalidate(quadtree::Rectangle<double>::Of(0.0, 100.0, 100.0, 100.0));
+
+    EXPECT_EQ(cache.Find(QueryCache::Cell{ 3, 4 }), nullptr);
+    EXPECT_NE(cache.Find(QueryCache::Cell{ 50, 50 }), nullptr);
+    EXPECT_EQ(cache.GetStatistics().invalidations, 1u);
+}
+
+TEST(QueryCacheTest, ClearDropsEverything)
+{
+    auto cache = QueryCache{ 10.0, 100 };
+    cache.Insert(QueryCache::Cell{ 0, 0 }, Results(2));
+    cache.Insert(QueryCache::Cell{ 5, 5 }, Results(3));
+
+    cache.Clear();
+
+    EXPECT_EQ(cache.Find(QueryCache::Cell{ 0, 0 }), nullptr);
+    EXPECT_EQ(cache.Find(QueryCache::Cell{ 5, 5 }), nullptr);
+    EXPECT_EQ(cache.GetStatistics().cachedResults, 0u);
+    EXPECT_EQ(cache.GetStatistics().invalidations, 2u);
+}
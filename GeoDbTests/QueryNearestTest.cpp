@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/Algo2d.h"
+#include "../GeoDb/Database.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    // Every way and tagged node with its distance to the point, nearest first
+    std::vector<DistanceQueryResult> BruteForceNearest(const Map& map, double x, double y, std::size_t k)
+    {
+        auto result = std::vector<DistanceQueryResult>{};
+        for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+        {
+            const auto& nodes = map.GetWays()[way].GetNodes();
+            auto distance = std::numeric_limits<double>::infinity();
+            for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+            {
+                const auto& start = map.GetNodes()[nodes[i]];
+                const auto& end = map.GetNodes()[nodes[i + 1]];
+                distance = std::min(distance, algo::PointSegmentDistance(x, y, start.GetX(), start.GetY(), end.GetX(), end.GetY()));
+            }
+            result.push_back(DistanceQueryResult{ way, ObjectType::Way, distance });
+        }
+        for (std::size_t node = 0; node < map.GetNodes().size(); ++node)
+        {
+            if (map.GetObjectTags(node, ObjectType::Node) != nullptr)
+            {
+                const auto& position = map.GetNodes()[node];
+                result.push_back(DistanceQueryResult{ node, ObjectType::Node, algo::PointPointDistance(x, y, position.GetX(), position.GetY()) });
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const auto& r1, const auto& r2) { return r1.distance < r2.distance; });
+        result.resize(std::min(k, result.size()));
+        return result;
+    }
+
+    void ExpectSameNearest(const std::vector<DistanceQueryResult>& actual, const std::vector<DistanceQueryResult>& expected)
+    {
+        ASSERT_EQ(actual.size(), expected.size());
+        for (std::size_t i = 0; i < expected.size(); ++i)
+        {
+            EXPECT_EQ(actual[i].objectId, expected[i].objectId) << i;
+            EXPECT_EQ(actual[i].objectType, expected[i].objectType) << i;
+            EXPECT_DOUBLE_EQ(actual[i].distance, expected[i].distance) << i;
+        }
+    }
+}
+
+TEST(QueryNearestTest, MatchesBruteForce)
+{
+    auto random = std::mt19937{ 21 };
+    const auto map = RandomMap(random, 2000, 500);
+    auto position = std::uniform_real_distribution<double>{ -500.0, 1500.0 };
+
+    for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+    {
+        auto database = Database::FromMap(map, engine);
+        for (auto i = 0; i < 100; ++i)
+        {
+            const auto x = position(random);
+            const auto y = position(random);
+            for (const auto k : { std::size_t{ 1 }, std::size_t{ 5 }, std::size_t{ 37 } })
+            {
+                ExpectSameNearest(database.QueryNearest(x, y, k), BruteForceNearest(map, x, y, k));
+            }
+        }
+    }
+}
+
+TEST(QueryNearestTest, ReturnsEveryObjectWhenAskedForMore)
+{
+    auto random = std::mt19937{ 22 };
+    const auto map = RandomMap(random, 30, 10);
+    auto database = Database::FromMap(map);
+
+    // Ten ways and the ten tagged nodes
+    for (const auto k : { std::size_t{ 20 }, std::size_t{ 21 }, std::size_t{ 1000 } })
+    {
+        const auto nearest = database.QueryNearest(100.0, -50.0, k);
+        EXPECT_EQ(nearest.size(), 20u);
+        ExpectSameNearest(nearest, BruteForceNearest(map, 100.0, -50.0, k));
+    }
+    EXPECT_TRUE(database.QueryNearest(100.0, -50.0, 0).empty());
+    EXPECT_TRUE(Database::FromMap(Map{}).QueryNearest(0.0, 0.0, 3).empty());
+}
+
+TEST(QueryNearestTest, RejectsPointsThatAreNotFinite)
+{
+    auto random = std::mt19937{ 23 };
+    auto database = Database::FromMap(RandomMap(random, 100, 10));
+
+    for (const auto value : { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity() })
+    {
+        EXPECT_THROW(database.QueryNearest(value, 500.0, 3), std::invalid_argument);
+        EXPECT_THROW(database.QueryNearest(500.0, -value, 3), std::invalid_argument);
+    }
+}
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/QueryPlanner.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    constexpr auto Origin = 500.0;
+    constexpr auto WayCount = std::size_t{ 10000 };
+
+    bool Overlaps(const quadtree::Rectangle<double>& a, const quadtree::Rectangle<double>& b)
+    {
+        return std::abs(a.GetCenterX() - b.GetCenterX()) <= a.GetHalfWidth() + b.GetHalfWidth()
+            && std::abs(a.GetCenterY() - b.GetCenterY()) <= a.GetHalfHeight() + b.GetHalfHeight();
+    }
+
+    bool Contains(const quadtree::Rectangle<double>& window, const quadtree::Rectangle<double>& box)
+    {
+        return box.GetCenterX() - box.GetHalfWidth() >= window.GetCenterX() - window.GetHalfWidth()
+            && box.GetCenterX() + box.GetHalfWidth() <= window.GetCenterX() + window.GetHalfWidth()
+            && box.GetCenterY() - box.GetHalfHeight() >= window.GetCenterY() - window.GetHalfHeight()
+            && box.GetCenterY() + box.GetHalfHeight() <= window.GetCenterY() + window.GetHalfHeight();
+    }
+
+    quadtree::Rectangle<double> Grow(const quadtree::Rectangle<double>& window, double margin)
+    {
+        return quadtree::Rectangle<double>{
+            window.GetCenterX(), window.GetCenterY(), window.GetHalfWidth() + margin, window.GetHalfHeight() + margin
+        };
+    }
+
+    // Small boxes spread over [0, 1000] on both axes, planned in the frame centered on the middle of that area
+    class PlannedBoxes
+    {
+    public:
+        PlannedBoxes()
+            : planner{ quadtree::Rectangle<float>{ 0.0f, 0.0f, 500.0f, 500.0f }, Origin, Origin, WayCount }
+        {
+            auto random = std::mt19937{ 8 };
+            auto position = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+            auto side = std::uniform_real_distribution<double>{ 0.1, 10.0 };
+            for (std::size_t i = 0; i < WayCount; ++i)
+            {
+                boxes.push_back(quadtree::Rectangle<double>{ position(random), position(random), side(random), side(random) });
+                planner.Add(ToEntry(i));
+            }
+        }
+
+        CompactBoundingBox ToEntry(std::size_t way) const
+        {
+            return CompactBoundingBox::Of(way, ObjectType::Way, boxes[way], Origin, Origin);
+        }
+
+        std::vector<std::size_t> Overlapping(const quadtree::Rectangle<double>& window, const std::vector<bool>& removed) const
+        {
+            auto result = std::vector<std::size_t>{};
+            for (std::size_t i = 0; i < boxes.size(); ++i)
+            {
+                if (!removed[i] && Overlaps(boxes[i], window))
+                {
+                    result.push_back(i);
+                }
+            }
+            return result;
+        }
+
+        std::vector<quadtree::Rectangle<double>> boxes;
+        QueryPlanner planner;
+    };
+
+    // Boxes are rounded outwards to floats, so scans may report boxes a float step away from the window but none farther
+    void ExpectCandidatesFor(
+        const PlannedBoxes& planned,
+        const quadtree::Rectangle<double>& window,
+        const std::vector<std::size_t>& candidates,
+        const std::vector<bool>& removed
+    )
+    {
+        const auto sorted = Sorted(candidates);
+        EXPECT_EQ(std::adjacent_find(sorted.begin(), sorted.end()), sorted.end());
+        for (const auto way : planned.Overlapping(window, removed))
+        {
+            EXPECT_TRUE(std::binary_search(sorted.begin(), sorted.end(), way)) << way;
+        }
+        for (const auto way : sorted)
+        {
+            EXPECT_FALSE(removed[way]) << way;
+            EXPECT_TRUE(Overlaps(planned.boxes[way], Grow(window, 1e-3))) << way;
+        }
+    }
+}
+
+TEST(QueryPlannerTest, ScansFindEveryOverlappingBox)
+{
+    auto planned = PlannedBoxes{};
+    auto removed = std::vector<bool>(WayCount, false);
+    for (std::size_t i = 0; i < WayCount; i += 3)
+    {
+        planned.planner.Remove(planned.ToEntry(i));
+        removed[i] = true;
+    }
+
+    auto random = std::mt19937{ 9 };
+    for (auto i = 0; i < 100; ++i)
+    {
+        const auto window = RandomWindow(random, 1000.0, i % 10 == 0 ? 600.0 : 60.0);
+
+        auto candidates = std::vector<std::size_t>{};
+        planned.planner.ScanAll(window, candidates);
+        ExpectCandidatesFor(planned, window, candidates, removed);
+
+        auto matches = std::vector<std::size_t>{};
+        candidates.clear();
+        planned.planner.ScanCells(window, matches, candidates);
+        for (const auto way : matches)
+        {
+            EXPECT_TRUE(Contains(window, planned.boxes[way])) << way;
+        }
+        candidates.insert(candidates.end(), matches.begin(), matches.end());
+        ExpectCandidatesFor(planned, window, candidates, removed);
+    }
+}
+
+TEST(QueryPlannerTest, EstimatesCandidatesFromTheHistogram)
+{
+    const auto planned = PlannedBoxes{};
+    const auto noneRemoved = std::vector<bool>(WayCount, false);
+
+    auto random = std::mt19937{ 10 };
+    for (auto i = 0; i < 50; ++i)
+    {
+        const auto window = quadtree::Rectangle<double>{
+            std::uniform_real_distribution<double>{ 200.0, 800.0 }(random),
+            std::uniform_real_distribution<double>{ 200.0, 800.0 }(random),
+            100.0,
+            100.0
+        };
+        const auto actual = static_cast<double>(planned.Overlapping(window, noneRemoved).size());
+        const auto estimate = planned.planner.Estimate(window);
+        EXPECT_GT(estimate.candidates, actual * 0.7);
+        EXPECT_LT(estimate.candidates, actual * 1.5);
+    }
+
+    const auto outside = planned.planner.Estimate(quadtree::Rectangle<double>{ 5000.0, 5000.0, 10.0, 10.0 });
+    EXPECT_EQ(outside.candidates, 0.0);
+}
+
+TEST(QueryPlannerTest, PicksTheCheapestPlan)
+{
+    const auto planned = PlannedBoxes{};
+
+    auto random = std::mt19937{ 11 };
+    for (auto i = 0; i < 50; ++i)
+    {
+        const auto estimate = planned.planner.Estimate(RandomWindow(random, 1000.0, 20.0 * (i + 1)));
+        const auto cheapest = std::min({ estimate.indexCost, estimate.scanCost, estimate.cellCost });
+        switch (estimate.plan)
+        {
+        case QueryPlan::IndexTraversal:
+            EXPECT_EQ(estimate.indexCost, cheapest);
+            break;
+        case QueryPlan::LinearScan:
+            EXPECT_EQ(estimate.scanCost, cheapest);
+            break;
+        case QueryPlan::CellScan:
+            EXPECT_EQ(estimate.cellCost, cheapest);
+            break;
+        }
+    }
+
+    // Every cell lies inside a window covering the whole area, so its ways need no refinement
+    const auto everything = planned.planner.Estimate(quadtree::Rectangle<double>{ Origin, Origin, 600.0, 600.0 });
+    EXPECT_EQ(everything.plan, QueryPlan::CellScan);
+    EXPECT_EQ(everything.candidates, static_cast<double>(WayCount));
+    EXPECT_EQ(std::string{ ToString(everything.plan) }, "cells");
+}
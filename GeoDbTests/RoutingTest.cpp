@@ -0,0 +1,335 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/Database.h"
+#include "../GeoDb/RoadGraph.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    constexpr auto Infinity = std::numeric_limits<double>::infinity();
+    constexpr std::size_t GridSide = 12;
+
+    std::string TagValue(const Map& map, std::size_t way, const std::string& key)
+    {
+        if (const auto* tags = map.GetObjectTags(way, ObjectType::Way))
+        {
+            for (const auto& tag : *tags)
+            {
+                if (tag.GetKey() == key)
+                {
+                    return std::string{ tag.GetValue() };
+                }
+            }
+        }
+        return {};
+    }
+
+    // Lengths of the allowed moves between map nodes, read from the tags of every highway
+    class Roads
+    {
+    public:
+        explicit Roads(const Map& map)
+            : m_map{ map }
+            , m_arcs(map.GetNodes().size())
+        {
+            for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+            {
+                if (map.GetWays()[way].IsDeleted() || TagValue(map, way, "highway").empty())
+                {
+                    continue;
+                }
+                const auto oneway = TagValue(map, way, "oneway");
+                const auto forward = oneway != "-1";
+                const auto backward = oneway != "yes" && (oneway == "no" || TagValue(map, way, "junction") != "roundabout");
+                const auto& nodes = map.GetWays()[way].GetNodes();
+                for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+                {
+                    m_segments.emplace_back(nodes[i], nodes[i + 1]);
+                    if (forward)
+                    {
+                        m_arcs[nodes[i]].emplace_back(nodes[i + 1], Length(nodes[i], nodes[i + 1]));
+                    }
+                    if (backward)
+                    {
+                        m_arcs[nodes[i + 1]].emplace_back(nodes[i], Length(nodes[i], nodes[i + 1]));
+                    }
+                }
+            }
+        }
+
+        const std::vector<std::pair<std::size_t, std::size_t>>& GetSegments() const { return m_segments; }
+
+        double Length(std::size_t from, std::size_t to) const
+        {
+            const auto& start = m_map.GetNodes()[from];
+            const auto& end = m_map.GetNodes()[to];
+            return std::hypot(end.GetX() - start.GetX(), end.GetY() - start.GetY());
+        }
+
+        // Infinity when the move is not allowed
+        double ArcLength(std::size_t from, std::size_t to) const
+        {
+            for (const auto& [next, length] : m_arcs[from])
+            {
+                if (next == to)
+                {
+                    return length;
+                }
+            }
+            return Infinity;
+        }
+
+        // Plain Dijkstra between points at a fraction along two segments, leaving and entering them in every allowed
+        // direction, or moving along the segment both lie on
+        double ShortestLength(std::size_t fromSegment, double fromFraction, std::size_t toSegment, double toFraction) const
+        {
+            const auto [a, b] = m_segments[fromSegment];
+            const auto [c, d] = m_segments[toSegment];
+            auto best = Infinity;
+            if (fromSegment == toSegment)
+            {
+                best = toFraction >= fromFraction
+                    ? (toFraction - fromFraction) * ArcLength(a, b)
+                    : (fromFraction - toFraction) * ArcLength(b, a);
+            }
+
+            auto distances = std::vector<double>(m_arcs.size(), Infinity);
+            using Entry = std::pair<double, std::size_t>;
+            auto queue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>{};
+            const auto start = [&](std::size_t node, double distance)
+                {
+                    if (distance < distances[node])
+                    {
+                        distances[node] = distance;
+                        queue.emplace(distance, node);
+                    }
+                };
+            start(b, (1.0 - fromFraction) * ArcLength(a, b));
+            start(a, fromFraction * ArcLength(b, a));
+            while (!queue.empty())
+            {
+                const auto [distance, node] = queue.top();
+                queue.pop();
+                if (distance > distances[node])
+                {
+                    continue;
+                }
+                for (const auto& [next, length] : m_arcs[node])
+                {
+                    start(next, distance + length);
+                }
+            }
+
+            best = std::min(best, distances[c] + toFraction * ArcLength(c, d));
+            return std::min(best, distances[d] + (1.0 - toFraction) * ArcLength(d, c));
+        }
+
+    private:
+        const Map& m_map;
+        std::vector<std::vector<std::pair<std::size_t, double>>> m_arcs;
+        std::vector<std::pair<std::size_t, std::size_t>> m_segments;
+    };
+
+    // A jittered grid of streets, some rows one way in either direction and some columns roundabouts, a river that
+    // is no road across it, and a one way spur leading out of a corner into a dead end
+    Map GridMap()
+    {
+        auto random = std::mt19937{ 15 };
+        auto jitter = std::uniform_real_distribution<double>{ -2.0, 2.0 };
+        auto map = Map{};
+        auto grid = std::vector<std::size_t>{};
+        for (std::size_t row = 0; row < GridSide; ++row)
+        {
+            for (std::size_t column = 0; column < GridSide; ++column)
+            {
+                grid.push_back(AddNode(map, column * 10.0 + jitter(random), row * 10.0 + jitter(random)));
+            }
+        }
+
+        for (std::size_t row = 0; row < GridSide; ++row)
+        {
+            const auto way = AddWay(map, std::vector<std::size_t>(grid.begin() + row * GridSide, grid.begin() + (row + 1) * GridSide));
+            map.AddTagToObject(way, ObjectType::Way, "highway", "residential");
+            if (row % 4 == 1)
+            {
+                map.AddTagToObject(way, ObjectType::Way, "oneway", "yes");
+            }
+            else if (row % 4 == 3)
+            {
+                map.AddTagToObject(way, ObjectType::Way, "oneway", "-1");
+            }
+        }
+        for (std::size_t column = 0; column < GridSide; ++column)
+        {
+            auto nodes = std::vector<std::size_t>{};
+            for (std::size_t row = 0; row < GridSide; ++row)
+            {
+                nodes.push_back(grid[row * GridSide + column]);
+            }
+            const auto way = AddWay(map, std::move(nodes));
+            map.AddTagToObject(way, ObjectType::Way, "highway", "tertiary");
+            if (column % 5 == 2)
+            {
+                map.AddTagToObject(way, ObjectType::Way, "junction", "roundabout");
+            }
+        }
+
+        const auto river = AddWay(map, { AddNode(map, -5.0, -5.0), AddNode(map, 115.0, 115.0) });
+        map.AddTagToObject(river, ObjectType::Way, "waterway", "river");
+        const auto spur = AddWay(map, { grid[0], AddNode(map, -30.0, -30.0) });
+        map.AddTagToObject(spur, ObjectType::Way, "highway", "service");
+        map.AddTagToObject(spur, ObjectType::Way, "oneway", "yes");
+        return map;
+    }
+
+    struct RoadPoint
+    {
+        std::size_t segment;
+        double fraction;
+        double x;
+        double y;
+    };
+
+    // Away from the ends of the segment, so that it is the nearest one
+    RoadPoint RandomRoadPoint(const Map& map, const Roads& roads, std::mt19937& random)
+    {
+        const auto segment = std::uniform_int_distribution<std::size_t>{ 0, roads.GetSegments().size() - 1 }(random);
+        const auto fraction = std::uniform_real_distribution<double>{ 0.2, 0.8 }(random);
+        const auto& start = map.GetNodes()[roads.GetSegments()[segment].first];
+        const auto& end = map.GetNodes()[roads.GetSegments()[segment].second];
+        return RoadPoint{
+            segment, fraction, start.GetX() + fraction * (end.GetX() - start.GetX()), start.GetY() + fraction * (end.GetY() - start.GetY())
+        };
+    }
+
+    // The nodes of a route follow allowed moves and add up to its length with the parts of the end segments
+    void ExpectValidRoute(const Route& route, const Roads& roads)
+    {
+        EXPECT_LT(route.from.distance, 1e-9);
+        EXPECT_LT(route.to.distance, 1e-9);
+        if (route.nodes.empty())
+        {
+            return;
+        }
+        auto length = 0.0;
+        for (std::size_t i = 0; i + 1 < route.nodes.size(); ++i)
+        {
+            const auto arc = roads.ArcLength(route.nodes[i], route.nodes[i + 1]);
+            ASSERT_NE(arc, Infinity) << route.nodes[i] << " to " << route.nodes[i + 1];
+            length += arc;
+        }
+        EXPECT_LE(length, route.length + 1e-9);
+    }
+
+    void ExpectShortestRoutes(Database& database, const std::vector<RouteAlgorithm>& algorithms, std::mt19937& random)
+    {
+        const auto& map = database.GetMap();
+        const auto roads = Roads{ map };
+        auto found = 0;
+        for (auto i = 0; i < 300; ++i)
+        {
+            const auto from = RandomRoadPoint(map, roads, random);
+            const auto to = RandomRoadPoint(map, roads, random);
+            const auto expected = roads.ShortestLength(from.segment, from.fraction, to.segment, to.fraction);
+            for (const auto algorithm : algorithms)
+            {
+                const auto route = database.FindRoute(from.x, from.y, to.x, to.y, algorithm, 1.0);
+                ASSERT_EQ(route.has_value(), expected != Infinity) << ToString(algorithm) << " route " << i;
+                if (route)
+                {
+                    EXPECT_NEAR(route->length, expected, 1e-9 * std::max(1.0, expected)) << ToString(algorithm) << " route " << i;
+                    ExpectValidRoute(*route, roads);
+                }
+            }
+            found += expected != Infinity ? 1 : 0;
+        }
+        EXPECT_GT(found, 250);
+    }
+}
+
+TEST(RoutingTest, AllAlgorithmsFindTheShortestRoute)
+{
+    auto random = std::mt19937{ 16 };
+    auto database = Database::FromMap(GridMap());
+
+    database.EnableRouting();
+    ExpectShortestRoutes(database, { RouteAlgorithm::BidirectionalDijkstra, RouteAlgorithm::AStar }, random);
+
+    database.EnableRouting(true);
+    EXPECT_GT(database.GetRoadGraph()->GetShortcutCount(), 0u);
+    ExpectShortestRoutes(database, { RouteAlgorithm::BidirectionalDijkstra, RouteAlgorithm::AStar, RouteAlgorithm::ContractionHierarchy }, random);
+}
+
+TEST(RoutingTest, LeavesDeadEndsAndNonRoadsOut)
+{
+    const auto map = GridMap();
+    auto database = Database::FromMap(map);
+    database.EnableRouting(true);
+
+    const auto* graph = database.GetRoadGraph();
+    EXPECT_EQ(graph->GetVertexCount(), GridSide * GridSide + 1);
+
+    // Into the spur is fine, out of it there is no way
+    for (const auto algorithm : { RouteAlgorithm::BidirectionalDijkstra, RouteAlgorithm::AStar, RouteAlgorithm::ContractionHierarchy })
+    {
+        EXPECT_TRUE(database.FindRoute(55.0, 50.0, -20.0, -20.0, algorithm, 3.0).has_value()) << ToString(algorithm);
+        EXPECT_FALSE(database.FindRoute(-20.0, -20.0, 55.0, 50.0, algorithm, 3.0).has_value()) << ToString(algorithm);
+    }
+}
+
+TEST(RoutingTest, RebuildsTheGraphAfterChanges)
+{
+    auto random = std::mt19937{ 17 };
+    const auto map = GridMap();
+    auto database = Database::FromMap(map);
+    EXPECT_THROW(database.FindRoute(0.0, 0.0, 10.0, 10.0, RouteAlgorithm::AStar, 1.0), std::logic_error);
+    database.EnableRouting(true);
+
+    // Even rows become one way, every third column is closed to traffic
+    auto changes = MapChanges{};
+    for (std::size_t way = 0; way < 2 * GridSide; ++way)
+    {
+        auto nodes = std::vector<OsmId>{};
+        for (const auto node : map.GetWays()[way].GetNodes())
+        {
+            nodes.push_back(static_cast<OsmId>(node + 1));
+        }
+        if (way < GridSide && way % 2 == 0)
+        {
+            changes.ways.push_back(WayChange{
+                static_cast<OsmId>(way + 1), false, std::move(nodes), { Tag{ "highway", "residential" }, Tag{ "oneway", "yes" } }
+            });
+        }
+        else if (way >= GridSide && way % 3 == 0)
+        {
+            changes.ways.push_back(WayChange{ static_cast<OsmId>(way + 1), false, std::move(nodes), { Tag{ "barrier", "fence" } } });
+        }
+    }
+    database.ApplyChanges(changes);
+
+    ExpectShortestRoutes(database, { RouteAlgorithm::BidirectionalDijkstra, RouteAlgorithm::AStar, RouteAlgorithm::ContractionHierarchy }, random);
+    EXPECT_TRUE(database.GetRoadGraph()->IsContracted());
+}
+
+TEST(RoutingTest, ContractionHierarchiesNeedAContractedGraph)
+{
+    auto database = Database::FromMap(GridMap());
+    database.EnableRouting();
+    EXPECT_THROW(database.FindRoute(5.0, 0.0, 55.0, 50.0, RouteAlgorithm::ContractionHierarchy, 3.0), std::logic_error);
+    EXPECT_FALSE(database.FindRoute(500.0, 500.0, 55.0, 50.0, RouteAlgorithm::AStar, 3.0).has_value());
+}
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+
+// The server runs on epoll
+#if defined(__linux__)
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "TestMaps.h"
+#include "../GeoDb/Database.h"
+#include "../GeoDbServer/Protocol.h"
+#include "../GeoDbServer/Server.h"
+
+using namespace geodb;
+using namespace geodb::protocol;
+using namespace geodb::test;
+
+namespace
+{
+    struct Answer
+    {
+        ResponseHeader header = {};
+        std::vector<std::uint64_t> values = {};
+    };
+
+    // Runs the server's event loop for the lifetime of the test
+    class RunningServer
+    {
+    public:
+        explicit RunningServer(Database& database)
+            : m_server{ database, 0, 3 }
+            , m_loop{ [this]() { m_server.Run(); } }
+        { }
+
+        ~RunningServer()
+        {
+            m_server.Stop();
+            m_loop.join();
+        }
+
+        std::uint16_t GetPort() const { return m_server.GetPort(); }
+
+    private:
+        Server m_server;
+        std::thread m_loop;
+    };
+
+    // Blocking loopback client that gives up after a few seconds instead of hanging the test
+    class Client
+    {
+    public:
+        explicit Client(std::uint16_t port)
+            : m_socket{ ::socket(AF_INET, SOCK_STREAM, 0) }
+        {
+            auto address = sockaddr_in{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            address.sin_port = htons(port);
+            const auto timeout = timeval{ 5, 0 };
+            ::setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            m_connected = ::connect(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        }
+
+        Client(const Client& other) = delete;
+
+        Client& operator=(const Client& other) = delete;
+
+        ~Client()
+        {
+            ::close(m_socket);
+        }
+
+        bool IsConnected() const { return m_connected; }
+
+        bool Send(std::span<const std::byte> bytes)
+        {
+            while (!bytes.empty())
+            {
+                const auto sent = ::send(m_socket, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+                if (sent <= 0)
+                {
+                    return false;
+                }
+                bytes = bytes.subspan(static_cast<std::size_t>(sent));
+            }
+            return true;
+        }
+
+        // Answers by request id, fewer than expected when the server stopped answering
+        std::map<std::uint32_t, Answer> Receive(std::size_t expected)
+        {
+            auto answers = std::map<std::uint32_t, Answer>{};
+            auto input = std::vector<std::byte>{};
+            auto chunk = std::vector<std::byte>(64 * 1024);
+            while (answers.size() < expected)
+            {
+                const auto frameSize = GetFrameSize(input);
+                if (frameSize != 0 && input.size() >= frameSize)
+                {
+                    const auto frame = std::span<const std::byte>{ input }.first(frameSize);
+                    auto answer = Answer{ ParseResponseHeader(frame) };
+                    answer.values.resize(answer.header.values);
+                    std::memcpy(answer.values.data(), frame.data() + ResponseHeaderSize, answer.values.size() * sizeof(std::uint64_t));
+                    answers.emplace(answer.header.requestId, std::move(answer));
+                    input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(frameSize));
+                    continue;
+                }
+
+                const auto received = ::recv(m_socket, chunk.data(), chunk.size(), 0);
+                if (received <= 0)
+                {
+                    break;
+                }
+                input.insert(input.end(), chunk.begin(), chunk.begin() + received);
+            }
+            return answers;
+        }
+
+    private:
+        int m_socket;
+        bool m_connected = false;
+    };
+
+    std::vector<QueryResult> ToObjects(const std::vector<std::uint64_t>& keys)
+    {
+        auto objects = std::vector<QueryResult>{};
+        for (const auto key : keys)
+        {
+            objects.push_back(FromObjectKey(key));
+        }
+        return objects;
+    }
+}
+
+TEST(ServerTest, AnswersPipelinedRequestsLikeTheDatabase)
+{
+    auto random = std::mt19937{ 24 };
+    auto database = Database::FromMap(RandomMap(random, 2000, 500));
+    const auto server = RunningServer{ database };
+    auto client = Client{ server.GetPort() };
+    ASSERT_TRUE(client.IsConnected());
+
+    auto requests = std::vector<Request>{};
+    auto frames = std::vector<std::byte>{};
+    const auto add = [&](Request request)
+        {
+            request.id = static_cast<std::uint32_t>(requests.size());
+            AppendRequest(request, frames);
+            requests.push_back(request);
+        };
+    auto position = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+    for (auto i = 0; i < 30; ++i)
+    {
+        auto window = Request{};
+        window.type = i % 3 == 0 ? RequestType::Count : RequestType::Window;
+        window.window = RandomWindow(random, 1000.0, 150.0);
+        add(window);
+
+        auto nearest = Request{};
+        nearest.type = RequestType::Nearest;
+        nearest.x = position(random);
+        nearest.y = position(random);
+        nearest.k = i == 0 ? 100000 : static_cast<std::uint32_t>(i);
+        add(nearest);
+    }
+    auto bounds = Request{};
+    bounds.type = RequestType::Bounds;
+    add(bounds);
+
+    // An unknown request type, and a nearest request around a point that is not a number
+    const auto unknownId = static_cast<std::uint32_t>(requests.size());
+    auto unknown = bounds;
+    unknown.id = unknownId;
+    AppendRequest(unknown, frames);
+    frames.back() = std::byte{ 9 };
+    auto notANumber = Request{};
+    notANumber.id = unknownId + 1;
+    notANumber.type = RequestType::Nearest;
+    notANumber.x = std::numeric_limits<double>::quiet_NaN();
+    notANumber.k = 3;
+    AppendRequest(notANumber, frames);
+
+    ASSERT_TRUE(client.Send(frames));
+    const auto answers = client.Receive(requests.size() + 2);
+    ASSERT_EQ(answers.size(), requests.size() + 2);
+
+    for (const auto& request : requests)
+    {
+        const auto& answer = answers.at(request.id);
+        EXPECT_EQ(answer.header.status, Status::Ok) << request.id;
+        switch (request.type)
+        {
+        case RequestType::Window:
+            EXPECT_EQ(Sorted(ToObjects(answer.values)), Sorted(database.QueryObjects(request.window))) << request.id;
+            EXPECT_EQ(answer.header.count, answer.values.size());
+            break;
+        case RequestType::Count:
+            EXPECT_EQ(answer.header.count, database.QueryObjects(request.window).size()) << request.id;
+            EXPECT_TRUE(answer.values.empty());
+            break;
+        case RequestType::Nearest:
+        {
+            auto expected = std::vector<QueryResult>{};
+            for (const auto& object : database.QueryNearest(request.x, request.y, request.k))
+            {
+                expected.push_back(QueryResult{ object.objectId, object.objectType });
+            }
+            EXPECT_EQ(ToObjects(answer.values), expected) << request.id;
+            break;
+        }
+        case RequestType::Bounds:
+        {
+            const auto& area = database.GetIndexedArea();
+            ASSERT_EQ(answer.values.size(), 4u);
+            EXPECT_EQ(std::bit_cast<double>(answer.values[0]), area.GetCenterX() - area.GetHalfWidth());
+            EXPECT_EQ(std::bit_cast<double>(answer.values[1]), area.GetCenterY() - area.GetHalfHeight());
+            EXPECT_EQ(std::bit_cast<double>(answer.values[2]), area.GetCenterX() + area.GetHalfWidth());
+            EXPECT_EQ(std::bit_cast<double>(answer.values[3]), area.GetCenterY() + area.GetHalfHeight());
+            break;
+        }
+        }
+    }
+    EXPECT_EQ(answers.at(unknownId).header.status, Status::BadRequest);
+    EXPECT_EQ(answers.at(unknownId + 1).header.status, Status::BadRequest);
+    EXPECT_TRUE(answers.at(unknownId + 1).values.empty());
+}
+
+#endif
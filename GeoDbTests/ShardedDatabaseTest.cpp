@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/ShardedDatabase.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    std::vector<DistanceQueryResult> SortedById(std::vector<DistanceQueryResult> results)
+    {
+        std::sort(results.begin(), results.end(), [](const auto& r1, const auto& r2)
+        {
+            return QueryResult{ r1.objectId, r1.objectType } < QueryResult{ r2.objectId, r2.objectType };
+        });
+        return results;
+    }
+}
+
+TEST(ShardedDatabaseTest, MatchesSingleDatabase)
+{
+    auto random = std::mt19937{ 4 };
+    const auto map = RandomMap(random, 3000, 800);
+    auto database = Database::FromMap(map);
+
+    for (const auto shardsPerSide : { 1, 2, 5 })
+    {
+        auto sharded = ShardedDatabase{ map, shardsPerSide };
+        EXPECT_EQ(sharded.GetShardCount(), static_cast<std::size_t>(shardsPerSide * shardsPerSide));
+        EXPECT_EQ(sharded.CountShardsOverlapping(database.GetIndexedArea()), sharded.GetShardCount());
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            const auto window = RandomWindow(random, 1000.0, 300.0);
+            EXPECT_EQ(Sorted(sharded.QueryObjects(window)), Sorted(database.QueryObjects(window)));
+        }
+
+        for (auto i = 0; i < 50; ++i)
+        {
+            auto position = std::uniform_real_distribution<double>{ 0.0, 1000.0 };
+            const auto x = position(random);
+            const auto y = position(random);
+            const auto expected = SortedById(database.QueryRadius(x, y, 60.0));
+            const auto actual = SortedById(sharded.QueryRadius(x, y, 60.0));
+            ASSERT_EQ(actual.size(), expected.size());
+            for (std::size_t j = 0; j < expected.size(); ++j)
+            {
+                EXPECT_EQ(actual[j].objectId, expected[j].objectId);
+                EXPECT_EQ(actual[j].objectType, expected[j].objectType);
+                EXPECT_DOUBLE_EQ(actual[j].distance, expected[j].distance);
+            }
+        }
+    }
+}
+
+// Ways crossing shard borders belong to the shard holding their center and are reported once
+TEST(ShardedDatabaseTest, ReportsWaysCrossingShardsOnce)
+{
+    auto map = Map{};
+    AddNode(map, 0.0, 0.0);
+    AddNode(map, 100.0, 100.0);
+    AddWay(map, { AddNode(map, 10.0, 50.0), AddNode(map, 90.0, 50.0) });
+    AddWay(map, { AddNode(map, 50.0, 10.0), AddNode(map, 50.0, 90.0) });
+    auto sharded = ShardedDatabase{ map, 2 };
+
+    const auto results = sharded.QueryObjects(quadtree::Rectangle<double>{ 50.0, 50.0, 45.0, 45.0 });
+    EXPECT_EQ(Sorted(results), (std::vector<QueryResult>{ { 0, ObjectType::Way }, { 1, ObjectType::Way } }));
+    EXPECT_EQ(sharded.CountShardsOverlapping(quadtree::Rectangle<double>{ 20.0, 80.0, 1.0, 1.0 }), 1u);
+}
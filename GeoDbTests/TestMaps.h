@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "../GeoDb/Algo2d.h"
+#include "../GeoDb/Map.h"
+
+// Small maps built in memory, OSM ids are the object index plus one
+namespace geodb::test
+{
+    inline quadtree::Rectangle<double> BoundingBoxOf(const Map& map, const std::vector<std::size_t>& nodes)
+    {
+        auto minX = map.GetNodes()[nodes[0]].GetX();
+        auto maxX = minX;
+        auto minY = map.GetNodes()[nodes[0]].GetY();
+        auto maxY = minY;
+        for (const auto node : nodes)
+        {
+            minX = std::min(minX, map.GetNodes()[node].GetX());
+            maxX = std::max(maxX, map.GetNodes()[node].GetX());
+            minY = std::min(minY, map.GetNodes()[node].GetY());
+            maxY = std::max(maxY, map.GetNodes()[node].GetY());
+        }
+        return quadtree::Rectangle<double>::Of(minX, maxY, maxX - minX, maxY - minY);
+    }
+
+    inline std::size_t AddNode(Map& map, double x, double y)
+    {
+        map.GetNodes().emplace_back(x, y);
+        const auto nodeIndex = map.GetNodes().size() - 1;
+        map.SetOsmId(nodeIndex, ObjectType::Node, static_cast<OsmId>(nodeIndex + 1));
+        return nodeIndex;
+    }
+
+    inline std::size_t AddWay(Map& map, std::vector<std::size_t> nodes)
+    {
+        const auto boundingBox = BoundingBoxOf(map, nodes);
+        map.GetWays().emplace_back(std::move(nodes), boundingBox);
+        const auto wayIndex = map.GetWays().size() - 1;
+        map.SetOsmId(wayIndex, ObjectType::Way, static_cast<OsmId>(wayIndex + 1));
+        return wayIndex;
+    }
+
+    // Scattered nodes, every third one tagged, and short ways of fresh nodes wandering from random points. Every
+    // other way is tagged as a road
+    inline Map RandomMap(std::mt19937& random, std::size_t nodeCount, std::size_t wayCount, double size = 1000.0)
+    {
+        auto coordinate = std::uniform_real_distribution<double>{ 0.0, size };
+        auto step = std::uniform_real_distribution<double>{ -size / 50.0, size / 50.0 };
+        auto length = std::uniform_int_distribution<std::size_t>{ 2, 6 };
+
+        auto map = Map{};
+        for (std::size_t i = 0; i < nodeCount; ++i)
+        {
+            const auto node = AddNode(map, coordinate(random), coordinate(random));
+            if (i % 3 == 0)
+            {
+                map.AddTagToObject(node, ObjectType::Node, "amenity", "cafe");
+            }
+        }
+        for (std::size_t i = 0; i < wayCount; ++i)
+        {
+            auto nodes = std::vector<std::size_t>{ AddNode(map, coordinate(random), coordinate(random)) };
+            for (auto j = length(random); j > 1; --j)
+            {
+                const auto& last = map.GetNodes()[nodes.back()];
+                nodes.push_back(AddNode(map, last.GetX() + step(random), last.GetY() + step(random)));
+            }
+            const auto way = AddWay(map, std::move(nodes));
+            if (i % 2 == 0)
+            {
+                map.AddTagToObject(way, ObjectType::Way, "highway", "residential");
+            }
+        }
+        return map;
+    }
+
+    inline quadtree::Rectangle<double> RandomWindow(std::mt19937& random, double size = 1000.0, double maxSide = 100.0)
+    {
+        auto position = std::uniform_real_distribution<double>{ 0.0, size };
+        auto side = std::uniform_real_distribution<double>{ 0.5, maxSide };
+        return quadtree::Rectangle<double>{ position(random), position(random), side(random), side(random) };
+    }
+
+    inline bool Contains(const quadtree::Rectangle<double>& window, double x, double y)
+    {
+        return x >= window.GetCenterX() - window.GetHalfWidth() && x <= window.GetCenterX() + window.GetHalfWidth()
+            && y >= window.GetCenterY() - window.GetHalfHeight() && y <= window.GetCenterY() + window.GetHalfHeight();
+    }
+
+    // A way matches a window when one of its nodes lies inside or one of its segments crosses the border
+    inline bool Intersects(const Map& map, const Way& way, const quadtree::Rectangle<double>& window)
+    {
+        const auto& nodes = way.GetNodes();
+        for (const auto node : nodes)
+        {
+            if (Contains(window, map.GetNodes()[node].GetX(), map.GetNodes()[node].GetY()))
+            {
+                return true;
+            }
+        }
+        for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+        {
+            const auto& start = map.GetNodes()[nodes[i]];
+            const auto& end = map.GetNodes()[nodes[i + 1]];
+            const auto intersects = algo::LineRectangleIntersection(
+                start.GetX(), start.GetY(), end.GetX(), end.GetY(),
+                window.GetCenterX() - window.GetHalfWidth(), window.GetCenterY() + window.GetHalfHeight(),
+                2.0 * window.GetHalfWidth(), 2.0 * window.GetHalfHeight());
+            if (intersects)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // What Database::Query answers, found by looking at every object: the matching ways, then the tagged nodes inside
+    inline std::vector<std::size_t> BruteForceQuery(const Map& map, const quadtree::Rectangle<double>& window)
+    {
+        auto result = std::vector<std::size_t>{};
+        for (std::size_t i = 0; i < map.GetWays().size(); ++i)
+        {
+            if (!map.GetWays()[i].IsDeleted() && Intersects(map, map.GetWays()[i], window))
+            {
+                result.push_back(i);
+            }
+        }
+        for (std::size_t i = 0; i < map.GetNodes().size(); ++i)
+        {
+            const auto& node = map.GetNodes()[i];
+            if (map.GetObjectTags(i, ObjectType::Node) != nullptr && Contains(window, node.GetX(), node.GetY()))
+            {
+                result.push_back(i);
+            }
+        }
+        return result;
+    }
+
+    template<typename T>
+    std::vector<T> Sorted(std::vector<T> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values;
+    }
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "TestMaps.h"
+#include "../GeoDb/Algo2d.h"
+#include "../GeoDb/Database.h"
+#include "../GeoDb/WaySnapping.h"
+
+using namespace geodb;
+using namespace geodb::test;
+
+namespace
+{
+    // Distance to the nearest segment of any way matching the filter, by looking at all of them
+    double BruteForceDistance(const Map& map, const Node& point, const TagFilter& tagFilter)
+    {
+        auto best = std::numeric_limits<double>::infinity();
+        for (std::size_t way = 0; way < map.GetWays().size(); ++way)
+        {
+            if (!tagFilter.Matches(map.GetObjectTags(way, ObjectType::Way)))
+            {
+                continue;
+            }
+            const auto& nodes = map.GetWays()[way].GetNodes();
+            for (std::size_t i = 0; i + 1 < nodes.size(); ++i)
+            {
+                const auto& start = map.GetNodes()[nodes[i]];
+                const auto& end = map.GetNodes()[nodes[i + 1]];
+                best = std::min(best, algo::PointSegmentDistance(point.GetX(), point.GetY(), start.GetX(), start.GetY(), end.GetX(), end.GetY()));
+            }
+        }
+        return best;
+    }
+
+    // The snap lies on the segment it names, at its fraction and distance from the point
+    void ExpectOnSegment(const Map& map, const Node& point, const WaySnap& snap)
+    {
+        const auto& nodes = map.GetWays()[snap.wayIndex].GetNodes();
+        ASSERT_LT(snap.segment + 1, nodes.size());
+        const auto& start = map.GetNodes()[nodes[snap.segment]];
+        const auto& end = map.GetNodes()[nodes[snap.segment + 1]];
+        EXPECT_GE(snap.fraction, 0.0);
+        EXPECT_LE(snap.fraction, 1.0);
+        EXPECT_NEAR(snap.x, start.GetX() + snap.fraction * (end.GetX() - start.GetX()), 1e-9);
+        EXPECT_NEAR(snap.y, start.GetY() + snap.fraction * (end.GetY() - start.GetY()), 1e-9);
+        EXPECT_NEAR(snap.distance, algo::PointPointDistance(point.GetX(), point.GetY(), snap.x, snap.y), 1e-9);
+    }
+
+    // Traces wandering through the map like GPS fixes of vehicles, and points scattered over and around it
+    std::vector<Node> RandomPoints(std::mt19937& random)
+    {
+        auto position = std::uniform_real_distribution<double>{ -100.0, 1100.0 };
+        auto step = std::uniform_real_distribution<double>{ -3.0, 3.0 };
+        auto points = std::vector<Node>{};
+        for (auto trace = 0; trace < 5; ++trace)
+        {
+            auto x = position(random);
+            auto y = position(random);
+            for (auto i = 0; i < 1000; ++i)
+            {
+                x += step(random);
+                y += step(random);
+                points.emplace_back(x, y);
+            }
+        }
+        for (auto i = 0; i < 3000; ++i)
+        {
+            points.emplace_back(position(random), position(random));
+        }
+        return points;
+    }
+}
+
+TEST(WaySnappingTest, MatchesBruteForce)
+{
+    auto random = std::mt19937{ 18 };
+    const auto map = RandomMap(random, 0, 800);
+    const auto points = RandomPoints(random);
+
+    for (const auto engine : { IndexEngine::Quadtree, IndexEngine::RTree })
+    {
+        auto database = Database::FromMap(map, engine);
+        for (const auto& tagFilter : { TagFilter{}, TagFilter{ "highway", "" }, TagFilter{ "highway", "residential" } })
+        {
+            const auto snaps = database.SnapToWays(points, 15.0, tagFilter);
+            ASSERT_EQ(snaps.size(), points.size());
+            auto snapped = 0;
+            for (std::size_t i = 0; i < points.size(); ++i)
+            {
+                const auto expected = BruteForceDistance(map, points[i], tagFilter);
+                ASSERT_EQ(snaps[i].has_value(), expected <= 15.0) << "point " << i << " at " << expected;
+                if (snaps[i])
+                {
+                    EXPECT_NEAR(snaps[i]->distance, expected, 1e-9) << "point " << i;
+                    EXPECT_TRUE(tagFilter.Matches(map.GetObjectTags(snaps[i]->wayIndex, ObjectType::Way)));
+                    ExpectOnSegment(map, points[i], *snaps[i]);
+                    ++snapped;
+                }
+            }
+            EXPECT_GT(snapped, 1000);
+        }
+
+        const auto none = database.SnapToWays(points, 15.0, TagFilter{ "highway", "motorway" });
+        EXPECT_EQ(std::count(none.begin(), none.end(), std::nullopt), static_cast<std::ptrdiff_t>(points.size()));
+    }
+}
+
+TEST(WaySnappingTest, SnapsPointsOnWaysWithinNoDistance)
+{
+    auto random = std::mt19937{ 19 };
+    const auto map = RandomMap(random, 0, 100);
+    auto database = Database::FromMap(map);
+
+    auto points = std::vector<Node>{};
+    for (const auto& way : map.GetWays())
+    {
+        points.push_back(map.GetNodes()[way.GetNodes()[0]]);
+    }
+    points.emplace_back(-1.0, -1.0);
+
+    const auto snaps = database.SnapToWays(points, 0.0);
+    for (std::size_t i = 0; i + 1 < points.size(); ++i)
+    {
+        ASSERT_TRUE(snaps[i].has_value()) << i;
+        EXPECT_EQ(snaps[i]->distance, 0.0);
+        EXPECT_EQ(snaps[i]->x, points[i].GetX());
+        EXPECT_EQ(snaps[i]->y, points[i].GetY());
+    }
+    EXPECT_FALSE(snaps.back().has_value());
+
+    EXPECT_TRUE(database.SnapToWays({}, 10.0).empty());
+    EXPECT_THROW(database.SnapToWays(points, -1.0), std::invalid_argument);
+    EXPECT_THROW(database.SnapToWays(points, std::numeric_limits<double>::infinity()), std::invalid_argument);
+    EXPECT_THROW(database.SnapToWays(points, std::numeric_limits<double>::quiet_NaN()), std::invalid_argument);
+}
+
+// All ways on one horizontal line, so the map has no height to order the points along
+TEST(WaySnappingTest, SnapsOnMapsWithoutHeight)
+{
+    auto map = Map{};
+    AddWay(map, { AddNode(map, 0.0, 5.0), AddNode(map, 10.0, 5.0) });
+    AddWay(map, { AddNode(map, 20.0, 5.0), AddNode(map, 30.0, 5.0) });
+    auto database = Database::FromMap(map);
+
+    const auto points = std::vector<Node>{ Node{ 2.0, 5.0 }, Node{ 25.0, 7.0 }, Node{ 15.0, 5.0 } };
+    const auto snaps = database.SnapToWays(points, 3.0);
+    ASSERT_EQ(snaps.size(), 3u);
+    ASSERT_TRUE(snaps[0].has_value());
+    EXPECT_EQ(snaps[0]->wayIndex, 0u);
+    EXPECT_EQ(snaps[0]->distance, 0.0);
+    ASSERT_TRUE(snaps[1].has_value());
+    EXPECT_EQ(snaps[1]->wayIndex, 1u);
+    EXPECT_DOUBLE_EQ(snaps[1]->distance, 2.0);
+    EXPECT_FALSE(snaps[2].has_value());
+}
+
+// Segments of an odd count so that the last one takes the scalar path, one of zero length, and a tie between two ways
+TEST(WaySnappingTest, CandidatesPickTheNearestAndBreakTiesByWay)
+{
+    auto candidates = SegmentCandidates{};
+    candidates.Add(7, 0, 0.0, 10.0, 10.0, 10.0);
+    candidates.Add(5, 2, 0.0, -10.0, 10.0, -10.0);
+    candidates.Add(3, 1, 20.0, 0.0, 20.0, 0.0);
+    EXPECT_EQ(candidates.GetSize(), 3u);
+
+    const auto tie = candidates.FindNearest(4.0, 0.0, 100.0);
+    ASSERT_TRUE(tie.has_value());
+    EXPECT_EQ(tie->wayIndex, 5u);
+    EXPECT_EQ(tie->segment, 2u);
+    EXPECT_DOUBLE_EQ(tie->fraction, 0.4);
+    EXPECT_DOUBLE_EQ(tie->distance, 10.0);
+
+    const auto point = candidates.FindNearest(19.0, 1.0, 100.0);
+    ASSERT_TRUE(point.has_value());
+    EXPECT_EQ(point->wayIndex, 3u);
+    EXPECT_EQ(point->fraction, 0.0);
+    EXPECT_EQ(point->x, 20.0);
+    EXPECT_DOUBLE_EQ(point->distance, std::sqrt(2.0));
+
+    EXPECT_FALSE(candidates.FindNearest(4.0, 0.0, 9.0).has_value());
+    candidates.Clear();
+    EXPECT_EQ(candidates.GetSize(), 0u);
+    EXPECT_FALSE(candidates.FindNearest(4.0, 0.0, 100.0).has_value());
+}
@@ -51,36 +51,36 @@ int main(int argc, char** argv)
 
     auto window = sf::RenderWindow{ sf::VideoMode({ WindowWidth, WindowHeight }), "Voronezh" };
 
-    auto addNode = [&](std::size_t i, const geodb::Way& way, std::vector<sf::Vertex>& projectedWay, bool insertTwice = false)
-        {
-            const auto& nodeIndex = way.GetNodes()[i];
-            const auto& node = database.GetMap().GetNodes()[nodeIndex];
-            const auto position = sf::Vector2f{ static_cast<float>(node.GetX()), static_cast<float>(node.GetY()) };
-            projectedWay.push_back(sf::Vertex{ position, sf::Color::Black });
-            if (insertTwice)
-            {
-                projectedWay.push_back(sf::Vertex{ position, sf::Color::Black });
-            }
-        };
+    database.EnableCompressedGeometry();
+    const auto& geometry = *database.GetCompressedGeometry();
 
+    // Every inner vertex ends one line and starts the next
     auto sfmlIdToDatabaseId = std::unordered_map<std::size_t, std::size_t>{};
     auto ways = std::vector<std::vector<sf::Vertex>>{};
-    for (std::size_t wayId = 0; wayId < database.GetMap().GetWays().size(); ++wayId)
+    for (std::size_t wayId = 0; wayId < geometry.GetWayCount(); ++wayId)
     {
-        const auto& way = database.GetMap().GetWays()[wayId];
-
-        auto projectedWay = std::vector<sf::Vertex>{};
-
-        addNode(0, way, projectedWay);
-
-        for (std::size_t i = 1; i < way.GetNodes().size() - 1; ++i)
+        const auto vertexCount = geometry.GetVertexCount(wayId);
+        if (vertexCount == 0)
         {
-            addNode(i, way, projectedWay, true);
+            continue;
         }
 
-        if (way.GetNodes().size() != 1)
+        auto projectedWay = std::vector<sf::Vertex>{};
+        projectedWay.reserve(vertexCount * 2);
+
+        auto decoder = geodb::CompressedGeometry::Decoder{ geometry, wayId };
+        auto vertex = std::size_t{ 0 };
+        for (auto count = decoder.Next(); count != 0; count = decoder.Next())
         {
-            addNode(way.GetNodes().size() - 1, way, projectedWay);
+            for (std::size_t i = 0; i < count; ++i, ++vertex)
+            {
+                const auto position = sf::Vector2f{ static_cast<float>(decoder.GetX()[i]), static_cast<float>(decoder.GetY()[i]) };
+                projectedWay.push_back(sf::Vertex{ position, sf::Color::Black });
+                if (vertex != 0 && vertex + 1 != vertexCount)
+                {
+                    projectedWay.push_back(sf::Vertex{ position, sf::Color::Black });
+                }
+            }
         }
 
         ways.push_back(std::move(projectedWay));
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace quadtree
+{
+	// Results of a batch of queries stored back to back, results of the i-th query
+	// occupy values[offsets[i], offsets[i + 1])
+	template<typename T>
+	struct BatchResult
+	{
+		std::vector<T> values;
+		std::vector<std::size_t> offsets;
+
+		std::size_t size() const
+		{
+			return offsets.empty() ? 0 : offsets.size() - 1;
+		}
+
+		std::span<const T> operator[](std::size_t queryIndex) const
+		{
+			return std::span<const T>{ values.data() + offsets[queryIndex], values.data() + offsets[queryIndex + 1] };
+		}
+	};
+}
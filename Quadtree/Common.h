@@ -2,10 +2,26 @@
 
 #include <concepts>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
 namespace quadtree
 {
 	template<typename T>
 	concept Numeric = std::is_arithmetic_v<T>;
 
 	using Index = std::int32_t;
+
+	// Hints the CPU to start loading a node that will be visited soon
+	inline void Prefetch(const void* address)
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+		__builtin_prefetch(address);
+#else
+		(void)address;
+#endif
+	}
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace quadtree
+{
+	struct MemoryUsage
+	{
+		std::size_t quadtreeNodeBytes = 0;
+		std::size_t axisNodeBytes = 0;
+		std::size_t listNodeBytes = 0;
+
+		std::size_t GetTotalBytes() const
+		{
+			return quadtreeNodeBytes + axisNodeBytes + listNodeBytes;
+		}
+	};
+
+	struct IndexStatistics
+	{
+		std::size_t elements = 0;
+		std::size_t xAxisElements = 0;
+		std::size_t yAxisElements = 0;
+		std::size_t axisLists = 0;
+		std::size_t longestAxisList = 0;
+		int maxDepthReached = 0;
+
+		// Indexed by quadtree depth, root is depth 1 and lives at index 0
+		std::vector<std::size_t> nodesPerDepth;
+		std::vector<std::size_t> elementsPerDepth;
+
+		// Bucket 0 counts empty entries, bucket i counts entries of size [2^(i - 1), 2^i)
+		std::vector<std::size_t> elementsPerNodeHistogram;
+		std::vector<std::size_t> axisListLengthHistogram;
+
+		MemoryUsage memory;
+
+		static std::size_t GetHistogramBucket(std::size_t size)
+		{
+			return static_cast<std::size_t>(std::bit_width(size));
+		}
+
+		static void AddToHistogram(std::vector<std::size_t>& histogram, std::size_t size)
+		{
+			const auto bucket = GetHistogramBucket(size);
+			if (histogram.size() <= bucket)
+			{
+				histogram.resize(bucket + 1, 0);
+			}
+			++histogram[bucket];
+		}
+	};
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Common.h"
+#include "Rectangle.h"
+#include "QueryStatistics.h"
+#include "Shape.h"
+
+namespace quadtree
+{
+	// Bucket PR quadtree over points. Nodes live in one vector and refer to their children by index,
+	// points are kept only in leaf buckets which split once they exceed the bucket capacity
+	template<Numeric N>
+	class PointQuadtree final
+	{
+	public:
+		using Id = std::uint32_t;
+
+		struct Point
+		{
+			N x;
+			N y;
+			Id id;
+		};
+
+		PointQuadtree(const Rectangle<N>& indexedArea, int maxDepth, std::size_t bucketCapacity = DefaultBucketCapacity)
+			: m_indexedArea{ indexedArea }
+			, m_maxDepth{ maxDepth }
+			, m_bucketCapacity{ bucketCapacity }
+		{
+			m_nodes.emplace_back();
+		}
+
+		void Insert(N x, N y, Id id)
+		{
+			auto nodeIndex = Index{ 0 };
+			auto area = m_indexedArea;
+			auto depth = 1;
+
+			while (!m_nodes[nodeIndex].IsLeaf())
+			{
+				const auto quadrant = GetQuadrant(area, x, y);
+				auto childIndex = m_nodes[nodeIndex].children[quadrant];
+				if (childIndex == NoNode)
+				{
+					childIndex = static_cast<Index>(m_nodes.size());
+					m_nodes.emplace_back();
+					m_nodes[nodeIndex].children[quadrant] = childIndex;
+				}
+				nodeIndex = childIndex;
+				area = GetChildArea(quadrant, area);
+				++depth;
+			}
+
+			m_nodes[nodeIndex].points.push_back(Point{ x, y, id });
+			++m_size;
+
+			if (m_nodes[nodeIndex].points.size() > m_bucketCapacity && depth < m_maxDepth)
+			{
+				Split(nodeIndex, area);
+			}
+		}
+
+		bool Remove(N x, N y, Id id)
+		{
+			auto nodeIndex = Index{ 0 };
+			auto area = m_indexedArea;
+
+			while (!m_nodes[nodeIndex].IsLeaf())
+			{
+				const auto quadrant = GetQuadrant(area, x, y);
+				nodeIndex = m_nodes[nodeIndex].children[quadrant];
+				if (nodeIndex == NoNode)
+				{
+					return false;
+				}
+				area = GetChildArea(quadrant, area);
+			}
+
+			auto& points = m_nodes[nodeIndex].points;
+			for (std::size_t i = 0; i < points.size(); ++i)
+			{
+				if (points[i].id == id)
+				{
+					points[i] = points.back();
+					points.pop_back();
+					--m_size;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template<typename Window>
+		void Query(const Window& searchWindow, std::vector<Point>& result) const
+		{
+			auto statistics = NoQueryStatistics{};
+			Query(0, m_indexedArea, searchWindow, result, statistics);
+		}
+
+		template<typename Window>
+		void Query(const Window& searchWindow, std::vector<Point>& result, QueryStatistics& statistics) const
+		{
+			Query(0, m_indexedArea, searchWindow, result, statistics);
+		}
+
+		const Rectangle<N>& GetIndexedArea() const { return m_indexedArea; }
+
+		std::size_t GetSize() const { return m_size; }
+
+		std::size_t GetAllocatedBytes() const
+		{
+			auto bytes = m_nodes.capacity() * sizeof(PointQuadtreeNode);
+			for (const auto& node : m_nodes)
+			{
+				bytes += node.points.capacity() * sizeof(Point);
+			}
+			return bytes;
+		}
+
+	private:
+		static constexpr std::size_t DefaultBucketCapacity = 32;
+		static constexpr Index NoNode = -1;
+
+		struct PointQuadtreeNode
+		{
+			std::array<Index, 4> children = { { NoNode, NoNode, NoNode, NoNode } };
+			std::vector<Point> points;
+			bool isLeaf = true;
+
+			bool IsLeaf() const { return isLeaf; }
+		};
+
+		// Quadrant order matches Quadtree: NE, NW, SW, SE
+		static int GetQuadrant(const Rectangle<N>& area, N x, N y)
+		{
+			if (x < area.GetCenterX())
+			{
+				return y < area.GetCenterY() ? 2 : 1;
+			}
+			return y < area.GetCenterY() ? 3 : 0;
+		}
+
+		static Rectangle<N> GetChildArea(int quadrant, const Rectangle<N>& area)
+		{
+			static constexpr std::array<int, 4> directionsX = { { 1, -1, -1,  1 } };
+			static constexpr std::array<int, 4> directionsY = { { 1,  1, -1, -1 } };
+
+			const auto childWidth = area.GetHalfWidth() / 2;
+			const auto childHeight = area.GetHalfHeight() / 2;
+
+			return Rectangle<N>{
+				area.GetCenterX() + childWidth * directionsX[quadrant],
+				area.GetCenterY() + childHeight * directionsY[quadrant],
+				childWidth,
+				childHeight
+			};
+		}
+
+		void Split(Index nodeIndex, const Rectangle<N>& area)
+		{
+			auto points = std::move(m_nodes[nodeIndex].points);
+			m_nodes[nodeIndex].points = {};
+			m_nodes[nodeIndex].isLeaf = false;
+			m_size -= points.size();
+
+			for (const auto& point : points)
+			{
+				const auto quadrant = GetQuadrant(area, point.x, point.y);
+				if (m_nodes[nodeIndex].children[quadrant] == NoNode)
+				{
+					m_nodes[nodeIndex].children[quadrant] = static_cast<Index>(m_nodes.size());
+					m_nodes.emplace_back();
+				}
+			}
+			for (const auto& point : points)
+			{
+				Insert(point.x, point.y, point.id);
+			}
+		}
+
+		// Points may lie outside of the indexed area, so borders shared with it are treated as unbounded
+		template<typename Window>
+		bool CellIntersects(const Rectangle<N>& area, const Window& searchWindow) const
+		{
+			const auto lowest = std::numeric_limits<N>::lowest();
+			const auto highest = std::numeric_limits<N>::max();
+
+			auto minX = area.GetCenterX() - area.GetHalfWidth();
+			auto maxX = area.GetCenterX() + area.GetHalfWidth();
+			auto minY = area.GetCenterY() - area.GetHalfHeight();
+			auto maxY = area.GetCenterY() + area.GetHalfHeight();
+
+			minX = minX <= m_indexedArea.GetCenterX() - m_indexedArea.GetHalfWidth() ? lowest : minX;
+			maxX = maxX >= m_indexedArea.GetCenterX() + m_indexedArea.GetHalfWidth() ? highest : maxX;
+			minY = minY <= m_indexedArea.GetCenterY() - m_indexedArea.GetHalfHeight() ? lowest : minY;
+			maxY = maxY >= m_indexedArea.GetCenterY() + m_indexedArea.GetHalfHeight() ? highest : maxY;
+
+			if constexpr (Shape<Window, N>)
+			{
+				return searchWindow.IntersectsBox(minX, minY, maxX, maxY);
+			}
+			else
+			{
+				return minX <= searchWindow.GetCenterX() + searchWindow.GetHalfWidth()
+					&& searchWindow.GetCenterX() - searchWindow.GetHalfWidth() <= maxX
+					&& minY <= searchWindow.GetCenterY() + searchWindow.GetHalfHeight()
+					&& searchWindow.GetCenterY() - searchWindow.GetHalfHeight() <= maxY;
+			}
+		}
+
+		template<typename Window>
+		static bool PointInWindow(const Point& point, const Window& searchWindow)
+		{
+			if constexpr (Shape<Window, N>)
+			{
+				return searchWindow.IntersectsBox(point.x, point.y, point.x, point.y);
+			}
+			else
+			{
+				return searchWindow.GetCenterX() - searchWindow.GetHalfWidth() <= point.x
+					&& point.x <= searchWindow.GetCenterX() + searchWindow.GetHalfWidth()
+					&& searchWindow.GetCenterY() - searchWindow.GetHalfHeight() <= point.y
+					&& point.y <= searchWindow.GetCenterY() + searchWindow.GetHalfHeight();
+			}
+		}
+
+		template<typename Window, QueryStatisticsCollector Statistics>
+		void Query
+		(
+			Index nodeIndex,
+			const Rectangle<N>& area,
+			const Window& searchWindow,
+			std::vector<Point>& result,
+			Statistics& statistics
+		) const
+		{
+			if (nodeIndex == NoNode || !CellIntersects(area, searchWindow))
+			{
+				return;
+			}
+			if constexpr (CollectsStatistics<Statistics>)
+			{
+				++statistics.quadtreeNodesVisited;
+			}
+
+			const auto& node = m_nodes[nodeIndex];
+			if (node.IsLeaf())
+			{
+				for (const auto& point : node.points)
+				{
+					if constexpr (CollectsStatistics<Statistics>)
+					{
+						++statistics.listElementsTested;
+					}
+					if (PointInWindow(point, searchWindow))
+					{
+						if constexpr (CollectsStatistics<Statistics>)
+						{
+							++statistics.candidatesReturned;
+						}
+						result.push_back(point);
+					}
+				}
+				return;
+			}
+
+			for (int i = 0; i < 4; ++i)
+			{
+				Query(node.children[i], GetChildArea(i, area), searchWindow, result, statistics);
+			}
+		}
+
+		Rectangle<N> m_indexedArea;
+		int m_maxDepth;
+		std::size_t m_bucketCapacity;
+		std::size_t m_size = 0;
+		std::vector<PointQuadtreeNode> m_nodes;
+	};
+}
@@ -1,23 +1,31 @@
 #pragma once
 
 #include <concepts>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "BatchResult.h"
 #include "Common.h"
 #include "Rectangle.h"
+#include "Rectangular.h"
+#include "QueryStatistics.h"
+#include "Shape.h"
+#include "IndexStatistics.h"
 
 namespace quadtree
 {
-	template<typename T, typename N>
-	concept Rectangular = Numeric<N> && requires(T a)
-	{
-		{ a.GetCenterX() } -> std::convertible_to<N>;
-		{ a.GetCenterY() } -> std::convertible_to<N>;
-		{ a.GetHalfWidth() } -> std::convertible_to<N>;
-		{ a.GetHalfHeight() } -> std::convertible_to<N>;
-	};
-
 	template<Numeric N, Rectangular<N> R>
 	class Quadtree final
 	{
@@ -27,43 +35,241 @@ namespace quadtree
 		Quadtree(Quadtree&& other)
 			: m_indexedArea{ other.m_indexedArea }
 			, m_maxDepth{ other.m_maxDepth }
+			, m_cellHalfSizes{ std::move(other.m_cellHalfSizes) }
+			, m_resource{ other.m_resource }
 			, m_root{ other.m_root }
+			, m_quadtreeNodesCount{ other.m_quadtreeNodesCount }
+			, m_axisNodesCount{ other.m_axisNodesCount }
+			, m_elementsCount{ other.m_elementsCount }
 		{
 			other.m_root = nullptr;
 		}
 
 		Quadtree& operator=(const Quadtree& other) = delete;
 
-		Quadtree(const Rectangle<N>& indexedArea, int maxDepth)
+		// Traversals use fixed-size stacks, which bounds the depth
+		static constexpr int MaxSupportedDepth = 64;
+
+		// Nodes and list elements are allocated from the resource, which must outlive the tree and be thread-safe
+		// for ParallelInsert
+		Quadtree(const Rectangle<N>& indexedArea, int maxDepth, std::pmr::memory_resource* resource = std::pmr::new_delete_resource())
 			: m_indexedArea{ indexedArea }
 			, m_maxDepth{ maxDepth }
+			, m_resource{ resource }
 		{
-			m_root = new QuadtreeNode;
+			if (maxDepth < 1 || maxDepth > MaxSupportedDepth)
+			{
+				throw std::invalid_argument{ "Quadtree depth must be between 1 and MaxSupportedDepth" };
+			}
+
+			// A node at depth d has level d - 1, each level of its axis trees adds one more
+			m_cellHalfSizes.reserve(2 * maxDepth + 1);
+			auto halfSize = CellHalfSize{ indexedArea.GetHalfWidth(), indexedArea.GetHalfHeight() };
+			for (int level = 0; level <= 2 * maxDepth; ++level)
+			{
+				m_cellHalfSizes.push_back(halfSize);
+				halfSize.halfWidth = halfSize.halfWidth / 2;
+				halfSize.halfHeight = halfSize.halfHeight / 2;
+			}
+
+			m_root = NewQuadtreeNode(indexedArea.GetCenterX(), indexedArea.GetCenterY());
+			++m_quadtreeNodesCount;
 		}
 
+		// Elements outside the indexed area make the root grow towards them first
 		void Insert(const R& r)
 		{
-			Insert(*m_root, m_indexedArea, r, 1);
+			while (!Contains(m_indexedArea, r))
+			{
+				GrowTowards(r);
+			}
+
+			auto counts = InsertionCounts{};
+			InsertElement<false>(r, counts);
+			AddInsertionCounts(counts);
+		}
+
+		// Inserts the elements from several threads, which create missing nodes with compare-and-swap
+		// and push onto lists without locks. The tree must not be used otherwise until this returns
+		void ParallelInsert(std::span<const R> elements, unsigned threadCount = std::thread::hardware_concurrency())
+		{
+			for (const auto& r : elements)
+			{
+				while (!Contains(m_indexedArea, r))
+				{
+					GrowTowards(r);
+				}
+			}
+
+			const auto chunks = std::max<std::size_t>(1, std::min<std::size_t>(threadCount, elements.size()));
+			const auto chunkSize = (elements.size() + chunks - 1) / chunks;
+
+			auto tasks = std::vector<std::future<InsertionCounts>>{};
+			for (std::size_t begin = chunkSize; begin < elements.size(); begin += chunkSize)
+			{
+				const auto chunk = elements.subspan(begin, std::min(chunkSize, elements.size() - begin));
+				tasks.push_back(std::async(std::launch::async, [this, chunk]() { return InsertConcurrently(chunk); }));
+			}
+
+			// The calling thread takes the first chunk, so a single chunk needs no extra thread
+			auto counts = InsertConcurrently(elements.first(std::min(chunkSize, elements.size())));
+			for (auto& task : tasks)
+			{
+				const auto taskCounts = task.get();
+				counts.quadtreeNodes += taskCounts.quadtreeNodes;
+				counts.axisNodes += taskCounts.axisNodes;
+				counts.elements += taskCounts.elements;
+			}
+			AddInsertionCounts(counts);
+		}
+
+		// Removes one element equal to r, emptied nodes are kept for later inserts
+		bool Remove(const R& r)
+		{
+			auto statistics = NoQueryStatistics{};
+			return VisitLists(r, statistics, [&](LinkedListNode*& elements)
+				{
+					for (auto link = &elements; *link != nullptr; link = &(*link)->next)
+					{
+						if ((*link)->element == r)
+						{
+							const auto removed = *link;
+							*link = removed->next;
+							DeleteNode(removed);
+							--m_elementsCount;
+							return true;
+						}
+					}
+					return false;
+				});
 		}
 
 		template<Rectangular<N> Window>
 		std::vector<R*> Query(const Window& searchWindow)
 		{
+			auto statistics = NoQueryStatistics{};
 			auto result = std::vector<R*>{};
-			Query(result, m_root, m_indexedArea, searchWindow);
+			Query(result, searchWindow, statistics);
+			return result;
+		}
+
+		template<Rectangular<N> Window>
+		std::vector<R*> Query(const Window& searchWindow, QueryStatistics& statistics)
+		{
+			auto result = std::vector<R*>{};
+			Query(result, searchWindow, statistics);
+			return result;
+		}
+
+		template<Shape<N> S>
+		std::vector<R*> Query(const S& searchShape)
+		{
+			auto statistics = NoQueryStatistics{};
+			auto result = std::vector<R*>{};
+			Query(result, searchShape, statistics);
+			return result;
+		}
+
+		template<Shape<N> S>
+		std::vector<R*> Query(const S& searchShape, QueryStatistics& statistics)
+		{
+			auto result = std::vector<R*>{};
+			Query(result, searchShape, statistics);
+			return result;
+		}
+
+		template<Rectangular<N> Window>
+		BatchResult<R*> QueryBatch(std::span<const Window> searchWindows)
+		{
+			auto activeWindows = std::vector<std::size_t>(searchWindows.size());
+			std::iota(activeWindows.begin(), activeWindows.end(), std::size_t{ 0 });
+
+			auto mortonCodes = std::vector<std::uint32_t>{};
+			mortonCodes.reserve(searchWindows.size());
+			for (const auto& window : searchWindows)
+			{
+				mortonCodes.push_back(GetMortonCode(window));
+			}
+			std::sort(activeWindows.begin(), activeWindows.end(), [&](std::size_t a, std::size_t b)
+				{
+					return mortonCodes[a] < mortonCodes[b];
+				});
+
+			auto candidates = std::vector<BatchCandidate>{};
+			QueryBatch(candidates, activeWindows, 0, m_root, m_indexedArea, searchWindows);
+
+			auto result = BatchResult<R*>{};
+			result.offsets.assign(searchWindows.size() + 1, 0);
+			for (const auto& candidate : candidates)
+			{
+				++result.offsets[candidate.windowIndex + 1];
+			}
+			std::partial_sum(result.offsets.begin(), result.offsets.end(), result.offsets.begin());
+
+			auto positions = std::vector<std::size_t>(result.offsets.begin(), result.offsets.end() - 1);
+			result.values.resize(candidates.size());
+			for (const auto& candidate : candidates)
+			{
+				result.values[positions[candidate.windowIndex]++] = candidate.element;
+			}
+
 			return result;
 		}
 
+		// Calls callback(R&, R2&) for every pair of intersecting elements of the two trees.
+		// Joining a tree with itself reports every unordered pair of distinct elements once
+		template<Rectangular<N> R2, typename Callback>
+		void Join(Quadtree<N, R2>& other, Callback&& callback)
+		{
+			JoinNodes(m_root, m_indexedArea, other, other.m_root, other.m_indexedArea, callback, false);
+		}
+
+		// Same as Join, but pairs of top-level quadrants are processed concurrently,
+		// so the callback must be safe to call from several threads
+		template<Rectangular<N> R2, typename Callback>
+		void ParallelJoin(Quadtree<N, R2>& other, Callback&& callback)
+		{
+			JoinNodes(m_root, m_indexedArea, other, other.m_root, other.m_indexedArea, callback, true);
+		}
+
+		template<typename Callback>
+		void SelfJoin(Callback&& callback)
+		{
+			Join(*this, callback);
+		}
+
 		const Rectangle<N>& GetIndexedArea() const { return m_indexedArea; }
 
 		int GetMaxDepth() const { return m_maxDepth; }
 
+		std::size_t GetSize() const { return m_elementsCount; }
+
+		MemoryUsage GetMemoryUsage() const
+		{
+			return MemoryUsage{
+				m_quadtreeNodesCount * sizeof(QuadtreeNode),
+				m_axisNodesCount * sizeof(AxisBinaryTreeNode),
+				m_elementsCount * sizeof(LinkedListNode)
+			};
+		}
+
+		IndexStatistics GetStatistics() const
+		{
+			auto statistics = IndexStatistics{};
+			CollectStatistics(statistics, m_root, 1);
+			statistics.memory = GetMemoryUsage();
+			return statistics;
+		}
+
 		~Quadtree()
 		{
 			DeleteQuadtree(m_root);
 		}
 
 	private:
+		template<Numeric N2, Rectangular<N2> R2>
+		friend class Quadtree;
+
 		enum struct Quadrant
 		{
 			NE = 0,
@@ -98,136 +304,274 @@ namespace quadtree
 			LinkedListNode* elements = nullptr;
 		};
 
+		// The center is stored rather than derived from the root, so growing the root keeps it exact
 		struct QuadtreeNode
 		{
 			std::array<QuadtreeNode*, 4> children = { { nullptr, nullptr, nullptr, nullptr } };
 			AxisBinaryTreeNode* xAxis = nullptr;
 			AxisBinaryTreeNode* yAxis = nullptr;
+			N centerX = static_cast<N>(0);
+			N centerY = static_cast<N>(0);
 		};
 
-		void Insert(
-			QuadtreeNode& node, 
-			const Rectangle<N>& indexedArea, 
-			const R& r, 
-			Index depth
-		) {
-			const auto posX = DetermineAxisPosition(
-				indexedArea, r, Axis::X
-			);
-			const auto posY = DetermineAxisPosition(
-				indexedArea, r, Axis::Y
-			);
+		struct BatchCandidate
+		{
+			std::size_t windowIndex;
+			R* element;
+		};
+
+		struct CellHalfSize
+		{
+			N halfWidth;
+			N halfHeight;
+		};
+
+		static constexpr std::array<int, 4> QuadrantDirectionsX = { { 1, -1, -1,  1 } };
+		static constexpr std::array<int, 4> QuadrantDirectionsY = { { 1,  1, -1, -1 } };
+
+		N GetAxisHalfSize(int level, Axis axis) const
+		{
+			return axis == Axis::X ? m_cellHalfSizes[level].halfWidth : m_cellHalfSizes[level].halfHeight;
+		}
+
+		struct InsertionCounts
+		{
+			std::size_t quadtreeNodes = 0;
+			std::size_t axisNodes = 0;
+			std::size_t elements = 0;
+		};
+
+		void AddInsertionCounts(const InsertionCounts& counts)
+		{
+			m_quadtreeNodesCount += counts.quadtreeNodes;
+			m_axisNodesCount += counts.axisNodes;
+			m_elementsCount += counts.elements;
+		}
 
-			if (depth < m_maxDepth 
-				&& posX != AxisPosition::Center 
+		InsertionCounts InsertConcurrently(std::span<const R> elements)
+		{
+			auto counts = InsertionCounts{};
+			for (const auto& r : elements)
+			{
+				InsertElement<true>(r, counts);
+			}
+			return counts;
+		}
+
+		// The element must lie within the indexed area. Concurrent insertions publish new nodes with
+		// compare-and-swap, so threads racing for the same slot all continue with the winner's node
+		template<bool Concurrent>
+		void InsertElement(const R& r, InsertionCounts& counts)
+		{
+			auto node = m_root;
+			auto centerX = node->centerX;
+			auto centerY = node->centerY;
+			auto depth = Index{ 1 };
+
+			auto posX = DetermineAxisPosition(centerX, r, Axis::X);
+			auto posY = DetermineAxisPosition(centerY, r, Axis::Y);
+			while (depth < m_maxDepth
+				&& posX != AxisPosition::Center
 				&& posY != AxisPosition::Center)
 			{
 				auto quadrant = Quadrant{};
-				if (r.GetCenterX() < indexedArea.GetCenterX())
+				if (r.GetCenterX() < centerX)
 				{
 					quadrant =
-						r.GetCenterY() < indexedArea.GetCenterY()
+						r.GetCenterY() < centerY
 						? Quadrant::SW
 						: Quadrant::NW;
 				}
 				else
 				{
 					quadrant =
-						r.GetCenterY() < indexedArea.GetCenterY()
+						r.GetCenterY() < centerY
 						? Quadrant::SE
 						: Quadrant::NE;
 				}
 
 				const auto childIndex = static_cast<int>(quadrant);
-				if (node.children[childIndex] == nullptr)
-				{
-					node.children[childIndex] = new QuadtreeNode;
-				}
-
-				Insert(
-					*node.children[childIndex],
-					GetChildArea(quadrant, indexedArea),
-					r,
-					depth + 1
-				);
+				const auto& childHalfSize = m_cellHalfSizes[depth];
+				node = GetOrCreate<Concurrent>(node->children[childIndex], counts.quadtreeNodes, [&]()
+					{
+						return NewQuadtreeNode(
+							centerX + childHalfSize.halfWidth * QuadrantDirectionsX[childIndex],
+							centerY + childHalfSize.halfHeight * QuadrantDirectionsY[childIndex]
+						);
+					});
+				centerX = node->centerX;
+				centerY = node->centerY;
+				++depth;
 
-				return;
+				posX = DetermineAxisPosition(centerX, r, Axis::X);
+				posY = DetermineAxisPosition(centerY, r, Axis::Y);
 			}
 
 			if (posX == AxisPosition::Center)
 			{
-				if (node.yAxis == nullptr)
-				{
-					node.yAxis = new AxisBinaryTreeNode;
-				}
-				InsertIntoAxis(
-					*node.yAxis, indexedArea, r, Axis::Y, 0
-				);
+				const auto axis = GetOrCreate<Concurrent>(node->yAxis, counts.axisNodes, [this]() { return NewNode<AxisBinaryTreeNode>(); });
+				InsertIntoAxis<Concurrent>(axis, centerY, depth - 1, r, Axis::Y, counts);
 			}
 			else
 			{
-				if (node.xAxis == nullptr)
-				{
-					node.xAxis = new AxisBinaryTreeNode;
-				}
-				InsertIntoAxis(
-					*node.xAxis, indexedArea, r, Axis::X, 0
-				);
+				const auto axis = GetOrCreate<Concurrent>(node->xAxis, counts.axisNodes, [this]() { return NewNode<AxisBinaryTreeNode>(); });
+				InsertIntoAxis<Concurrent>(axis, centerX, depth - 1, r, Axis::X, counts);
 			}
 		}
 
+		template<bool Concurrent>
 		void InsertIntoAxis
 		(
-			AxisBinaryTreeNode& node,
-			const Rectangle<N>& indexedArea,
+			AxisBinaryTreeNode* node,
+			N axisCenter,
+			int level,
 			const R& r,
 			Axis axis,
-			Index depth
+			InsertionCounts& counts
 		)
 		{
-			const auto pos = DetermineAxisPosition(indexedArea, r, axis);
-
-			if (pos == AxisPosition::Center || depth >= m_maxDepth)
+			for (auto depth = Index{ 0 }; ; ++depth)
 			{
-				auto next = new LinkedListNode;
-				next->element = r;
-				next->next = node.elements;
-				node.elements = next;
+				const auto pos = DetermineAxisPosition(axisCenter, r, axis);
+
+				if (pos == AxisPosition::Center || depth >= m_maxDepth)
+				{
+					PushElement<Concurrent>(node->elements, r);
+					++counts.elements;
+					return;
+				}
+
+				auto& child = pos == AxisPosition::Left ? node->left : node->right;
+				node = GetOrCreate<Concurrent>(child, counts.axisNodes, [this]() { return NewNode<AxisBinaryTreeNode>(); });
+				const auto childHalfSize = GetAxisHalfSize(level + depth + 1, axis);
+				axisCenter += pos == AxisPosition::Left ? -childHalfSize : childHalfSize;
 			}
-			else if (pos == AxisPosition::Left)
+		}
+
+		// Returns the node in the slot, creating it first if the slot is empty
+		template<bool Concurrent, typename Node, typename Create>
+		Node* GetOrCreate(Node*& slot, std::size_t& createdCount, Create&& create)
+		{
+			if constexpr (Concurrent)
 			{
-				if (node.left == nullptr)
+				const auto published = std::atomic_ref<Node*>{ slot };
+				auto existing = published.load(std::memory_order_acquire);
+				if (existing != nullptr)
 				{
-					node.left = new AxisBinaryTreeNode;
+					return existing;
 				}
-				InsertIntoAxis(*node.left, GetChildAxisArea(pos, axis, indexedArea), r, axis, depth + 1);
+
+				const auto created = create();
+				if (published.compare_exchange_strong(existing, created, std::memory_order_acq_rel, std::memory_order_acquire))
+				{
+					++createdCount;
+					return created;
+				}
+				DeleteNode(created);
+				return existing;
 			}
 			else
 			{
-				if (node.right == nullptr)
+				if (slot == nullptr)
 				{
-					node.right = new AxisBinaryTreeNode;
+					slot = create();
+					++createdCount;
 				}
-				InsertIntoAxis(*node.right, GetChildAxisArea(pos, axis, indexedArea), r, axis, depth + 1);
+				return slot;
 			}
 		}
 
-		Rectangle<N> GetChildArea(Quadrant quadrant, const Rectangle<N>& indexedArea)
+		template<bool Concurrent>
+		void PushElement(LinkedListNode*& head, const R& r)
+		{
+			auto element = NewNode<LinkedListNode>(r, nullptr);
+			if constexpr (Concurrent)
+			{
+				const auto published = std::atomic_ref<LinkedListNode*>{ head };
+				element->next = published.load(std::memory_order_relaxed);
+				while (!published.compare_exchange_weak(element->next, element, std::memory_order_release, std::memory_order_relaxed))
+				{ }
+			}
+			else
+			{
+				element->next = head;
+				head = element;
+			}
+		}
+
+		template<typename Node, typename... Args>
+		Node* NewNode(Args&&... args)
+		{
+			return new (m_resource->allocate(sizeof(Node), alignof(Node))) Node{ std::forward<Args>(args)... };
+		}
+
+		template<typename Node>
+		void DeleteNode(Node* node)
+		{
+			node->~Node();
+			m_resource->deallocate(node, sizeof(Node), alignof(Node));
+		}
+
+		QuadtreeNode* NewQuadtreeNode(N centerX, N centerY)
+		{
+			auto node = NewNode<QuadtreeNode>();
+			node->centerX = centerX;
+			node->centerY = centerY;
+			return node;
+		}
+
+		template<Rectangular<N> R1>
+		static bool Contains(const Rectangle<N>& area, const R1& r)
 		{
-			static constexpr std::array<int, 4> directionsX = { { 1, -1, -1,  1 } };
-			static constexpr std::array<int, 4> directionsY = { { 1,  1, -1, -1 } };
+			return area.GetCenterX() - area.GetHalfWidth() <= r.GetCenterX() - r.GetHalfWidth()
+				&& r.GetCenterX() + r.GetHalfWidth() <= area.GetCenterX() + area.GetHalfWidth()
+				&& area.GetCenterY() - area.GetHalfHeight() <= r.GetCenterY() - r.GetHalfHeight()
+				&& r.GetCenterY() + r.GetHalfHeight() <= area.GetCenterY() + area.GetHalfHeight();
+		}
 
+		// Doubles the indexed area towards the element, the old root becomes one of the new root's children,
+		// and the depth limit grows with it so that the smallest cells keep their size
+		void GrowTowards(const R& r)
+		{
+			const auto halfWidth = m_indexedArea.GetHalfWidth();
+			const auto halfHeight = m_indexedArea.GetHalfHeight();
+			const auto growWest = r.GetCenterX() - r.GetHalfWidth() < m_indexedArea.GetCenterX() - halfWidth;
+			const auto growSouth = r.GetCenterY() - r.GetHalfHeight() < m_indexedArea.GetCenterY() - halfHeight;
+
+			const auto quadrant = growWest
+				? (growSouth ? Quadrant::NE : Quadrant::SE)
+				: (growSouth ? Quadrant::NW : Quadrant::SW);
 			const auto index = static_cast<int>(quadrant);
 
-			const auto childWidth = indexedArea.GetHalfWidth() / 2;
-			const auto childHeight = indexedArea.GetHalfHeight() / 2;
+			const auto centerX = static_cast<double>(m_indexedArea.GetCenterX()) - static_cast<double>(halfWidth) * QuadrantDirectionsX[index];
+			const auto centerY = static_cast<double>(m_indexedArea.GetCenterY()) - static_cast<double>(halfHeight) * QuadrantDirectionsY[index];
+			const auto fits = [](double center, double halfSide)
+				{
+					return halfSide > 0.0
+						&& center - 2.0 * halfSide >= static_cast<double>(std::numeric_limits<N>::lowest())
+						&& center + 2.0 * halfSide <= static_cast<double>(std::numeric_limits<N>::max());
+				};
+			if (m_maxDepth >= MaxSupportedDepth || !fits(centerX, halfWidth) || !fits(centerY, halfHeight))
+			{
+				throw std::out_of_range{ "Element is too far outside the indexed area to grow the quadtree" };
+			}
 
-			return Rectangle{
-				indexedArea.GetCenterX() + (childWidth * directionsX[index]),
-				indexedArea.GetCenterY() + (childHeight * directionsY[index]),
-				childWidth,
-				childHeight
-			};
+			auto root = NewQuadtreeNode(static_cast<N>(centerX), static_cast<N>(centerY));
+			++m_quadtreeNodesCount;
+			root->children[index] = m_root;
+			m_root = root;
+			m_indexedArea = Rectangle<N>{ root->centerX, root->centerY, halfWidth * 2, halfHeight * 2 };
+
+			++m_maxDepth;
+			m_cellHalfSizes.insert(m_cellHalfSizes.begin(), CellHalfSize{ halfWidth * 2, halfHeight * 2 });
+			const auto smallest = m_cellHalfSizes.back();
+			m_cellHalfSizes.push_back(CellHalfSize{ smallest.halfWidth / 2, smallest.halfHeight / 2 });
+		}
+
+		// Child centers come from the nodes, which keeps them exact after the root has grown
+		Rectangle<N> GetChildArea(const QuadtreeNode* child, const Rectangle<N>& indexedArea) const
+		{
+			return Rectangle<N>{ child->centerX, child->centerY, indexedArea.GetHalfWidth() / 2, indexedArea.GetHalfHeight() / 2 };
 		}
 
 		Rectangle<N> GetChildAxisArea(AxisPosition position, Axis axis, const Rectangle<N>& indexedArea)
@@ -240,53 +584,197 @@ namespace quadtree
 			{
 				const auto side = indexedArea.GetHalfWidth() / 2;
 				return Rectangle{
-					side,
-					indexedArea.GetHalfHeight(),
 					indexedArea.GetCenterX() + side * directions[index],
-					indexedArea.GetCenterY()
+					indexedArea.GetCenterY(),
+					side,
+					indexedArea.GetHalfHeight()
 				};
 			}
 			const auto side = indexedArea.GetHalfHeight() / 2;
 			return Rectangle{
-				indexedArea.GetHalfWidth(),
-				side,
 				indexedArea.GetCenterX(),
-				indexedArea.GetCenterY() + side * directions[index]
+				indexedArea.GetCenterY() + side * directions[index],
+				indexedArea.GetHalfWidth(),
+				side
+			};
+		}
+
+		template<typename Window, QueryStatisticsCollector Statistics>
+		void Query(std::vector<R*>& result, const Window& searchWindow, Statistics& statistics)
+		{
+			VisitLists(searchWindow, statistics, [&](LinkedListNode*& elements)
+				{
+					QueryLinkedList(result, elements, searchWindow, statistics);
+					return false;
+				});
+		}
+
+		// Calls visit(LinkedListNode*&) for the head of every list that may hold elements intersecting
+		// the window, until it returns true. Returns whether the visit was stopped this way
+		template<typename Window, QueryStatisticsCollector Statistics, typename Visit>
+		bool VisitLists(const Window& searchWindow, Statistics& statistics, Visit&& visit)
+		{
+			struct Frame
+			{
+				QuadtreeNode* node;
+				int level;
 			};
+
+			// Every level leaves at most three siblings behind on the stack, which is left uninitialized
+			std::array<Frame, 3 * MaxSupportedDepth + 4> stack;
+			auto stackSize = std::size_t{ 0 };
+			stack[stackSize++] = Frame{ m_root, 0 };
+
+			while (stackSize > 0)
+			{
+				const auto frame = stack[--stackSize];
+				if constexpr (CollectsStatistics<Statistics>)
+				{
+					++statistics.quadtreeNodesVisited;
+				}
+
+				const auto node = frame.node;
+				const auto& halfSize = m_cellHalfSizes[frame.level];
+				const auto area = Rectangle<N>{ node->centerX, node->centerY, halfSize.halfWidth, halfSize.halfHeight };
+				if (!WindowIntersects(searchWindow, area))
+				{
+					continue;
+				}
+
+				if (VisitAxisBinaryTree(node->xAxis, node->centerX, frame.level, searchWindow, Axis::X, statistics, visit)
+					|| VisitAxisBinaryTree(node->yAxis, node->centerY, frame.level, searchWindow, Axis::Y, statistics, visit))
+				{
+					return true;
+				}
+
+				// Pushed in reverse so that quadrants are visited in the same order as before
+				for (int i = 3; i >= 0; --i)
+				{
+					const auto child = node->children[i];
+					if (child != nullptr)
+					{
+						Prefetch(child);
+						stack[stackSize++] = Frame{ child, frame.level + 1 };
+					}
+				}
+			}
+			return false;
+		}
+
+		template<typename Window, QueryStatisticsCollector Statistics, typename Visit>
+		bool VisitAxisBinaryTree
+		(
+			AxisBinaryTreeNode* root,
+			N axisCenter,
+			int level,
+			const Window& searchWindow,
+			Axis axis,
+			Statistics& statistics,
+			Visit& visit
+		)
+		{
+			if (root == nullptr)
+			{
+				return false;
+			}
+
+			struct Frame
+			{
+				AxisBinaryTreeNode* node;
+				N axisCenter;
+				int level;
+			};
+
+			const auto& windowBoundingBox = GetWindowBoundingBox(searchWindow);
+
+			std::array<Frame, MaxSupportedDepth + 2> stack;
+			auto stackSize = std::size_t{ 0 };
+			stack[stackSize++] = Frame{ root, axisCenter, level };
+
+			while (stackSize > 0)
+			{
+				const auto frame = stack[--stackSize];
+				if constexpr (CollectsStatistics<Statistics>)
+				{
+					++statistics.axisNodesVisited;
+				}
+				if (visit(frame.node->elements))
+				{
+					return true;
+				}
+
+				const auto windowPos = DetermineAxisPosition(frame.axisCenter, windowBoundingBox, axis);
+				const auto childHalfSize = GetAxisHalfSize(frame.level + 1, axis);
+				const auto pushChild = [&](AxisBinaryTreeNode* child, AxisPosition pos)
+					{
+						if (child != nullptr && (windowPos == pos || windowPos == AxisPosition::Center))
+						{
+							Prefetch(child);
+							stack[stackSize++] = Frame{
+								child,
+								pos == AxisPosition::Left ? frame.axisCenter - childHalfSize : frame.axisCenter + childHalfSize,
+								frame.level + 1
+							};
+						}
+					};
+				pushChild(frame.node->right, AxisPosition::Right);
+				pushChild(frame.node->left, AxisPosition::Left);
+			}
+			return false;
 		}
 
 		template<Rectangular<N> Window>
-		void Query
+		void QueryBatch
 		(
-			std::vector<R*>& result,
+			std::vector<BatchCandidate>& result,
+			std::vector<std::size_t>& activeWindows,
+			std::size_t activeBegin,
 			QuadtreeNode* node,
 			const Rectangle<N>& indexedArea,
-			const Window& searchWindow
+			std::span<const Window> searchWindows
 		)
 		{
 			if (node == nullptr)
 			{
 				return;
 			}
-			if (RectanglesIntersect(indexedArea, searchWindow))
+
+			// Windows still active in this node are pushed on top of the parent's ones and popped on return
+			const auto nodeBegin = activeWindows.size();
+			for (auto i = activeBegin; i < nodeBegin; ++i)
+			{
+				const auto windowIndex = activeWindows[i];
+				if (RectanglesIntersect(indexedArea, searchWindows[windowIndex]))
+				{
+					activeWindows.push_back(windowIndex);
+				}
+			}
+
+			if (activeWindows.size() != nodeBegin)
 			{
-				QueryAxisBinaryTree(result, node->xAxis, indexedArea, searchWindow, Axis::X);
-				QueryAxisBinaryTree(result, node->yAxis, indexedArea, searchWindow, Axis::Y);
-				for (int i = 0; i < 4; ++i)
+				QueryAxisBinaryTreeBatch(result, activeWindows, nodeBegin, node->xAxis, indexedArea, searchWindows, Axis::X);
+				QueryAxisBinaryTreeBatch(result, activeWindows, nodeBegin, node->yAxis, indexedArea, searchWindows, Axis::Y);
+				for (const auto child : node->children)
 				{
-					const auto quadrant = static_cast<Quadrant>(i);
-					Query(result, node->children[i], GetChildArea(quadrant, indexedArea), searchWindow);
+					if (child != nullptr)
+					{
+						QueryBatch(result, activeWindows, nodeBegin, child, GetChildArea(child, indexedArea), searchWindows);
+					}
 				}
 			}
+
+			activeWindows.resize(nodeBegin);
 		}
 
 		template<Rectangular<N> Window>
-		void QueryAxisBinaryTree
+		void QueryAxisBinaryTreeBatch
 		(
-			std::vector<R*>& result,
+			std::vector<BatchCandidate>& result,
+			std::vector<std::size_t>& activeWindows,
+			std::size_t activeBegin,
 			AxisBinaryTreeNode* node,
 			const Rectangle<N>& indexedArea,
-			const Window& searchWindow,
+			std::span<const Window> searchWindows,
 			Axis axis
 		)
 		{
@@ -294,34 +782,297 @@ namespace quadtree
 			{
 				return;
 			}
-			QueryLinkedList(result, node->elements, searchWindow);
-			const auto windowPos = DetermineAxisPosition(indexedArea, searchWindow, axis);
+
+			const auto activeEnd = activeWindows.size();
+			for (auto current = node->elements; current != nullptr; current = current->next)
+			{
+				for (auto i = activeBegin; i < activeEnd; ++i)
+				{
+					if (RectanglesIntersect(current->element, searchWindows[activeWindows[i]]))
+					{
+						result.push_back(BatchCandidate{ activeWindows[i], &current->element });
+					}
+				}
+			}
+
 			const auto searchChild = [&](AxisBinaryTreeNode* child, AxisPosition pos)
 				{
-					if (child != nullptr)
+					if (child == nullptr)
+					{
+						return;
+					}
+					const auto childBegin = activeWindows.size();
+					for (auto i = activeBegin; i < activeEnd; ++i)
 					{
-						QueryAxisBinaryTree(
+						const auto windowIndex = activeWindows[i];
+						const auto windowPos = DetermineAxisPosition(indexedArea, searchWindows[windowIndex], axis);
+						if (windowPos == pos || windowPos == AxisPosition::Center)
+						{
+							activeWindows.push_back(windowIndex);
+						}
+					}
+					if (activeWindows.size() != childBegin)
+					{
+						QueryAxisBinaryTreeBatch(
 							result,
+							activeWindows,
+							childBegin,
 							child,
 							GetChildAxisArea(pos, axis, indexedArea),
-							searchWindow,
+							searchWindows,
 							axis
 						);
 					}
+					activeWindows.resize(childBegin);
+				};
+			searchChild(node->left, AxisPosition::Left);
+			searchChild(node->right, AxisPosition::Right);
+		}
+
+		template<Rectangular<N> Window>
+		std::uint32_t GetMortonCode(const Window& window) const
+		{
+			const auto quantize = [](N value, N min, N size) -> std::uint32_t
+				{
+					if (size <= static_cast<N>(0))
+					{
+						return 0;
+					}
+					const auto normalized = std::clamp(static_cast<double>(value - min) / static_cast<double>(size), 0.0, 1.0);
+					return static_cast<std::uint32_t>(normalized * 65535.0);
+				};
+			const auto spread = [](std::uint32_t v)
+				{
+					v = (v | (v << 8)) & 0x00FF00FFu;
+					v = (v | (v << 4)) & 0x0F0F0F0Fu;
+					v = (v | (v << 2)) & 0x33333333u;
+					v = (v | (v << 1)) & 0x55555555u;
+					return v;
 				};
-			if (windowPos == AxisPosition::Center)
+
+			const auto x = quantize(
+				window.GetCenterX(),
+				m_indexedArea.GetCenterX() - m_indexedArea.GetHalfWidth(),
+				m_indexedArea.GetHalfWidth() * 2
+			);
+			const auto y = quantize(
+				window.GetCenterY(),
+				m_indexedArea.GetCenterY() - m_indexedArea.GetHalfHeight(),
+				m_indexedArea.GetHalfHeight() * 2
+			);
+			return spread(x) | (spread(y) << 1);
+		}
+
+		struct Bounds
+		{
+			N minX;
+			N minY;
+			N maxX;
+			N maxY;
+		};
+
+		// Elements stored in a node never cross the inner borders of its area, but they may stick out
+		// of the indexed area, so borders shared with the indexed area are treated as unbounded
+		Bounds GetCellBounds(const Rectangle<N>& area) const
+		{
+			const auto lowest = std::numeric_limits<N>::lowest();
+			const auto highest = std::numeric_limits<N>::max();
+
+			const auto minX = area.GetCenterX() - area.GetHalfWidth();
+			const auto maxX = area.GetCenterX() + area.GetHalfWidth();
+			const auto minY = area.GetCenterY() - area.GetHalfHeight();
+			const auto maxY = area.GetCenterY() + area.GetHalfHeight();
+
+			return Bounds{
+				minX <= m_indexedArea.GetCenterX() - m_indexedArea.GetHalfWidth() ? lowest : minX,
+				minY <= m_indexedArea.GetCenterY() - m_indexedArea.GetHalfHeight() ? lowest : minY,
+				maxX >= m_indexedArea.GetCenterX() + m_indexedArea.GetHalfWidth() ? highest : maxX,
+				maxY >= m_indexedArea.GetCenterY() + m_indexedArea.GetHalfHeight() ? highest : maxY
+			};
+		}
+
+		static bool BoundsIntersect(const Bounds& b1, const Bounds& b2)
+		{
+			return b1.minX <= b2.maxX && b2.minX <= b1.maxX && b1.minY <= b2.maxY && b2.minY <= b1.maxY;
+		}
+
+		template<Rectangular<N> R1>
+		static bool BoundsIntersect(const Bounds& b, const R1& r)
+		{
+			return b.minX <= r.GetCenterX() + r.GetHalfWidth()
+				&& r.GetCenterX() - r.GetHalfWidth() <= b.maxX
+				&& b.minY <= r.GetCenterY() + r.GetHalfHeight()
+				&& r.GetCenterY() - r.GetHalfHeight() <= b.maxY;
+		}
+
+		void CollectElements(AxisBinaryTreeNode* node, std::vector<R*>& elements)
+		{
+			if (node == nullptr)
 			{
-				searchChild(node->left, AxisPosition::Left);
-				searchChild(node->right, AxisPosition::Right);
+				return;
 			}
-			else if (windowPos == AxisPosition::Left)
+			for (auto current = node->elements; current != nullptr; current = current->next)
 			{
-				searchChild(node->left, AxisPosition::Left);
+				elements.push_back(&current->element);
 			}
-			else
+			CollectElements(node->left, elements);
+			CollectElements(node->right, elements);
+		}
+
+		template<Rectangular<N> R2, typename Callback>
+		void JoinNodes
+		(
+			QuadtreeNode* node,
+			const Rectangle<N>& indexedArea,
+			Quadtree<N, R2>& other,
+			typename Quadtree<N, R2>::QuadtreeNode* otherNode,
+			const Rectangle<N>& otherIndexedArea,
+			Callback& callback,
+			bool parallel
+		)
+		{
+			if (node == nullptr || otherNode == nullptr)
 			{
-				searchChild(node->right, AxisPosition::Right);
+				return;
 			}
+			if (!BoundsIntersect(GetCellBounds(indexedArea), other.GetCellBounds(otherIndexedArea)))
+			{
+				return;
+			}
+
+			const auto sameNode = static_cast<const void*>(node) == static_cast<const void*>(otherNode);
+
+			auto elements = std::vector<R*>{};
+			CollectElements(node->xAxis, elements);
+			CollectElements(node->yAxis, elements);
+
+			auto otherElements = std::vector<R2*>{};
+			other.CollectElements(otherNode->xAxis, otherElements);
+			other.CollectElements(otherNode->yAxis, otherElements);
+
+			for (std::size_t i = 0; i < elements.size(); ++i)
+			{
+				for (auto j = sameNode ? i + 1 : std::size_t{ 0 }; j < otherElements.size(); ++j)
+				{
+					if (RectanglesIntersect(*elements[i], *otherElements[j]))
+					{
+						callback(*elements[i], *otherElements[j]);
+					}
+				}
+			}
+
+			const auto emit = [&callback](R& element, R2& otherElement) { callback(element, otherElement); };
+			const auto emitSwapped = [&callback](R2& otherElement, R& element) { callback(element, otherElement); };
+
+			for (int i = 0; i < 4; ++i)
+			{
+				const auto otherChild = otherNode->children[i];
+				if (otherChild != nullptr)
+				{
+					other.JoinElementsWithSubtree(elements, 0, otherChild, other.GetChildArea(otherChild, otherIndexedArea), emit);
+				}
+				const auto child = node->children[i];
+				if (!sameNode && child != nullptr)
+				{
+					JoinElementsWithSubtree(otherElements, 0, child, GetChildArea(child, indexedArea), emitSwapped);
+				}
+			}
+
+			auto tasks = std::vector<std::future<void>>{};
+			for (int i = 0; i < 4; ++i)
+			{
+				for (auto j = sameNode ? i : 0; j < 4; ++j)
+				{
+					const auto child = node->children[i];
+					const auto otherChild = otherNode->children[j];
+					if (child == nullptr || otherChild == nullptr)
+					{
+						continue;
+					}
+					const auto childArea = GetChildArea(child, indexedArea);
+					const auto otherChildArea = other.GetChildArea(otherChild, otherIndexedArea);
+					const auto joinChildren = [&, child, otherChild, childArea, otherChildArea]()
+						{
+							JoinNodes(child, childArea, other, otherChild, otherChildArea, callback, false);
+						};
+					if (parallel)
+					{
+						tasks.push_back(std::async(std::launch::async, joinChildren));
+					}
+					else
+					{
+						joinChildren();
+					}
+				}
+			}
+			for (auto& task : tasks)
+			{
+				task.get();
+			}
+		}
+
+		// Reports intersections between the elements in [begin, end) and the elements stored in the subtree,
+		// elements still relevant for a node are pushed on top of the vector and popped on return
+		template<Rectangular<N> E, typename Emit>
+		void JoinElementsWithSubtree
+		(
+			std::vector<E*>& elements,
+			std::size_t begin,
+			QuadtreeNode* node,
+			const Rectangle<N>& indexedArea,
+			const Emit& emit
+		)
+		{
+			if (node == nullptr)
+			{
+				return;
+			}
+
+			const auto bounds = GetCellBounds(indexedArea);
+			const auto nodeBegin = elements.size();
+			for (auto i = begin; i < nodeBegin; ++i)
+			{
+				const auto element = elements[i];
+				if (BoundsIntersect(bounds, *element))
+				{
+					elements.push_back(element);
+				}
+			}
+
+			if (elements.size() != nodeBegin)
+			{
+				const auto joinAxis = [&](AxisBinaryTreeNode* axisNode, const auto& self) -> void
+					{
+						if (axisNode == nullptr)
+						{
+							return;
+						}
+						for (auto current = axisNode->elements; current != nullptr; current = current->next)
+						{
+							for (auto i = nodeBegin; i < elements.size(); ++i)
+							{
+								if (RectanglesIntersect(*elements[i], current->element))
+								{
+									emit(*elements[i], current->element);
+								}
+							}
+						}
+						self(axisNode->left, self);
+						self(axisNode->right, self);
+					};
+				joinAxis(node->xAxis, joinAxis);
+				joinAxis(node->yAxis, joinAxis);
+
+				for (const auto child : node->children)
+				{
+					if (child != nullptr)
+					{
+						JoinElementsWithSubtree(elements, nodeBegin, child, GetChildArea(child, indexedArea), emit);
+					}
+				}
+			}
+
+			elements.resize(nodeBegin);
 		}
 
 		template<Rectangular<N> R1>
@@ -331,6 +1082,12 @@ namespace quadtree
 				? indexedArea.GetCenterX()
 				: indexedArea.GetCenterY();
 
+			return DetermineAxisPosition(axisCenter, r, axis);
+		}
+
+		template<Rectangular<N> R1>
+		AxisPosition DetermineAxisPosition(N axisCenter, const R1& r, Axis axis) const
+		{
 			const auto rCenter = (axis == Axis::X)
 				? r.GetCenterX()
 				: r.GetCenterY();
@@ -350,20 +1107,59 @@ namespace quadtree
 			return AxisPosition::Left;
 		}
 
-		template<Rectangular<N> Window>
-		void QueryLinkedList(std::vector<R*>& result, LinkedListNode* root, const Window& searchWindow)
+		template<typename Window, QueryStatisticsCollector Statistics>
+		void QueryLinkedList(std::vector<R*>& result, LinkedListNode* root, const Window& searchWindow, Statistics& statistics)
 		{
 			auto current = root;
 			while (current != nullptr)
 			{
-				if (RectanglesIntersect(current->element, searchWindow))
+				if constexpr (CollectsStatistics<Statistics>)
+				{
+					++statistics.listElementsTested;
+				}
+				if (WindowIntersects(searchWindow, current->element))
 				{
+					if constexpr (CollectsStatistics<Statistics>)
+					{
+						++statistics.candidatesReturned;
+					}
 					result.push_back(&current->element);
 				}
 				current = current->next;
 			}
 		}
 
+		template<typename Window, Rectangular<N> R1>
+		bool WindowIntersects(const Window& searchWindow, const R1& r)
+		{
+			if constexpr (Shape<Window, N>)
+			{
+				return searchWindow.IntersectsBox(
+					r.GetCenterX() - r.GetHalfWidth(),
+					r.GetCenterY() - r.GetHalfHeight(),
+					r.GetCenterX() + r.GetHalfWidth(),
+					r.GetCenterY() + r.GetHalfHeight()
+				);
+			}
+			else
+			{
+				return RectanglesIntersect(r, searchWindow);
+			}
+		}
+
+		template<typename Window>
+		static decltype(auto) GetWindowBoundingBox(const Window& searchWindow)
+		{
+			if constexpr (Shape<Window, N>)
+			{
+				return searchWindow.GetBoundingBox();
+			}
+			else
+			{
+				return (searchWindow);
+			}
+		}
+
 		template<Rectangular<N> R1, Rectangular<N> R2>
 		bool RectanglesIntersect(const R1& r1, const R2& r2)
 		{
@@ -373,6 +1169,60 @@ namespace quadtree
 				&& (r1.GetCenterX() + r1.GetHalfWidth() >= r2.GetCenterX() - r2.GetHalfWidth());
 		}
 
+		void CollectStatistics(IndexStatistics& statistics, const QuadtreeNode* node, int depth) const
+		{
+			if (node == nullptr)
+			{
+				return;
+			}
+
+			const auto depthIndex = static_cast<std::size_t>(depth - 1);
+			if (statistics.nodesPerDepth.size() <= depthIndex)
+			{
+				statistics.nodesPerDepth.resize(depthIndex + 1, 0);
+				statistics.elementsPerDepth.resize(depthIndex + 1, 0);
+			}
+			statistics.maxDepthReached = std::max(statistics.maxDepthReached, depth);
+			++statistics.nodesPerDepth[depthIndex];
+
+			const auto xAxisElements = CollectAxisStatistics(statistics, node->xAxis);
+			const auto yAxisElements = CollectAxisStatistics(statistics, node->yAxis);
+			const auto nodeElements = xAxisElements + yAxisElements;
+
+			statistics.xAxisElements += xAxisElements;
+			statistics.yAxisElements += yAxisElements;
+			statistics.elements += nodeElements;
+			statistics.elementsPerDepth[depthIndex] += nodeElements;
+			IndexStatistics::AddToHistogram(statistics.elementsPerNodeHistogram, nodeElements);
+
+			for (const auto child : node->children)
+			{
+				CollectStatistics(statistics, child, depth + 1);
+			}
+		}
+
+		std::size_t CollectAxisStatistics(IndexStatistics& statistics, const AxisBinaryTreeNode* node) const
+		{
+			if (node == nullptr)
+			{
+				return 0;
+			}
+
+			auto listLength = std::size_t{ 0 };
+			for (auto current = node->elements; current != nullptr; current = current->next)
+			{
+				++listLength;
+			}
+
+			++statistics.axisLists;
+			statistics.longestAxisList = std::max(statistics.longestAxisList, listLength);
+			IndexStatistics::AddToHistogram(statistics.axisListLengthHistogram, listLength);
+
+			return listLength
+				+ CollectAxisStatistics(statistics, node->left)
+				+ CollectAxisStatistics(statistics, node->right);
+		}
+
 		void DeleteQuadtree(QuadtreeNode* root)
 		{
 			if (root != nullptr)
@@ -383,7 +1233,7 @@ namespace quadtree
 				}
 				DeleteAxisBinaryTree(root->xAxis);
 				DeleteAxisBinaryTree(root->yAxis);
-				delete root;
+				DeleteNode(root);
 			}
 		}
 
@@ -394,7 +1244,7 @@ namespace quadtree
 				DeleteAxisBinaryTree(root->left);
 				DeleteAxisBinaryTree(root->right);
 				DeleteLinkedList(root->elements);
-				delete root;
+				DeleteNode(root);
 			}
 		}
 
@@ -404,13 +1254,18 @@ namespace quadtree
 			while (current != nullptr)
 			{
 				auto tmp = current->next;
-				delete current;
+				DeleteNode(current);
 				current = tmp;
 			}
 		}
 
 		Rectangle<N> m_indexedArea;
 		int m_maxDepth;
+		std::vector<CellHalfSize> m_cellHalfSizes;
+		std::pmr::memory_resource* m_resource;
 		QuadtreeNode* m_root = nullptr;
+		std::size_t m_quadtreeNodesCount = 0;
+		std::size_t m_axisNodesCount = 0;
+		std::size_t m_elementsCount = 0;
 	};
 }
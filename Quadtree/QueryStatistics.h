@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <concepts>
+
+namespace quadtree
+{
+	struct QueryStatistics
+	{
+		std::size_t quadtreeNodesVisited = 0;
+		std::size_t axisNodesVisited = 0;
+		std::size_t listElementsTested = 0;
+		std::size_t candidatesReturned = 0;
+
+		QueryStatistics& operator+=(const QueryStatistics& other)
+		{
+			quadtreeNodesVisited += other.quadtreeNodesVisited;
+			axisNodesVisited += other.axisNodesVisited;
+			listElementsTested += other.listElementsTested;
+			candidatesReturned += other.candidatesReturned;
+			return *this;
+		}
+	};
+
+	// Used when statistics are not requested, all counting compiles away
+	struct NoQueryStatistics {};
+
+	template<typename T>
+	concept QueryStatisticsCollector = std::same_as<T, QueryStatistics> || std::same_as<T, NoQueryStatistics>;
+
+	template<QueryStatisticsCollector S>
+	constexpr bool CollectsStatistics = std::same_as<S, QueryStatistics>;
+}
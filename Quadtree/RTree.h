@@ -0,0 +1,618 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BatchResult.h"
+#include "Common.h"
+#include "IndexStatistics.h"
+#include "QueryStatistics.h"
+#include "Rectangle.h"
+#include "Rectangular.h"
+#include "Shape.h"
+
+namespace quadtree
+{
+	// Static R-tree bulk loaded with Sort-Tile-Recursive packing. All nodes live in one array, level by level from
+	// the leaves up to the root, and the children of a node are next to each other. Elements inserted later wait in
+	// an overflow list scanned by every query, removed elements are only marked, and the tree is packed again once
+	// either of them grows too large
+	template<Numeric N, Rectangular<N> R>
+	class RTree final
+	{
+	public:
+		static constexpr std::size_t DefaultNodeCapacity = 16;
+		static constexpr std::size_t MaxNodeCapacity = 64;
+
+		explicit RTree(std::span<const R> elements, std::size_t nodeCapacity = DefaultNodeCapacity)
+			: m_nodeCapacity{ nodeCapacity }
+		{
+			if (nodeCapacity < 2 || nodeCapacity > MaxNodeCapacity)
+			{
+				throw std::invalid_argument{ "R-tree node capacity must be between 2 and MaxNodeCapacity" };
+			}
+			Build(std::vector<R>(elements.begin(), elements.end()));
+		}
+
+		RTree(const RTree& other) = delete;
+
+		RTree(RTree&& other) = default;
+
+		RTree& operator=(const RTree& other) = delete;
+
+		RTree& operator=(RTree&& other) = default;
+
+		void Insert(const R& r)
+		{
+			m_overflow.push_back(r);
+			if (m_overflow.size() > GetRepackThreshold())
+			{
+				Repack();
+			}
+		}
+
+		// Removes one element equal to r
+		bool Remove(const R& r)
+		{
+			const auto overflowElement = std::find(m_overflow.begin(), m_overflow.end(), r);
+			if (overflowElement != m_overflow.end())
+			{
+				*overflowElement = m_overflow.back();
+				m_overflow.pop_back();
+				return true;
+			}
+
+			auto removed = false;
+			VisitLeaves(GetBounds(r), [&](std::size_t element)
+				{
+					if (!removed && m_removed[element] == 0 && m_elements[element] == r)
+					{
+						m_removed[element] = 1;
+						++m_removedCount;
+						removed = true;
+					}
+				});
+			if (m_removedCount > GetRepackThreshold())
+			{
+				Repack();
+			}
+			return removed;
+		}
+
+		template<Rectangular<N> Window>
+		std::vector<R*> Query(const Window& searchWindow)
+		{
+			auto statistics = NoQueryStatistics{};
+			auto result = std::vector<R*>{};
+			Query(result, searchWindow, statistics);
+			return result;
+		}
+
+		template<Rectangular<N> Window>
+		std::vector<R*> Query(const Window& searchWindow, QueryStatistics& statistics)
+		{
+			auto result = std::vector<R*>{};
+			Query(result, searchWindow, statistics);
+			return result;
+		}
+
+		template<Shape<N> S>
+		std::vector<R*> Query(const S& searchShape)
+		{
+			auto statistics = NoQueryStatistics{};
+			auto result = std::vector<R*>{};
+			Query(result, searchShape, statistics);
+			return result;
+		}
+
+		template<Shape<N> S>
+		std::vector<R*> Query(const S& searchShape, QueryStatistics& statistics)
+		{
+			auto result = std::vector<R*>{};
+			Query(result, searchShape, statistics);
+			return result;
+		}
+
+		template<Rectangular<N> Window>
+		BatchResult<R*> QueryBatch(std::span<const Window> searchWindows)
+		{
+			auto statistics = NoQueryStatistics{};
+			auto result = BatchResult<R*>{};
+			result.offsets.reserve(searchWindows.size() + 1);
+			result.offsets.push_back(0);
+			for (const auto& searchWindow : searchWindows)
+			{
+				Query(result.values, searchWindow, statistics);
+				result.offsets.push_back(result.values.size());
+			}
+			return result;
+		}
+
+		// Calls callback(R&, R2&) for every pair of intersecting elements of the two trees.
+		// Joining a tree with itself reports every unordered pair of distinct elements once
+		template<Rectangular<N> R2, typename Callback>
+		void Join(RTree<N, R2>& other, Callback&& callback)
+		{
+			JoinTrees(other, callback, false);
+		}
+
+		// Same as Join, but pairs of children of the roots are processed concurrently,
+		// so the callback must be safe to call from several threads
+		template<Rectangular<N> R2, typename Callback>
+		void ParallelJoin(RTree<N, R2>& other, Callback&& callback)
+		{
+			JoinTrees(other, callback, true);
+		}
+
+		template<typename Callback>
+		void SelfJoin(Callback&& callback)
+		{
+			Join(*this, callback);
+		}
+
+		std::size_t GetSize() const { return m_elements.size() - m_removedCount + m_overflow.size(); }
+
+		std::size_t GetHeight() const { return m_levelBegins.size(); }
+
+		// Nodes are reported as quadtree nodes and elements as list nodes
+		MemoryUsage GetMemoryUsage() const
+		{
+			return MemoryUsage{
+				m_nodes.capacity() * sizeof(Node),
+				0,
+				(m_elements.capacity() + m_overflow.capacity()) * sizeof(R) + m_removed.capacity()
+			};
+		}
+
+		IndexStatistics GetStatistics() const
+		{
+			auto statistics = IndexStatistics{};
+			statistics.elements = GetSize();
+			statistics.maxDepthReached = static_cast<int>(GetHeight());
+			for (auto level = m_levelBegins.size(); level-- > 0; )
+			{
+				const auto end = level + 1 < m_levelBegins.size() ? m_levelBegins[level + 1] : m_nodes.size();
+				statistics.nodesPerDepth.push_back(end - m_levelBegins[level]);
+				statistics.elementsPerDepth.push_back(level == 0 ? m_elements.size() - m_removedCount : 0);
+			}
+			for (std::size_t leaf = 0; leaf < m_leafCount; ++leaf)
+			{
+				IndexStatistics::AddToHistogram(statistics.elementsPerNodeHistogram, m_nodes[leaf].count);
+			}
+			statistics.memory = GetMemoryUsage();
+			return statistics;
+		}
+
+	private:
+		template<Numeric N2, Rectangular<N2> R2>
+		friend class RTree;
+
+		struct Bounds
+		{
+			N minX;
+			N minY;
+			N maxX;
+			N maxY;
+		};
+
+		struct Node
+		{
+			Bounds bounds;
+			std::uint32_t first;
+			std::uint32_t count;
+		};
+
+		// Depth-first traversals leave at most capacity - 1 siblings behind per level
+		static constexpr std::size_t MaxHeight = 34;
+		static constexpr std::size_t MaxStackSize = MaxHeight * MaxNodeCapacity;
+		static constexpr std::size_t MinRepackThreshold = 256;
+
+		template<Rectangular<N> R1>
+		static Bounds GetBounds(const R1& r)
+		{
+			return Bounds{
+				static_cast<N>(r.GetCenterX() - r.GetHalfWidth()),
+				static_cast<N>(r.GetCenterY() - r.GetHalfHeight()),
+				static_cast<N>(r.GetCenterX() + r.GetHalfWidth()),
+				static_cast<N>(r.GetCenterY() + r.GetHalfHeight())
+			};
+		}
+
+		static Bounds GetBounds(const Bounds& bounds)
+		{
+			return bounds;
+		}
+
+		static Bounds GetBounds(const Node& node)
+		{
+			return node.bounds;
+		}
+
+		static Bounds Union(const Bounds& b1, const Bounds& b2)
+		{
+			return Bounds{ std::min(b1.minX, b2.minX), std::min(b1.minY, b2.minY), std::max(b1.maxX, b2.maxX), std::max(b1.maxY, b2.maxY) };
+		}
+
+		static bool BoundsIntersect(const Bounds& b1, const Bounds& b2)
+		{
+			return b1.minX <= b2.maxX && b2.minX <= b1.maxX && b1.minY <= b2.maxY && b2.minY <= b1.maxY;
+		}
+
+		template<typename Window>
+		static bool WindowIntersects(const Window& searchWindow, const Bounds& bounds)
+		{
+			if constexpr (Shape<Window, N>)
+			{
+				return searchWindow.IntersectsBox(bounds.minX, bounds.minY, bounds.maxX, bounds.maxY);
+			}
+			else
+			{
+				return BoundsIntersect(bounds, GetBounds(searchWindow));
+			}
+		}
+
+		std::size_t GetRepackThreshold() const
+		{
+			return std::max(MinRepackThreshold, m_elements.size() / 8);
+		}
+
+		bool IsLeaf(std::uint32_t node) const { return node < m_leafCount; }
+
+		std::uint32_t GetRoot() const { return static_cast<std::uint32_t>(m_nodes.size() - 1); }
+
+		// Sorts items into vertical slices by x and every slice by y, so that consecutive runs
+		// of nodeCapacity items cover compact tiles
+		template<typename T>
+		void SortTileRecursive(std::span<T> items) const
+		{
+			const auto centerX = [](const T& item) { const auto b = GetBounds(item); return static_cast<double>(b.minX) + b.maxX; };
+			const auto centerY = [](const T& item) { const auto b = GetBounds(item); return static_cast<double>(b.minY) + b.maxY; };
+
+			const auto pages = (items.size() + m_nodeCapacity - 1) / m_nodeCapacity;
+			const auto slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(pages))));
+			const auto sliceSize = slices * m_nodeCapacity;
+
+			std::sort(items.begin(), items.end(), [&](const T& a, const T& b) { return centerX(a) < centerX(b); });
+			for (std::size_t begin = 0; begin < items.size(); begin += sliceSize)
+			{
+				const auto slice = items.subspan(begin, std::min(sliceSize, items.size() - begin));
+				std::sort(slice.begin(), slice.end(), [&](const T& a, const T& b) { return centerY(a) < centerY(b); });
+			}
+		}
+
+		// Packs runs of nodeCapacity items starting at begin into parent nodes appended to the node array
+		template<typename T>
+		void AppendParents(std::span<const T> items, std::size_t begin)
+		{
+			for (std::size_t first = 0; first < items.size(); first += m_nodeCapacity)
+			{
+				const auto count = std::min(m_nodeCapacity, items.size() - first);
+				auto bounds = GetBounds(items[first]);
+				for (auto i = first + 1; i < first + count; ++i)
+				{
+					bounds = Union(bounds, GetBounds(items[i]));
+				}
+				m_nodes.push_back(Node{ bounds, static_cast<std::uint32_t>(begin + first), static_cast<std::uint32_t>(count) });
+			}
+		}
+
+		void Build(std::vector<R> elements)
+		{
+			if (elements.size() > std::numeric_limits<std::uint32_t>::max())
+			{
+				throw std::length_error{ "Too many elements for an R-tree" };
+			}
+
+			m_elements = std::move(elements);
+			m_removed.assign(m_elements.size(), 0);
+			m_removedCount = 0;
+			m_nodes.clear();
+			m_levelBegins.clear();
+			m_leafCount = 0;
+			if (m_elements.empty())
+			{
+				return;
+			}
+
+			SortTileRecursive(std::span<R>{ m_elements });
+			m_levelBegins.push_back(0);
+			AppendParents(std::span<const R>{ m_elements }, 0);
+			m_leafCount = m_nodes.size();
+
+			// Nodes of a level are sorted again before their parents are packed, which only moves whole subtrees
+			while (m_nodes.size() - m_levelBegins.back() > 1)
+			{
+				const auto begin = m_levelBegins.back();
+				const auto level = std::span<Node>{ m_nodes }.subspan(begin);
+				SortTileRecursive(level);
+				const auto levelNodes = std::vector<Node>(level.begin(), level.end());
+				m_levelBegins.push_back(m_nodes.size());
+				AppendParents(std::span<const Node>{ levelNodes }, begin);
+			}
+		}
+
+		void Repack()
+		{
+			auto elements = std::vector<R>{};
+			elements.reserve(GetSize());
+			for (std::size_t i = 0; i < m_elements.size(); ++i)
+			{
+				if (m_removed[i] == 0)
+				{
+					elements.push_back(m_elements[i]);
+				}
+			}
+			elements.insert(elements.end(), m_overflow.begin(), m_overflow.end());
+			m_overflow.clear();
+			Build(std::move(elements));
+		}
+
+		// Calls visit(elementIndex) for every element of the packed tree in a leaf whose bounds intersect the window
+		template<typename Window, QueryStatisticsCollector Statistics, typename Visit>
+		void VisitLeaves(const Window& searchWindow, Statistics& statistics, Visit&& visit) const
+		{
+			if (m_nodes.empty())
+			{
+				return;
+			}
+
+			std::array<std::uint32_t, MaxStackSize> stack;
+			auto stackSize = std::size_t{ 0 };
+			if (WindowIntersects(searchWindow, m_nodes[GetRoot()].bounds))
+			{
+				stack[stackSize++] = GetRoot();
+			}
+
+			while (stackSize > 0)
+			{
+				const auto nodeIndex = stack[--stackSize];
+				const auto& node = m_nodes[nodeIndex];
+				if constexpr (CollectsStatistics<Statistics>)
+				{
+					++statistics.quadtreeNodesVisited;
+				}
+
+				if (IsLeaf(nodeIndex))
+				{
+					for (auto element = node.first; element < node.first + node.count; ++element)
+					{
+						visit(element);
+					}
+					continue;
+				}
+
+				for (auto child = node.first + node.count; child-- > node.first; )
+				{
+					if (WindowIntersects(searchWindow, m_nodes[child].bounds))
+					{
+						Prefetch(&m_nodes[m_nodes[child].first]);
+						stack[stackSize++] = child;
+					}
+				}
+			}
+		}
+
+		template<typename Window, typename Visit>
+		void VisitLeaves(const Window& searchWindow, Visit&& visit) const
+		{
+			auto statistics = NoQueryStatistics{};
+			VisitLeaves(searchWindow, statistics, visit);
+		}
+
+		template<typename Window, QueryStatisticsCollector Statistics>
+		void Query(std::vector<R*>& result, const Window& searchWindow, Statistics& statistics)
+		{
+			const auto test = [&](R& element)
+				{
+					if constexpr (CollectsStatistics<Statistics>)
+					{
+						++statistics.listElementsTested;
+					}
+					if (WindowIntersects(searchWindow, GetBounds(element)))
+					{
+						if constexpr (CollectsStatistics<Statistics>)
+						{
+							++statistics.candidatesReturned;
+						}
+						result.push_back(&element);
+					}
+				};
+
+			VisitLeaves(searchWindow, statistics, [&](std::size_t element)
+				{
+					if (m_removed[element] == 0)
+					{
+						test(m_elements[element]);
+					}
+				});
+			for (auto& element : m_overflow)
+			{
+				test(element);
+			}
+		}
+
+		template<Rectangular<N> R2, typename Callback>
+		void JoinTrees(RTree<N, R2>& other, Callback& callback, bool parallel)
+		{
+			const auto sameTree = static_cast<const void*>(this) == static_cast<const void*>(&other);
+
+			if (!m_nodes.empty() && !other.m_nodes.empty())
+			{
+				if (parallel)
+				{
+					JoinRootsInParallel(other, callback, sameTree);
+				}
+				else
+				{
+					JoinNodes(GetRoot(), other, other.GetRoot(), callback, sameTree);
+				}
+			}
+
+			// Overflow elements are joined with everything in the other tree, pairs within one overflow list only once
+			for (std::size_t i = 0; i < m_overflow.size(); ++i)
+			{
+				auto& element = m_overflow[i];
+				const auto bounds = GetBounds(element);
+				other.VisitLeaves(bounds, [&](std::size_t otherElement)
+					{
+						if (other.m_removed[otherElement] == 0 && BoundsIntersect(bounds, other.GetBounds(other.m_elements[otherElement])))
+						{
+							callback(element, other.m_elements[otherElement]);
+						}
+					});
+				for (auto j = sameTree ? i + 1 : 0; j < other.m_overflow.size(); ++j)
+				{
+					if (BoundsIntersect(bounds, other.GetBounds(other.m_overflow[j])))
+					{
+						callback(element, other.m_overflow[j]);
+					}
+				}
+			}
+
+			if (sameTree)
+			{
+				return;
+			}
+			for (auto& otherElement : other.m_overflow)
+			{
+				const auto bounds = GetBounds(otherElement);
+				VisitLeaves(bounds, [&](std::size_t element)
+					{
+						if (m_removed[element] == 0 && BoundsIntersect(GetBounds(m_elements[element]), bounds))
+						{
+							callback(m_elements[element], otherElement);
+						}
+					});
+			}
+		}
+
+		template<Rectangular<N> R2, typename Callback>
+		void JoinRootsInParallel(RTree<N, R2>& other, Callback& callback, bool sameTree)
+		{
+			const auto root = GetRoot();
+			const auto otherRoot = other.GetRoot();
+			if (IsLeaf(root))
+			{
+				JoinNodes(root, other, otherRoot, callback, sameTree);
+				return;
+			}
+
+			auto pairs = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+			const auto& node = m_nodes[root];
+			for (auto child = node.first; child < node.first + node.count; ++child)
+			{
+				if (!sameTree)
+				{
+					pairs.emplace_back(child, otherRoot);
+					continue;
+				}
+				for (auto otherChild = child; otherChild < node.first + node.count; ++otherChild)
+				{
+					pairs.emplace_back(child, otherChild);
+				}
+			}
+
+			auto next = std::atomic<std::size_t>{ 0 };
+			const auto work = [&]()
+				{
+					for (auto i = next++; i < pairs.size(); i = next++)
+					{
+						JoinNodes(pairs[i].first, other, pairs[i].second, callback, sameTree);
+					}
+				};
+
+			const auto threads = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()), pairs.size());
+			auto tasks = std::vector<std::future<void>>{};
+			for (std::size_t i = 1; i < threads; ++i)
+			{
+				tasks.push_back(std::async(std::launch::async, work));
+			}
+			work();
+			for (auto& task : tasks)
+			{
+				task.get();
+			}
+		}
+
+		// Both trees have all leaves on one level, so descending the side that is not a leaf yet reaches
+		// every pair of leaves once. Within one tree only pairs of siblings in order are visited
+		template<Rectangular<N> R2, typename Callback>
+		void JoinNodes(std::uint32_t nodeIndex, RTree<N, R2>& other, std::uint32_t otherIndex, Callback& callback, bool sameTree)
+		{
+			const auto& node = m_nodes[nodeIndex];
+			const auto& otherNode = other.m_nodes[otherIndex];
+			if (!BoundsIntersect(node.bounds, otherNode.bounds))
+			{
+				return;
+			}
+
+			const auto sameNode = sameTree && nodeIndex == otherIndex;
+			const auto leaf = IsLeaf(nodeIndex);
+			const auto otherLeaf = other.IsLeaf(otherIndex);
+
+			if (leaf && otherLeaf)
+			{
+				for (auto i = node.first; i < node.first + node.count; ++i)
+				{
+					if (m_removed[i] != 0)
+					{
+						continue;
+					}
+					const auto bounds = GetBounds(m_elements[i]);
+					for (auto j = sameNode ? i + 1 : otherNode.first; j < otherNode.first + otherNode.count; ++j)
+					{
+						if (other.m_removed[j] == 0 && BoundsIntersect(bounds, other.GetBounds(other.m_elements[j])))
+						{
+							callback(m_elements[i], other.m_elements[j]);
+						}
+					}
+				}
+			}
+			else if (sameNode)
+			{
+				for (auto child = node.first; child < node.first + node.count; ++child)
+				{
+					for (auto otherChild = child; otherChild < node.first + node.count; ++otherChild)
+					{
+						JoinNodes(child, other, otherChild, callback, sameTree);
+					}
+				}
+			}
+			else if (!leaf)
+			{
+				for (auto child = node.first; child < node.first + node.count; ++child)
+				{
+					JoinNodes(child, other, otherIndex, callback, sameTree);
+				}
+			}
+			else
+			{
+				for (auto otherChild = otherNode.first; otherChild < otherNode.first + otherNode.count; ++otherChild)
+				{
+					JoinNodes(nodeIndex, other, otherChild, callback, sameTree);
+				}
+			}
+		}
+
+	private:
+		std::size_t m_nodeCapacity;
+		std::vector<Node> m_nodes;
+		// First node of every level, leaves are level 0 and come first
+		std::vector<std::size_t> m_levelBegins;
+		std::size_t m_leafCount = 0;
+		std::vector<R> m_elements;
+		std::vector<std::uint8_t> m_removed;
+		std::size_t m_removedCount = 0;
+		std::vector<R> m_overflow;
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <concepts>
+
+#include "Common.h"
+
+namespace quadtree
+{
+	template<typename T, typename N>
+	concept Rectangular = Numeric<N> && requires(T a)
+	{
+		{ a.GetCenterX() } -> std::convertible_to<N>;
+		{ a.GetCenterY() } -> std::convertible_to<N>;
+		{ a.GetHalfWidth() } -> std::convertible_to<N>;
+		{ a.GetHalfHeight() } -> std::convertible_to<N>;
+	};
+}
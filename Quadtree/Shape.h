@@ -0,0 +1,19 @@
+#pragma once
+
+#include <concepts>
+
+#include "Common.h"
+#include "Rectangle.h"
+#include "Rectangular.h"
+
+namespace quadtree
+{
+	// Non-rectangular search region. The bounding box is used to choose axis tree branches,
+	// IntersectsBox decides which cells are visited and which elements are returned
+	template<typename T, typename N>
+	concept Shape = Numeric<N> && requires(const T shape, N value)
+	{
+		{ shape.GetBoundingBox() } -> Rectangular<N>;
+		{ shape.IntersectsBox(value, value, value, value) } -> std::convertible_to<bool>;
+	};
+}
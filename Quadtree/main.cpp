@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <random>
+#include <thread>
+#include <vector>
 
 #include "Quadtree.h"
 #include "Rectangle.h"
@@ -64,18 +69,98 @@ int main()
 	const auto indexedArea = Rectangle<float>::Of(-100.0f, 100.0f, 200.0f, 200.0f);
 	auto quadtree = Quadtree<float, Rectangle<float>>{ indexedArea, 10 };
 
-	std::cout << "Inserting...\n";
+	using Clock = std::chrono::steady_clock;
+	const auto toMs = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
 
+	auto rectangles = std::vector<Rectangle<float>>{};
+	rectangles.reserve(10000000);
 	for (int i = 0; i < 10000000; ++i)
 	{
-		quadtree.Insert(RandomRectangle(indexedArea));
+		rectangles.push_back(RandomRectangle(indexedArea));
+	}
+
+	std::cout << "Inserting...\n";
+	const auto insertStart = Clock::now();
+	for (const auto& rectangle : rectangles)
+	{
+		quadtree.Insert(rectangle);
+	}
+	std::cout << "Sequential insert: " << toMs(Clock::now() - insertStart) << " ms\n";
+
+	std::cout << "Inserting in parallel...\n";
+	const auto maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	auto singleThreadTime = 0.0;
+	for (auto threads = 1u; ; threads = std::min(threads * 2, maxThreads))
+	{
+		auto parallel = Quadtree<float, Rectangle<float>>{ indexedArea, 10 };
+		const auto parallelStart = Clock::now();
+		parallel.ParallelInsert(std::span<const Rectangle<float>>{ rectangles }, threads);
+		const auto parallelTime = toMs(Clock::now() - parallelStart);
+		if (threads == 1)
+		{
+			singleThreadTime = parallelTime;
+		}
+		std::cout << "Parallel insert with " << threads << " threads: " << parallelTime << " ms, speedup " << singleThreadTime / parallelTime << "\n";
+
+		if (threads == maxThreads)
+		{
+			break;
+		}
 	}
 
+	auto windows = std::vector<Rectangle<float>>{};
 	for (int i = 0; i < 100; ++i)
 	{
-		std::cout << "Query " << (i + 1) << "...\n";
-		quadtree.Query(RandomRectangle(indexedArea, 2));
+		windows.push_back(RandomRectangle(indexedArea, 2));
 	}
 
+	std::cout << "Querying independently...\n";
+	auto independentResults = std::size_t{ 0 };
+	const auto independentStart = Clock::now();
+	for (const auto& window : windows)
+	{
+		independentResults += quadtree.Query(window).size();
+	}
+	const auto independentTime = Clock::now() - independentStart;
+
+	std::cout << "Querying in batch...\n";
+	const auto batchStart = Clock::now();
+	const auto batchResults = quadtree.QueryBatch(std::span<const Rectangle<float>>{ windows }).values.size();
+	const auto batchTime = Clock::now() - batchStart;
+
+	std::cout << "Independent: " << independentResults << " results in " << toMs(independentTime) << " ms\n";
+	std::cout << "Batch: " << batchResults << " results in " << toMs(batchTime) << " ms\n";
+
+	std::cout << "Joining...\n";
+	auto outer = Quadtree<float, Rectangle<float>>{ indexedArea, 10 };
+	auto outerRectangles = std::vector<Rectangle<float>>{};
+	for (int i = 0; i < 10000; ++i)
+	{
+		outerRectangles.push_back(RandomRectangle(indexedArea, 200));
+		outer.Insert(outerRectangles.back());
+	}
+
+	auto nestedPairs = std::size_t{ 0 };
+	const auto nestedStart = Clock::now();
+	for (const auto& rectangle : outerRectangles)
+	{
+		nestedPairs += quadtree.Query(rectangle).size();
+	}
+	const auto nestedTime = Clock::now() - nestedStart;
+
+	auto joinPairs = std::size_t{ 0 };
+	const auto joinStart = Clock::now();
+	outer.Join(quadtree, [&](const Rectangle<float>&, const Rectangle<float>&) { ++joinPairs; });
+	const auto joinTime = Clock::now() - joinStart;
+
+	auto parallelJoinPairs = std::atomic<std::size_t>{ 0 };
+	const auto parallelJoinStart = Clock::now();
+	outer.ParallelJoin(quadtree, [&](const Rectangle<float>&, const Rectangle<float>&) { ++parallelJoinPairs; });
+	const auto parallelJoinTime = Clock::now() - parallelJoinStart;
+
+	std::cout << "Nested queries: " << nestedPairs << " pairs in " << toMs(nestedTime) << " ms\n";
+	std::cout << "Join: " << joinPairs << " pairs in " << toMs(joinTime) << " ms\n";
+	std::cout << "Parallel join: " << parallelJoinPairs << " pairs in " << toMs(parallelJoinTime) << " ms\n";
+
 	return 0;
 }
@@ -0,0 +1,131 @@
+#include "Distributions.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr std::size_t HotSpotCount = 64;
+	constexpr double BackgroundFraction = 0.1;
+	constexpr float MaxUniformSide = 5e-4f;
+	constexpr float MinSkewedSide = 1e-5f;
+	// Pareto exponent of the skewed sides, below 2 the variance of the sizes is unbounded
+	constexpr double SkewedSideExponent = 1.2;
+}
+
+namespace benchmark
+{
+	const char* ToString(Distribution distribution)
+	{
+		switch (distribution)
+		{
+		case Distribution::Uniform:
+			return "uniform";
+		case Distribution::Clustered:
+			return "clustered";
+		case Distribution::SkewedSizes:
+			return "skewed";
+		case Distribution::Points:
+			return "points";
+		}
+		return "unknown";
+	}
+
+	std::optional<Distribution> ParseDistribution(std::string_view name)
+	{
+		for (const auto distribution : { Distribution::Uniform, Distribution::Clustered, Distribution::SkewedSizes, Distribution::Points })
+		{
+			if (name == ToString(distribution))
+			{
+				return distribution;
+			}
+		}
+		return std::nullopt;
+	}
+
+	ElementGenerator::ElementGenerator(Distribution distribution, const quadtree::Rectangle<float>& area, unsigned seed)
+		: m_distribution{ distribution }
+		, m_area{ area }
+		, m_random{ seed }
+	{
+		if (distribution != Distribution::Clustered)
+		{
+			return;
+		}
+
+		auto x = std::uniform_real_distribution<float>{ area.GetCenterX() - area.GetHalfWidth(), area.GetCenterX() + area.GetHalfWidth() };
+		auto y = std::uniform_real_distribution<float>{ area.GetCenterY() - area.GetHalfHeight(), area.GetCenterY() + area.GetHalfHeight() };
+		auto sigma = std::uniform_real_distribution<float>{ 0.002f, 0.03f };
+		for (std::size_t i = 0; i < HotSpotCount; ++i)
+		{
+			m_hotSpots.push_back(HotSpot{ x(m_random), y(m_random), sigma(m_random) * area.GetHalfWidth() * 2 });
+		}
+	}
+
+	void ElementGenerator::Generate(std::size_t count, std::vector<quadtree::Rectangle<float>>& elements)
+	{
+		elements.clear();
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto [x, y] = NextCenter();
+			const auto halfWidth = NextSide() / 2;
+			const auto halfHeight = m_distribution == Distribution::SkewedSizes ? NextSide() / 2 : halfWidth;
+			elements.push_back(quadtree::Rectangle<float>{ ClampX(x, halfWidth), ClampY(y, halfHeight), halfWidth, halfHeight });
+		}
+	}
+
+	std::vector<quadtree::Rectangle<float>> ElementGenerator::GenerateWindows(float relativeSide, std::size_t count)
+	{
+		auto windows = std::vector<quadtree::Rectangle<float>>{};
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto [x, y] = NextCenter();
+			windows.push_back(quadtree::Rectangle<float>{ x, y, m_area.GetHalfWidth() * relativeSide, m_area.GetHalfHeight() * relativeSide });
+		}
+		return windows;
+	}
+
+	std::pair<float, float> ElementGenerator::NextCenter()
+	{
+		auto unit = std::uniform_real_distribution<float>{ -1.0f, 1.0f };
+		if (m_distribution == Distribution::Clustered && std::uniform_real_distribution<double>{ 0.0, 1.0 }(m_random) >= BackgroundFraction)
+		{
+			const auto& hotSpot = m_hotSpots[std::uniform_int_distribution<std::size_t>{ 0, m_hotSpots.size() - 1 }(m_random)];
+			auto offset = std::normal_distribution<float>{ 0.0f, hotSpot.sigma };
+			return { ClampX(hotSpot.x + offset(m_random), 0.0f), ClampY(hotSpot.y + offset(m_random), 0.0f) };
+		}
+		return {
+			m_area.GetCenterX() + unit(m_random) * m_area.GetHalfWidth(),
+			m_area.GetCenterY() + unit(m_random) * m_area.GetHalfHeight()
+		};
+	}
+
+	// Sides are relative to the width of the area
+	float ElementGenerator::NextSide()
+	{
+		const auto areaSide = m_area.GetHalfWidth() * 2;
+		switch (m_distribution)
+		{
+		case Distribution::Points:
+			return 0.0f;
+		case Distribution::SkewedSizes:
+		{
+			const auto u = std::uniform_real_distribution<double>{ 0.0, 1.0 }(m_random);
+			const auto side = MinSkewedSide * std::pow(1.0 - u, -1.0 / SkewedSideExponent);
+			return static_cast<float>(std::min(side, 0.25)) * areaSide;
+		}
+		default:
+			return std::uniform_real_distribution<float>{ 0.0f, MaxUniformSide }(m_random) * areaSide;
+		}
+	}
+
+	float ElementGenerator::ClampX(float x, float halfWidth) const
+	{
+		return std::clamp(x, m_area.GetCenterX() - m_area.GetHalfWidth() + halfWidth, m_area.GetCenterX() + m_area.GetHalfWidth() - halfWidth);
+	}
+
+	float ElementGenerator::ClampY(float y, float halfHeight) const
+	{
+		return std::clamp(y, m_area.GetCenterY() - m_area.GetHalfHeight() + halfHeight, m_area.GetCenterY() + m_area.GetHalfHeight() - halfHeight);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../Quadtree/Rectangle.h"
+
+namespace benchmark
+{
+	enum class Distribution
+	{
+		// Centers uniform over the area, sides uniform up to a small fraction of it
+		Uniform,
+		// Centers around a fixed set of Gaussian hot spots over a thin uniform background
+		Clustered,
+		// Uniform centers with power-law sides, most elements are tiny and a few span large parts of the area
+		SkewedSizes,
+		// Uniform centers with zero-sized elements
+		Points
+	};
+
+	const char* ToString(Distribution distribution);
+
+	std::optional<Distribution> ParseDistribution(std::string_view name);
+
+	// Draws the elements of a distribution in chunks, so that large runs do not need to keep them outside the index
+	class ElementGenerator
+	{
+	public:
+		ElementGenerator(Distribution distribution, const quadtree::Rectangle<float>& area, unsigned seed);
+
+		// Replaces the contents of elements with the next count elements
+		void Generate(std::size_t count, std::vector<quadtree::Rectangle<float>>& elements);
+
+		// Query windows of the given side relative to the area, centered where the elements are dense
+		std::vector<quadtree::Rectangle<float>> GenerateWindows(float relativeSide, std::size_t count);
+
+	private:
+		struct HotSpot
+		{
+			float x;
+			float y;
+			float sigma;
+		};
+
+		std::pair<float, float> NextCenter();
+
+		float NextSide();
+
+		// Elements are kept inside the area, the quadtree would grow its root for any outside of it
+		float ClampX(float x, float halfWidth) const;
+
+		float ClampY(float y, float halfHeight) const;
+
+	private:
+		Distribution m_distribution;
+		quadtree::Rectangle<float> m_area;
+		std::mt19937_64 m_random;
+		std::vector<HotSpot> m_hotSpots;
+	};
+}
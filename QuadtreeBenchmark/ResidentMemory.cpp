@@ -0,0 +1,65 @@
+#include "ResidentMemory.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <fstream>
+#include <string>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace benchmark
+{
+#if defined(_WIN32)
+	std::size_t GetPeakResidentBytes()
+	{
+		auto counters = PROCESS_MEMORY_COUNTERS{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return 0;
+		}
+		return counters.PeakWorkingSetSize;
+	}
+
+	void ResetPeakResidentBytes() {}
+#elif defined(__linux__)
+	std::size_t GetPeakResidentBytes()
+	{
+		auto status = std::ifstream{ "/proc/self/status" };
+		auto line = std::string{};
+		while (std::getline(status, line))
+		{
+			if (line.starts_with("VmHWM:"))
+			{
+				return std::stoull(line.substr(6)) * 1024;
+			}
+		}
+		return 0;
+	}
+
+	void ResetPeakResidentBytes()
+	{
+		auto clearRefs = std::ofstream{ "/proc/self/clear_refs" };
+		clearRefs << "5";
+	}
+#else
+	std::size_t GetPeakResidentBytes()
+	{
+		auto usage = rusage{};
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		}
+#if defined(__APPLE__)
+		return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+		return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+
+	void ResetPeakResidentBytes() {}
+#endif
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+namespace benchmark
+{
+	// Peak resident set size of the process, 0 where it cannot be read
+	std::size_t GetPeakResidentBytes();
+
+	// Starts a new peak from the current resident set size. Only Linux supports this, elsewhere the peak
+	// covers the whole process and a single configuration per run gives exact numbers
+	void ResetPeakResidentBytes();
+}
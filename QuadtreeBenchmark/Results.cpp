@@ -0,0 +1,101 @@
+#include "Results.h"
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <tuple>
+
+namespace
+{
+	using Key = std::tuple<std::string, std::size_t, int, std::string>;
+
+	Key KeyOf(const benchmark::Measurement& measurement)
+	{
+		return Key{ measurement.distribution, measurement.count, measurement.maxDepth, measurement.metric };
+	}
+
+	bool ImprovesUpwards(const std::string& metric)
+	{
+		return metric.ends_with("_per_s");
+	}
+}
+
+namespace benchmark
+{
+	void WriteResults(std::ostream& out, const std::vector<Measurement>& measurements)
+	{
+		// Byte counts need more digits than the default precision
+		out << std::setprecision(12) << "distribution,count,max_depth,metric,value\n";
+		for (const auto& measurement : measurements)
+		{
+			out << measurement.distribution << ',' << measurement.count << ',' << measurement.maxDepth << ','
+				<< measurement.metric << ',' << measurement.value << '\n';
+		}
+	}
+
+	std::vector<Measurement> ReadResults(std::istream& in)
+	{
+		auto measurements = std::vector<Measurement>{};
+		auto line = std::string{};
+		std::getline(in, line);
+		while (std::getline(in, line))
+		{
+			if (line.empty())
+			{
+				continue;
+			}
+
+			auto fields = std::istringstream{ line };
+			auto measurement = Measurement{};
+			auto count = std::string{};
+			auto maxDepth = std::string{};
+			auto value = std::string{};
+			if (!std::getline(fields, measurement.distribution, ',') || !std::getline(fields, count, ',')
+				|| !std::getline(fields, maxDepth, ',') || !std::getline(fields, measurement.metric, ',') || !std::getline(fields, value))
+			{
+				throw std::runtime_error{ "Malformed benchmark result line: " + line };
+			}
+			measurement.count = std::stoull(count);
+			measurement.maxDepth = std::stoi(maxDepth);
+			measurement.value = std::stod(value);
+			measurements.push_back(std::move(measurement));
+		}
+		return measurements;
+	}
+
+	std::size_t CompareResults(
+		const std::vector<Measurement>& baseline,
+		const std::vector<Measurement>& current,
+		double tolerance,
+		std::ostream& out
+	)
+	{
+		auto baselineValues = std::map<Key, double>{};
+		for (const auto& measurement : baseline)
+		{
+			baselineValues[KeyOf(measurement)] = measurement.value;
+		}
+
+		auto regressions = std::size_t{ 0 };
+		for (const auto& measurement : current)
+		{
+			const auto found = baselineValues.find(KeyOf(measurement));
+			if (found == baselineValues.end() || found->second == 0.0)
+			{
+				continue;
+			}
+
+			const auto change = (measurement.value - found->second) / found->second;
+			const auto worse = ImprovesUpwards(measurement.metric) ? -change : change;
+			if (worse > tolerance)
+			{
+				++regressions;
+				out << "Regression: " << measurement.distribution << " n=" << measurement.count << " depth=" << measurement.maxDepth
+					<< " " << measurement.metric << " " << found->second << " -> " << measurement.value
+					<< " (" << (change > 0 ? "+" : "") << change * 100.0 << "%)\n";
+			}
+		}
+		return regressions;
+	}
+}
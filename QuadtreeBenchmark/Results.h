@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace benchmark
+{
+	// One value measured for one configuration. Metrics ending in "_per_s" improve upwards, all others downwards
+	struct Measurement
+	{
+		std::string distribution;
+		std::size_t count = 0;
+		int maxDepth = 0;
+		std::string metric;
+		double value = 0.0;
+	};
+
+	// CSV with a header line and one measurement per line, which diffs and loads into spreadsheets or pandas directly
+	void WriteResults(std::ostream& out, const std::vector<Measurement>& measurements);
+
+	std::vector<Measurement> ReadResults(std::istream& in);
+
+	// Prints the measurements that got worse than the baseline by more than the tolerance and returns how many did
+	std::size_t CompareResults(
+		const std::vector<Measurement>& baseline,
+		const std::vector<Measurement>& current,
+		double tolerance,
+		std::ostream& out
+	);
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Distributions.h"
+#include "ResidentMemory.h"
+#include "Results.h"
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace benchmark;
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr std::size_t ChunkSize = 1 << 20;
+	constexpr float AreaSide = 1000.0f;
+	constexpr float WindowSides[] = { 0.001f, 0.01f, 0.1f };
+
+	struct Options
+	{
+		std::vector<Distribution> distributions{ Distribution::Uniform, Distribution::Clustered, Distribution::SkewedSizes, Distribution::Points };
+		std::size_t minCount = 10000;
+		std::size_t maxCount = 100000000;
+		std::vector<int> depths{ 8, 10, 12 };
+		std::size_t queries = 1000;
+		unsigned seed = 1;
+		std::string csvFileName;
+		std::string baselineFileName;
+		double tolerance = 0.1;
+	};
+
+	std::vector<std::string> Split(std::string_view list)
+	{
+		auto items = std::vector<std::string>{};
+		auto stream = std::istringstream{ std::string{ list } };
+		auto item = std::string{};
+		while (std::getline(stream, item, ','))
+		{
+			items.push_back(item);
+		}
+		return items;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i + 1 < argc; i += 2)
+		{
+			const auto name = std::string_view{ argv[i] };
+			const auto value = std::string_view{ argv[i + 1] };
+			if (name == "--distributions")
+			{
+				options.distributions.clear();
+				for (const auto& item : Split(value))
+				{
+					const auto distribution = ParseDistribution(item);
+					if (!distribution)
+					{
+						return false;
+					}
+					options.distributions.push_back(*distribution);
+				}
+			}
+			else if (name == "--depths")
+			{
+				options.depths.clear();
+				for (const auto& item : Split(value))
+				{
+					options.depths.push_back(std::atoi(item.c_str()));
+				}
+			}
+			else if (name == "--min-count")
+			{
+				options.minCount = std::strtoull(argv[i + 1], nullptr, 10);
+			}
+			else if (name == "--max-count")
+			{
+				options.maxCount = std::strtoull(argv[i + 1], nullptr, 10);
+			}
+			else if (name == "--queries")
+			{
+				options.queries = std::strtoull(argv[i + 1], nullptr, 10);
+			}
+			else if (name == "--seed")
+			{
+				options.seed = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+			}
+			else if (name == "--csv")
+			{
+				options.csvFileName = value;
+			}
+			else if (name == "--baseline")
+			{
+				options.baselineFileName = value;
+			}
+			else if (name == "--tolerance")
+			{
+				options.tolerance = std::atof(argv[i + 1]);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return argc % 2 == 1 && options.minCount > 0 && options.queries > 0;
+	}
+
+	double Percentile(const std::vector<double>& sorted, double p)
+	{
+		return sorted[static_cast<std::size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1))];
+	}
+
+	std::string WindowMetric(float side, std::string_view percentile)
+	{
+		auto name = std::ostringstream{};
+		name << "query_" << side << "_" << percentile << "_us";
+		return name.str();
+	}
+
+	// Elements are generated in chunks outside the timed part, so the insert rate covers the quadtree only
+	void Run(Distribution distribution, std::size_t count, int maxDepth, const Options& options, std::vector<Measurement>& measurements)
+	{
+		ResetPeakResidentBytes();
+
+		const auto area = quadtree::Rectangle<float>{ 0.0f, 0.0f, AreaSide / 2, AreaSide / 2 };
+		auto generator = ElementGenerator{ distribution, area, options.seed };
+		auto quadtree = quadtree::Quadtree<float, quadtree::Rectangle<float>>{ area, maxDepth };
+
+		auto chunk = std::vector<quadtree::Rectangle<float>>{};
+		auto insertTime = Clock::duration{};
+		for (std::size_t inserted = 0; inserted < count; inserted += chunk.size())
+		{
+			generator.Generate(std::min(ChunkSize, count - inserted), chunk);
+			const auto start = Clock::now();
+			for (const auto& element : chunk)
+			{
+				quadtree.Insert(element);
+			}
+			insertTime += Clock::now() - start;
+		}
+		std::vector<quadtree::Rectangle<float>>{}.swap(chunk);
+
+		const auto add = [&](std::string metric, double value)
+			{
+				measurements.push_back(Measurement{ ToString(distribution), count, maxDepth, std::move(metric), value });
+			};
+		const auto insertsPerSecond = static_cast<double>(count) / std::chrono::duration<double>(insertTime).count();
+		const auto indexBytes = quadtree.GetStatistics().memory.GetTotalBytes();
+		add("insert_per_s", insertsPerSecond);
+		add("index_bytes", static_cast<double>(indexBytes));
+
+		std::cout << std::setw(9) << ToString(distribution) << " n=" << std::setw(9) << count << " depth=" << std::setw(2) << maxDepth
+			<< ": " << insertsPerSecond / 1e6 << " M inserts/s, index " << indexBytes / (1024 * 1024) << " MiB";
+
+		for (const auto side : WindowSides)
+		{
+			const auto windows = generator.GenerateWindows(side, options.queries);
+			auto latencies = std::vector<double>{};
+			auto results = std::size_t{ 0 };
+			for (const auto& window : windows)
+			{
+				const auto start = Clock::now();
+				results += quadtree.Query(window).size();
+				latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			}
+			std::sort(latencies.begin(), latencies.end());
+			add(WindowMetric(side, "p50"), Percentile(latencies, 50.0));
+			add(WindowMetric(side, "p90"), Percentile(latencies, 90.0));
+			add(WindowMetric(side, "p99"), Percentile(latencies, 99.0));
+			std::cout << ", window " << side << ": p50 " << Percentile(latencies, 50.0) << " us, p99 " << Percentile(latencies, 99.0)
+				<< " us (" << results / windows.size() << " results)";
+		}
+
+		const auto peakBytes = GetPeakResidentBytes();
+		add("peak_rss_bytes", static_cast<double>(peakBytes));
+		std::cout << ", peak RSS " << peakBytes / (1024 * 1024) << " MiB\n";
+	}
+}
+
+// Usage: QuadtreeBenchmark [--distributions uniform,clustered,skewed,points] [--min-count 10000] [--max-count 100000000]
+//     [--depths 8,10,12] [--queries 1000] [--seed 1] [--csv results.csv] [--baseline previous.csv] [--tolerance 0.1]
+// Counts grow tenfold from the minimum to the maximum. With a baseline, the exit code tells whether anything regressed
+int main(int argc, char** argv)
+{
+	auto options = Options{};
+	if (!ParseOptions(argc, argv, options))
+	{
+		std::cout << "Usage: QuadtreeBenchmark [--distributions uniform,clustered,skewed,points] [--min-count 10000] [--max-count 100000000]\n"
+			<< "    [--depths 8,10,12] [--queries 1000] [--seed 1] [--csv results.csv] [--baseline previous.csv] [--tolerance 0.1]\n";
+		return 1;
+	}
+
+	auto measurements = std::vector<Measurement>{};
+	for (auto count = options.minCount; count <= options.maxCount; count *= 10)
+	{
+		for (const auto distribution : options.distributions)
+		{
+			for (const auto maxDepth : options.depths)
+			{
+				Run(distribution, count, maxDepth, options, measurements);
+			}
+		}
+	}
+
+	if (!options.csvFileName.empty())
+	{
+		auto csv = std::ofstream{ options.csvFileName };
+		WriteResults(csv, measurements);
+	}
+
+	if (!options.baselineFileName.empty())
+	{
+		auto baselineFile = std::ifstream{ options.baselineFileName };
+		if (!baselineFile)
+		{
+			std::cout << "Cannot open " << options.baselineFileName << "\n";
+			return 1;
+		}
+		const auto regressions = CompareResults(ReadResults(baselineFile), measurements, options.tolerance, std::cout);
+		std::cout << regressions << " regressions beyond " << options.tolerance * 100.0 << "% against " << options.baselineFileName << "\n";
+		return regressions == 0 ? 0 : 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace quadtree;
+
+namespace
+{
+    Rectangle<float> RandomRectangle(std::mt19937& random, float maxHalfSide)
+    {
+        auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+        auto side = std::uniform_real_distribution<float>{ 0.01f, maxHalfSide };
+        return Rectangle<float>{ position(random), position(random), side(random), side(random) };
+    }
+}
+
+TEST(BatchQueryTest, MatchesIndependentQueries)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 6);
+
+    auto random = std::mt19937{ 42 };
+    for (int i = 0; i < 2000; ++i)
+    {
+        quadtree.Insert(RandomRectangle(random, 5.0f));
+    }
+
+    auto windows = std::vector<Rectangle<float>>{};
+    for (int i = 0; i < 50; ++i)
+    {
+        windows.push_back(RandomRectangle(random, 20.0f));
+    }
+
+    const auto batch = quadtree.QueryBatch(std::span<const Rectangle<float>>{ windows });
+    ASSERT_EQ(batch.size(), windows.size());
+
+    for (std::size_t i = 0; i < windows.size(); ++i)
+    {
+        auto expected = quadtree.Query(windows[i]);
+        auto actual = std::vector<Rectangle<float>*>(batch[i].begin(), batch[i].end());
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(actual, expected);
+    }
+}
+
+TEST(BatchQueryTest, EmptyBatch)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 4);
+    quadtree.Insert(Rectangle<float>{ 50.0f, 50.0f, 5.0f, 5.0f });
+
+    const auto batch = quadtree.QueryBatch(std::span<const Rectangle<float>>{});
+
+    EXPECT_EQ(batch.size(), 0);
+    EXPECT_TRUE(batch.values.empty());
+}
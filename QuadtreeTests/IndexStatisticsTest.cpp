@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace quadtree;
+
+TEST(IndexStatisticsTest, EmptyTree)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    const auto quadtree = Quadtree<float, Rectangle<float>>(area, 4);
+
+    const auto statistics = quadtree.GetStatistics();
+
+    EXPECT_EQ(statistics.elements, 0);
+    EXPECT_EQ(statistics.maxDepthReached, 1);
+    ASSERT_EQ(statistics.nodesPerDepth.size(), 1);
+    EXPECT_EQ(statistics.nodesPerDepth[0], 1);
+    EXPECT_EQ(statistics.axisLists, 0);
+    EXPECT_GT(statistics.memory.quadtreeNodeBytes, 0);
+    EXPECT_EQ(statistics.memory.listNodeBytes, 0);
+}
+
+TEST(IndexStatisticsTest, ElementsDistribution)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 4);
+
+    quadtree.Insert(Rectangle<float>{ 50.0f, 30.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 30.0f, 50.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 50.0f, 50.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 10.0f, 10.0f, 1.0f, 1.0f });
+
+    const auto statistics = quadtree.GetStatistics();
+
+    EXPECT_EQ(statistics.elements, 4);
+    EXPECT_EQ(quadtree.GetSize(), 4);
+    EXPECT_EQ(statistics.yAxisElements, 2);
+    EXPECT_EQ(statistics.xAxisElements, 2);
+    EXPECT_EQ(statistics.elementsPerDepth[0], 3);
+    EXPECT_GT(statistics.maxDepthReached, 1);
+    EXPECT_EQ(statistics.memory.listNodeBytes, quadtree.GetMemoryUsage().listNodeBytes);
+}
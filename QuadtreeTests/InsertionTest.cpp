@@ -1,5 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
 #include "../Quadtree/Quadtree.h"
 #include "../Quadtree/Rectangle.h"
 
@@ -234,3 +240,209 @@ TEST(QuadtreeTest, NestedElementsAreFoundCorrectly) {
         EXPECT_EQ(results.size(), 4);
     }
 }
+
+TEST(QuadtreeTest, ElementsOnAxesMatchBruteForce)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = quadtree::Quadtree<float, Rectangle<float>>(area, 8);
+
+    // Every element crosses the vertical center line, so all of them go into the root's axis tree
+    auto random = std::mt19937{ 7 };
+    auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+    auto side = std::uniform_real_distribution<float>{ 0.01f, 2.0f };
+    auto elements = std::vector<Rectangle<float>>{};
+    for (int i = 0; i < 500; ++i)
+    {
+        elements.push_back(Rectangle<float>{ 50.0f, position(random), side(random), side(random) });
+        quadtree.Insert(elements.back());
+    }
+
+    EXPECT_GT(quadtree.GetStatistics().axisLists, 1);
+
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto window = Rectangle<float>{ position(random), position(random), 4.0f * side(random), 4.0f * side(random) };
+
+        auto expected = std::vector<Rectangle<float>>{};
+        for (const auto& element : elements)
+        {
+            if (element.GetCenterX() - element.GetHalfWidth() <= window.GetCenterX() + window.GetHalfWidth()
+                && window.GetCenterX() - window.GetHalfWidth() <= element.GetCenterX() + element.GetHalfWidth()
+                && element.GetCenterY() - element.GetHalfHeight() <= window.GetCenterY() + window.GetHalfHeight()
+                && window.GetCenterY() - window.GetHalfHeight() <= element.GetCenterY() + element.GetHalfHeight())
+            {
+                expected.push_back(element);
+            }
+        }
+
+        EXPECT_EQ(quadtree.Query(window).size(), expected.size());
+    }
+}
+
+TEST(QuadtreeTest, RejectsUnsupportedDepth)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+
+    EXPECT_THROW((quadtree::Quadtree<float, Rectangle<float>>(area, 0)), std::invalid_argument);
+    EXPECT_THROW(
+        (quadtree::Quadtree<float, Rectangle<float>>(area, quadtree::Quadtree<float, Rectangle<float>>::MaxSupportedDepth + 1)),
+        std::invalid_argument
+    );
+}
+
+TEST(QuadtreeTest, RootGrowsTowardsOutOfBoundsElements)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = quadtree::Quadtree<float, Rectangle<float>>(area, 4);
+
+    const auto inside = Rectangle<float>{ 20.0f, 70.0f, 1.0f, 1.0f };
+    const auto onCenterLine = Rectangle<float>{ 50.0f, 30.0f, 5.0f, 1.0f };
+    quadtree.Insert(inside);
+    quadtree.Insert(onCenterLine);
+
+    const auto west = Rectangle<float>{ -30.0f, 40.0f, 2.0f, 2.0f };
+    const auto northEast = Rectangle<float>{ 380.0f, 250.0f, 2.0f, 2.0f };
+    quadtree.Insert(west);
+    quadtree.Insert(northEast);
+
+    const auto& grown = quadtree.GetIndexedArea();
+    EXPECT_LE(grown.GetCenterX() - grown.GetHalfWidth(), -32.0f);
+    EXPECT_GE(grown.GetCenterX() + grown.GetHalfWidth(), 382.0f);
+    EXPECT_GE(grown.GetCenterY() + grown.GetHalfHeight(), 252.0f);
+    EXPECT_GT(quadtree.GetMaxDepth(), 4);
+    EXPECT_EQ(quadtree.GetSize(), 4);
+
+    for (const auto& element : { inside, onCenterLine, west, northEast })
+    {
+        const auto results = quadtree.Query(Rectangle<float>{ element.GetCenterX(), element.GetCenterY(), 0.5f, 0.5f });
+        ASSERT_EQ(results.size(), 1);
+        EXPECT_EQ(*results[0], element);
+    }
+
+    EXPECT_EQ(quadtree.Query(Rectangle<float>{ 175.0f, 125.0f, 250.0f, 250.0f }).size(), 4);
+}
+
+TEST(QuadtreeTest, RootGrowthIsBounded)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 1.0f, 1.0f, 1.0f);
+    auto quadtree = quadtree::Quadtree<float, Rectangle<float>>(area, 60);
+
+    EXPECT_THROW(quadtree.Insert(Rectangle<float>{ 1.0e30f, 0.5f, 1.0f, 1.0f }), std::out_of_range);
+}
+
+TEST(QuadtreeTest, RemoveElements)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = quadtree::Quadtree<float, Rectangle<float>>(area, 4);
+
+    const auto small = Rectangle<float>{ 10.0f, 10.0f, 1.0f, 1.0f };
+    const auto onCenterLine = Rectangle<float>{ 50.0f, 20.0f, 5.0f, 1.0f };
+    const auto outside = Rectangle<float>{ 150.0f, 20.0f, 1.0f, 1.0f };
+    quadtree.Insert(small);
+    quadtree.Insert(small);
+    quadtree.Insert(onCenterLine);
+    quadtree.Insert(outside);
+
+    EXPECT_TRUE(quadtree.Remove(small));
+    EXPECT_EQ(quadtree.Query(small).size(), 1);
+    EXPECT_TRUE(quadtree.Remove(small));
+    EXPECT_FALSE(quadtree.Remove(small));
+    EXPECT_TRUE(quadtree.Remove(onCenterLine));
+    EXPECT_TRUE(quadtree.Remove(outside));
+
+    EXPECT_EQ(quadtree.GetSize(), 0);
+    EXPECT_TRUE(quadtree.Query(Rectangle<float>{ 100.0f, 50.0f, 100.0f, 100.0f }).empty());
+}
+
+TEST(QuadtreeTest, ParallelInsertMatchesSequentialInsert)
+{
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto sequential = quadtree::Quadtree<float, Rectangle<float>>(area, 8);
+    auto parallel = quadtree::Quadtree<float, Rectangle<float>>(area, 8);
+
+    // Some elements lie outside the area, so both trees have to grow
+    auto random = std::mt19937{ 11 };
+    auto position = std::uniform_real_distribution<float>{ -20.0f, 120.0f };
+    auto side = std::uniform_real_distribution<float>{ 0.01f, 3.0f };
+    auto elements = std::vector<Rectangle<float>>{};
+    for (int i = 0; i < 20000; ++i)
+    {
+        elements.push_back(Rectangle<float>{ position(random), position(random), side(random), side(random) });
+        sequential.Insert(elements.back());
+    }
+    parallel.ParallelInsert(std::span<const Rectangle<float>>{ elements }, 4);
+
+    EXPECT_EQ(parallel.GetSize(), sequential.GetSize());
+    EXPECT_EQ(parallel.GetMaxDepth(), sequential.GetMaxDepth());
+    EXPECT_EQ(parallel.GetMemoryUsage().quadtreeNodeBytes, sequential.GetMemoryUsage().quadtreeNodeBytes);
+    EXPECT_EQ(parallel.GetMemoryUsage().axisNodeBytes, sequential.GetMemoryUsage().axisNodeBytes);
+    EXPECT_EQ(parallel.GetStatistics().elements, elements.size());
+
+    const auto centers = [](const std::vector<Rectangle<float>*>& results)
+    {
+        auto values = std::vector<std::pair<float, float>>{};
+        for (const auto result : results)
+        {
+            values.emplace_back(result->GetCenterX(), result->GetCenterY());
+        }
+        std::sort(values.begin(), values.end());
+        return values;
+    };
+
+    for (int i = 0; i < 100; ++i)
+    {
+        const auto window = Rectangle<float>{ position(random), position(random), 5.0f * side(random), 5.0f * side(random) };
+        EXPECT_EQ(centers(parallel.Query(window)), centers(sequential.Query(window)));
+    }
+}
+
+TEST(QuadtreeTest, NodesComeFromTheMemoryResource)
+{
+    // Counts the bytes in use and hands out memory from the default resource
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        std::atomic<std::size_t> bytesInUse = 0;
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            bytesInUse += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+            bytesInUse -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    const auto area = quadtree::Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto resource = CountingResource{};
+    auto random = std::mt19937{ 13 };
+    auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+    auto elements = std::vector<Rectangle<float>>{};
+    for (int i = 0; i < 5000; ++i)
+    {
+        elements.push_back(Rectangle<float>{ position(random), position(random), 0.5f, 0.5f });
+    }
+
+    {
+        auto quadtree = quadtree::Quadtree<float, Rectangle<float>>(area, 8, &resource);
+        quadtree.ParallelInsert(std::span<const Rectangle<float>>{ elements }, 4);
+        quadtree.Insert(Rectangle<float>{ 150.0f, 50.0f, 1.0f, 1.0f });
+        EXPECT_TRUE(quadtree.Remove(elements.front()));
+        EXPECT_EQ(quadtree.GetSize(), elements.size());
+        EXPECT_EQ(resource.bytesInUse.load(), quadtree.GetMemoryUsage().GetTotalBytes());
+
+        auto moved = std::move(quadtree);
+        EXPECT_EQ(moved.Query(Rectangle<float>{ 150.0f, 50.0f, 1.0f, 1.0f }).size(), 1);
+    }
+    EXPECT_EQ(resource.bytesInUse.load(), 0);
+}
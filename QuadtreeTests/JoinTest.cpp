@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+#include "TestRectangles.h"
+
+using namespace quadtree;
+using namespace quadtree::test;
+
+namespace
+{
+    std::vector<Rectangle<float>*> Fill(Quadtree<float, Rectangle<float>>& quadtree, std::mt19937& random, int count)
+    {
+        auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+        auto side = std::uniform_real_distribution<float>{ 0.01f, 4.0f };
+        for (int i = 0; i < count; ++i)
+        {
+            quadtree.Insert(Rectangle<float>{ position(random), position(random), side(random), side(random) });
+        }
+        return quadtree.Query(Rectangle<float>{ 50.0f, 50.0f, 1000.0f, 1000.0f });
+    }
+}
+
+TEST(JoinTest, MatchesNestedLoop)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto random = std::mt19937{ 7 };
+    auto first = Quadtree<float, Rectangle<float>>(area, 6);
+    auto second = Quadtree<float, Rectangle<float>>(Rectangle<float>::Of(-10.0f, 90.0f, 120.0f, 100.0f), 5);
+    const auto firstElements = Fill(first, random, 500);
+    const auto secondElements = Fill(second, random, 500);
+
+    auto expected = std::set<Pair>{};
+    for (const auto r1 : firstElements)
+    {
+        for (const auto r2 : secondElements)
+        {
+            if (Intersect(*r1, *r2))
+            {
+                expected.insert({ r1, r2 });
+            }
+        }
+    }
+
+    auto actual = std::multiset<Pair>{};
+    first.Join(second, [&](Rectangle<float>& r1, Rectangle<float>& r2) { actual.insert({ &r1, &r2 }); });
+    EXPECT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(std::set<Pair>(actual.begin(), actual.end()), expected);
+
+    auto mutex = std::mutex{};
+    auto parallel = std::multiset<Pair>{};
+    first.ParallelJoin(second, [&](Rectangle<float>& r1, Rectangle<float>& r2)
+        {
+            const auto lock = std::lock_guard{ mutex };
+            parallel.insert({ &r1, &r2 });
+        });
+    EXPECT_EQ(parallel, actual);
+}
+
+TEST(JoinTest, SelfJoinReportsEachPairOnce)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto random = std::mt19937{ 11 };
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 6);
+    const auto elements = Fill(quadtree, random, 800);
+
+    auto expected = std::set<Pair>{};
+    for (std::size_t i = 0; i < elements.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < elements.size(); ++j)
+        {
+            if (Intersect(*elements[i], *elements[j]))
+            {
+                expected.insert(std::minmax<const Rectangle<float>*>(elements[i], elements[j]));
+            }
+        }
+    }
+
+    auto actual = std::multiset<Pair>{};
+    quadtree.SelfJoin([&](Rectangle<float>& r1, Rectangle<float>& r2)
+        {
+            EXPECT_NE(&r1, &r2);
+            actual.insert(std::minmax<const Rectangle<float>*>(&r1, &r2));
+        });
+
+    EXPECT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(std::set<Pair>(actual.begin(), actual.end()), expected);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../Quadtree/PointQuadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace quadtree;
+
+namespace
+{
+    std::vector<PointQuadtree<float>::Id> Ids(const std::vector<PointQuadtree<float>::Point>& points)
+    {
+        auto ids = std::vector<PointQuadtree<float>::Id>{};
+        for (const auto& point : points)
+        {
+            ids.push_back(point.id);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+}
+
+TEST(PointQuadtreeTest, QueryMatchesLinearScan)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = PointQuadtree<float>(area, 12, 4);
+
+    auto random = std::mt19937{ 3 };
+    auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+    auto points = std::vector<PointQuadtree<float>::Point>{};
+    for (PointQuadtree<float>::Id i = 0; i < 3000; ++i)
+    {
+        points.push_back({ position(random), position(random), i });
+        quadtree.Insert(points.back().x, points.back().y, i);
+    }
+    EXPECT_EQ(quadtree.GetSize(), points.size());
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const auto window = Rectangle<float>{ position(random), position(random), 10.0f, 5.0f };
+
+        auto expected = std::vector<PointQuadtree<float>::Point>{};
+        std::copy_if(points.begin(), points.end(), std::back_inserter(expected), [&](const auto& point)
+            {
+                return std::abs(point.x - window.GetCenterX()) <= window.GetHalfWidth()
+                    && std::abs(point.y - window.GetCenterY()) <= window.GetHalfHeight();
+            });
+
+        auto actual = std::vector<PointQuadtree<float>::Point>{};
+        quadtree.Query(window, actual);
+        EXPECT_EQ(Ids(actual), Ids(expected));
+    }
+}
+
+TEST(PointQuadtreeTest, DuplicatesAndRemoval)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = PointQuadtree<float>(area, 5, 2);
+
+    for (PointQuadtree<float>::Id i = 0; i < 10; ++i)
+    {
+        quadtree.Insert(25.0f, 25.0f, i);
+    }
+    quadtree.Insert(150.0f, 150.0f, 10);
+
+    auto result = std::vector<PointQuadtree<float>::Point>{};
+    quadtree.Query(Rectangle<float>{ 25.0f, 25.0f, 0.0f, 0.0f }, result);
+    EXPECT_EQ(result.size(), 10);
+
+    EXPECT_TRUE(quadtree.Remove(25.0f, 25.0f, 3));
+    EXPECT_FALSE(quadtree.Remove(25.0f, 25.0f, 3));
+
+    result.clear();
+    quadtree.Query(Rectangle<float>{ 50.0f, 50.0f, 200.0f, 200.0f }, result);
+    EXPECT_EQ(result.size(), 10);
+    EXPECT_EQ(quadtree.GetSize(), 10);
+}
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace quadtree;
+
+TEST(QueryStatisticsTest, CountsMatchResults)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 4);
+
+    quadtree.Insert(Rectangle<float>{ 10.0f, 10.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 20.0f, 20.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 80.0f, 80.0f, 5.0f, 5.0f });
+    quadtree.Insert(Rectangle<float>{ 50.0f, 50.0f, 40.0f, 40.0f });
+
+    auto statistics = QueryStatistics{};
+    const auto searchArea = Rectangle<float>{ 15.0f, 15.0f, 15.0f, 15.0f };
+    const auto results = quadtree.Query(searchArea, statistics);
+
+    EXPECT_EQ(results.size(), quadtree.Query(searchArea).size());
+    EXPECT_EQ(statistics.candidatesReturned, results.size());
+    EXPECT_GE(statistics.listElementsTested, statistics.candidatesReturned);
+    EXPECT_GE(statistics.quadtreeNodesVisited, 1);
+    EXPECT_GE(statistics.axisNodesVisited, 1);
+}
+
+TEST(QueryStatisticsTest, Accumulates)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 4);
+    quadtree.Insert(Rectangle<float>{ 50.0f, 50.0f, 5.0f, 5.0f });
+
+    auto total = QueryStatistics{};
+    for (int i = 0; i < 3; ++i)
+    {
+        auto statistics = QueryStatistics{};
+        quadtree.Query(Rectangle<float>{ 50.0f, 50.0f, 1.0f, 1.0f }, statistics);
+        total += statistics;
+    }
+
+    EXPECT_EQ(total.candidatesReturned, 3);
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../Quadtree/RTree.h"
+#include "../Quadtree/Rectangle.h"
+#include "TestRectangles.h"
+
+using namespace quadtree;
+using namespace quadtree::test;
+
+namespace
+{
+    // Mostly small elements with a few that are orders of magnitude larger
+    std::vector<Rectangle<float>> Generate(std::mt19937& random, int count)
+    {
+        auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+        auto side = std::uniform_real_distribution<float>{ 0.01f, 2.0f };
+        auto elements = std::vector<Rectangle<float>>{};
+        for (int i = 0; i < count; ++i)
+        {
+            const auto scale = i % 50 == 0 ? 20.0f : 1.0f;
+            elements.push_back(Rectangle<float>{ position(random), position(random), side(random) * scale, side(random) * scale });
+        }
+        return elements;
+    }
+
+    std::vector<Rectangle<float>> Sorted(const std::vector<Rectangle<float>*>& elements)
+    {
+        auto result = std::vector<Rectangle<float>>{};
+        for (const auto element : elements)
+        {
+            result.push_back(*element);
+        }
+        std::sort(result.begin(), result.end(), [](const Rectangle<float>& a, const Rectangle<float>& b)
+            {
+                return std::make_pair(a.GetCenterX(), a.GetCenterY()) < std::make_pair(b.GetCenterX(), b.GetCenterY());
+            });
+        return result;
+    }
+
+    std::vector<Rectangle<float>*> BruteForce(std::vector<Rectangle<float>>& elements, const Rectangle<float>& window)
+    {
+        auto result = std::vector<Rectangle<float>*>{};
+        for (auto& element : elements)
+        {
+            if (Intersect(element, window))
+            {
+                result.push_back(&element);
+            }
+        }
+        return result;
+    }
+}
+
+TEST(RTreeTest, QueryMatchesLinearScan)
+{
+    auto random = std::mt19937{ 3 };
+    auto elements = Generate(random, 5000);
+    auto rtree = RTree<float, Rectangle<float>>{ std::span<const Rectangle<float>>{ elements } };
+    EXPECT_EQ(rtree.GetSize(), elements.size());
+    EXPECT_GT(rtree.GetHeight(), 2u);
+
+    auto position = std::uniform_real_distribution<float>{ 0.0f, 100.0f };
+    auto side = std::uniform_real_distribution<float>{ 0.1f, 20.0f };
+    for (int i = 0; i < 200; ++i)
+    {
+        const auto window = Rectangle<float>{ position(random), position(random), side(random), side(random) };
+        EXPECT_EQ(Sorted(rtree.Query(window)), Sorted(BruteForce(elements, window)));
+    }
+}
+
+TEST(RTreeTest, InsertAndRemoveAfterBulkLoad)
+{
+    auto random = std::mt19937{ 5 };
+    auto elements = Generate(random, 2000);
+    auto rtree = RTree<float, Rectangle<float>>{ std::span<const Rectangle<float>>{ elements }.first(1000) };
+
+    // Enough inserts and removals to make the tree pack itself again in between
+    for (std::size_t i = 1000; i < elements.size(); ++i)
+    {
+        rtree.Insert(elements[i]);
+    }
+    for (std::size_t i = 0; i < elements.size(); i += 3)
+    {
+        EXPECT_TRUE(rtree.Remove(elements[i]));
+    }
+    EXPECT_FALSE(rtree.Remove(Rectangle<float>{ -50.0f, -50.0f, 1.0f, 1.0f }));
+
+    auto remaining = std::vector<Rectangle<float>>{};
+    for (std::size_t i = 0; i < elements.size(); ++i)
+    {
+        if (i % 3 != 0)
+        {
+            remaining.push_back(elements[i]);
+        }
+    }
+    EXPECT_EQ(rtree.GetSize(), remaining.size());
+
+    const auto window = Rectangle<float>{ 50.0f, 50.0f, 30.0f, 20.0f };
+    EXPECT_EQ(Sorted(rtree.Query(window)), Sorted(BruteForce(remaining, window)));
+}
+
+TEST(RTreeTest, SelfJoinReportsEachPairOnce)
+{
+    auto random = std::mt19937{ 11 };
+    const auto elements = Generate(random, 1500);
+    auto rtree = RTree<float, Rectangle<float>>{ std::span<const Rectangle<float>>{ elements }.first(1200) };
+    for (std::size_t i = 1200; i < elements.size(); ++i)
+    {
+        rtree.Insert(elements[i]);
+    }
+    const auto stored = rtree.Query(Rectangle<float>{ 50.0f, 50.0f, 1000.0f, 1000.0f });
+
+    auto expected = std::set<Pair>{};
+    for (std::size_t i = 0; i < stored.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < stored.size(); ++j)
+        {
+            if (Intersect(*stored[i], *stored[j]))
+            {
+                expected.insert(std::minmax<const Rectangle<float>*>(stored[i], stored[j]));
+            }
+        }
+    }
+
+    auto actual = std::multiset<Pair>{};
+    rtree.SelfJoin([&](Rectangle<float>& r1, Rectangle<float>& r2)
+        {
+            EXPECT_NE(&r1, &r2);
+            actual.insert(std::minmax<const Rectangle<float>*>(&r1, &r2));
+        });
+    EXPECT_EQ(actual.size(), expected.size());
+    EXPECT_EQ(std::set<Pair>(actual.begin(), actual.end()), expected);
+
+    auto mutex = std::mutex{};
+    auto parallel = std::multiset<Pair>{};
+    rtree.ParallelJoin(rtree, [&](Rectangle<float>& r1, Rectangle<float>& r2)
+        {
+            const auto lock = std::lock_guard{ mutex };
+            parallel.insert(std::minmax<const Rectangle<float>*>(&r1, &r2));
+        });
+    EXPECT_EQ(parallel, actual);
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Quadtree/Quadtree.h"
+#include "../Quadtree/Rectangle.h"
+
+using namespace quadtree;
+
+namespace
+{
+    class Disc
+    {
+    public:
+        Disc(float x, float y, float radius)
+            : m_x{ x }
+            , m_y{ y }
+            , m_radius{ radius }
+        { }
+
+        Rectangle<float> GetBoundingBox() const
+        {
+            return Rectangle<float>{ m_x, m_y, m_radius, m_radius };
+        }
+
+        bool IntersectsBox(float minX, float minY, float maxX, float maxY) const
+        {
+            const auto dx = std::max({ minX - m_x, 0.0f, m_x - maxX });
+            const auto dy = std::max({ minY - m_y, 0.0f, m_y - maxY });
+            return std::hypot(dx, dy) <= m_radius;
+        }
+
+    private:
+        float m_x;
+        float m_y;
+        float m_radius;
+    };
+}
+
+TEST(ShapeQueryTest, PrunesBoxCornersOutsideShape)
+{
+    const auto area = Rectangle<float>::Of(0.0f, 100.0f, 100.0f, 100.0f);
+    auto quadtree = Quadtree<float, Rectangle<float>>(area, 5);
+
+    quadtree.Insert(Rectangle<float>{ 50.0f, 50.0f, 1.0f, 1.0f });
+    quadtree.Insert(Rectangle<float>{ 58.0f, 58.0f, 1.0f, 1.0f });
+    quadtree.Insert(Rectangle<float>{ 59.0f, 50.0f, 1.0f, 1.0f });
+
+    const auto disc = Disc{ 50.0f, 50.0f, 9.0f };
+
+    EXPECT_EQ(quadtree.Query(disc.GetBoundingBox()).size(), 3);
+    EXPECT_EQ(quadtree.Query(disc).size(), 2);
+}
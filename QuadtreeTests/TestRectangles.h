@@ -0,0 +1,19 @@
+#pragma once
+
+#include <utility>
+
+#include "../Quadtree/Rectangle.h"
+
+// Brute-force references shared by the join tests of both indexes
+namespace quadtree::test
+{
+    using Pair = std::pair<const Rectangle<float>*, const Rectangle<float>*>;
+
+    inline bool Intersect(const Rectangle<float>& r1, const Rectangle<float>& r2)
+    {
+        return r1.GetCenterX() - r1.GetHalfWidth() <= r2.GetCenterX() + r2.GetHalfWidth()
+            && r2.GetCenterX() - r2.GetHalfWidth() <= r1.GetCenterX() + r1.GetHalfWidth()
+            && r1.GetCenterY() - r1.GetHalfHeight() <= r2.GetCenterY() + r2.GetHalfHeight()
+            && r2.GetCenterY() - r2.GetHalfHeight() <= r1.GetCenterY() + r1.GetHalfHeight();
+    }
+}